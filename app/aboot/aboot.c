@@ -45,6 +45,7 @@
 
 #include <dev/flash.h>
 #include <lib/ptable.h>
+#include <lib/heap.h>
 #include <dev/keys.h>
 #include <dev/fbcon.h>
 #include <baseband.h>
@@ -60,6 +61,9 @@
 #include <platform/msm_shared.h>
 #include <boot_device.h>
 #include <boot_verifier.h>
+#include <err.h>
+#include <lib/decompress.h>
+#include <lib/pixel.h>
 #if WITH_APP_DISPLAY_SERVER
 #include <app/display_server.h>
 #endif
@@ -82,6 +86,7 @@
 #include "bootimg.h"
 #include "fastboot.h"
 #include "sparse_format.h"
+#include "sparse_stream.h"
 #include "mmc.h"
 #include "devinfo.h"
 #include "board.h"
@@ -99,6 +104,7 @@ extern uint32_t mmc_get_device_blocksize(void);
 void write_device_info_mmc(device_info *dev);
 void write_device_info_flash(device_info *dev);
 static int aboot_save_boot_hash_mmc(uint32_t image_addr, uint32_t image_size);
+static int aboot_save_boot_hash_iov(iovec_t *iov, uint32_t iov_cnt);
 
 #define EXPAND(NAME) #NAME
 
@@ -697,6 +703,9 @@ void boot_linux(void *kernel, unsigned *tags,
 	display_server_stop();
 #endif
 
+	/* the kernel takes the uart over, don't leave log output queued */
+	platform_dflush();
+
 	enter_critical_section();
 
 	/* do any platform specific cleanup before kernel entry */
@@ -739,6 +748,24 @@ int check_aboot_addr_range_overlap(uint32_t start, uint32_t size)
 
 #define ROUND_TO_PAGE(x,y) (((x) + (y)) & (~(y)))
 
+/* Header page, kernel, ramdisk & the rest of the boot image */
+#define BOOT_IMG_IOV_CNT 4
+
+/* Boot image reads overlapped with hashing */
+#define BOOT_IMG_READ_CHUNK (1024 * 1024)
+#define BOOT_IMG_READ_DEPTH 2
+
+#if IMAGE_VERIF_ALGO_SHA1 && !VERIFIED_BOOT
+#define BOOT_IMG_HASH_ALGO CRYPTO_AUTH_ALG_SHA1
+#else
+#define BOOT_IMG_HASH_ALGO CRYPTO_AUTH_ALG_SHA256
+#endif
+
+static bool addr_range_overlap(uint32_t start1, uint32_t size1, uint32_t start2, uint32_t size2)
+{
+	return (start1 < start2 + size2) && (start2 < start1 + size1);
+}
+
 BUF_DMA_ALIGN(buf, BOOT_IMG_MAX_PAGE_SIZE); //Equal to max-supported pagesize
 #if DEVICE_TREE
 BUF_DMA_ALIGN(dt_buf, BOOT_IMG_MAX_PAGE_SIZE);
@@ -821,37 +848,51 @@ out:
 }
 #endif
 
-static void verify_signed_bootimg(uint32_t bootimg_addr, uint32_t bootimg_size)
+/*
+ * Authenticate a boot image whose pieces are scattered over the buffers
+ * of iov, the signature covers the pieces in iovec order. If hashed is
+ * set, the pieces were already fed to the hash by boot_img_read_hashed.
+ */
+static void verify_signed_bootimg_iov(iovec_t *iov, uint32_t iov_cnt, unsigned char *sig_addr,
+		bool hashed)
 {
 	int ret;
-#if IMAGE_VERIF_ALGO_SHA1
-	uint32_t auth_algo = CRYPTO_AUTH_ALG_SHA1;
-#else
-	uint32_t auth_algo = CRYPTO_AUTH_ALG_SHA256;
+	uint32_t auth_algo = BOOT_IMG_HASH_ALGO;
+#if !VERIFIED_BOOT
+	unsigned int digest[8];
 #endif
 
 	/* Assume device is rooted at this time. */
 	device.is_tampered = 1;
 
-	dprintf(INFO, "Authenticating boot image (%d): start\n", bootimg_size);
+	dprintf(INFO, "Authenticating boot image (%d): start\n", (int) iovec_size(iov, iov_cnt));
 
 #if VERIFIED_BOOT
+	/* Verified boot appends the signed attributes to the image in place */
+	ASSERT(iov_cnt == 1);
+
+	if (hashed)
+		boot_verify_image_hashed(iov[0].iov_len);
+
 	if(boot_into_recovery)
 	{
-		ret = boot_verify_image((unsigned char *)bootimg_addr,
-				bootimg_size, "recovery");
+		ret = boot_verify_image((unsigned char *)iov[0].iov_base,
+				iov[0].iov_len, "recovery");
 	}
 	else
 	{
-		ret = boot_verify_image((unsigned char *)bootimg_addr,
-				bootimg_size, "boot");
+		ret = boot_verify_image((unsigned char *)iov[0].iov_base,
+				iov[0].iov_len, "boot");
 	}
 	boot_verify_print_state();
 #else
-	ret = image_verify((unsigned char *)bootimg_addr,
-					   (unsigned char *)(bootimg_addr + bootimg_size),
-					   bootimg_size,
-					   auth_algo);
+	if (hashed)
+	{
+		image_finish_digest(auth_algo, (unsigned char *)&digest);
+		ret = image_verify_digest((unsigned char *)&digest, sig_addr, auth_algo);
+	}
+	else
+		ret = image_verify_iov(iov, iov_cnt, sig_addr, auth_algo);
 #endif
 	dprintf(INFO, "Authenticating boot image: done return value = %d\n", ret);
 
@@ -897,6 +938,234 @@ static void verify_signed_bootimg(uint32_t bootimg_addr, uint32_t bootimg_size)
 #endif
 }
 
+static void verify_signed_bootimg(uint32_t bootimg_addr, uint32_t bootimg_size)
+{
+	iovec_t iov = { (void *)bootimg_addr, bootimg_size };
+
+	verify_signed_bootimg_iov(&iov, 1, (unsigned char *)(bootimg_addr + bootimg_size), false);
+}
+
+/*
+ * Function: boot img read hashed
+ * Arg     : Partition offset, buffers to read the boot image to & number
+ *           of bytes of the image covered by the signature
+ * Return  : 0 on success, -1 on failure
+ * Flow    : Read the image in BOOT_IMG_READ_CHUNK pieces with up to
+ *           BOOT_IMG_READ_DEPTH reads queued. Each piece is fed to the
+ *           hash as soon as it is read, while the next one is on the
+ *           bus, so the hash is mostly done when the last read completes.
+ *           The caller completes the digest.
+ */
+static int boot_img_read_hashed(unsigned long long ptn, iovec_t *iov, uint32_t iov_cnt,
+		unsigned hash_len)
+{
+	struct mmc_io_req req[BOOT_IMG_READ_DEPTH];
+	unsigned char *chunk[BOOT_IMG_READ_DEPTH];
+	unsigned chunk_len[BOOT_IMG_READ_DEPTH];
+	unsigned submitted = 0;
+	unsigned completed = 0;
+	unsigned hashed = 0;
+	unsigned pos = 0;
+	unsigned len;
+	uint32_t slot;
+	uint32_t i = 0;
+	int ret = 0;
+
+	hash_start(BOOT_IMG_HASH_ALGO);
+
+	do {
+		/* Keep the read queue full */
+		while (!ret && (i < iov_cnt) && (submitted - completed < BOOT_IMG_READ_DEPTH))
+		{
+			len = MIN(iov[i].iov_len - pos, BOOT_IMG_READ_CHUNK);
+
+			if (len)
+			{
+				slot = submitted % BOOT_IMG_READ_DEPTH;
+				chunk[slot] = (unsigned char *) iov[i].iov_base + pos;
+				chunk_len[slot] = len;
+
+				/* A failure shows up in the request status */
+				mmc_read_async(&req[slot], ptn, (uint32_t *) chunk[slot], len);
+
+				submitted++;
+				ptn += len;
+				pos += len;
+			}
+
+			if (pos == iov[i].iov_len)
+			{
+				pos = 0;
+				i++;
+			}
+		}
+
+		if (completed == submitted)
+			break;
+
+		slot = completed % BOOT_IMG_READ_DEPTH;
+		if (mmc_io_wait(&req[slot]))
+			ret = -1;
+		completed++;
+
+		if (!ret && (hashed < hash_len))
+		{
+			len = MIN(chunk_len[slot], hash_len - hashed);
+			hash_update(chunk[slot], len);
+			hashed += len;
+		}
+	} while (1);
+
+	return ret;
+}
+
+/*
+ * Function: boot img scatter list
+ * Arg     : Boot image header, scratch address, kernel & ramdisk sizes
+ *           rounded to pages & length of the data after the ramdisk
+ * Return  : Number of iovec entries filled in iov, 0 if the image can
+ *           not be loaded in place
+ * Flow    : Describe the boot image on storage as the list of the buffers
+ *           it should be read to: the header page & the data after the
+ *           ramdisk go to the scratch region, the kernel & the ramdisk
+ *           straight to their load addresses.
+ */
+static uint32_t boot_img_scatter_list(struct boot_img_hdr *hdr, unsigned char *image_addr,
+		unsigned kernel_actual, unsigned ramdisk_actual, unsigned rest_len, iovec_t *iov)
+{
+#if VERIFIED_BOOT
+	/* boot_verify_image needs the whole image in one buffer */
+	return 0;
+#else
+	addr_t scratch = (addr_t) image_addr;
+	unsigned scratch_len = page_size + rest_len;
+
+	/* Every piece has to start on a block boundary on storage */
+	if (page_size % mmc_get_device_blocksize())
+		return 0;
+
+	/* Read buffers have to be cache line aligned */
+	if (!IS_CACHE_LINE_ALIGNED(hdr->kernel_addr) || !IS_CACHE_LINE_ALIGNED(hdr->ramdisk_addr))
+		return 0;
+
+	if (addr_range_overlap(hdr->kernel_addr, kernel_actual, hdr->ramdisk_addr, ramdisk_actual) ||
+		addr_range_overlap(hdr->kernel_addr, kernel_actual, scratch, scratch_len) ||
+		addr_range_overlap(hdr->ramdisk_addr, ramdisk_actual, scratch, scratch_len))
+		return 0;
+
+	iov[0].iov_base = image_addr;
+	iov[0].iov_len = page_size;
+	iov[1].iov_base = (void *) hdr->kernel_addr;
+	iov[1].iov_len = kernel_actual;
+	iov[2].iov_base = (void *) hdr->ramdisk_addr;
+	iov[2].iov_len = ramdisk_actual;
+	iov[3].iov_base = image_addr + page_size;
+	iov[3].iov_len = rest_len;
+
+	return BOOT_IMG_IOV_CNT;
+#endif
+}
+
+/*
+ * Function: kernel_is_arm64
+ * Arg     : start of the kernel as stored in the image, bytes available
+ *           there, its compression
+ * Return  : true if the kernel carries an arm64 Image header
+ * Flow    : A compressed kernel is inflated just far enough to see the
+ *           header, from the page already read.
+ */
+static bool kernel_is_arm64(void *kernel, unsigned len, enum decompress_type ktype)
+{
+	struct kernel64_hdr khdr;
+	size_t out_len;
+
+	if (ktype == DECOMPRESS_NONE)
+		return IS_ARM64(((struct kernel64_hdr *) kernel));
+
+	/* the stream is cut short, only the prefix matters */
+	decompress(kernel, len, &khdr, sizeof(khdr), &out_len, NULL);
+	if (out_len < sizeof(khdr))
+		return false;
+
+	return IS_ARM64((&khdr));
+}
+
+/*
+ * Function: boot_img_load_kernel
+ * Arg     : boot image header, the kernel as stored in the image & its
+ *           compression, the buffer holding the image, length of the
+ *           compressed stream (out)
+ * Return  : 0 on success, -1 on failure
+ * Flow    : Move the kernel to kernel_addr, inflating it on the way if the
+ *           image carries a gzip or lz4 kernel. The decompressed kernel may
+ *           not run into the ramdisk, the tags, the image buffer or aboot.
+ */
+static int boot_img_load_kernel(struct boot_img_hdr *hdr, void *kernel,
+		enum decompress_type ktype, addr_t scratch, unsigned scratch_len,
+		unsigned *stream_len)
+{
+	addr_t bounds[] = { hdr->ramdisk_addr, hdr->tags_addr, scratch, MEMBASE };
+	addr_t end = UINT_MAX;
+	size_t out_len, in_used;
+	time_t start;
+	unsigned i;
+	status_t err;
+
+	if (ktype == DECOMPRESS_NONE) {
+		memmove((void*) hdr->kernel_addr, kernel, hdr->kernel_size);
+		*stream_len = hdr->kernel_size;
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(bounds); i++)
+		if (bounds[i] > hdr->kernel_addr && bounds[i] < end)
+			end = bounds[i];
+
+	/* the image may still be loading behind the kernel, stay off all of it */
+	if (addr_range_overlap(hdr->kernel_addr, end - hdr->kernel_addr, scratch, scratch_len)) {
+		dprintf(CRITICAL, "ERROR: Kernel address overlaps the boot image buffer\n");
+		return -1;
+	}
+
+	start = current_time();
+	err = decompress(kernel, hdr->kernel_size, (void*) hdr->kernel_addr,
+			 end - hdr->kernel_addr, &out_len, &in_used);
+	if (err != NO_ERROR) {
+		dprintf(CRITICAL, "ERROR: Cannot decompress %s kernel (%d)\n",
+			decompress_type_name(ktype), err);
+		return -1;
+	}
+
+	dprintf(INFO, "Kernel decompressed (%s): %u -> %u bytes in %u ms\n",
+		decompress_type_name(ktype), hdr->kernel_size, (unsigned) out_len,
+		(unsigned) (current_time() - start));
+
+	*stream_len = in_used;
+	return 0;
+}
+
+#if DEVICE_TREE
+/*
+ * Function: boot_img_dev_tree_appended
+ * Arg     : boot image header, the kernel as stored in the image & its
+ *           compression, bytes to scan for an uncompressed kernel, length
+ *           of the compressed stream
+ * Return  : DTB address if an appended device tree is found, NULL otherwise
+ * Flow    : The device trees follow what is stored in the image, so for
+ *           a compressed kernel they are searched right after the stream.
+ */
+static void *boot_img_dev_tree_appended(struct boot_img_hdr *hdr, void *kernel,
+		enum decompress_type ktype, unsigned kernel_len, unsigned stream_len)
+{
+	if (ktype == DECOMPRESS_NONE)
+		return dev_tree_appended((void*) hdr->kernel_addr, kernel_len,
+					 (void *)hdr->tags_addr);
+
+	return dev_tree_appended_at(kernel, hdr->kernel_size, stream_len,
+				    (void *)hdr->tags_addr);
+}
+#endif
+
 static bool check_format_bit(void)
 {
 	bool ret = false;
@@ -980,6 +1249,14 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 	unsigned ramdisk_actual;
 	unsigned imagesize_actual;
 	unsigned second_actual __UNUSED = 0;
+	struct mmc_io_req img_req[2];
+	iovec_t img_iov[BOOT_IMG_IOV_CNT];
+	uint32_t iov_cnt;
+	unsigned rest_len;
+	unsigned char *rest_addr __UNUSED = 0;
+	bool in_place;
+	enum decompress_type ktype;
+	unsigned kernel_stream __UNUSED = 0;
 
 #if DEVICE_TREE
 	struct dt_table *table;
@@ -1108,12 +1385,16 @@ int boot_linux_from_mmc(enum bootmode bootmode)
                 return -1;
 	}
 
+	ktype = decompress_detect(kbuf, page_size);
+	if (ktype != DECOMPRESS_NONE)
+		dprintf(INFO, "Kernel is %s compressed\n", decompress_type_name(ktype));
+
 	/*
 	 * Update the kernel/ramdisk/tags address if the boot image header
 	 * has default values, these default values come from mkbootimg when
 	 * the boot image is flashed using fastboot flash:raw
 	 */
-	update_ker_tags_rdisk_addr(hdr, IS_ARM64(kptr));
+	update_ker_tags_rdisk_addr(hdr, kernel_is_arm64(kptr, page_size, ktype));
 
 	/* Get virtual addresses since the hdr saves physical addresses. */
 	hdr->kernel_addr = VA((addr_t)(hdr->kernel_addr));
@@ -1193,8 +1474,32 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 			return -1;
 		}
 
-		/* Read image without signature */
-		if (mmc_read(ptn + offset, (void *)image_addr, imagesize_actual))
+		if (check_aboot_addr_range_overlap((unsigned)image_addr + imagesize_actual, page_size))
+		{
+			dprintf(CRITICAL, "Signature read buffer address overlaps with aboot addresses.\n");
+			return -1;
+		}
+
+		rest_len = imagesize_actual - page_size - kernel_actual - ramdisk_actual;
+
+		/* Read the image & the signature in place if the layout allows,
+		 * a compressed kernel is inflated out of the scratch region */
+		iov_cnt = 0;
+		if (ktype == DECOMPRESS_NONE)
+			iov_cnt = boot_img_scatter_list(hdr, image_addr, kernel_actual, ramdisk_actual,
+							rest_len + page_size, img_iov);
+		in_place = !!iov_cnt;
+		if (in_place)
+			rest_addr = image_addr + page_size;
+		else
+		{
+			img_iov[0].iov_base = image_addr;
+			img_iov[0].iov_len = imagesize_actual + page_size;
+			iov_cnt = 1;
+			rest_addr = image_addr + page_size + kernel_actual + ramdisk_actual;
+		}
+
+		if (boot_img_read_hashed(ptn + offset, img_iov, iov_cnt, imagesize_actual))
 		{
 			dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
 				return -1;
@@ -1203,30 +1508,23 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 		dprintf(INFO, "Loading boot image (%d): done\n", imagesize_actual);
 		bs_set_timestamp(BS_KERNEL_LOAD_DONE);
 
-		offset = imagesize_actual;
+		/* The signature is not part of the signed data */
+		img_iov[iov_cnt - 1].iov_len -= page_size;
 
-		if (check_aboot_addr_range_overlap((unsigned)image_addr + offset, page_size))
-		{
-			dprintf(CRITICAL, "Signature read buffer address overlaps with aboot addresses.\n");
-			return -1;
-		}
+		verify_signed_bootimg_iov(img_iov, iov_cnt, rest_addr + rest_len, true);
 
-		/* Read signature */
-		if(mmc_read(ptn + offset, (void *)(image_addr + offset), page_size))
+		if (!in_place)
 		{
-			dprintf(CRITICAL, "ERROR: Cannot read boot image signature\n");
-			return -1;
+			/* Move kernel, ramdisk and device tree to correct address */
+			if (boot_img_load_kernel(hdr, image_addr + page_size, ktype, (addr_t) image_addr,
+						 imagesize_actual + page_size, &kernel_stream))
+				return -1;
+			memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
 		}
 
-		verify_signed_bootimg((unsigned)image_addr, imagesize_actual);
-
-		/* Move kernel, ramdisk and device tree to correct address */
-		memmove((void*) hdr->kernel_addr, (char *)(image_addr + page_size), hdr->kernel_size);
-		memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
-
 		#if DEVICE_TREE
 		if(hdr->dt_size) {
-			dt_table_offset = ((uint32_t)image_addr + page_size + kernel_actual + ramdisk_actual + second_actual);
+			dt_table_offset = ((uint32_t)rest_addr + second_actual);
 			table = (struct dt_table*) dt_table_offset;
 
 			if (dev_tree_validate(table, hdr->page_size, &dt_hdr_size) != 0) {
@@ -1255,9 +1553,8 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 			 * Else update with the atags address in the kernel header
 			 */
 			void *dtb;
-			dtb = dev_tree_appended((void*) hdr->kernel_addr,
-						hdr->kernel_size,
-						(void *)hdr->tags_addr);
+			dtb = boot_img_dev_tree_appended(hdr, image_addr + page_size, ktype,
+						hdr->kernel_size, kernel_stream);
 			if (!dtb) {
 				dprintf(CRITICAL, "ERROR: Appended Device Tree Blob not found\n");
 #if !DEVICE_TREE_FALLBACK
@@ -1306,28 +1603,107 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 		bs_set_timestamp(BS_KERNEL_LOAD_START);
 
 		offset = 0;
+		rest_len = imagesize_actual - page_size - kernel_actual - ramdisk_actual;
+
+		/* Read the kernel & ramdisk in place if the layout allows,
+		 * a compressed kernel is inflated out of the scratch region */
+		iov_cnt = 0;
+		if (ktype == DECOMPRESS_NONE)
+			iov_cnt = boot_img_scatter_list(hdr, image_addr, kernel_actual, ramdisk_actual,
+							rest_len, img_iov);
+		if (iov_cnt)
+		{
+			if (mmc_read_iovec(ptn + offset, img_iov, iov_cnt)) {
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
 
-		/* Load the entire boot image */
-		if (mmc_read(ptn + offset, (void *)image_addr, imagesize_actual)) {
-			dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
-					return -1;
+			dprintf(INFO, "Loading boot image (%d): done\n",
+					imagesize_actual);
+			bs_set_timestamp(BS_KERNEL_LOAD_DONE);
+
+			#ifdef TZ_SAVE_KERNEL_HASH
+			aboot_save_boot_hash_iov(img_iov, iov_cnt);
+			#endif /* TZ_SAVE_KERNEL_HASH */
+
+			rest_addr = image_addr + page_size;
 		}
+		else
+		{
+			/*
+			 * Load the entire boot image, queue the header & kernel and
+			 * the rest of the image as separate requests so the kernel
+			 * can be moved while the ramdisk and device tree are loading
+			 */
+			if (mmc_read_async(&img_req[0], ptn + offset, (void *)image_addr,
+							   page_size + kernel_actual)) {
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
 
-		dprintf(INFO, "Loading boot image (%d): done\n",
-				imagesize_actual);
-		bs_set_timestamp(BS_KERNEL_LOAD_DONE);
+			if (mmc_read_async(&img_req[1], ptn + offset + page_size + kernel_actual,
+						   (void *)(image_addr + page_size + kernel_actual),
+						   imagesize_actual - page_size - kernel_actual)) {
+				mmc_io_wait(&img_req[0]);
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
 
-		#ifdef TZ_SAVE_KERNEL_HASH
-		aboot_save_boot_hash_mmc(image_addr, imagesize_actual);
-		#endif /* TZ_SAVE_KERNEL_HASH */
+			if (mmc_io_wait(&img_req[0])) {
+				mmc_io_wait(&img_req[1]);
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
 
-		/* Move kernel, ramdisk and device tree to correct address */
-		memmove((void*) hdr->kernel_addr, (char *)(image_addr + page_size), hdr->kernel_size);
-		memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
+			#ifndef TZ_SAVE_KERNEL_HASH
+			/*
+			 * The rest of the image is still coming in. A compressed
+			 * kernel is kept out of the whole buffer, an uncompressed
+			 * one landing on the rest has to wait for it.
+			 */
+			if (ktype == DECOMPRESS_NONE &&
+				addr_range_overlap(hdr->kernel_addr, hdr->kernel_size,
+						   (uint32_t) image_addr + page_size + kernel_actual,
+						   imagesize_actual - page_size - kernel_actual) &&
+				mmc_io_wait(&img_req[1])) {
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
+
+			if (boot_img_load_kernel(hdr, image_addr + page_size, ktype, (addr_t) image_addr,
+						 imagesize_actual, &kernel_stream)) {
+				mmc_io_wait(&img_req[1]);
+				return -1;
+			}
+			#endif
+
+			if (mmc_io_wait(&img_req[1])) {
+				dprintf(CRITICAL, "ERROR: Cannot read boot image\n");
+						return -1;
+			}
+
+			dprintf(INFO, "Loading boot image (%d): done\n",
+					imagesize_actual);
+			bs_set_timestamp(BS_KERNEL_LOAD_DONE);
+
+			#ifdef TZ_SAVE_KERNEL_HASH
+			aboot_save_boot_hash_mmc(image_addr, imagesize_actual);
+
+			/* The hash covers the loaded image, move the kernel only now */
+			if (boot_img_load_kernel(hdr, image_addr + page_size, ktype, (addr_t) image_addr,
+						 imagesize_actual, &kernel_stream))
+				return -1;
+			#endif /* TZ_SAVE_KERNEL_HASH */
+
+			/* Move ramdisk and device tree to correct address */
+			memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
+
+			rest_addr = image_addr + page_size + kernel_actual + ramdisk_actual;
+		}
 
 		#if DEVICE_TREE
 		if(hdr->dt_size) {
-			dt_table_offset = ((uint32_t)image_addr + page_size + kernel_actual + ramdisk_actual + second_actual);
+			dt_table_offset = ((uint32_t)rest_addr + second_actual);
 			table = (struct dt_table*) dt_table_offset;
 
 			if (dev_tree_validate(table, hdr->page_size, &dt_hdr_size) != 0) {
@@ -1362,9 +1738,8 @@ int boot_linux_from_mmc(enum bootmode bootmode)
 			 * Else update with the atags address in the kernel header
 			 */
 			void *dtb;
-			dtb = dev_tree_appended((void*) hdr->kernel_addr,
-						kernel_actual,
-						(void *)hdr->tags_addr);
+			dtb = boot_img_dev_tree_appended(hdr, image_addr + page_size, ktype,
+						kernel_actual, kernel_stream);
 			if (!dtb) {
 				dprintf(CRITICAL, "ERROR: Appended Device Tree Blob not found\n");
 #if !DEVICE_TREE_FALLBACK
@@ -1399,6 +1774,9 @@ int boot_linux_from_flash(enum bootmode bootmode)
 	unsigned ramdisk_actual;
 	unsigned imagesize_actual __UNUSED;
 	unsigned second_actual;
+	enum decompress_type ktype;
+	unsigned kernel_stream;
+	BUF_DMA_ALIGN(kbuf, BOOT_IMG_MAX_PAGE_SIZE);
 
 #if DEVICE_TREE
 	struct dt_table *table;
@@ -1503,6 +1881,16 @@ int boot_linux_from_flash(enum bootmode bootmode)
 		return -1;
 	}
 
+	/* The first page of the kernel tells if it is compressed */
+	if (flash_read(ptn, page_size, kbuf, page_size)) {
+		dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
+		return -1;
+	}
+
+	ktype = decompress_detect(kbuf, page_size);
+	if (ktype != DECOMPRESS_NONE)
+		dprintf(INFO, "Kernel is %s compressed\n", decompress_type_name(ktype));
+
 	/*
 	 * Update the kernel/ramdisk/tags address if the boot image header
 	 * has default values, these default values come from mkbootimg when
@@ -1593,7 +1981,9 @@ int boot_linux_from_flash(enum bootmode bootmode)
 		verify_signed_bootimg((unsigned)image_addr, imagesize_actual);
 
 		/* Move kernel and ramdisk to correct address */
-		memmove((void*) hdr->kernel_addr, (char *)(image_addr + page_size), hdr->kernel_size);
+		if (boot_img_load_kernel(hdr, image_addr + page_size, ktype, (addr_t) image_addr,
+					 imagesize_actual + page_size, &kernel_stream))
+			return -1;
 		memmove((void*) hdr->ramdisk_addr, (char *)(image_addr + page_size + kernel_actual), hdr->ramdisk_size);
 #if DEVICE_TREE
 #if DEVICE_TREE_FALLBACK
@@ -1632,9 +2022,27 @@ int boot_linux_from_flash(enum bootmode bootmode)
 				kernel_actual + ramdisk_actual);
 		bs_set_timestamp(BS_KERNEL_LOAD_START);
 
-		if (flash_read(ptn, offset, (void *)hdr->kernel_addr, kernel_actual)) {
-			dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
-			return -1;
+		if (ktype == DECOMPRESS_NONE) {
+			if (flash_read(ptn, offset, (void *)hdr->kernel_addr, kernel_actual)) {
+				dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
+				return -1;
+			}
+		} else {
+			/* Inflate a compressed kernel out of the scratch region */
+			image_addr = (unsigned char *)target_get_scratch_address();
+			if (check_aboot_addr_range_overlap((unsigned)image_addr, kernel_actual)) {
+				dprintf(CRITICAL, "Boot image buffer address overlaps with aboot addresses.\n");
+				return -1;
+			}
+
+			if (flash_read(ptn, offset, (void *)image_addr, kernel_actual)) {
+				dprintf(CRITICAL, "ERROR: Cannot read kernel image\n");
+				return -1;
+			}
+
+			if (boot_img_load_kernel(hdr, image_addr, ktype, (addr_t) image_addr,
+						 kernel_actual, &kernel_stream))
+				return -1;
 		}
 		offset += kernel_actual;
 
@@ -2009,6 +2417,8 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	char *ptr = ((char*) data);
 	int ret __UNUSED = 0;
 	uint8_t dtb_copied __UNUSED = 0;
+	enum decompress_type ktype;
+	unsigned kernel_stream __UNUSED = 0;
 
 #if VERIFIED_BOOT
 	if(!device.is_unlocked)
@@ -2073,7 +2483,8 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 	 * the boot image is flashed using fastboot flash:raw
 	 */
 	kptr = (struct kernel64_hdr*)((char*) data + page_size);
-	update_ker_tags_rdisk_addr(hdr, IS_ARM64(kptr));
+	ktype = decompress_detect(kptr, kernel_actual);
+	update_ker_tags_rdisk_addr(hdr, kernel_is_arm64(kptr, kernel_actual, ktype));
 
 	/* Get virtual addresses since the hdr saves physical addresses. */
 	hdr->kernel_addr = (unsigned)VA(hdr->kernel_addr);
@@ -2114,7 +2525,10 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 
 	/* Load ramdisk & kernel */
 	memmove((void*) hdr->ramdisk_addr, ptr + page_size + kernel_actual, hdr->ramdisk_size);
-	memmove((void*) hdr->kernel_addr, ptr + page_size, hdr->kernel_size);
+	if (boot_img_load_kernel(hdr, ptr + page_size, ktype, (addr_t) data, sz, &kernel_stream)) {
+		fastboot_fail("kernel decompression failed");
+		return;
+	}
 
 #if DEVICE_TREE
 #if DEVICE_TREE_FALLBACK
@@ -2129,8 +2543,8 @@ void cmd_boot(const char *arg, void *data, unsigned sz)
 		 */
 		if (!dtb_copied) {
 			void *dtb;
-			dtb = dev_tree_appended((void *)hdr->kernel_addr, hdr->kernel_size,
-						(void *)hdr->tags_addr);
+			dtb = boot_img_dev_tree_appended(hdr, ptr + page_size, ktype,
+						hdr->kernel_size, kernel_stream);
 			if (!dtb) {
 				fastboot_fail("dtb not found");
 				return;
@@ -2202,7 +2616,7 @@ void cmd_erase_mmc(const char *arg, void *data, unsigned sz)
 	}
 #endif
 
-	index = partition_get_index(arg);
+	index = partition_get_index_spec(arg);
 	ptn = partition_get_offset(index);
 	size = partition_get_size(index);
 
@@ -2285,7 +2699,11 @@ void cmd_flash_mmc_img(const char *arg, void *data, unsigned sz)
 				}
 			}
 #endif
-			index = partition_get_index(pname);
+			/* with a lun given, a name repeated across luns is the one on it */
+			if (lun_set)
+				index = partition_get_index_lun(pname, lun);
+			else
+				index = partition_get_index(pname);
 			ptn = partition_get_offset(index);
 			if(ptn == 0) {
 				fastboot_fail("partition table doesn't exist");
@@ -2328,7 +2746,6 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 {
 	unsigned int chunk;
 	unsigned int chunk_data_sz;
-	uint32_t *fill_buf = NULL;
 	uint32_t fill_val;
 	uint32_t chunk_blk_cnt = 0;
 	sparse_header_t *sparse_header;
@@ -2337,10 +2754,9 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 	unsigned long long ptn = 0;
 	unsigned long long size = 0;
 	int index = INVALID_PTN;
-	unsigned int i;
 	uint8_t lun = 0;
 
-	index = partition_get_index(arg);
+	index = partition_get_index_spec(arg);
 	ptn = partition_get_offset(index);
 	if(ptn == 0) {
 		fastboot_fail("partition table doesn't exist");
@@ -2432,37 +2848,20 @@ void cmd_flash_mmc_sparse_img(const char *arg, void *data, unsigned sz)
 				return;
 			}
 
-			fill_buf = (uint32_t *)memalign(CACHE_LINE, ROUNDUP(sparse_header->blk_sz, CACHE_LINE));
-			if (!fill_buf)
-			{
-				fastboot_fail("Malloc failed for: CHUNK_TYPE_FILL");
-				return;
-			}
-
 			fill_val = *(uint32_t *)data;
 			data = (char *) data + sizeof(uint32_t);
 			chunk_blk_cnt = chunk_data_sz / sparse_header->blk_sz;
 
-			for (i = 0; i < (sparse_header->blk_sz / sizeof(fill_val)); i++)
-			{
-				fill_buf[i] = fill_val;
-			}
-
-			for (i = 0; i < chunk_blk_cnt; i++)
+			if(sparse_write_fill(ptn + ((uint64_t)total_blocks*sparse_header->blk_sz),
+						sparse_header->blk_sz,
+						chunk_blk_cnt,
+						fill_val))
 			{
-				if(mmc_write(ptn + ((uint64_t)total_blocks*sparse_header->blk_sz),
-							sparse_header->blk_sz,
-							fill_buf))
-				{
-					fastboot_fail("flash write failure");
-					free(fill_buf);
-					return;
-				}
-
-				total_blocks++;
+				fastboot_fail("flash write failure");
+				return;
 			}
 
-			free(fill_buf);
+			total_blocks += chunk_blk_cnt;
 			break;
 
 			case CHUNK_TYPE_DONT_CARE:
@@ -2504,6 +2903,15 @@ void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 	/* 8 Byte Magic + 2048 Byte xml + Encrypted Data */
 	unsigned int *magic_number = (unsigned int *) data;
 
+	/* A streamed download has already been written while it was
+	 * received, only its outcome is left to report.
+	 */
+	if (sparse_stream_pending())
+	{
+		sparse_stream_complete(arg);
+		return;
+	}
+
 #ifdef SSD_ENABLE
 	int              ret=0;
 	uint32           major_version=0;
@@ -2594,6 +3002,51 @@ void cmd_flash_mmc(const char *arg, void *data, unsigned sz)
 	return;
 }
 
+/*
+ * "fastboot oem stream-flash <partition>" makes the next download of a
+ * sparse image be written to <partition> while it is received, so that
+ * USB and storage transfers overlap and the image size is not bound by
+ * the download buffer. The usual "fastboot flash <partition>" then just
+ * reports the result. Every streamed image needs its own stream-flash,
+ * "fastboot oem stream-flash" without a partition cancels a pending one.
+ */
+void cmd_oem_stream_flash(const char *arg, void *data, unsigned sz)
+{
+	while (*arg == ' ')
+		arg++;
+
+	if (!*arg)
+	{
+		sparse_stream_disarm();
+		fastboot_okay("");
+		return;
+	}
+
+#if VERIFIED_BOOT
+	if(!device.is_unlocked && !device.is_verified)
+	{
+		fastboot_fail("device is locked. Cannot flash images");
+		return;
+	}
+	if(!device.is_unlocked && device.is_verified)
+	{
+		if(!boot_verify_flash_allowed(arg))
+		{
+			fastboot_fail("cannot flash this partition in verified state");
+			return;
+		}
+	}
+#endif
+
+	if (sparse_stream_arm(arg))
+	{
+		fastboot_fail("partition table doesn't exist");
+		return;
+	}
+
+	fastboot_okay("");
+}
+
 void cmd_flash(const char *arg, void *data, unsigned sz)
 {
 	struct ptentry *ptn;
@@ -2803,7 +3256,13 @@ void cmd_oem_devinfo(const char *arg, void *data, unsigned sz)
 void cmd_oem_lk_log(const char *arg, void *data, unsigned sz)
 {
 	char* pch;
-	char* buf = strdup(lk_log_getbuf());
+	char* buf = malloc(LK_LOG_BUF_SIZE + 1);
+
+	if (!buf) {
+		fastboot_fail("out of memory");
+		return;
+	}
+	lk_log_copy(buf, LK_LOG_BUF_SIZE + 1);
 
 	pch = strtok(buf, "\n\r");
 	while (pch != NULL) {
@@ -2823,6 +3282,24 @@ void cmd_oem_lk_log(const char *arg, void *data, unsigned sz)
 }
 #endif
 
+#if HEAP_TRACE
+/* the heap calls since heap_init, one replay table row per line */
+void cmd_oem_heap_trace(const char *arg, void *data, unsigned sz)
+{
+	const struct heap_trace_op *ops;
+	char response[MAX_RSP_SIZE];
+	size_t count, i;
+
+	count = heap_trace_get(&ops);
+	for (i = 0; i < count; i++) {
+		snprintf(response, sizeof(response), "\t{ %3u, %4u, %5u },",
+			 ops[i].slot, ops[i].align, ops[i].size);
+		fastboot_info(response);
+	}
+	fastboot_okay("");
+}
+#endif
+
 void cmd_oem_screenshot(const char *arg, void *unused, unsigned sz)
 {
 	struct fbcon_config* config = fbcon_display();
@@ -2839,24 +3316,72 @@ void cmd_preflash(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
-static struct fbimage logo_header = {{{0},0,0,0,{0}}, NULL};
+static struct fbimage logo_header = {{{0},0,0,0,0,0,0,0,0,{0}}, NULL};
 struct fbimage* splash_screen_flash(void);
 
 int splash_screen_check_header(struct fbimage *logo)
 {
+	struct fbcon_config *fb_display = fbcon_display();
+
 	if (memcmp(logo->header.magic, LOGO_IMG_MAGIC, 8))
 		return -1;
 	if (logo->header.width == 0 || logo->header.height == 0)
 		return -1;
+	/* the image is staged behind the framebuffer, which holds one panel */
+	if (fb_display && (logo->header.width > fb_display->width ||
+		logo->header.height > fb_display->height))
+		return -1;
+	/* a compressed image that doesn't save anything is not one we wrote */
+	if (logo_img_compressed(&logo->header) &&
+		(logo->header.size == 0 ||
+		 logo->header.size / logo->header.width / logo->header.height >= 3))
+		return -1;
 	return 0;
 }
 
+/* A compressed payload is read whole into the scratch space behind the
+ * framebuffer, which is only known to be large enough for a raw image of
+ * the panel. len is what the read will transfer, rounded up to the device's
+ * unit, and has to fit there as well as in the partition. */
+static int splash_screen_check_payload(struct fbcon_config *fb_display,
+	uint64_t len, uint64_t ptn_size)
+{
+	if (len > (uint64_t) fb_display->width * fb_display->height * fb_display->bpp / 8)
+		return -1;
+	if (len > ptn_size)
+		return -1;
+	return 0;
+}
+
+/* The payload of a compressed splash has been read to the scratch space
+ * behind the framebuffer; decode it into place. */
+static struct fbimage* splash_screen_decode(struct fbimage *logo, void *payload,
+	lk_time_t start)
+{
+	int ret;
+
+	ret = fbcon_splash_decode(&logo->header, payload, logo->header.size);
+	if (ret) {
+		fbcon_clear();
+		dprintf(CRITICAL, "ERROR: Cannot decode splash image: %d\n", ret);
+		return NULL;
+	}
+
+	dprintf(INFO, "splash: %ux%u type %u, %u bytes in %lu ms\n",
+		logo->header.width, logo->header.height, logo->header.type,
+		logo->header.size, current_time() - start);
+
+	logo->image = payload;
+	return logo;
+}
+
 struct fbimage* splash_screen_flash(void)
 {
 	struct ptentry *ptn;
 	struct ptable *ptable;
 	struct fbcon_config *fb_display = NULL;
 	struct fbimage *logo = &logo_header;
+	lk_time_t start = current_time();
 
 
 	ptable = flash_get_ptable();
@@ -2881,6 +3406,26 @@ struct fbimage* splash_screen_flash(void)
 	}
 
 	fb_display = fbcon_display();
+	if (fb_display && logo_img_compressed(&logo->header)) {
+		uint8_t *buf = (uint8_t *) fb_display->base + LOGO_IMG_OFFSET;
+		/* reads have to start on a page, so take the header along */
+		uint64_t len = ROUNDUP((uint64_t) sizeof(logo->header) + logo->header.size,
+			(uint64_t) flash_page_size());
+
+		if (splash_screen_check_payload(fb_display, len,
+			(uint64_t) ptn->length * flash_get_info()->block_size)) {
+			dprintf(CRITICAL, "ERROR: Splash image too large\n");
+			return NULL;
+		}
+
+		if (flash_read(ptn, 0, buf, len)) {
+			dprintf(CRITICAL, "ERROR: Cannot read splash image\n");
+			return NULL;
+		}
+
+		return splash_screen_decode(logo, buf + sizeof(logo->header), start);
+	}
+
 	if (fb_display) {
 		uint8_t *base = (uint8_t *) fb_display->base;
 		if (logo->header.width != fb_display->width || logo->header.height != fb_display->height) {
@@ -2896,21 +3441,12 @@ struct fbimage* splash_screen_flash(void)
 		}
 
 #if DISPLAY_USE_BGR
-		unsigned i;
-		for(i=0; i<(logo->header.width*fb_display->height); i++) {
-			int r,g,b;
-			char* color = (char*) base + i*3;
-
-			r = color[0];
-			g = color[1];
-			b = color[2];
-
-			color[0] = b;
-			color[1] = g;
-			color[2] = r;
-		}
+		pixel_swap_rgb888(base, logo->header.width * logo->header.height);
 #endif
 
+		dprintf(INFO, "splash: %ux%u raw in %lu ms\n", logo->header.width,
+			logo->header.height, current_time() - start);
+
 		logo->image = base;
 	}
 
@@ -2923,6 +3459,7 @@ struct fbimage* splash_screen_mmc(void)
 	unsigned long long ptn = 0;
 	struct fbcon_config *fb_display = NULL;
 	struct fbimage *logo = &logo_header;
+	lk_time_t start = current_time();
 
 	index = partition_get_index(SPLASH_PARTITION_NAME);
 	if (index == 0) {
@@ -2947,6 +3484,26 @@ struct fbimage* splash_screen_mmc(void)
 	}
 
 	fb_display = fbcon_display();
+	if (fb_display && logo_img_compressed(&logo->header)) {
+		uint8_t *buf = (uint8_t *) fb_display->base + LOGO_IMG_OFFSET;
+		uint64_t len = ROUNDUP((uint64_t) logo->header.size, (uint64_t) 512);
+		uint64_t ptn_size = partition_get_size(index);
+
+		/* the payload starts after the header */
+		ptn_size = ptn_size > sizeof(logo->header) ? ptn_size - sizeof(logo->header) : 0;
+		if (splash_screen_check_payload(fb_display, len, ptn_size)) {
+			dprintf(CRITICAL, "ERROR: Splash image too large\n");
+			return NULL;
+		}
+
+		if (mmc_read(ptn + sizeof(logo->header), (unsigned int *)buf, len)) {
+			dprintf(CRITICAL, "ERROR: Cannot read splash image\n");
+			return NULL;
+		}
+
+		return splash_screen_decode(logo, buf, start);
+	}
+
 	if (fb_display) {
 		uint8_t *base = (uint8_t *) fb_display->base;
 		if (logo->header.width != fb_display->width || logo->header.height != fb_display->height)
@@ -2961,21 +3518,12 @@ struct fbimage* splash_screen_mmc(void)
 		}
 
 #if DISPLAY_USE_BGR
-		unsigned i;
-		for(i=0; i<(logo->header.width*fb_display->height); i++) {
-			int r,g,b;
-			char* color = (char*) base + i*3;
-
-			r = color[0];
-			g = color[1];
-			b = color[2];
-
-			color[0] = b;
-			color[1] = g;
-			color[2] = r;
-		}
+		pixel_swap_rgb888(base, logo->header.width * logo->header.height);
 #endif
 
+		dprintf(INFO, "splash: %ux%u raw in %lu ms\n", logo->header.width,
+			logo->header.height, current_time() - start);
+
 		logo->image = base;
 	}
 
@@ -3063,6 +3611,7 @@ void aboot_fastboot_register_commands(void)
 	{
 		fastboot_register("flash:", cmd_flash_mmc);
 		fastboot_register("erase:", cmd_erase_mmc);
+		fastboot_register("oem stream-flash", cmd_oem_stream_flash);
 	}
 	else
 	{
@@ -3081,6 +3630,9 @@ void aboot_fastboot_register_commands(void)
 	fastboot_register("oem device-info",   cmd_oem_devinfo);
 #if WITH_DEBUG_LOG_BUF
 	fastboot_register("oem lk_log",        cmd_oem_lk_log);
+#endif
+#if HEAP_TRACE
+	fastboot_register("oem heap-trace",    cmd_oem_heap_trace);
 #endif
 	fastboot_register("oem screenshot",    cmd_oem_screenshot);
 	fastboot_register("preflash",          cmd_preflash);
@@ -3311,6 +3863,21 @@ uint32_t get_page_size(void)
  * @return int - 0 on success, negative value on failure.
  */
 static int aboot_save_boot_hash_mmc(uint32_t image_addr, uint32_t image_size)
+{
+	iovec_t iov = { (void *)image_addr, image_size };
+
+	return aboot_save_boot_hash_iov(&iov, 1);
+}
+
+/*
+ * Same as aboot_save_boot_hash_mmc, for a boot image loaded in place
+ *
+ * @param iov - Buffers holding the pieces of the boot image, in order
+ * @param iov_cnt - Number of buffers
+ *
+ * @return int - 0 on success, negative value on failure.
+ */
+static int aboot_save_boot_hash_iov(iovec_t *iov, uint32_t iov_cnt)
 {
 	unsigned int digest[8];
 #if IMAGE_VERIF_ALGO_SHA1
@@ -3320,10 +3887,10 @@ static int aboot_save_boot_hash_mmc(uint32_t image_addr, uint32_t image_size)
 #endif
 
 	target_crypto_init_params();
-	hash_find((unsigned char *)image_addr, image_size, (unsigned char *)&digest, auth_algo);
+	hash_find_iov(iov, iov_cnt, (unsigned char *)&digest, auth_algo);
 
 	save_kernel_hash_cmd(digest);
-	dprintf(INFO, "aboot_save_boot_hash_mmc: imagesize_actual size %d bytes.\n", (int) image_size);
+	dprintf(INFO, "aboot_save_boot_hash_mmc: imagesize_actual size %d bytes.\n", (int) iovec_size(iov, iov_cnt));
 
 	return 0;
 }
@@ -37,6 +37,7 @@
 #include <target.h>
 #include <kernel/thread.h>
 #include <kernel/event.h>
+#include <kernel/semaphore.h>
 #include <dev/udc.h>
 #include <app/aboot.h>
 #include "fastboot.h"
@@ -69,6 +70,12 @@ usb_controller_interface_t usb_if;
 
 #define MAX_USBFS_BULK_SIZE (32 * 1024)
 
+/* Streaming downloads carve download_base into this many slices */
+#define FASTBOOT_STREAM_NUM_BUFS 3
+#ifndef FASTBOOT_STREAM_BUF_SIZE
+#define FASTBOOT_STREAM_BUF_SIZE (4 * 1024 * 1024)
+#endif
+
 void boot_linux(void *bootimg, unsigned sz);
 static void fastboot_notify(struct udc_gadget *gadget, unsigned event);
 static struct udc_endpoint *fastboot_endpoints[2];
@@ -180,6 +187,22 @@ static unsigned download_size;
 
 static unsigned fastboot_state = STATE_OFFLINE;
 
+/*
+ * State of an armed streaming download. While a download is streamed the
+ * fastboot thread keeps receiving into the free slices and the writer
+ * thread drains the filled ones through the sink, so the USB transfer of
+ * one slice overlaps the storage write of the previous one.
+ */
+static struct {
+	const struct fastboot_stream_sink *sink;
+	semaphore_t free_bufs;
+	semaphore_t full_bufs;
+	uint8_t *buf[FASTBOOT_STREAM_NUM_BUFS];
+	unsigned len[FASTBOOT_STREAM_NUM_BUFS];
+	unsigned buf_size;
+	int status;
+} stream;
+
 static void req_complete(struct udc_request *req, unsigned actual, int status)
 {
 	txn_status = status;
@@ -511,15 +534,100 @@ static void cmd_help(const char *arg, void *data, unsigned sz)
 	fastboot_okay("");
 }
 
+void fastboot_stream_arm(const struct fastboot_stream_sink *sink)
+{
+	stream.sink = sink;
+}
+
+static int fastboot_stream_writer(void *arg)
+{
+	unsigned i = 0;
+
+	for (;;) {
+		sem_wait(&stream.full_bufs);
+
+		/* a zero length slice marks the end of the download */
+		if (!stream.len[i])
+			break;
+
+		if (!stream.status)
+			stream.status = stream.sink->write(stream.buf[i], stream.len[i]);
+
+		sem_post(&stream.free_bufs);
+		i = (i + 1) % FASTBOOT_STREAM_NUM_BUFS;
+	}
+
+	return 0;
+}
+
+/*
+ * Receive len bytes, of which the first head bytes already sit in the
+ * first slice, handing every filled slice to the writer thread.
+ * Returns 0 once all the data has been received, even if the sink
+ * failed; the sink reports its own error when the data is flashed.
+ */
+static int fastboot_stream_download(unsigned head, unsigned len)
+{
+	thread_t *thr;
+	unsigned i = 0;
+	unsigned xfer;
+	int r;
+
+	sem_init(&stream.free_bufs, FASTBOOT_STREAM_NUM_BUFS - 1);
+	sem_init(&stream.full_bufs, 0);
+	stream.status = 0;
+
+	thr = thread_create("fastboot_stream", fastboot_stream_writer, NULL,
+			    DEFAULT_PRIORITY - 1, 4096);
+	if (!thr) {
+		stream.sink->finish(-1);
+		return -1;
+	}
+	thread_resume(thr);
+
+	stream.len[0] = head;
+	len -= head;
+	sem_post(&stream.full_bufs);
+
+	do {
+		sem_wait(&stream.free_bufs);
+		i = (i + 1) % FASTBOOT_STREAM_NUM_BUFS;
+
+		xfer = MIN(len, stream.buf_size);
+		if (xfer) {
+			r = usb_if.usb_read(stream.buf[i], xfer);
+			if ((r < 0) || ((unsigned) r != xfer))
+				xfer = 0;
+		}
+
+		/* a zero length slice stops the writer once it has
+		 * drained the slices queued before it
+		 */
+		stream.len[i] = xfer;
+		len -= xfer;
+		sem_post(&stream.full_bufs);
+	} while (xfer);
+
+	thread_join(thr, NULL, INFINITE_TIME);
+
+	sem_destroy(&stream.free_bufs);
+	sem_destroy(&stream.full_bufs);
+
+	stream.sink->finish(len ? -1 : stream.status);
+
+	return len ? -1 : 0;
+}
+
 static void cmd_download(const char *arg, void *data, unsigned sz)
 {
 	STACKBUF_DMA_ALIGN(__response, MAX_RSP_SIZE);
 	char* response = (char*)__response;
 	unsigned len = hex2unsigned(arg);
+	unsigned head = 0;
 	int r;
 
 	download_size = 0;
-	if (len > download_max) {
+	if (len > download_max && !stream.sink) {
 		fastboot_fail("data too large");
 		return;
 	}
@@ -528,10 +636,46 @@ static void cmd_download(const char *arg, void *data, unsigned sz)
 	if (usb_if.usb_write(response, strlen(response)) < 0)
 		return;
 
-	r = usb_if.usb_read(download_base, len);
-	if ((r < 0) || ((unsigned) r != len)) {
-		fastboot_state = STATE_ERROR;
-		return;
+	if (stream.sink) {
+		/* let the sink decide from the first slice whether it
+		 * wants the data, otherwise fall back to a plain download
+		 */
+		head = MIN(len, stream.buf_size);
+		r = usb_if.usb_read(download_base, head);
+		if ((r < 0) || ((unsigned) r != head)) {
+			fastboot_state = STATE_ERROR;
+			return;
+		}
+
+		if (stream.sink->accept(download_base, head)) {
+			if (fastboot_stream_download(head, len))
+				fastboot_state = STATE_ERROR;
+			else
+				fastboot_okay("");
+			return;
+		}
+
+		if (len > download_max) {
+			/* drain the rest so the host sees our failure */
+			while (len > head) {
+				r = usb_if.usb_read(download_base, MIN(len - head, stream.buf_size));
+				if (r <= 0) {
+					fastboot_state = STATE_ERROR;
+					return;
+				}
+				head += r;
+			}
+			fastboot_fail("data too large");
+			return;
+		}
+	}
+
+	if (len > head) {
+		r = usb_if.usb_read(download_base + head, len - head);
+		if ((r < 0) || ((unsigned) r != len - head)) {
+			fastboot_state = STATE_ERROR;
+			return;
+		}
 	}
 	download_size = len;
 	fastboot_okay("");
@@ -619,6 +763,14 @@ int fastboot_init(void *base, unsigned size)
 	download_base = base;
 	download_max = size;
 
+	/* keep the slices a whole number of pages so that neither USB
+	 * packets nor cache lines straddle two of them
+	 */
+	stream.buf_size = MIN(FASTBOOT_STREAM_BUF_SIZE,
+			      ROUNDDOWN(size / FASTBOOT_STREAM_NUM_BUFS, 4096));
+	for (unsigned i = 0; i < FASTBOOT_STREAM_NUM_BUFS; i++)
+		stream.buf[i] = (uint8_t *) base + i * stream.buf_size;
+
 	/* target specific initialization before going into fastboot. */
 	target_fastboot_init();
 
@@ -31,6 +31,8 @@
 #ifndef __APP_FASTBOOT_H
 #define __APP_FASTBOOT_H
 
+#include <stdbool.h>
+
 #define MAX_RSP_SIZE            64
 #define MAX_GET_VAR_NAME_SIZE   256
 
@@ -48,6 +50,22 @@ void fastboot_register(const char *prefix,
 /* publish a variable readable by the built-in getvar command */
 void fastboot_publish(const char *name, const char *value);
 
+/* sink for streamed downloads, see fastboot_stream_arm() */
+struct fastboot_stream_sink {
+	/* peek at the start of a download, return true to stream it */
+	bool (*accept)(void *data, unsigned len);
+	/* consume the next piece of the download, non zero aborts */
+	int (*write)(void *data, unsigned len);
+	/* called once the whole download has been received */
+	void (*finish)(int status);
+};
+
+/* hand subsequent downloads accepted by sink to it while they are being
+ * received instead of staging them in the download buffer. Such downloads
+ * are not limited by the download buffer size. Pass NULL to disarm.
+ */
+void fastboot_stream_arm(const struct fastboot_stream_sink *sink);
+
 /* only callable from within a command handler */
 void fastboot_okay(const char *result);
 void fastboot_fail(const char *reason);
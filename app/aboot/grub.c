@@ -10,6 +10,10 @@
 #include <ext4_types.h>
 #include <ext4_fs.h>
 #include <ext4_mmcdev.h>
+#if WITH_LIB_BIO
+#include <lib/bio.h>
+#include <ext4_biodev.h>
+#endif
 #include <kernel/thread.h>
 
 #if WITH_APP_DISPLAY_SERVER
@@ -25,6 +29,9 @@ struct tar_io_priv {
 	unsigned long long index;
 	unsigned long long ptn;
 	int is_ramdisk;
+#if WITH_LIB_BIO
+	bdev_t *bdev; // published partition, ptn is relative to it
+#endif
 };
 
 unsigned long grub_tar_read(struct tar_io *tio, ulong start, ulong blkcnt, void *buffer) {
@@ -34,6 +41,12 @@ unsigned long grub_tar_read(struct tar_io *tio, ulong start, ulong blkcnt, void
 	if(priv->is_ramdisk) {
 		memcpy(buffer, (void*)(unsigned long)(priv->ptn+ptn), blkcnt*BLOCK_SIZE);
 	}
+#if WITH_LIB_BIO
+	else if(priv->bdev) {
+		if(bio_read(priv->bdev, buffer, priv->ptn + ptn, blkcnt*BLOCK_SIZE) != (ssize_t)(blkcnt*BLOCK_SIZE))
+			return 0;
+	}
+#endif
 	else {
 		if(mmc_read(priv->ptn + ptn, buffer, blkcnt*BLOCK_SIZE))
 			return 0;
@@ -125,8 +138,12 @@ static int grub_load_from_mmc(void) {
 
 	dprintf(INFO, "%s: part=[%s] path=[%s]\n", __func__, GRUB_BOOT_PARTITION, GRUB_PATH);
 
-	// create ext4 device
+	// create ext4 device, through the published partition when bio is available
+#if WITH_LIB_BIO
+	struct ext4_blockdev* mmcdev = ext4_biodev_get(GRUB_BOOT_PARTITION);
+#else
 	struct ext4_blockdev* mmcdev = ext4_mmcdev_get(GRUB_BOOT_PARTITION);
+#endif
 	if(!mmcdev){
 		dprintf(CRITICAL, "MMC device ERROR\n");
 		return -1;
@@ -200,6 +217,13 @@ static int grub_load_from_tar(void) {
 	priv.index = partition_get_index("aboot");
 	priv.ptn = partition_get_offset(priv.index) + 1024*1024; // 1MB offset to aboot
 	priv.is_ramdisk = 0;
+#if WITH_LIB_BIO
+	// read through the published partition when there is one
+	if(!priv.bdev)
+		priv.bdev = bio_open("aboot");
+	if(priv.bdev)
+		priv.ptn = 1024*1024;
+#endif
 	tio.blksz = BLOCK_SIZE;
 	tio.lba = partition_get_size(priv.index) / tio.blksz - 1;
 
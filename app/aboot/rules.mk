@@ -5,6 +5,8 @@ MODULE := $(LOCAL_DIR)
 MODULE_DEPS += \
 	lib/ext4 \
 	lib/tar \
+	lib/decompress \
+	lib/pixel \
 	app/aboot/uboot_api
 
 GLOBAL_INCLUDES += $(LOCAL_DIR)/include
@@ -15,6 +17,7 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/aboot.c \
 	$(LOCAL_DIR)/fastboot.c \
 	$(LOCAL_DIR)/recovery.c \
+	$(LOCAL_DIR)/sparse_stream.c \
 	$(LOCAL_DIR)/grub.c
 	
 GLOBAL_DEFINES += GRUB_LOADING_ADDRESS=$(GRUB_LOADING_ADDRESS)
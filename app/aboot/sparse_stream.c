@@ -0,0 +1,471 @@
+/* Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of The Linux Foundation nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Streaming sparse image flasher.
+ *
+ * The chunks of a sparse image are parsed and written while the image is
+ * still being received over USB, instead of after the whole image has been
+ * staged in the download buffer. Fastboot hands the received data over in
+ * slices of arbitrary length, so any header or block may straddle two
+ * slices; those are gathered in small bounce buffers while whole blocks
+ * of RAW chunks are written straight from the USB buffer.
+ */
+
+#include <debug.h>
+#include <string.h>
+#include <stdlib.h>
+#include <arch/defines.h>
+#include <malloc.h>
+#include <partition_parser.h>
+#include <mmc.h>
+
+#include "fastboot.h"
+#include "sparse_format.h"
+#include "sparse_stream.h"
+
+enum sparse_stream_state {
+	SPARSE_STREAM_CHUNK_HDR,
+	SPARSE_STREAM_RAW,
+	SPARSE_STREAM_FILL,
+	SPARSE_STREAM_DONE,
+};
+
+static struct {
+	char name[MAX_GPT_NAME_SIZE];
+	unsigned long long ptn;
+	unsigned long long size;
+	uint8_t lun;
+
+	enum sparse_stream_state state;
+	sparse_header_t hdr;
+	chunk_header_t chunk;
+	uint32_t fill_val;
+	uint8_t hdr_buf[sizeof(chunk_header_t)];
+	uint32_t hdr_fill;
+	uint32_t skip;
+	uint64_t remain;
+	uint32_t chunks_done;
+	uint32_t total_blocks;
+
+	/* one output block, for RAW blocks split across slices */
+	uint8_t *blk_buf;
+	uint32_t blk_fill;
+
+	bool pending;
+	const char *error;
+} ctx;
+
+static bool sparse_stream_accept(void *data, unsigned len);
+static int sparse_stream_write(void *data, unsigned len);
+static void sparse_stream_finish(int status);
+
+static const struct fastboot_stream_sink sparse_stream_sink = {
+	.accept = sparse_stream_accept,
+	.write  = sparse_stream_write,
+	.finish = sparse_stream_finish,
+};
+
+/*
+ * Function: sparse write fill
+ * Arg     : Partition offset, sparse block size, block count & fill value
+ * Return  : 0 on success, non zero on failure
+ * Flow    : Write a FILL chunk with as few storage commands as possible
+ */
+int sparse_write_fill(uint64_t offset, uint32_t blk_sz, uint32_t count, uint32_t fill_val)
+{
+#if MMC_SDHCI_SUPPORT
+	return mmc_fill(offset, (uint64_t) blk_sz * count, fill_val);
+#else
+	uint32_t *fill_buf;
+	uint32_t i;
+
+	fill_buf = (uint32_t *)memalign(CACHE_LINE, ROUNDUP(blk_sz, CACHE_LINE));
+	if (!fill_buf)
+	{
+		dprintf(CRITICAL, "Malloc failed for: CHUNK_TYPE_FILL\n");
+		return -1;
+	}
+
+	for (i = 0; i < (blk_sz / sizeof(fill_val)); i++)
+		fill_buf[i] = fill_val;
+
+	for (i = 0; i < count; i++)
+	{
+		if (mmc_write(offset + (uint64_t) i * blk_sz, blk_sz, fill_buf))
+		{
+			free(fill_buf);
+			return -1;
+		}
+	}
+
+	free(fill_buf);
+	return 0;
+#endif
+}
+
+/*
+ * Function: sparse stream accept
+ * Arg     : Start of the download and its length
+ * Return  : true if the download is a sparse image that fits the partition
+ * Flow    : Validate the sparse header and set up the parser for it
+ */
+static bool sparse_stream_accept(void *data, unsigned len)
+{
+	sparse_header_t *hdr = (sparse_header_t *) data;
+	uint32_t block_size = mmc_get_device_blocksize();
+
+	ctx.pending = false;
+
+	if (len < sizeof(sparse_header_t) || hdr->magic != SPARSE_HEADER_MAGIC)
+		return false;
+
+	if (hdr->file_hdr_sz < sizeof(sparse_header_t) ||
+		hdr->chunk_hdr_sz < sizeof(chunk_header_t) ||
+		!hdr->blk_sz || (hdr->blk_sz % block_size))
+	{
+		dprintf(CRITICAL, "Invalid sparse header, not streaming it\n");
+		return false;
+	}
+
+	if ((uint64_t) hdr->total_blks * hdr->blk_sz > ctx.size)
+	{
+		dprintf(CRITICAL, "Sparse image too large for %s, not streaming it\n", ctx.name);
+		return false;
+	}
+
+	ctx.blk_buf = (uint8_t *) memalign(CACHE_LINE, ROUNDUP(hdr->blk_sz, CACHE_LINE));
+	if (!ctx.blk_buf)
+	{
+		dprintf(CRITICAL, "Failed to allocate sparse block buffer\n");
+		return false;
+	}
+
+	memcpy(&ctx.hdr, hdr, sizeof(sparse_header_t));
+	ctx.state = ctx.hdr.total_chunks ? SPARSE_STREAM_CHUNK_HDR : SPARSE_STREAM_DONE;
+	ctx.skip = ctx.hdr.file_hdr_sz;
+	ctx.hdr_fill = 0;
+	ctx.blk_fill = 0;
+	ctx.chunks_done = 0;
+	ctx.total_blocks = 0;
+	ctx.error = NULL;
+
+	dprintf(INFO, "Streaming sparse image to '%s': %u blocks of %u bytes in %u chunks\n",
+			ctx.name, ctx.hdr.total_blks, ctx.hdr.blk_sz, ctx.hdr.total_chunks);
+
+	mmc_set_lun(ctx.lun);
+
+	return true;
+}
+
+/* Gather size bytes of a header which may straddle two slices */
+static bool sparse_stream_collect(uint8_t **buf, unsigned *len, void *dst, uint32_t size)
+{
+	uint32_t n = MIN(*len, size - ctx.hdr_fill);
+
+	memcpy(ctx.hdr_buf + ctx.hdr_fill, *buf, n);
+	ctx.hdr_fill += n;
+	*buf += n;
+	*len -= n;
+
+	if (ctx.hdr_fill < size)
+		return false;
+
+	memcpy(dst, ctx.hdr_buf, size);
+	ctx.hdr_fill = 0;
+	return true;
+}
+
+static int sparse_stream_write_blocks(void *buf, uint32_t count)
+{
+	uint64_t offset = (uint64_t) ctx.total_blocks * ctx.hdr.blk_sz;
+
+	if (mmc_write(ctx.ptn + offset, count * ctx.hdr.blk_sz, buf))
+	{
+		ctx.error = "flash write failure";
+		return -1;
+	}
+
+	ctx.total_blocks += count;
+	return 0;
+}
+
+static void sparse_stream_next_chunk(void)
+{
+	ctx.chunks_done++;
+	if (ctx.chunks_done == ctx.hdr.total_chunks)
+		ctx.state = SPARSE_STREAM_DONE;
+	else
+		ctx.state = SPARSE_STREAM_CHUNK_HDR;
+}
+
+static int sparse_stream_chunk(void)
+{
+	chunk_header_t *chunk = &ctx.chunk;
+	uint64_t chunk_data_sz = (uint64_t) ctx.hdr.blk_sz * chunk->chunk_sz;
+
+	dprintf (SPEW, "=== Chunk Header ===\n");
+	dprintf (SPEW, "chunk_type: 0x%x\n", chunk->chunk_type);
+	dprintf (SPEW, "chunk_data_sz: 0x%x\n", chunk->chunk_sz);
+	dprintf (SPEW, "total_size: 0x%x\n", chunk->total_sz);
+
+	if (chunk->chunk_sz > ctx.hdr.total_blks - ctx.total_blocks)
+	{
+		ctx.error = "sparse chunk exceeds image size";
+		return -1;
+	}
+
+	/* Skip the remaining bytes in a header that is longer than
+	 * we expected.
+	 */
+	ctx.skip = ctx.hdr.chunk_hdr_sz - sizeof(chunk_header_t);
+
+	switch (chunk->chunk_type)
+	{
+		case CHUNK_TYPE_RAW:
+		if (chunk->total_sz != (ctx.hdr.chunk_hdr_sz + chunk_data_sz))
+		{
+			ctx.error = "Bogus chunk size for chunk type Raw";
+			return -1;
+		}
+		ctx.remain = chunk_data_sz;
+		ctx.state = SPARSE_STREAM_RAW;
+		if (!ctx.remain)
+			sparse_stream_next_chunk();
+		break;
+
+		case CHUNK_TYPE_FILL:
+		if (chunk->total_sz != (ctx.hdr.chunk_hdr_sz + sizeof(uint32_t)))
+		{
+			ctx.error = "Bogus chunk size for chunk type FILL";
+			return -1;
+		}
+		ctx.state = SPARSE_STREAM_FILL;
+		break;
+
+		case CHUNK_TYPE_DONT_CARE:
+		ctx.total_blocks += chunk->chunk_sz;
+		sparse_stream_next_chunk();
+		break;
+
+		case CHUNK_TYPE_CRC:
+		if (chunk->total_sz != ctx.hdr.chunk_hdr_sz)
+		{
+			ctx.error = "Bogus chunk size for chunk type Dont Care";
+			return -1;
+		}
+		ctx.total_blocks += chunk->chunk_sz;
+		ctx.skip += chunk_data_sz;
+		sparse_stream_next_chunk();
+		break;
+
+		default:
+		dprintf(CRITICAL, "Unkown chunk type: %x\n", chunk->chunk_type);
+		ctx.error = "Unknown chunk type";
+		return -1;
+	}
+
+	return 0;
+}
+
+static int sparse_stream_fill(void)
+{
+	uint64_t offset = (uint64_t) ctx.total_blocks * ctx.hdr.blk_sz;
+
+	if (sparse_write_fill(ctx.ptn + offset, ctx.hdr.blk_sz, ctx.chunk.chunk_sz, ctx.fill_val))
+	{
+		ctx.error = "flash write failure";
+		return -1;
+	}
+
+	ctx.total_blocks += ctx.chunk.chunk_sz;
+	sparse_stream_next_chunk();
+	return 0;
+}
+
+/* Write out as much of the current RAW chunk as this slice holds */
+static int sparse_stream_raw(uint8_t **buf, unsigned *len)
+{
+	uint32_t blk_sz = ctx.hdr.blk_sz;
+	uint32_t n;
+
+	if (ctx.blk_fill || *len < blk_sz)
+	{
+		/* partial block at the end of a slice */
+		n = MIN(*len, blk_sz - ctx.blk_fill);
+		memcpy(ctx.blk_buf + ctx.blk_fill, *buf, n);
+		ctx.blk_fill += n;
+
+		if (ctx.blk_fill == blk_sz)
+		{
+			if (sparse_stream_write_blocks(ctx.blk_buf, 1))
+				return -1;
+			ctx.blk_fill = 0;
+		}
+	}
+	else
+	{
+		/* whole blocks go straight from the USB buffer */
+		n = MIN(*len, ctx.remain);
+		n -= n % blk_sz;
+		if (sparse_stream_write_blocks(*buf, n / blk_sz))
+			return -1;
+	}
+
+	*buf += n;
+	*len -= n;
+	ctx.remain -= n;
+
+	if (!ctx.remain)
+		sparse_stream_next_chunk();
+
+	return 0;
+}
+
+/*
+ * Function: sparse stream write
+ * Arg     : Next slice of the download and its length
+ * Return  : 0 on success, -1 on failure with ctx.error set
+ * Flow    : Feed the slice through the chunk parser
+ */
+static int sparse_stream_write(void *data, unsigned len)
+{
+	uint8_t *buf = (uint8_t *) data;
+	uint32_t n;
+
+	while (len)
+	{
+		if (ctx.skip)
+		{
+			n = MIN(len, ctx.skip);
+			ctx.skip -= n;
+			buf += n;
+			len -= n;
+			continue;
+		}
+
+		switch (ctx.state)
+		{
+			case SPARSE_STREAM_CHUNK_HDR:
+			if (!sparse_stream_collect(&buf, &len, &ctx.chunk, sizeof(chunk_header_t)))
+				break;
+			if (sparse_stream_chunk())
+				return -1;
+			break;
+
+			case SPARSE_STREAM_RAW:
+			if (sparse_stream_raw(&buf, &len))
+				return -1;
+			break;
+
+			case SPARSE_STREAM_FILL:
+			if (!sparse_stream_collect(&buf, &len, &ctx.fill_val, sizeof(uint32_t)))
+				break;
+			if (sparse_stream_fill())
+				return -1;
+			break;
+
+			case SPARSE_STREAM_DONE:
+			ctx.error = "trailing data after sparse image";
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void sparse_stream_finish(int status)
+{
+	free(ctx.blk_buf);
+	ctx.blk_buf = NULL;
+	ctx.pending = true;
+
+	/* an arm covers one image, the next one has to name its partition */
+	fastboot_stream_arm(NULL);
+
+	if (status)
+	{
+		if (!ctx.error)
+			ctx.error = "sparse image download failed";
+		return;
+	}
+
+	dprintf(INFO, "Wrote %d blocks, expected to write %d blocks\n",
+					ctx.total_blocks, ctx.hdr.total_blks);
+
+	if (ctx.state != SPARSE_STREAM_DONE || ctx.total_blocks != ctx.hdr.total_blks)
+		ctx.error = "sparse image write failure";
+}
+
+int sparse_stream_arm(const char *name)
+{
+	int index;
+
+	index = partition_get_index_spec(name);
+	ctx.ptn = partition_get_offset(index);
+	if (ctx.ptn == 0)
+		return -1;
+
+	ctx.size = partition_get_size(index);
+	ctx.lun = partition_get_lun(index);
+	strlcpy(ctx.name, name, sizeof(ctx.name));
+	ctx.pending = false;
+
+	fastboot_stream_arm(&sparse_stream_sink);
+	return 0;
+}
+
+void sparse_stream_disarm(void)
+{
+	fastboot_stream_arm(NULL);
+	ctx.pending = false;
+}
+
+bool sparse_stream_pending(void)
+{
+	return ctx.pending;
+}
+
+void sparse_stream_complete(const char *name)
+{
+	ctx.pending = false;
+
+	if (strcmp(name, ctx.name))
+	{
+		fastboot_fail("data was streamed to another partition");
+		return;
+	}
+
+	if (ctx.error)
+	{
+		fastboot_fail(ctx.error);
+		return;
+	}
+
+	fastboot_okay("");
+}
@@ -26,6 +26,7 @@
 #include <platform.h>
 #include <mipi_dsi.h>
 #include <api_public.h>
+#include <lib/cksum.h>
 
 #if DEVICE_TREE
 #include <libfdt.h>
@@ -36,7 +37,6 @@
 #include "../grub.h"
 #include "../bootimg.h"
 
-extern unsigned int calculate_crc32(unsigned char *buffer, int len);
 extern unsigned char *update_cmdline(const char * cmdline);
 extern void generate_atags(unsigned *ptr, const char *cmdline,
                     void *ramdisk, unsigned ramdisk_size);
@@ -834,7 +834,7 @@ void api_init(void)
 	sig->version = API_SIG_VERSION;
 	sig->syscall = &syscall;
 	sig->checksum = 0;
-	sig->checksum = calculate_crc32((unsigned char *)sig,
+	sig->checksum = crc32(0, (unsigned char *)sig,
 			      sizeof(struct api_signature));
 	dprintf(INFO, "syscall entry: %p\n", sig->syscall);
 
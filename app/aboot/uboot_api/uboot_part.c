@@ -12,6 +12,10 @@
 #include <mmc.h>
 #include <partition_parser.h>
 #include <lib/tar.h>
+#if WITH_LIB_BIO
+#include <lib/bio.h>
+#include <mmc_bio.h>
+#endif
 
 #include "uboot_part.h"
 #include "../grub.h"
@@ -19,6 +23,9 @@
 static unsigned long block_read(int dev, lbaint_t start, lbaint_t blkcnt, void *buffer);
 static unsigned long block_write(int dev, lbaint_t start, lbaint_t blkcnt, const void *buffer);
 static int initialized = 0;
+#if WITH_LIB_BIO
+static bdev_t *mmc_bdev;
+#endif
 
 static block_dev_desc_t mmcdev = {
 	.type = DEV_TYPE_HARDDISK,
@@ -44,6 +51,13 @@ static unsigned long block_read(int dev, lbaint_t start, lbaint_t blkcnt, void *
 	// NAND
 	if(dev==0) {
 		unsigned long long ptn = ((unsigned long long) start)*BLOCK_SIZE;
+#if WITH_LIB_BIO
+		if(mmc_bdev) {
+			if(bio_read(mmc_bdev, buffer, ptn, blkcnt*BLOCK_SIZE) != (ssize_t)(blkcnt*BLOCK_SIZE))
+				return 0;
+			return blkcnt*BLOCK_SIZE;
+		}
+#endif
 		if(mmc_read(ptn, buffer, blkcnt*BLOCK_SIZE))
 			return 0;
 		return blkcnt*BLOCK_SIZE;
@@ -67,6 +81,13 @@ static int initialize(void) {
 	mmcdev.lba = (mmc_get_device_capacity()) / BLOCK_SIZE;
 	tardev.lba = tio->lba;
 
+#if WITH_LIB_BIO
+	// go through the raw bio device of the current lun when there is one
+	const char *name = mmc_bio_get_bdev(mmc_get_lun());
+	if(name)
+		mmc_bdev = bio_open(name);
+#endif
+
 	initialized = 1;
 	return 0;
 }
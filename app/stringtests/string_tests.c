@@ -36,29 +36,99 @@ static uint8_t *dst2;
 #define BUFFER_SIZE (4*1024)
 #define ITERATIONS 1024
 
+/* plain C versions to check the libc routines against */
+static void *ref_memmove(void *dst, const void *src, size_t len)
+{
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+    if (d < s) {
+        while (len--)
+            *d++ = *s++;
+    } else {
+        while (len--)
+            d[len] = s[len];
+    }
+    return dst;
+}
+
+static void *ref_memset(void *dst, int c, size_t len)
+{
+    uint8_t *d = dst;
+
+    while (len--)
+        *d++ = c;
+    return dst;
+}
+
+static int ref_memcmp(const void *a, const void *b, size_t len)
+{
+    const uint8_t *x = a, *y = b;
+
+    for (; len; len--, x++, y++) {
+        if (*x != *y)
+            return *x - *y;
+    }
+    return 0;
+}
+
+static size_t ref_strlen(const char *s)
+{
+    size_t i = 0;
+
+    while (s[i])
+        i++;
+    return i;
+}
+
+static void *ref_memchr(const void *buf, int c, size_t len)
+{
+    const uint8_t *b = buf;
+
+    for (; len; len--, b++) {
+        if (*b == (uint8_t)c)
+            return (void *)b;
+    }
+    return NULL;
+}
+
+#if ARCH_arm
 extern void *mymemcpy(void *dst, const void *src, size_t len);
 extern void *mymemset(void *dst, int c, size_t len);
+#else
+/* no work in progress versions here, measure against the C ones */
+#define mymemcpy ref_memmove
+#define mymemset ref_memset
+#endif
 
 static void *null_memcpy(void *dst, const void *src, size_t len)
 {
     return dst;
 }
 
-static lk_time_t bench_memcpy_routine(void *memcpy_routine(void *, const void *, size_t), size_t srcalign, size_t dstalign)
+/* bytes per usec is MB/s */
+static void print_rate(const char *name, lk_bigtime_t usecs, uint64_t bytes)
+{
+    unsigned long long mbs = bytes / (usecs ? usecs : 1);
+
+    printf("%s %llu usecs, %llu.%02llu GB/s; ", name, usecs, mbs / 1000, (mbs % 1000) / 10);
+}
+
+static lk_bigtime_t bench_memcpy_routine(void *memcpy_routine(void *, const void *, size_t), size_t srcalign, size_t dstalign)
 {
     int i;
-    lk_time_t t0;
+    lk_bigtime_t t0;
 
-    t0 = current_time();
+    t0 = current_time_hires();
     for (i=0; i < ITERATIONS; i++) {
         memcpy_routine(dst + dstalign, src + srcalign, BUFFER_SIZE);
     }
-    return current_time() - t0;
+    return current_time_hires() - t0;
 }
 
 static void bench_memcpy(void)
 {
-    lk_time_t null, libc, mine;
+    lk_bigtime_t null, libc, mine;
     size_t srcalign, dstalign;
 
     printf("memcpy speed test\n");
@@ -72,9 +142,9 @@ static void bench_memcpy(void)
             mine = bench_memcpy_routine(&mymemcpy, srcalign, dstalign);
 
             printf("srcalign %zu, dstalign %zu: ", srcalign, dstalign);
-            printf("   null memcpy %lu msecs\n", null);
-            printf("libc memcpy %lu msecs, %llu bytes/sec; ", libc, BUFFER_SIZE * ITERATIONS * 1000ULL / libc);
-            printf("my memcpy %lu msecs, %llu bytes/sec; ", mine, BUFFER_SIZE * ITERATIONS * 1000ULL / mine);
+            printf("   null memcpy %llu usecs\n", null);
+            print_rate("libc memcpy", libc, (uint64_t)BUFFER_SIZE * ITERATIONS);
+            print_rate("my memcpy", mine, (uint64_t)BUFFER_SIZE * ITERATIONS);
             printf("\n");
 
             if (dstalign < 8)
@@ -87,6 +157,27 @@ static void bench_memcpy(void)
         else
             srcalign <<= 1;
     }
+
+    /* overlapping moves either way, as when relocating a kernel in place */
+    for (srcalign = 1; srcalign <= 64; srcalign <<= 3) {
+        lk_bigtime_t up, down;
+        int i;
+
+        up = current_time_hires();
+        for (i = 0; i < ITERATIONS; i++)
+            memmove(dst + srcalign, dst, BUFFER_SIZE);
+        up = current_time_hires() - up;
+
+        down = current_time_hires();
+        for (i = 0; i < ITERATIONS; i++)
+            memmove(dst, dst + srcalign, BUFFER_SIZE);
+        down = current_time_hires() - down;
+
+        printf("memmove by %zu: ", srcalign);
+        print_rate("up", up, (uint64_t)BUFFER_SIZE * ITERATIONS);
+        print_rate("down", down, (uint64_t)BUFFER_SIZE * ITERATIONS);
+        printf("\n");
+    }
 }
 
 static void fillbuf(void *ptr, size_t len, uint32_t seed)
@@ -135,21 +226,50 @@ static void validate_memcpy(void)
     }
 }
 
-static lk_time_t bench_memset_routine(void *memset_routine(void *, int, size_t), size_t dstalign, size_t len)
+static void validate_memmove(void)
+{
+    size_t align, size;
+    int shift;
+    const size_t maxsize = 256;
+
+    printf("testing memmove for correctness\n");
+
+    /* every overlap distance in both directions, within one buffer */
+    for (align = 0; align < 16; align++) {
+        printf("align %zu\n", align);
+        for (shift = -80; shift <= 80; shift++) {
+            for (size = 0; size < maxsize; size++) {
+                uint8_t *from = dst + 128 + align;
+
+                fillbuf(dst, maxsize * 2, 123514);
+                fillbuf(dst2, maxsize * 2, 123514);
+
+                memmove(from + shift, from, size);
+                ref_memmove(dst2 + 128 + align + shift, dst2 + 128 + align, size);
+
+                if (memcmp(dst, dst2, maxsize * 2) != 0) {
+                    printf("error! align %zu, shift %d, size %zu\n", align, shift, size);
+                }
+            }
+        }
+    }
+}
+
+static lk_bigtime_t bench_memset_routine(void *memset_routine(void *, int, size_t), size_t dstalign, size_t len)
 {
     int i;
-    lk_time_t t0;
+    lk_bigtime_t t0;
 
-    t0 = current_time();
+    t0 = current_time_hires();
     for (i=0; i < ITERATIONS; i++) {
         memset_routine(dst + dstalign, 0, len);
     }
-    return current_time() - t0;
+    return current_time_hires() - t0;
 }
 
 static void bench_memset(void)
 {
-    lk_time_t libc, mine;
+    lk_bigtime_t libc, mine;
     size_t dstalign;
 
     printf("memset speed test\n");
@@ -161,8 +281,8 @@ static void bench_memset(void)
         mine = bench_memset_routine(&mymemset, dstalign, BUFFER_SIZE);
 
         printf("dstalign %zu: ", dstalign);
-        printf("libc memset %lu msecs, %llu bytes/sec; ", libc, BUFFER_SIZE * ITERATIONS * 1000ULL / libc);
-        printf("my memset %lu msecs, %llu bytes/sec; ", mine, BUFFER_SIZE * ITERATIONS * 1000ULL / mine);
+        print_rate("libc memset", libc, (uint64_t)BUFFER_SIZE * ITERATIONS);
+        print_rate("my memset", mine, (uint64_t)BUFFER_SIZE * ITERATIONS);
         printf("\n");
     }
 }
@@ -195,6 +315,110 @@ static void validate_memset(void)
     }
 }
 
+static int sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+static void validate_memcmp(void)
+{
+    size_t align1, align2, size, i;
+    const size_t maxsize = 256;
+
+    printf("testing memcmp for correctness\n");
+
+    for (align1 = 0; align1 < 16; align1++) {
+        printf("align %zu\n", align1);
+        for (align2 = 0; align2 < 16; align2++) {
+            for (size = 0; size < maxsize; size++) {
+                uint8_t *a = src + align1, *b = dst + align2;
+
+                /* equal, then a difference either way at each end and in the middle */
+                fillbuf(a, size, 567);
+                fillbuf(b, size, 567);
+                if (memcmp(a, b, size) != 0)
+                    printf("error! align %zu/%zu, size %zu, equal\n", align1, align2, size);
+
+                for (i = 0; i < size; i += (size / 3) ? size / 3 : 1) {
+                    b[i] ^= 0x80;
+                    if (sign(memcmp(a, b, size)) != sign(ref_memcmp(a, b, size)) ||
+                            sign(memcmp(b, a, size)) != sign(ref_memcmp(b, a, size)))
+                        printf("error! align %zu/%zu, size %zu, differs at %zu\n", align1, align2, size, i);
+                    b[i] ^= 0x80;
+                }
+            }
+        }
+    }
+}
+
+static void validate_strlen(void)
+{
+    size_t align, len;
+    const size_t maxsize = 256;
+
+    printf("testing strlen and memchr for correctness\n");
+
+    for (align = 0; align < 64; align++) {
+        for (len = 0; len < maxsize; len++) {
+            char *s = (char *)dst + align;
+            size_t limit;
+
+            memset(dst, 'a', maxsize * 2);
+            s[len] = 0;
+            if (strlen(s) != ref_strlen(s))
+                printf("error! strlen align %zu, len %zu\n", align, len);
+
+            /* the terminator searched for with every limit around it */
+            for (limit = (len > 17) ? len - 17 : 0; limit < len + 17; limit++) {
+                if (memchr(s, 0, limit) != ref_memchr(s, 0, limit) ||
+                        memchr(s, 'a' + 256, limit) != ref_memchr(s, 'a', limit))
+                    printf("error! memchr align %zu, len %zu, limit %zu\n", align, len, limit);
+            }
+        }
+    }
+}
+
+/* results land here so the calls can't be thrown away */
+static volatile size_t sink;
+
+static void bench_string_routines(void)
+{
+    lk_bigtime_t t;
+    size_t align;
+    int i;
+
+    printf("memcmp, strlen, memchr speed test\n");
+    thread_sleep(200); // let the debug string clear the serial port
+
+    fillbuf(src, BUFFER_SIZE, 567);
+    memcpy(dst + 1, src, BUFFER_SIZE);
+    memset(src2, 'a', BUFFER_SIZE);
+    src2[BUFFER_SIZE - 1] = 0;
+
+    for (align = 0; align < 2; align++) {
+        t = current_time_hires();
+        for (i = 0; i < ITERATIONS; i++)
+            sink += memcmp(src, dst + align, BUFFER_SIZE);
+        t = current_time_hires() - t;
+        printf("%s: ", align ? "misaligned" : "aligned");
+        print_rate("memcmp", t, (uint64_t)BUFFER_SIZE * ITERATIONS);
+        printf("\n");
+    }
+
+    t = current_time_hires();
+    for (i = 0; i < ITERATIONS; i++)
+        sink += strlen((char *)src2);
+    t = current_time_hires() - t;
+    print_rate("strlen", t, (uint64_t)BUFFER_SIZE * ITERATIONS);
+
+    t = current_time_hires();
+    for (i = 0; i < ITERATIONS; i++)
+        sink += (uintptr_t)memchr(src2, 0, BUFFER_SIZE);
+    t = current_time_hires() - t;
+    print_rate("memchr", t, (uint64_t)BUFFER_SIZE * ITERATIONS);
+    printf("\n");
+}
+
 #if defined(WITH_LIB_CONSOLE)
 #include <lib/console.h>
 
@@ -218,20 +442,29 @@ static int string_tests(int argc, const cmd_args *argv)
 usage:
         printf("%s validate <routine>\n", argv[0].str);
         printf("%s bench <routine>\n", argv[0].str);
+        printf("routines: memcpy, memmove, memset, memcmp, strlen (validate), string (bench)\n");
         goto out;
     }
 
     if (!strcmp(argv[1].str, "validate")) {
         if (!strcmp(argv[2].str, "memcpy")) {
             validate_memcpy();
+        } else if (!strcmp(argv[2].str, "memmove")) {
+            validate_memmove();
         } else if (!strcmp(argv[2].str, "memset")) {
             validate_memset();
+        } else if (!strcmp(argv[2].str, "memcmp")) {
+            validate_memcmp();
+        } else if (!strcmp(argv[2].str, "strlen")) {
+            validate_strlen();
         }
     } else if (!strcmp(argv[1].str, "bench")) {
         if (!strcmp(argv[2].str, "memcpy")) {
             bench_memcpy();
         } else if (!strcmp(argv[2].str, "memset")) {
             bench_memset();
+        } else if (!strcmp(argv[2].str, "string")) {
+            bench_string_routines();
         }
     } else {
         goto usage;
@@ -254,4 +487,3 @@ STATIC_COMMAND_END(stringtests);
 
 APP_START(stringtests)
 APP_END
-
@@ -26,12 +26,18 @@
 #include <err.h>
 #include <stdlib.h>
 #include <string.h>
+#include <malloc.h>
 #include <app/tests.h>
 #include <kernel/thread.h>
 #include <kernel/mutex.h>
 #include <kernel/semaphore.h>
 #include <kernel/event.h>
 #include <platform.h>
+#include <lib/cksum.h>
+#include <lib/workq.h>
+#if WITH_LIB_OPENSSL
+#include <sha/sha.h>
+#endif
 
 #if ARCH_ARM
 void bench_set_overhead(void)
@@ -57,25 +63,6 @@ void bench_set_overhead(void)
 	free(buf);
 }
 
-void bench_memset(void)
-{
-	const uint BUFSIZE = 4096;
-	const uint ITER = 4096;
-	void *buf = malloc(BUFSIZE);
-	printf("buf %p\n", buf);
-
-	uint count = arch_cycle_count();
-	for (uint i = 0; i < ITER; i++) {
-		memset(buf, 0, BUFSIZE);
-	}
-	count = arch_cycle_count() - count;
-
-	printf("took %u cycles to memset a buffer of size %u %d times (%u bytes)\n",
-	       count, BUFSIZE, ITER, BUFSIZE * ITER);
-
-	free(buf);
-}
-
 #define bench_cset(type) \
 void bench_cset_##type(void) \
 { \
@@ -155,39 +142,269 @@ void bench_cset_stm(void)
 	free(buf);
 }
 
+#endif
+
+#define STRING_BENCH_SIZE	(1024 * 1024)
+#define STRING_BENCH_ITER	16
+
+static const uint string_bench_align[] = { 0, 1, 3, 8, 16, 63 };
+
+/* bytes per usec is MB/s */
+static void string_bench_report(const char *name, uint srcalign, uint dstalign, lk_bigtime_t t)
+{
+	unsigned long long mbs = (unsigned long long)STRING_BENCH_SIZE * STRING_BENCH_ITER / (t ? t : 1);
+
+	printf("%s src +%u dst +%u: %llu usecs, %llu.%02llu GB/s\n", name, srcalign, dstalign,
+	       t, mbs / 1000, (mbs % 1000) / 10);
+}
+
+void bench_memset(void)
+{
+	uint8_t *buf = memalign(64, STRING_BENCH_SIZE + 64);
+	lk_bigtime_t t;
+
+	if (!buf)
+		return;
+
+	for (uint a = 0; a < countof(string_bench_align); a++) {
+		uint align = string_bench_align[a];
+
+		t = current_time_hires();
+		for (uint i = 0; i < STRING_BENCH_ITER; i++)
+			memset(buf + align, 0, STRING_BENCH_SIZE);
+		t = current_time_hires() - t;
+		string_bench_report("memset 0", 0, align, t);
+
+		t = current_time_hires();
+		for (uint i = 0; i < STRING_BENCH_ITER; i++)
+			memset(buf + align, 0x5a, STRING_BENCH_SIZE);
+		t = current_time_hires() - t;
+		string_bench_report("memset 0x5a", 0, align, t);
+	}
+
+	free(buf);
+}
 
 void bench_memcpy(void)
 {
-	const uint BUFSIZE = 4096;
-	const uint ITER = 4096;
+	uint8_t *src = memalign(64, STRING_BENCH_SIZE + 64);
+	uint8_t *dst = memalign(64, STRING_BENCH_SIZE + 64);
+	lk_bigtime_t t;
+
+	if (!src || !dst)
+		goto out;
+
+	memset(src, 0x5a, STRING_BENCH_SIZE + 64);
+
+	for (uint s = 0; s < countof(string_bench_align); s++) {
+		for (uint d = 0; d < countof(string_bench_align); d++) {
+			t = current_time_hires();
+			for (uint i = 0; i < STRING_BENCH_ITER; i++)
+				memcpy(dst + string_bench_align[d], src + string_bench_align[s], STRING_BENCH_SIZE);
+			t = current_time_hires() - t;
+			string_bench_report("memcpy", string_bench_align[s], string_bench_align[d], t);
+		}
+	}
+
+	/* in place moves up and down, as when shifting a kernel or ramdisk */
+	t = current_time_hires();
+	for (uint i = 0; i < STRING_BENCH_ITER; i++)
+		memmove(src + 64, src, STRING_BENCH_SIZE);
+	t = current_time_hires() - t;
+	string_bench_report("memmove up", 0, 64, t);
+
+	t = current_time_hires();
+	for (uint i = 0; i < STRING_BENCH_ITER; i++)
+		memmove(src, src + 1, STRING_BENCH_SIZE);
+	t = current_time_hires() - t;
+	string_bench_report("memmove down", 1, 0, t);
+
+out:
+	free(dst);
+	free(src);
+}
+
+/* bit at a time reference, as GPT header/entry crcs used to be computed */
+static uint32_t crc32_bitwise(uint32_t crc, const uint8_t *buf, uint len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *buf++;
+		for (uint i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xedb88320 : 0);
+	}
+	return ~crc;
+}
+
+void bench_crc32(void)
+{
+	const uint BUFSIZE = 16384;	/* GPT partition entry array */
+	const uint ITER = 64;
 	uint8_t *buf = malloc(BUFSIZE);
-	printf("buf %p\n", buf);
+	lk_bigtime_t t;
+	uint32_t crc, ref;
 
-	uint count = arch_cycle_count();
-	for (uint i = 0; i < ITER; i++) {
-		memcpy(buf, buf + BUFSIZE / 2, BUFSIZE / 2);
+	if (!buf)
+		return;
+	for (uint i = 0; i < BUFSIZE; i++)
+		buf[i] = rand();
+
+	/* check every alignment/length combination for the tail handling */
+	for (uint i = 0; i < 8; i++) {
+		for (uint j = 0; j < 64; j++) {
+			if (crc32(0, buf + i, j) != crc32_bitwise(0, buf + i, j)) {
+				printf("crc32 mismatch at offset %u len %u\n", i, j);
+				goto out;
+			}
+		}
 	}
-	count = arch_cycle_count() - count;
 
-	printf("took %u cycles to memcpy a buffer of size %u %d times (%u bytes)\n",
-	       count, BUFSIZE / 2, ITER, BUFSIZE * ITER);
+	t = current_time_hires();
+	ref = 0;
+	for (uint i = 0; i < ITER; i++)
+		ref = crc32_bitwise(ref, buf, BUFSIZE);
+	t = current_time_hires() - t;
 
+	printf("took %llu usecs to bitwise crc32 %u bytes (%llu bytes/sec)\n",
+	       t, BUFSIZE * ITER, (BUFSIZE * ITER) * 1000000ULL / (t ? t : 1));
+
+	t = current_time_hires();
+	crc = 0;
+	for (uint i = 0; i < ITER; i++)
+		crc = crc32(crc, buf, BUFSIZE);
+	t = current_time_hires() - t;
+
+	printf("took %llu usecs to crc32 %u bytes (%llu bytes/sec)%s\n",
+	       t, BUFSIZE * ITER, (BUFSIZE * ITER) * 1000000ULL / (t ? t : 1),
+	       crc == ref ? "" : " MISMATCH");
+
+out:
 	free(buf);
 }
-#endif
 
 void benchmarks(void)
 {
 #if ARCH_ARM
 	bench_set_overhead();
-	bench_memset();
 	bench_cset_uint8_t();
 	bench_cset_uint16_t();
 	bench_cset_uint32_t();
 	bench_cset_uint64_t();
 	bench_cset_wide();
 	bench_cset_stm();
-	bench_memcpy();
 #endif
+	bench_memset();
+	bench_memcpy();
+	bench_crc32();
+}
+
+
+#define WORKQ_BENCH_SIZE (64 * 1024 * 1024)
+#define WORKQ_BENCH_CHUNK (256 * 1024)
+
+struct workq_bench_state {
+	uint8_t *buf;
+	uint32_t *crcs;
+	uint8_t *digests;
+};
+
+static lk_bigtime_t workq_bench_time(parallel_for_callback cb, struct workq_bench_state *s,
+                                     size_t count, bool parallel)
+{
+	lk_bigtime_t t = current_time_hires();
+
+	if (parallel)
+		parallel_for(0, count, 1, cb, s);
+	else
+		cb(0, count, s);
+
+	return current_time_hires() - t;
+}
+
+static void workq_bench_report(const char *name, lk_bigtime_t serial, lk_bigtime_t parallel)
+{
+	printf("%s: serial %llu usecs, parallel %llu usecs, speedup %llu.%02llux\n",
+	       name, serial, parallel,
+	       serial / (parallel ? parallel : 1),
+	       (serial * 100 / (parallel ? parallel : 1)) % 100);
 }
 
+/* copy the lower half of the buffer over the upper half */
+static void workq_bench_memcpy(size_t start, size_t end, void *arg)
+{
+	struct workq_bench_state *s = arg;
+	size_t half = WORKQ_BENCH_SIZE / 2;
+
+	for (size_t i = start; i < end; i++)
+		memcpy(s->buf + half + i * WORKQ_BENCH_CHUNK, s->buf + i * WORKQ_BENCH_CHUNK,
+		       WORKQ_BENCH_CHUNK);
+}
+
+static void workq_bench_crc32(size_t start, size_t end, void *arg)
+{
+	struct workq_bench_state *s = arg;
+
+	for (size_t i = start; i < end; i++)
+		s->crcs[i] = crc32(0, s->buf + i * WORKQ_BENCH_CHUNK, WORKQ_BENCH_CHUNK);
+}
+
+#if WITH_LIB_OPENSSL
+/* one digest per chunk, as when hashing several partitions at once */
+static void workq_bench_sha256(size_t start, size_t end, void *arg)
+{
+	struct workq_bench_state *s = arg;
+
+	for (size_t i = start; i < end; i++)
+		SHA256(s->buf + i * WORKQ_BENCH_CHUNK, WORKQ_BENCH_CHUNK,
+		       s->digests + i * SHA256_DIGEST_LENGTH);
+}
+#endif
+
+int workq_bench(int argc, const cmd_args *argv)
+{
+	const size_t chunks = WORKQ_BENCH_SIZE / WORKQ_BENCH_CHUNK;
+	struct workq_bench_state s;
+	lk_bigtime_t serial, parallel;
+	uint32_t crc, ref;
+
+	s.buf = malloc(WORKQ_BENCH_SIZE);
+	s.crcs = malloc(chunks * sizeof(uint32_t));
+	s.digests = malloc(chunks * 32);	/* SHA256_DIGEST_LENGTH */
+	if (!s.buf || !s.crcs || !s.digests) {
+		printf("failed to allocate %u byte buffer\n", WORKQ_BENCH_SIZE);
+		goto out;
+	}
+
+	for (size_t i = 0; i < WORKQ_BENCH_SIZE / sizeof(uint32_t); i++)
+		((uint32_t *)s.buf)[i] = rand();
+
+	printf("%u workers, %u byte buffer in %u byte chunks\n",
+	       workq_num_workers(), WORKQ_BENCH_SIZE, WORKQ_BENCH_CHUNK);
+
+	serial = workq_bench_time(workq_bench_memcpy, &s, chunks / 2, false);
+	parallel = workq_bench_time(workq_bench_memcpy, &s, chunks / 2, true);
+	workq_bench_report("memcpy", serial, parallel);
+
+	/* per chunk crcs folded back together must match the whole buffer crc */
+	serial = workq_bench_time(workq_bench_crc32, &s, chunks, false);
+	ref = crc32(0, s.buf, WORKQ_BENCH_SIZE);
+	parallel = workq_bench_time(workq_bench_crc32, &s, chunks, true);
+	crc = s.crcs[0];
+	for (size_t i = 1; i < chunks; i++)
+		crc = crc32_combine(crc, s.crcs[i], WORKQ_BENCH_CHUNK);
+	workq_bench_report("crc32", serial, parallel);
+	if (crc != ref)
+		printf("crc32 MISMATCH %08x != %08x\n", crc, ref);
+
+#if WITH_LIB_OPENSSL
+	serial = workq_bench_time(workq_bench_sha256, &s, chunks, false);
+	parallel = workq_bench_time(workq_bench_sha256, &s, chunks, true);
+	workq_bench_report("sha256", serial, parallel);
+#endif
+
+out:
+	free(s.digests);
+	free(s.crcs);
+	free(s.buf);
+	return 0;
+}
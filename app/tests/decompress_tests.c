@@ -0,0 +1,162 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <app/tests.h>
+#include <platform.h>
+#include <lib/decompress.h>
+
+#if MMC_SDHCI_SUPPORT
+#include <mmc.h>
+#include <partition_parser.h>
+#include "../aboot/bootimg.h"
+
+static void decompress_bench_report(const char *name, lk_time_t tim, uint64_t len)
+{
+	printf("%-24s %8u msecs", name, tim);
+	if (tim)
+		printf(" %6llu KB/s", (len / 1024) * 1000 / tim);
+	printf("\n");
+}
+
+/*
+ * Boot the kernel of a boot image the slow way and the fast way: read the
+ * compressed kernel and inflate it, then read as many bytes as the
+ * decompressed kernel takes, which is what an uncompressed image costs.
+ */
+int decompress_bench(int argc, const cmd_args *argv)
+{
+	struct boot_img_hdr *hdr;
+	unsigned long long ptn;
+	unsigned long long size;
+	enum decompress_type type;
+	uint32_t page, kernel_len, raw_len;
+	size_t out_len, out_size;
+	uint8_t *in = NULL, *out = NULL;
+	lk_time_t tim, tread, tdec;
+	status_t err;
+	int index;
+
+	if (argc < 2) {
+		printf("usage: %s <partition> [output buffer MB]\n", argv[0].str);
+		return ERR_INVALID_ARGS;
+	}
+
+	index = partition_get_index(argv[1].str);
+	ptn = partition_get_offset(index);
+	size = partition_get_size(index);
+	if (!ptn) {
+		printf("unknown partition %s\n", argv[1].str);
+		return ERR_NOT_FOUND;
+	}
+
+	mmc_set_lun(partition_get_lun(index));
+
+	hdr = memalign(CACHE_LINE, BOOT_IMG_MAX_PAGE_SIZE);
+	if (!hdr)
+		return ERR_NO_MEMORY;
+
+	err = ERR_NOT_VALID;
+	if (mmc_read(ptn, (unsigned int *) hdr, BOOT_IMG_MAX_PAGE_SIZE) ||
+	    memcmp(hdr->magic, BOOT_MAGIC, BOOT_MAGIC_SIZE)) {
+		printf("no boot image in %s\n", argv[1].str);
+		goto out;
+	}
+
+	page = hdr->page_size ? hdr->page_size : 2048;
+	kernel_len = ROUNDUP(hdr->kernel_size, page);
+	if (page > BOOT_IMG_MAX_PAGE_SIZE || page + kernel_len > size) {
+		printf("bad boot image header\n");
+		goto out;
+	}
+
+	out_size = (argc > 2 ? argv[2].u : 64) * 1024 * 1024;
+
+	err = ERR_NO_MEMORY;
+	in = memalign(CACHE_LINE, kernel_len);
+	out = memalign(CACHE_LINE, out_size);
+	if (!in || !out)
+		goto out;
+
+	tim = current_time();
+	if (mmc_read(ptn + page, (unsigned int *) in, kernel_len)) {
+		printf("read failed\n");
+		err = ERR_IO;
+		goto out;
+	}
+	tread = current_time() - tim;
+
+	type = decompress_detect(in, hdr->kernel_size);
+	if (type == DECOMPRESS_NONE) {
+		printf("kernel is not compressed\n");
+		decompress_bench_report("raw read", tread, kernel_len);
+		err = NO_ERROR;
+		goto out;
+	}
+
+	tim = current_time();
+	err = decompress(in, hdr->kernel_size, out, out_size, &out_len, NULL);
+	tdec = current_time() - tim;
+	if (err < 0) {
+		printf("%s decompression failed: %d\n", decompress_type_name(type), err);
+		goto out;
+	}
+
+	printf("%s kernel, %u bytes, %u decompressed\n", decompress_type_name(type),
+	       hdr->kernel_size, (unsigned) out_len);
+
+	decompress_bench_report("compressed read", tread, hdr->kernel_size);
+	decompress_bench_report("decompress", tdec, out_len);
+	decompress_bench_report("read + decompress", tread + tdec, out_len);
+
+	/* the same number of bytes read straight into place */
+	raw_len = ROUNDUP(out_len, page);
+	if (raw_len > size - page)
+		raw_len = ROUNDDOWN(size - page, page);
+	if (raw_len > out_size)
+		raw_len = ROUNDDOWN(out_size, page);
+
+	tim = current_time();
+	if (mmc_read(ptn + page, (unsigned int *) out, raw_len)) {
+		printf("read failed\n");
+		err = ERR_IO;
+		goto out;
+	}
+	decompress_bench_report("raw read", current_time() - tim, raw_len);
+
+out:
+	free(out);
+	free(in);
+	free(hdr);
+
+	return err;
+}
+#endif
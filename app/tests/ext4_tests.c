@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <err.h>
+#include <app/tests.h>
+#include <platform.h>
+
+#if WITH_LIB_EXT4 && WITH_LIB_BIO
+#include <lib/bio.h>
+#include <ext4.h>
+#include <ext4_biodev.h>
+
+#define EXT4_BENCH_BDEV       "ext4bench"
+#define EXT4_BENCH_MOUNTPOINT "/ext4bench/"
+#define EXT4_BENCH_CHUNK      (1024 * 1024)
+
+static void ext4_bench_report(const char *name, lk_bigtime_t t, uint64_t len)
+{
+	printf("%-24s %8llu usecs", name, t);
+	if (t)
+		printf(" %6llu KB/s", (len / 1024) * 1000000ULL / t);
+	printf("\n");
+}
+
+/* Read the whole file in chunks of the given size, return the time taken */
+static int ext4_bench_read(const char *path, void *buf, uint32_t chunk,
+	uint64_t *len, lk_bigtime_t *t)
+{
+	ext4_file f;
+	uint32_t rcnt;
+	int r;
+
+	r = ext4_fopen(&f, path, "rb");
+	if (r != EOK)
+		return r;
+
+	*len = 0;
+	*t = current_time_hires();
+	do {
+		r = ext4_fread(&f, buf, chunk, &rcnt);
+		*len += rcnt;
+	} while (r == EOK && rcnt == chunk);
+	*t = current_time_hires() - *t;
+
+	ext4_fclose(&f);
+	return r;
+}
+
+/*
+ * Time reading a file out of an ext4 image in memory, first with large
+ * reads that go straight to the device one extent at a time, then 4KB at
+ * a time, the block size sized reads grub's own ext4 driver does.
+ */
+int ext4_read_bench(int argc, const cmd_args *argv)
+{
+	static bool mounted;
+	char path[128];
+	lk_bigtime_t t;
+	uint64_t len;
+	void *buf;
+	int r;
+
+	if (argc < 4) {
+		printf("usage: %s <image address> <image size> <file path>\n", argv[0].str);
+		return ERR_INVALID_ARGS;
+	}
+
+	if (!mounted) {
+		create_membdev(EXT4_BENCH_BDEV, (void *)argv[1].u, argv[2].u);
+
+		r = ext4_device_register(ext4_biodev_get(EXT4_BENCH_BDEV), 0,
+			EXT4_BENCH_BDEV);
+		if (r == EOK)
+			r = ext4_mount(EXT4_BENCH_BDEV, EXT4_BENCH_MOUNTPOINT);
+		if (r != EOK) {
+			printf("failed to mount the image: %d\n", r);
+			return ERR_GENERIC;
+		}
+		mounted = true;
+	} else {
+		printf("reusing the image mounted by the first run\n");
+	}
+
+	snprintf(path, sizeof(path), "%s%s", EXT4_BENCH_MOUNTPOINT,
+		argv[3].str[0] == '/' ? argv[3].str + 1 : argv[3].str);
+
+	buf = malloc(EXT4_BENCH_CHUNK);
+	if (!buf)
+		return ERR_NO_MEMORY;
+
+	r = ext4_bench_read(path, buf, EXT4_BENCH_CHUNK, &len, &t);
+	if (r != EOK) {
+		printf("failed to read %s: %d\n", path, r);
+		goto out;
+	}
+	printf("read %llu bytes of %s\n", len, path);
+	ext4_bench_report("1MB reads", t, len);
+
+	r = ext4_bench_read(path, buf, 4096, &len, &t);
+	if (r == EOK)
+		ext4_bench_report("4KB reads", t, len);
+
+out:
+	free(buf);
+	return r == EOK ? NO_ERROR : ERR_IO;
+}
+#endif
@@ -0,0 +1,120 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <printf.h>
+#include <err.h>
+#include <app/tests.h>
+#include <platform.h>
+
+#if WITH_DEV_FBCON
+#include <dev/fbcon.h>
+
+#define FBCON_BENCH_LINES	2000
+
+static void fbcon_bench_puts(const char *s)
+{
+	while (*s)
+		fbcon_putc(*s++);
+}
+
+/* print lines straight at the console, so the uart doesn't set the pace */
+static lk_bigtime_t fbcon_flood(unsigned lines, bool flush_each_line)
+{
+	char line[80];
+	lk_bigtime_t t;
+	unsigned i;
+
+	t = current_time_hires();
+	for (i = 0; i < lines; i++) {
+		snprintf(line, sizeof(line), "fbcon flood %6u: the quick brown fox jumps over the lazy dog\n", i);
+		fbcon_bench_puts(line);
+		if (flush_each_line)
+			fbcon_flush();
+	}
+	fbcon_flush();
+
+	return current_time_hires() - t;
+}
+
+static void fbcon_bench_report(const char *name, unsigned lines, lk_bigtime_t t)
+{
+	printf("%-20s %10llu usecs", name, t);
+	if (t)
+		printf(" %8llu lines/s", (uint64_t)lines * 1000000 / t);
+	printf("\n");
+}
+
+/*
+ * Flood the framebuffer console: scrolling by moving the text up and
+ * updating the panel after every line the way the console used to, then
+ * with ring scrolling, per line and left to the periodic flush.
+ */
+int fbcon_bench(int argc, const cmd_args *argv)
+{
+	struct fbcon_config *config = fbcon_display();
+	unsigned lines = FBCON_BENCH_LINES;
+	lk_bigtime_t tmove, tline = 0, tcoalesced;
+	bool ring;
+
+	if (!config) {
+		printf("no framebuffer console\n");
+		return ERR_NOT_FOUND;
+	}
+
+	if (argc > 1)
+		lines = argv[1].u;
+	if (!lines)
+		return ERR_INVALID_ARGS;
+
+	printf("%ux%u %ubpp stride %u, %u lines\n", config->width, config->height,
+	       config->bpp, config->stride, lines);
+
+	ring = fbcon_set_ring_scroll(false);
+	tmove = fbcon_flood(lines, true);
+	fbcon_set_ring_scroll(ring);
+
+	if (ring)
+		tline = fbcon_flood(lines, true);
+	tcoalesced = fbcon_flood(lines, false);
+
+	fbcon_bench_report("memmove every line", lines, tmove);
+	if (ring)
+		fbcon_bench_report("ring every line", lines, tline);
+	else
+		printf("no panel update hook, ring scrolling not used\n");
+	fbcon_bench_report("coalesced", lines, tcoalesced);
+	if (tcoalesced)
+		printf("speedup %llu.%02llux\n", tmove / tcoalesced,
+		       tmove * 100 / tcoalesced % 100);
+
+	return NO_ERROR;
+}
+#endif
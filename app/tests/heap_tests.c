@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <string.h>
+#include <stdio.h>
+#include <app/tests.h>
+#include <platform.h>
+#include <lib/heap.h>
+
+/*
+ * Heap calls of an msm8916 eMMC boot to fastboot, in the format a HEAP_TRACE=1
+ * build dumps with "fastboot oem heap-trace": { slot, align, size }, where
+ * align 0 is a malloc and size 0 frees the slot. Replace the table with a
+ * dump from the target being tuned.
+ */
+static const struct heap_trace_op heap_boot_trace[] = {
+	/* bootstrap2 thread */
+	{   0,    0,   128 }, {   1,    0,  4096 },
+	/* init hooks: bio device list, log drain and fbcon flush threads */
+	{   2,    0,    36 }, {   3,    0,   128 }, {   4,    0,  4096 },
+	{   5,    0,   128 }, {   6,    0,  4096 },
+	/* target_init: spmi channels, sdhci host and card, HS200 tuning */
+	{   7,    0,  4096 }, {   8,    0,   264 }, {   9,    0,    16 },
+	{  10,   64,  4224 }, {  11,   64,   512 }, {  12,   64,   128 },
+	{  12,    0,     0 },
+	/* partition_read_table: entry array, MBR and GPT header blocks */
+	{  12,    0, 19456 }, {  13,   64,   512 }, {  13,    0,     0 },
+	{  13,   64,   512 }, {  13,    0,     0 },
+	/* bio devices for the card and each of its 31 partitions */
+	{  13,    0,   144 }, {  14,    0,     5 }, {  15,    0,   144 },
+	{  16,    0,     6 }, {  17,    0,   144 }, {  18,    0,     5 },
+	{  19,    0,   144 }, {  20,    0,     8 }, {  21,    0,   144 },
+	{  22,    0,     6 }, {  23,    0,   144 }, {  24,    0,     9 },
+	{  25,    0,   144 }, {  26,    0,     4 }, {  27,    0,   144 },
+	{  28,    0,     7 }, {  29,    0,   144 }, {  30,    0,     3 },
+	{  31,    0,   144 }, {  32,    0,     6 }, {  33,    0,   144 },
+	{  34,    0,     4 }, {  35,    0,   144 }, {  36,    0,     7 },
+	{  37,    0,   144 }, {  38,    0,     4 }, {  39,    0,   144 },
+	{  40,    0,     9 }, {  41,    0,   144 }, {  42,    0,     9 },
+	{  43,    0,   144 }, {  44,    0,     5 }, {  45,    0,   144 },
+	{  46,    0,     4 }, {  47,    0,   144 }, {  48,    0,     4 },
+	{  49,    0,   144 }, {  50,    0,     7 }, {  51,    0,   144 },
+	{  52,    0,     4 }, {  53,    0,   144 }, {  54,    0,     4 },
+	{  55,    0,   144 }, {  56,    0,     4 }, {  57,    0,   144 },
+	{  58,    0,     5 }, {  59,    0,   144 }, {  60,    0,     7 },
+	{  61,    0,   144 }, {  62,    0,     8 }, {  63,    0,   144 },
+	{  64,    0,     6 }, {  65,    0,   144 }, {  66,    0,     9 },
+	{  67,    0,   144 }, {  68,    0,     8 }, {  69,    0,   144 },
+	{  70,    0,     9 }, {  71,    0,   144 }, {  72,    0,     7 },
+	{  73,    0,   144 }, {  74,    0,     4 }, {  75,    0,   144 },
+	{  76,    0,     9 },
+	/* aboot_init: fbcon row buffer, uboot api signature */
+	{  77,    0,  2160 }, {  78,    8,    20 },
+	/* fastboot commands and variables */
+	{  79,    0,    16 }, {  80,    0,    16 }, {  81,    0,    16 },
+	{  82,    0,    16 }, {  83,    0,    16 }, {  84,    0,    16 },
+	{  85,    0,    16 }, {  86,    0,    16 }, {  87,    0,    16 },
+	{  88,    0,    16 }, {  89,    0,    16 }, {  90,    0,    16 },
+	{  91,    0,    16 }, {  92,    0,    16 }, {  93,    0,    16 },
+	{  94,    0,    16 }, {  95,    0,    16 }, {  96,    0,    16 },
+	{  97,    0,    16 }, {  98,    0,    16 }, {  99,    0,    16 },
+	{ 100,    0,    16 }, { 101,    0,    12 }, { 102,    0,    12 },
+	{ 103,    0,    12 }, { 104,    0,    12 }, { 105,    0,    12 },
+	{ 106,    0,    12 }, { 107,    0,    12 }, { 108,    0,    12 },
+	{ 109,    0,    12 }, { 110,    0,    12 }, { 111,    0,    12 },
+	{ 112,    0,    12 }, { 113,    0,    12 }, { 114,    0,    12 },
+	/* udc_init: endpoints, ep0, request pools, ep0 buffer, language */
+	{ 115, 4096,  4096 }, { 116,   64,    64 }, { 117,   64,    64 },
+	{ 118,   64,  4096 }, { 119,   64,  4096 }, { 120,   64,  4096 },
+	{ 121,    0,    12 },
+	/* fastboot_init: bulk endpoints, gadget string, commands, thread */
+	{ 122,   64,    64 }, { 123,   64,    64 }, { 124,    0,    26 },
+	{ 125,    0,    16 }, { 126,    0,    16 }, { 127,    0,    16 },
+	{ 128,    0,    12 }, { 129,    0,   128 }, { 130,    0,  4096 },
+	/* udc_start: device, vendor, product, serial and config descriptors */
+	{ 131,    0,    26 }, { 132,    0,    22 }, { 133,    0,    24 },
+	{ 134,    0,    26 }, { 135,    0,    40 },
+	/* bootstrap2 exits, fastboot command buffer once usb is online */
+	{   1,    0,     0 }, {   0,    0,     0 }, {   0,   64,  4096 },
+};
+
+#define HEAP_TRACE_LEN (sizeof(heap_boot_trace) / sizeof(heap_boot_trace[0]))
+
+/* Slots used by the trace, the peak number of live allocations */
+static uint heap_trace_slots(void)
+{
+	uint i, slots = 0;
+
+	for (i = 0; i < HEAP_TRACE_LEN; i++) {
+		if (heap_boot_trace[i].slot >= slots)
+			slots = heap_boot_trace[i].slot + 1;
+	}
+
+	return slots;
+}
+
+/* Replay the trace, returning the number of heap calls made or -1 on failure */
+static int heap_trace_replay(void **slot)
+{
+	const struct heap_trace_op *op;
+	uint i;
+	int calls = 0;
+
+	for (i = 0; i < HEAP_TRACE_LEN; i++) {
+		op = &heap_boot_trace[i];
+
+		if (op->size) {
+			if (slot[op->slot])
+				free(slot[op->slot]);
+			if (op->align)
+				slot[op->slot] = memalign(op->align, op->size);
+			else
+				slot[op->slot] = malloc(op->size);
+			if (!slot[op->slot])
+				return -1;
+		} else {
+			free(slot[op->slot]);
+			slot[op->slot] = NULL;
+		}
+		calls++;
+	}
+
+	return calls;
+}
+
+/*
+ * Time the boot allocation trace replayed a number of times, leaving the
+ * survivors of every pass allocated so the heap fragments like a long boot.
+ */
+int heap_trace_bench(int argc, const cmd_args *argv)
+{
+	void **keep;
+	struct heap_stats stats;
+	/* every pass keeps a whole boot worth of buffers, about 90KB */
+	uint passes = 4;
+	uint slots = heap_trace_slots();
+	uint i, j;
+	int calls = 0;
+	int ret;
+	lk_bigtime_t t;
+
+	if (argc > 1)
+		passes = argv[1].u;
+
+	keep = calloc(passes * slots, sizeof(void *));
+	if (!keep) {
+		printf("not enough memory\n");
+		return -1;
+	}
+
+	t = current_time_hires();
+	for (i = 0; i < passes; i++) {
+		ret = heap_trace_replay(&keep[i * slots]);
+		if (ret < 0) {
+			printf("allocation failed in pass %u\n", i);
+			break;
+		}
+		calls += ret;
+	}
+	t = current_time_hires() - t;
+
+	heap_get_stats(&stats);
+	printf("%u passes, %d calls in %llu usecs (%llu ns per call)\n",
+	       i, calls, t, calls ? t * 1000 / calls : 0);
+	printf("heap free %zu, largest chunk %zu, low watermark %zu\n",
+	       stats.heap_free, stats.heap_max_chunk, stats.heap_low_watermark);
+
+	for (i = 0; i < passes * slots; i++)
+		free(keep[i]);
+
+	/* the same trace on a clean heap, one pass at a time */
+	t = current_time_hires();
+	for (j = 0; j < passes; j++) {
+		memset(keep, 0, slots * sizeof(void *));
+		ret = heap_trace_replay(keep);
+		for (i = 0; i < slots; i++)
+			free(keep[i]);
+		if (ret < 0)
+			break;
+	}
+	t = current_time_hires() - t;
+
+	printf("%u clean passes in %llu usecs\n", j, t);
+
+	free(keep);
+
+	return 0;
+}
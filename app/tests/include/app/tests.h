@@ -31,6 +31,12 @@ void clock_tests(void);
 void float_tests(void);
 void benchmarks(void);
 int fibo(int argc, const cmd_args *argv);
+int mmc_fill_bench(int argc, const cmd_args *argv);
+int ext4_read_bench(int argc, const cmd_args *argv);
+int heap_trace_bench(int argc, const cmd_args *argv);
+int workq_bench(int argc, const cmd_args *argv);
+int decompress_bench(int argc, const cmd_args *argv);
+int fbcon_bench(int argc, const cmd_args *argv);
 
 #endif
 
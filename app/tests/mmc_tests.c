@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2014, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <string.h>
+#include <err.h>
+#include <app/tests.h>
+#include <platform.h>
+
+#if MMC_SDHCI_SUPPORT
+#include <mmc.h>
+#include <partition_parser.h>
+
+/* block size of the FILL chunks produced by make_ext4fs/img2simg */
+#define SPARSE_BLK_SZ 4096
+
+static void mmc_bench_report(const char *name, lk_time_t tim, uint64_t len)
+{
+	printf("%-24s %8u msecs", name, tim);
+	if (tim)
+		printf(" %6llu KB/s", (len / 1024) * 1000 / tim);
+	printf("\n");
+}
+
+/*
+ * Time the ways a sparse FILL chunk of the given size can be written to
+ * a partition: one write per sparse block as the flasher used to do, the
+ * batched pattern write, and a zero fill which may become an erase.
+ * This overwrites the start of the partition.
+ */
+int mmc_fill_bench(int argc, const cmd_args *argv)
+{
+	unsigned long long ptn;
+	unsigned long long size;
+	uint64_t len;
+	uint32_t *blk;
+	uint32_t i;
+	int index;
+	lk_time_t tim;
+
+	if (argc < 3) {
+		printf("usage: %s <partition> <size in MB>\n", argv[0].str);
+		printf("WARNING: destroys the data at the start of the partition\n");
+		return ERR_INVALID_ARGS;
+	}
+
+	index = partition_get_index(argv[1].str);
+	ptn = partition_get_offset(index);
+	size = partition_get_size(index);
+	if (!ptn) {
+		printf("unknown partition %s\n", argv[1].str);
+		return ERR_NOT_FOUND;
+	}
+
+	len = (uint64_t) argv[2].u * 1024 * 1024;
+	if (!len || len > size) {
+		printf("size must be between 1 and %llu MB\n", size / (1024 * 1024));
+		return ERR_INVALID_ARGS;
+	}
+
+	mmc_set_lun(partition_get_lun(index));
+
+	blk = memalign(CACHE_LINE, SPARSE_BLK_SZ);
+	if (!blk)
+		return ERR_NO_MEMORY;
+
+	for (i = 0; i < SPARSE_BLK_SZ / sizeof(uint32_t); i++)
+		blk[i] = 0xdeadbeef;
+
+	printf("filling %llu MB of %s\n", len / (1024 * 1024), argv[1].str);
+
+	tim = current_time();
+	for (i = 0; i < len / SPARSE_BLK_SZ; i++) {
+		if (mmc_write(ptn + (uint64_t) i * SPARSE_BLK_SZ, SPARSE_BLK_SZ, blk)) {
+			printf("write failed\n");
+			break;
+		}
+	}
+	mmc_bench_report("per block writes", current_time() - tim, len);
+
+	tim = current_time();
+	if (mmc_fill(ptn, len, 0xdeadbeef))
+		printf("pattern fill failed\n");
+	mmc_bench_report("batched pattern fill", current_time() - tim, len);
+
+	tim = current_time();
+	if (mmc_fill(ptn, len, 0))
+		printf("zero fill failed\n");
+	mmc_bench_report("zero fill", current_time() - tim, len);
+
+	free(blk);
+
+	return NO_ERROR;
+}
+#endif
@@ -4,6 +4,11 @@ MODULE := $(LOCAL_DIR)
 
 GLOBAL_INCLUDES += $(LOCAL_DIR)/include
 
+MODULE_DEPS += \
+	lib/cksum \
+	lib/decompress \
+	lib/workq
+
 MODULE_SRCS += \
 	$(LOCAL_DIR)/tests.c \
 	$(LOCAL_DIR)/thread_tests.c \
@@ -11,6 +16,11 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/clock_tests.c \
 	$(LOCAL_DIR)/cache_tests.c \
 	$(LOCAL_DIR)/benchmarks.c \
+	$(LOCAL_DIR)/mmc_tests.c \
+	$(LOCAL_DIR)/decompress_tests.c \
+	$(LOCAL_DIR)/fbcon_tests.c \
+	$(LOCAL_DIR)/ext4_tests.c \
+	$(LOCAL_DIR)/heap_tests.c \
 	$(LOCAL_DIR)/float.c \
 	$(LOCAL_DIR)/float_instructions.S \
 	$(LOCAL_DIR)/fibo.c
@@ -37,6 +37,18 @@ STATIC_COMMAND("float_tests", "floating point test", (console_cmd)&float_tests)
 #endif
 STATIC_COMMAND("bench", "miscellaneous benchmarks", (console_cmd)&benchmarks)
 STATIC_COMMAND("fibo", "threaded fibonacci", (console_cmd)&fibo)
+#if MMC_SDHCI_SUPPORT
+STATIC_COMMAND("bench_fill", "sparse fill chunk write benchmark", (console_cmd)&mmc_fill_bench)
+STATIC_COMMAND("bench_decompress", "compressed kernel read + decompress against a raw read", (console_cmd)&decompress_bench)
+#endif
+#if WITH_LIB_EXT4 && WITH_LIB_BIO
+STATIC_COMMAND("bench_ext4", "ext4 file read benchmark on an image in memory", (console_cmd)&ext4_read_bench)
+#endif
+STATIC_COMMAND("bench_heap", "replay a boot allocation trace on the heap", (console_cmd)&heap_trace_bench)
+STATIC_COMMAND("bench_workq", "parallel_for speedup over a 64MB buffer", (console_cmd)&workq_bench)
+#if WITH_DEV_FBCON
+STATIC_COMMAND("bench_fbcon", "framebuffer console line flood, memmove vs ring scrolling and coalesced flush", (console_cmd)&fbcon_bench)
+#endif
 STATIC_COMMAND_END(tests);
 
 #endif
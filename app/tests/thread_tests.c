@@ -24,11 +24,13 @@
 #include <trace.h>
 #include <rand.h>
 #include <err.h>
+#include <stdlib.h>
 #include <app/tests.h>
 #include <kernel/thread.h>
 #include <kernel/mutex.h>
 #include <kernel/semaphore.h>
 #include <kernel/event.h>
+#include <kernel/timer.h>
 #include <platform.h>
 
 static int sleep_thread(void *arg)
@@ -480,6 +482,71 @@ static void preempt_test(void)
 	printf("done with preempt test, above time stamps should be very close\n");
 }
 
+#define TIMER_CHURN_COUNT 256
+#define TIMER_CHURN_ITER (64*1024)
+
+static volatile int timer_churn_fired;
+
+static enum handler_return timer_churn_cb(struct timer *t, lk_time_t now, void *arg)
+{
+	timer_churn_fired++;
+	return INT_NO_RESCHEDULE;
+}
+
+static int timer_churn_test(void)
+{
+	timer_t *timers;
+	lk_bigtime_t t;
+	uint i;
+	int err = 0;
+
+	printf("testing timer churn, %u timers\n", TIMER_CHURN_COUNT);
+
+	timers = malloc(sizeof(timer_t) * TIMER_CHURN_COUNT);
+	if (!timers)
+		return ERR_NO_MEMORY;
+
+	for (i = 0; i < TIMER_CHURN_COUNT; i++) {
+		timer_initialize(&timers[i]);
+		timer_set_oneshot(&timers[i], 10000 + (rand() % 10000), timer_churn_cb, NULL);
+	}
+
+	/* rearm random timers the way wait queue timeouts and sleeps do */
+	t = current_time_hires();
+	for (i = 0; i < TIMER_CHURN_ITER; i++) {
+		timer_t *timer = &timers[(uint)rand() % TIMER_CHURN_COUNT];
+
+		timer_cancel(timer);
+		timer_set_oneshot(timer, 10000 + (rand() % 10000), timer_churn_cb, NULL);
+	}
+	t = current_time_hires() - t;
+
+	printf("%u cancel/set pairs took %llu usecs (%llu ns each)\n",
+	       TIMER_CHURN_ITER, t, t * 1000 / TIMER_CHURN_ITER);
+
+	/* short deadlines all have to fire, in any insertion order */
+	timer_churn_fired = 0;
+	for (i = 0; i < TIMER_CHURN_COUNT; i++) {
+		timer_cancel(&timers[i]);
+		timer_set_oneshot(&timers[i], 1 + (rand() % 50), timer_churn_cb, NULL);
+	}
+
+	thread_sleep(100);
+
+	printf("%d of %u short timers fired\n", timer_churn_fired, TIMER_CHURN_COUNT);
+	if (timer_churn_fired != TIMER_CHURN_COUNT) {
+		printf("timer churn test failed\n");
+		err = ERR_GENERIC;
+	}
+
+	for (i = 0; i < TIMER_CHURN_COUNT; i++)
+		timer_cancel(&timers[i]);
+
+	free(timers);
+
+	return err;
+}
+
 int thread_tests(void)
 {
 	mutex_test();
@@ -493,5 +560,5 @@ int thread_tests(void)
 
 	preempt_test();
 
-	return 0;
+	return timer_churn_test();
 }
@@ -127,6 +127,21 @@ void arm_mmu_init(void)
 #endif
 }
 
+#if WITH_SMP
+/* point a secondary cpu at the boot cpu's translation table */
+void arm_mmu_init_secondary(void)
+{
+#if !WITH_MMU_RELOC
+	arm_write_sctlr(arm_read_sctlr() & ~((1<<29)|(1<<28)|(1<<0))); // access flag disabled, TEX remap disabled, mmu disabled
+
+	arm_invalidate_tlb();
+	arm_write_ttbr0((uint32_t)tt);
+	arm_write_dacr(0x1 << (MMU_MEMORY_DOMAIN_MEM * 2));
+	arm_write_sctlr(arm_read_sctlr() | 0x1);
+#endif
+}
+#endif
+
 void arch_disable_mmu(void)
 {
 	/* Ensure all memory access are complete
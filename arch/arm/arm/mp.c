@@ -0,0 +1,76 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <arch.h>
+#include <arch/ops.h>
+#include <arch/arm.h>
+#include <arch/arm/mmu.h>
+#include <kernel/thread.h>
+#include <kernel/mp.h>
+
+extern void arm_secondary_reset(void);
+extern int _end;
+
+status_t arch_mp_start_cpu(uint cpu)
+{
+	/* the new cpu runs with its caches off until arm_secondary_entry, so
+	 * everything it touches before then, the translation table included,
+	 * has to be in memory.
+	 */
+	arch_clean_cache_range(MEMBASE, (addr_t)&_end - MEMBASE);
+
+	return platform_mp_start_cpu(cpu, (paddr_t)&arm_secondary_reset);
+}
+
+/* called from arm_secondary_reset on the cpu's boot stack */
+void arm_secondary_entry(uint cpu)
+{
+#if ARM_ISA_ARMV7
+	arm_write_vbar(MEMBASE);
+#endif
+
+#if ARM_WITH_MMU
+	arm_mmu_init_secondary();
+#endif
+
+	arch_enable_cache(UCACHE);
+
+#if ARM_WITH_VFP
+	/* enable cp10 and cp11 */
+	uint32_t val = arm_read_cpacr();
+	val |= (3<<22)|(3<<20);
+	arm_write_cpacr(val);
+
+	/* make sure the fpu starts off disabled */
+	arm_fpu_set_enable(false);
+#endif
+
+	lk_secondary_cpu_entry();
+}
@@ -283,6 +283,19 @@ static inline uint32_t arch_cycle_count(void) { return _arch_cycle_count(); }
 
 #endif
 
+/* logical number of the cpu we are running on, derived from the MPIDR
+ * affinity fields: aff1 selects the cluster, aff0 the core within it.
+ */
+static inline uint arch_curr_cpu_num(void)
+{
+#if WITH_SMP
+	uint32_t mpidr = arm_read_mpidr();
+	return ((mpidr >> 8) & 0xff) * SMP_CPUS_PER_CLUSTER + (mpidr & 0xff);
+#else
+	return 0;
+#endif
+}
+
 typedef unsigned long spin_lock_t;
 void spin_lock(spin_lock_t *lock); /* interrupts should already be disabled */
 int spin_trylock(spin_lock_t *lock); /* Returns 0 on success, non-0 on failure */
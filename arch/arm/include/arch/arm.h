@@ -153,6 +153,9 @@ void arm_invalidate_tlb(void);
 
 status_t arm_vtop(addr_t va, addr_t *pa);
 
+/* smp */
+void arm_secondary_entry(uint cpu) __NO_RETURN;
+
 /* fpu */
 void arm_fpu_set_enable(bool enable);
 #if ARM_WITH_VFP
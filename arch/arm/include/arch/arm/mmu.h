@@ -168,6 +168,7 @@
 __BEGIN_CDECLS
 
 void arm_mmu_init(void);
+void arm_mmu_init_secondary(void);
 
 void arm_mmu_map_section(addr_t paddr, addr_t vaddr, uint flags);
 void arm_mmu_unmap_section(addr_t vaddr);
@@ -58,4 +58,7 @@
 
 #define GET_CAHE_LINE_START_ADDR(addr) ROUNDDOWN(addr, CACHE_LINE)
 
+/* boot stack for each secondary cpu, used until it becomes an idle thread */
+#define ARM_SECONDARY_STACK_SIZE 4096
+
 #endif
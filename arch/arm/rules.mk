@@ -153,6 +153,11 @@ MODULE_SRCS += \
 MODULE_ARM_OVERRIDE_SRCS := \
 	$(LOCAL_DIR)/arm/arch.c
 
+ifeq ($(WITH_SMP),1)
+MODULE_SRCS += \
+	$(LOCAL_DIR)/arm/mp.c
+endif
+
 GLOBAL_DEFINES += \
 	ARCH_DEFAULT_STACK_SIZE=4096
 
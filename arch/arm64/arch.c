@@ -38,6 +38,9 @@ void arch_early_init(void)
     unsigned int current_el = ARM64_READ_SYSREG(CURRENTEL) >> 2;
     if (current_el > 1) {
         arm64_el3_to_el1();
+    } else {
+        /* entered at EL1, the exception and context switch paths save the fpu */
+        ARM64_WRITE_SYSREG(cpacr_el1, (uint64_t)(0b11 << 20));
     }
 }
 
@@ -197,6 +197,24 @@ static inline uint32_t arch_cycle_count(void)
 #endif
 }
 
+/* logical number of the cpu we are running on, derived from the MPIDR
+ * affinity fields: aff1 selects the cluster, aff0 the core within it.
+ */
+static inline uint arch_curr_cpu_num(void)
+{
+#if WITH_SMP
+    uint64_t mpidr = ARM64_READ_SYSREG(mpidr_el1);
+    return ((mpidr >> 8) & 0xff) * SMP_CPUS_PER_CLUSTER + (mpidr & 0xff);
+#else
+    return 0;
+#endif
+}
+
+typedef unsigned long spin_lock_t;
+void spin_lock(spin_lock_t *lock); /* interrupts should already be disabled */
+int spin_trylock(spin_lock_t *lock); /* Returns 0 on success, non-0 on failure */
+void spin_unlock(spin_lock_t *lock);
+
 /* use the cpu local thread context pointer to store current_thread */
 static inline struct thread *get_current_thread(void)
 {
@@ -56,5 +56,16 @@ struct arm64_iframe_long {
 extern void arm64_exception_base(void);
 void arm64_el3_to_el1(void);
 
+/* smp */
+extern void arm64_secondary_start(void);
+void arm64_secondary_entry(uint cpu) __NO_RETURN;
+
+/* psci */
+#define PSCI_0_2_FN64_CPU_ON    0xc4000003
+#define PSCI_SUCCESS            0
+#define PSCI_ALREADY_ON         -4
+
+int64_t arm64_psci_call(uint64_t fn, uint64_t arg0, uint64_t arg1, uint64_t arg2);
+
 __END_CDECLS
 
@@ -27,3 +27,5 @@
 
 #define CACHE_LINE 32
 
+/* boot stack for each secondary cpu, used until it becomes an idle thread */
+#define ARM64_SECONDARY_STACK_SIZE 4096
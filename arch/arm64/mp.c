@@ -0,0 +1,90 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <assert.h>
+#include <err.h>
+#include <trace.h>
+#include <kernel/thread.h>
+#include <kernel/mp.h>
+#include <arch/ops.h>
+#include <arch/arm64.h>
+
+#define LOCAL_TRACE 0
+
+/* PSCI calls go to the monitor (smc) by default, or to the hypervisor
+ * (hvc) when the platform runs us at EL1 under one, as QEMU's virt
+ * machine does without EL3 firmware.
+ */
+int64_t arm64_psci_call(uint64_t fn, uint64_t arg0, uint64_t arg1, uint64_t arg2)
+{
+    register uint64_t x0 __asm__("x0") = fn;
+    register uint64_t x1 __asm__("x1") = arg0;
+    register uint64_t x2 __asm__("x2") = arg1;
+    register uint64_t x3 __asm__("x3") = arg2;
+
+    __asm__ volatile(
+#if ARM64_PSCI_USE_HVC
+        "hvc #0"
+#else
+        "smc #0"
+#endif
+        : "+r" (x0), "+r" (x1), "+r" (x2), "+r" (x3)
+        :
+        : "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11",
+          "x12", "x13", "x14", "x15", "x16", "x17", "memory");
+
+    return (int64_t)x0;
+}
+
+status_t arch_mp_start_cpu(uint cpu)
+{
+    uint64_t mpidr = ((cpu / SMP_CPUS_PER_CLUSTER) << 8) | (cpu % SMP_CPUS_PER_CLUSTER);
+    int64_t ret;
+
+    LTRACEF("cpu %u mpidr 0x%llx\n", cpu, mpidr);
+
+    ret = arm64_psci_call(PSCI_0_2_FN64_CPU_ON, mpidr, (uint64_t)&arm64_secondary_start, cpu);
+    if (ret != PSCI_SUCCESS && ret != PSCI_ALREADY_ON)
+        return ERR_GENERIC;
+
+    return NO_ERROR;
+}
+
+void arm64_secondary_entry(uint cpu)
+{
+    /* set the vector base */
+    ARM64_WRITE_SYSREG(VBAR_EL1, (uint64_t)&arm64_exception_base);
+
+    /* disable EL1 FPU traps, the boot cpu did this on its way down from EL3 */
+    ARM64_WRITE_SYSREG(cpacr_el1, (uint64_t)(0b11 << 20));
+
+    DEBUG_ASSERT(cpu == arch_curr_cpu_num());
+
+    lk_secondary_cpu_entry();
+}
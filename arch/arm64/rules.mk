@@ -17,6 +17,16 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/thread.c \
 	$(LOCAL_DIR)/start.S \
 
+ifeq ($(WITH_SMP),1)
+ARM64_PSCI_USE_HVC ?= 0
+
+GLOBAL_DEFINES += \
+	ARM64_PSCI_USE_HVC=$(ARM64_PSCI_USE_HVC)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/mp.c
+endif
+
 #	$(LOCAL_DIR)/arm/start.S \
 	$(LOCAL_DIR)/arm/cache-ops.S \
 	$(LOCAL_DIR)/arm/cache.c \
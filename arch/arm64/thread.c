@@ -32,6 +32,9 @@
 
 struct context_switch_frame {
     vaddr_t lr;
+    vaddr_t fpcr;
+    vaddr_t fpsr;
+    vaddr_t d[8];   /* d8-d15 */
     vaddr_t r18;
     vaddr_t r19;
     vaddr_t r20;
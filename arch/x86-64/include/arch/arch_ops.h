@@ -97,6 +97,11 @@ static inline uint32_t arch_cycle_count(void)
 	return timestamp;
 }
 
+static inline uint arch_curr_cpu_num(void)
+{
+	return 0;
+}
+
 /* use a global pointer to store the current_thread */
 extern struct thread *_current_thread;
 
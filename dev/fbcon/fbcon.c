@@ -32,6 +32,9 @@
 #include <err.h>
 #include <stdlib.h>
 #include <dev/fbcon.h>
+#include <kernel/thread.h>
+#include <lk/init.h>
+#include <lib/pixel.h>
 #include <splash.h>
 #include <platform.h>
 #include <string.h>
@@ -44,6 +47,13 @@ struct pos {
 	int y;
 };
 
+struct rect {
+	unsigned x0;
+	unsigned y0;
+	unsigned x1;
+	unsigned y1;
+};
+
 static struct fbcon_config *config = NULL;
 
 #define RGB565_BLACK		0x0000
@@ -52,76 +62,254 @@ static struct fbcon_config *config = NULL;
 #define RGB888_BLACK            0x000000
 #define RGB888_WHITE            0xffffff
 
+#define XRGB8888_BLACK		0x00000000
+#define XRGB8888_WHITE		0xffffffff
+
 #define FONT_WIDTH		5
 #define FONT_HEIGHT		12
 
-static uint16_t			BGCOLOR;
-static uint16_t			FGCOLOR;
+/* how long console output may sit in the framebuffer before the panel
+ * is updated */
+#define FBCON_FLUSH_MS		50
+
+static uint32_t			BGCOLOR;
+static uint32_t			FGCOLOR;
 
 static struct pos		cur_pos;
 static struct pos		max_pos;
 
-static void fbcon_drawglyph(uint16_t *pixels, uint16_t paint, unsigned stride,
-			    unsigned *glyph)
+static unsigned			fb_cpp;		/* bytes per pixel */
+static unsigned			fb_pitch;	/* bytes per scanline */
+
+/*
+ * The text area is a ring of max_pos.y character rows: scrolling only
+ * clears the row that falls off the top and moves ring_top along, and
+ * the ring is rotated back into place once per panel update rather
+ * than once per line. Everything outside fbcon (splash, menu) expects a
+ * linear framebuffer, so fbcon_display() and fbcon_flush() unroll it.
+ *
+ * Video mode panels (no update hook) scan the framebuffer out as it is
+ * written, a rotated ring would be on screen, so those scroll linearly.
+ */
+static bool			ring_scroll;
+static unsigned			ring_top;
+static uint8_t			*row_tmp;
+
+static struct rect		dirty;
+static bool			flusher_running;
+
+static inline uint8_t *fbcon_pixel(unsigned x, unsigned y)
+{
+	return (uint8_t *)config->base + y * fb_pitch + x * fb_cpp;
+}
+
+static inline void fbcon_put_pixel(uint8_t *p, uint32_t color)
+{
+	switch (fb_cpp) {
+	case 2:
+		*(uint16_t *)p = color;
+		break;
+	case 3:
+		p[0] = color;
+		p[1] = color >> 8;
+		p[2] = color >> 16;
+		break;
+	default:
+		*(uint32_t *)p = color;
+		break;
+	}
+}
+
+static void fbcon_fill(uint8_t *p, unsigned count, uint32_t color)
+{
+	uint32_t mask = fb_cpp == 4 ? ~0u : (1u << (fb_cpp * 8)) - 1;
+	unsigned i;
+
+	/* black and white are the same byte all the way through */
+	if ((((color & 0xff) * 0x01010101u) & mask) == (color & mask)) {
+		memset(p, color & 0xff, count * fb_cpp);
+		return;
+	}
+
+	for (i = 0; i < count; i++, p += fb_cpp)
+		fbcon_put_pixel(p, color);
+}
+
+static void fbcon_drawglyph(uint8_t *pixels, uint32_t paint, unsigned *glyph)
 {
 	unsigned x, y, data;
-	stride -= FONT_WIDTH;
 
 	data = glyph[0];
-	for (y = 0; y < (FONT_HEIGHT / 2); ++y) {
+	for (y = 0; y < FONT_HEIGHT; ++y) {
+		if (y == FONT_HEIGHT / 2)
+			data = glyph[1];
 		for (x = 0; x < FONT_WIDTH; ++x) {
 			if (data & 1)
-				*pixels = paint;
+				fbcon_put_pixel(pixels + x * fb_cpp, paint);
 			data >>= 1;
-			pixels++;
 		}
-		pixels += stride;
+		pixels += fb_pitch;
 	}
+}
 
-	data = glyph[1];
-	for (y = 0; y < (FONT_HEIGHT / 2); y++) {
-		for (x = 0; x < FONT_WIDTH; x++) {
-			if (data & 1)
-				*pixels = paint;
-			data >>= 1;
-			pixels++;
+/* dirty is kept in screen (unrolled) coordinates */
+static void fbcon_mark_dirty(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+	if (dirty.x1 == dirty.x0) {
+		dirty.x0 = x;
+		dirty.y0 = y;
+		dirty.x1 = x + w;
+		dirty.y1 = y + h;
+		return;
+	}
+
+	dirty.x0 = MIN(dirty.x0, x);
+	dirty.y0 = MIN(dirty.y0, y);
+	dirty.x1 = MAX(dirty.x1, x + w);
+	dirty.y1 = MAX(dirty.y1, y + h);
+}
+
+/* rotate the scanlines of the text area so that ring_top is row 0 again;
+ * every line is moved exactly once, with one line of scratch per cycle */
+static void fbcon_unroll(void)
+{
+	unsigned n = max_pos.y * FONT_HEIGHT;
+	unsigned k = ring_top * FONT_HEIGHT;
+	unsigned len = config->width * fb_cpp;
+	unsigned moved = 0;
+	unsigned start, i, next;
+
+	if (!ring_top)
+		return;
+
+	for (start = 0; moved < n; start++) {
+		memcpy(row_tmp, fbcon_pixel(0, start), len);
+		for (i = start;; i = next) {
+			next = i + k;
+			if (next >= n)
+				next -= n;
+			moved++;
+			if (next == start)
+				break;
+			memcpy(fbcon_pixel(0, i), fbcon_pixel(0, next), len);
 		}
-		pixels += stride;
+		memcpy(fbcon_pixel(0, i), row_tmp, len);
 	}
+
+	ring_top = 0;
 }
 
-void fbcon_flush(void)
+static void fbcon_update(const struct rect *r)
 {
+	if (r && config->update_rect) {
+		config->update_rect(r->x0, r->y0, r->x1 - r->x0, r->y1 - r->y0);
+		return;
+	}
+
 	if (config->update_start)
 		config->update_start();
 	if (config->update_done)
 		while (!config->update_done());
 }
 
-/* TODO: Take stride into account */
-static void fbcon_scroll_up(void)
+/* push the whole framebuffer to the panel; for anyone who has drawn into
+ * it directly */
+void fbcon_flush(void)
+{
+	if (!config)
+		return;
+
+	enter_critical_section();
+	fbcon_unroll();
+	dirty.x0 = dirty.x1 = 0;
+	exit_critical_section();
+
+	fbcon_update(NULL);
+}
+
+/* push only what the console has drawn since the last update */
+static void fbcon_flush_dirty(void)
 {
-	unsigned short *dst = config->base;
-	unsigned short *src = dst + (config->width * FONT_HEIGHT);
-	unsigned count = config->width * (config->height - FONT_HEIGHT);
+	struct rect r;
 
-	while(count--) {
-		*dst++ = *src++;
+	enter_critical_section();
+	if (dirty.x1 == dirty.x0) {
+		exit_critical_section();
+		return;
 	}
+	fbcon_unroll();
+	r = dirty;
+	dirty.x0 = dirty.x1 = 0;
+	exit_critical_section();
+
+	fbcon_update(&r);
+}
 
-	count = config->width * FONT_HEIGHT;
-	while(count--) {
-		*dst++ = BGCOLOR;
+/* move the text area up a row and clear the bottom one */
+static void fbcon_scroll_linear(void)
+{
+	unsigned n = (max_pos.y - 1) * FONT_HEIGHT;
+	unsigned len = config->width * fb_cpp;
+	unsigned y;
+
+	if (fb_pitch == len)
+		memmove(fbcon_pixel(0, 0), fbcon_pixel(0, FONT_HEIGHT), n * len);
+	else
+		for (y = 0; y < n; y++)
+			memcpy(fbcon_pixel(0, y), fbcon_pixel(0, y + FONT_HEIGHT), len);
+
+	for (y = n; y < n + FONT_HEIGHT; y++)
+		fbcon_fill(fbcon_pixel(0, y), config->width, BGCOLOR);
+}
+
+static void fbcon_scroll_up(void)
+{
+	unsigned y = ring_top * FONT_HEIGHT;
+	unsigned i;
+
+	if (ring_scroll) {
+		/* the old top row becomes the new, blank, bottom row */
+		for (i = 0; i < FONT_HEIGHT; i++)
+			fbcon_fill(fbcon_pixel(0, y + i), config->width, BGCOLOR);
+
+		if (++ring_top == (unsigned)max_pos.y)
+			ring_top = 0;
+	} else {
+		fbcon_scroll_linear();
 	}
 
-	fbcon_flush();
+	fbcon_mark_dirty(0, 0, config->width, max_pos.y * FONT_HEIGHT);
+}
+
+/* Pick ring or linear scrolling, returns the previous setting. The ring
+ * is never used on panels without an update hook. */
+bool fbcon_set_ring_scroll(bool enable)
+{
+	bool old = ring_scroll;
+
+	if (!config)
+		return false;
+
+	enter_critical_section();
+	fbcon_unroll();
+	ring_scroll = enable && (config->update_start || config->update_rect);
+	exit_critical_section();
+
+	return old;
 }
 
-/* TODO: take stride into account */
 void fbcon_clear(void)
 {
-	unsigned count = config->width * config->height;
-	memset(config->base, BGCOLOR, count * ((config->bpp) / 8));
+	unsigned y;
+
+	enter_critical_section();
+	if (config->stride == config->width)
+		fbcon_fill(config->base, config->width * config->height, BGCOLOR);
+	else
+		for (y = 0; y < config->height; y++)
+			fbcon_fill(fbcon_pixel(0, y), config->width, BGCOLOR);
+	ring_top = 0;
+	exit_critical_section();
 }
 
 
@@ -133,7 +321,8 @@ static void fbcon_set_colors(unsigned bg, unsigned fg)
 
 void fbcon_putc(char c)
 {
-	uint16_t *pixels;
+	unsigned row;
+	bool newline = false;
 
 	/* ignore anything that happens before fbcon is initialized */
 	if (!config)
@@ -142,31 +331,43 @@ void fbcon_putc(char c)
 	if((unsigned char)c > 127)
 		return;
 	if((unsigned char)c < 32) {
-		if(c == '\n')
+		if(c == '\n') {
+			enter_critical_section();
 			goto newline;
-		else if (c == '\r')
+		} else if (c == '\r')
 			cur_pos.x = 0;
 		return;
 	}
 
-	pixels = config->base;
-	pixels += cur_pos.y * FONT_HEIGHT * config->width;
-	pixels += cur_pos.x * (FONT_WIDTH + 1);
-	fbcon_drawglyph(pixels, FGCOLOR, config->stride,
-			font5x12 + (c - 32) * 2);
+	enter_critical_section();
+
+	row = ring_top + cur_pos.y;
+	if (row >= (unsigned)max_pos.y)
+		row -= max_pos.y;
+	fbcon_drawglyph(fbcon_pixel(cur_pos.x * (FONT_WIDTH + 1), row * FONT_HEIGHT),
+			FGCOLOR, font5x12 + (c - 32) * 2);
+	fbcon_mark_dirty(cur_pos.x * (FONT_WIDTH + 1), cur_pos.y * FONT_HEIGHT,
+			 FONT_WIDTH, FONT_HEIGHT);
 
 	cur_pos.x++;
 	if (cur_pos.x < max_pos.x)
-		return;
+		goto out;
 
 newline:
+	newline = true;
 	cur_pos.y++;
 	cur_pos.x = 0;
 	if(cur_pos.y >= max_pos.y) {
 		cur_pos.y = max_pos.y - 1;
 		fbcon_scroll_up();
-	} else
-		fbcon_flush();
+	}
+
+out:
+	exit_critical_section();
+
+	/* until the flusher is up, update the panel line by line as before */
+	if (newline && !flusher_running)
+		fbcon_flush_dirty();
 }
 
 void fbcon_setup(struct fbcon_config *_config)
@@ -176,29 +377,47 @@ void fbcon_setup(struct fbcon_config *_config)
 
 	ASSERT(_config);
 
-	config = _config;
-
-	switch (config->format) {
-	case FB_FORMAT_RGB565:
+	switch (_config->bpp) {
+	case 16:
 		fg = RGB565_WHITE;
 		bg = RGB565_BLACK;
 		break;
-        case FB_FORMAT_RGB888:
-                fg = RGB888_WHITE;
-                bg = RGB888_BLACK;
-                break;
+	case 24:
+		fg = RGB888_WHITE;
+		bg = RGB888_BLACK;
+		break;
+	case 32:
+		fg = XRGB8888_WHITE;
+		bg = XRGB8888_BLACK;
+		break;
 	default:
-		dprintf(CRITICAL, "unknown framebuffer pixel format\n");
+		dprintf(CRITICAL, "unsupported framebuffer depth %u\n", _config->bpp);
 		ASSERT(0);
-		break;
+		return;
 	}
 
+	/* some panels leave stride unset, meaning packed scanlines */
+	if (_config->stride < _config->width)
+		_config->stride = _config->width;
+
+	fb_cpp = _config->bpp / 8;
+	fb_pitch = _config->stride * fb_cpp;
+
+	free(row_tmp);
+	row_tmp = malloc(_config->width * fb_cpp);
+	ASSERT(row_tmp);
+
+	config = _config;
+
 	fbcon_set_colors(bg, fg);
 
 	cur_pos.x = 0;
 	cur_pos.y = 0;
 	max_pos.x = config->width / (FONT_WIDTH+1);
 	max_pos.y = (config->height - 1) / FONT_HEIGHT;
+	ring_scroll = config->update_start || config->update_rect;
+	ring_top = 0;
+	dirty.x0 = dirty.x1 = 0;
 #if !DISPLAY_SPLASH_SCREEN
 	fbcon_clear();
 #endif
@@ -206,9 +425,41 @@ void fbcon_setup(struct fbcon_config *_config)
 
 struct fbcon_config* fbcon_display(void)
 {
-    return config;
+	if (config) {
+		enter_critical_section();
+		fbcon_unroll();
+		exit_critical_section();
+	}
+
+	return config;
 }
 
+static int fbcon_flush_thread(void *arg)
+{
+	for (;;) {
+		thread_sleep(FBCON_FLUSH_MS);
+		if (config)
+			fbcon_flush_dirty();
+	}
+
+	return 0;
+}
+
+static void fbcon_flush_init(uint level)
+{
+	thread_t *t;
+
+	t = thread_create("fbcon_flush", fbcon_flush_thread, NULL,
+			  DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+	if (!t)
+		return;
+
+	flusher_running = true;
+	thread_detach_and_resume(t);
+}
+
+LK_INIT_HOOK(fbcon_flush, &fbcon_flush_init, LK_INIT_LEVEL_THREADING);
+
 
 extern struct fbimage* fetch_image_from_partition(void);
 void fbcon_putImage(struct fbimage *fbimg, bool flag);
@@ -230,19 +481,7 @@ void display_image_on_screen(void)
 		fbimg->image = (unsigned char *)imageBuffer_rgb888;
 
 	#if DISPLAY_USE_BGR
-			unsigned i;
-			for(i=0; i<(fbimg->header.width*fbimg->header.height); i++) {
-				int r,g,b;
-				char* color = (char*) fbimg->image + i*3;
-
-				r = color[0];
-				g = color[1];
-				b = color[2];
-
-				color[0] = b;
-				color[1] = g;
-				color[2] = r;
-			}
+			pixel_swap_rgb888(fbimg->image, fbimg->header.width * fbimg->header.height);
 	#endif
 #else
 		fbimg->image = (unsigned char *)imageBuffer;
@@ -287,7 +526,9 @@ void fbcon_putImage(struct fbimage *fbimg, bool flag)
 	if (bytes_per_bpp == 3)
 	{
 		if(flag) {
-			if (header->width == config->width && header->height == config->height)
+			/* read straight into place, or decoded there */
+			if ((header->width == config->width && header->height == config->height) ||
+			    logo_img_compressed(header))
 				return;
 			else {
 				logo_base = (unsigned char *)config->base + LOGO_IMG_OFFSET;
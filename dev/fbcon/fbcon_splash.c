@@ -0,0 +1,219 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dev/fbcon.h>
+#include <lib/decompress.h>
+#include <lib/pixel.h>
+
+/* keep the lz4 band buffer to something the heap can always give us */
+#define SPLASH_BAND_MAX		(1024 * 1024)
+
+/*
+ * Where the decoded pixels go: the image is centred on the panel and
+ * cropped to it the same way fbcon_putImage() does it, so only the
+ * visible window of the image is ever written.
+ */
+struct splash_sink {
+	uint8_t *fb;		/* first visible pixel */
+	unsigned pitch;		/* framebuffer bytes per row */
+	unsigned width;		/* image width */
+	unsigned skip_x;	/* image columns left of the window */
+	unsigned vis_w;
+	unsigned skip_y;	/* image rows above the window */
+	unsigned vis_h;
+	unsigned x;		/* image position of the next pixel */
+	unsigned y;
+};
+
+static void splash_copy(uint8_t *dst, const uint8_t *src, unsigned n, bool swap)
+{
+	if (!swap) {
+		memcpy(dst, src, n * 3);
+		return;
+	}
+
+	for (; n; n--, dst += 3, src += 3) {
+		dst[0] = src[2];
+		dst[1] = src[1];
+		dst[2] = src[0];
+	}
+}
+
+static void splash_fill(uint8_t *dst, const uint8_t *px, unsigned n, bool swap)
+{
+	uint8_t c0 = swap ? px[2] : px[0];
+	uint8_t c1 = px[1];
+	uint8_t c2 = swap ? px[0] : px[2];
+
+	for (; n; n--) {
+		*dst++ = c0;
+		*dst++ = c1;
+		*dst++ = c2;
+	}
+}
+
+static inline bool splash_done(const struct splash_sink *s)
+{
+	return s->y >= s->skip_y + s->vis_h;
+}
+
+/* feed n pixels, or n copies of the one pixel at src for a run */
+static void splash_put(struct splash_sink *s, const uint8_t *src, unsigned n,
+		       bool run, bool swap)
+{
+	unsigned chunk, a, b;
+	uint8_t *dst;
+
+	while (n && !splash_done(s)) {
+		chunk = MIN(n, s->width - s->x);
+
+		if (s->y >= s->skip_y) {
+			a = MAX(s->x, s->skip_x);
+			b = MIN(s->x + chunk, s->skip_x + s->vis_w);
+			if (a < b) {
+				dst = s->fb + (s->y - s->skip_y) * s->pitch + (a - s->skip_x) * 3;
+				if (run)
+					splash_fill(dst, src, b - a, swap);
+				else
+					splash_copy(dst, src + (a - s->x) * 3, b - a, swap);
+			}
+		}
+
+		if (!run)
+			src += chunk * 3;
+		n -= chunk;
+		s->x += chunk;
+		if (s->x == s->width) {
+			s->x = 0;
+			s->y++;
+		}
+	}
+}
+
+/* a count byte, then one pixel repeated (bit 7 set) or literal pixels,
+ * (count & 0x7f) + 1 of them */
+static int splash_decode_rle24(struct splash_sink *s, const uint8_t *p,
+			       const uint8_t *end, bool swap)
+{
+	unsigned n;
+	bool run;
+
+	while (p < end && !splash_done(s)) {
+		run = *p & 0x80;
+		n = (*p++ & 0x7f) + 1;
+
+		if ((unsigned)(end - p) < (run ? 3 : n * 3))
+			return ERR_NOT_VALID;
+
+		splash_put(s, p, n, run, swap);
+		p += run ? 3 : n * 3;
+	}
+
+	return splash_done(s) ? NO_ERROR : ERR_NOT_VALID;
+}
+
+static int splash_decode_lz4(struct splash_sink *s, unsigned band_rows,
+			     const uint8_t *p, const uint8_t *end, bool swap)
+{
+	size_t band = band_rows * s->width * 3;
+	size_t out_len, used;
+	uint8_t *buf;
+	int err = NO_ERROR;
+
+	if (!band_rows || band / band_rows / 3 != s->width || band > SPLASH_BAND_MAX)
+		return ERR_NOT_SUPPORTED;
+
+	buf = malloc(band);
+	if (!buf)
+		return ERR_NO_MEMORY;
+
+	while (p < end && !splash_done(s)) {
+		err = unlz4(p, end - p, buf, band, &out_len, &used);
+		if (err < 0 || out_len % 3)
+			break;
+
+		/* swizzle in cached memory, then one copy into the panel */
+		if (swap)
+			pixel_swap_rgb888(buf, out_len / 3);
+		splash_put(s, buf, out_len / 3, false, false);
+		p += used;
+	}
+
+	free(buf);
+
+	if (err < 0)
+		return err;
+	return splash_done(s) ? NO_ERROR : ERR_NOT_VALID;
+}
+
+int fbcon_splash_decode(const struct logo_img_header *header, const void *data, unsigned len)
+{
+	struct fbcon_config *config = fbcon_display();
+	const uint8_t *p = data;
+	struct splash_sink s;
+	unsigned dst_x, dst_y;
+	bool swap;
+
+	if (!config || config->bpp != 24)
+		return ERR_NOT_SUPPORTED;
+	if (!header->width || !header->height)
+		return ERR_NOT_VALID;
+
+	s.width = header->width;
+	s.vis_w = MIN(header->width, config->width);
+	s.skip_x = (header->width - s.vis_w) / 2;
+	s.vis_h = MIN(header->height, config->height);
+	s.skip_y = (header->height - s.vis_h) / 2;
+	s.x = 0;
+	s.y = 0;
+
+	dst_x = config->width / 2 - s.vis_w / 2;
+	dst_y = config->height / 2 - s.vis_h / 2;
+	s.pitch = (config->stride ? config->stride : config->width) * 3;
+	s.fb = (uint8_t *)config->base + dst_y * s.pitch + dst_x * 3;
+
+	/* the framebuffer takes BGR where the panel says so */
+#if DISPLAY_USE_BGR
+	swap = !(header->flags & LOGO_IMG_FLAG_BGR);
+#else
+	swap = !!(header->flags & LOGO_IMG_FLAG_BGR);
+#endif
+
+	switch (header->type) {
+		case LOGO_IMG_TYPE_RLE24:
+			return splash_decode_rle24(&s, p, p + len, swap);
+		case LOGO_IMG_TYPE_LZ4:
+			return splash_decode_lz4(&s, header->band_rows, p, p + len, swap);
+		default:
+			return ERR_NOT_SUPPORTED;
+	}
+}
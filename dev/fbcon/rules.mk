@@ -2,7 +2,12 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 
 MODULE := $(LOCAL_DIR)
 
+MODULE_DEPS += \
+	lib/decompress \
+	lib/pixel
+
 MODULE_SRCS += \
-	$(LOCAL_DIR)/fbcon.c
+	$(LOCAL_DIR)/fbcon.c \
+	$(LOCAL_DIR)/fbcon_splash.c
 
 include make/module.mk
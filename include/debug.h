@@ -84,9 +84,14 @@ static inline void hexdump8(const void *ptr, size_t len) { }
 void halt(void) __NO_RETURN;
 
 #if WITH_DEBUG_LOG_BUF
-/* lk_log */
+/* lk_log, a power of two sized ring; projects may set LK_LOG_BUF_SIZE */
+#ifndef LK_LOG_BUF_SIZE
+#define LK_LOG_BUF_SIZE    (4096) /* align on 4k */
+#endif
+
 char* lk_log_getbuf(void);
 unsigned lk_log_getsize(void);
+unsigned lk_log_copy(char *buf, unsigned len);
 #endif
 
 void _panic(void *caller, const char *fmt, ...) __PRINTFLIKE(2, 3) __NO_RETURN;
@@ -32,19 +32,39 @@
 #define __DEV_FBCON_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #define LOGO_IMG_OFFSET (12*1024*1024)
 #define LOGO_IMG_MAGIC "SPLASH!!"
 #define LOGO_IMG_MAGIC_SIZE sizeof(LOGO_IMG_MAGIC) - 1
 
+/* version 0 images are raw RGB888 right after the header; from version 1
+ * the payload can be compressed, see scripts/splash_image.py */
+#define LOGO_IMG_VERSION	1
+
+#define LOGO_IMG_TYPE_RAW	0
+#define LOGO_IMG_TYPE_RLE24	1	/* runs and literals of RGB888 pixels */
+#define LOGO_IMG_TYPE_LZ4	2	/* one lz4 frame per band_rows rows */
+
+#define LOGO_IMG_FLAG_BGR	(1 << 0)	/* payload is already BGR888 */
 
 struct logo_img_header {
     unsigned char magic[LOGO_IMG_MAGIC_SIZE]; // "SPLASH!!"
     uint32_t width; // logo's width, little endian
     uint32_t height; // logo's height, little endian
     uint32_t offset;
-    unsigned char reserved[512-20];
+    uint32_t version; // LOGO_IMG_VERSION, 0 in older images
+    uint32_t type; // LOGO_IMG_TYPE_*, from version 1
+    uint32_t flags; // LOGO_IMG_FLAG_*, from version 1
+    uint32_t size; // payload bytes after the header, from version 1
+    uint32_t band_rows; // lz4 only
+    unsigned char reserved[512-40];
 };
 
+static inline int logo_img_compressed(const struct logo_img_header *header)
+{
+	return header->version >= 1 && header->type != LOGO_IMG_TYPE_RAW;
+}
+
 struct fbimage {
 	struct logo_img_header  header;
 	void *image;
@@ -65,6 +85,8 @@ struct fbcon_config {
 
 	void        (*update_start)(void);
 	int     (*update_done)(void);
+	/* optional: push just a rectangle of the framebuffer to the panel */
+	void        (*update_rect)(unsigned x, unsigned y, unsigned w, unsigned h);
 };
 
 void fbcon_setup(struct fbcon_config *cfg);
@@ -72,5 +94,10 @@ void fbcon_putc(char c);
 void fbcon_clear(void);
 void fbcon_flush(void);
 struct fbcon_config* fbcon_display(void);
+/* scroll by rotating rows in place (default where the panel has an update
+ * hook) or by moving the text up, returns the previous setting */
+bool fbcon_set_ring_scroll(bool enable);
+/* decode a compressed splash payload straight into the framebuffer */
+int fbcon_splash_decode(const struct logo_img_header *header, const void *data, unsigned len);
 
 #endif /* __DEV_FBCON_H */
@@ -0,0 +1,114 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __KERNEL_MP_H
+#define __KERNEL_MP_H
+
+#include <sys/types.h>
+#include <compiler.h>
+#include <arch/ops.h>
+
+/* logical cpu numbers run from 0 (the boot cpu) to SMP_MAX_CPUS - 1 */
+#ifndef SMP_MAX_CPUS
+#define SMP_MAX_CPUS 1
+#endif
+
+#define MP_CPU_ALL ((mp_cpu_mask_t)((1UL << SMP_MAX_CPUS) - 1))
+
+typedef uint32_t mp_cpu_mask_t;
+
+typedef enum {
+	MP_IPI_GENERIC = 0,
+	MP_IPI_RESCHEDULE,
+	MP_IPI_TICK,
+} mp_ipi_t;
+
+/* SGI numbers used for the ipis on gic based platforms */
+#define MP_IPI_SGI_BASE 13
+
+#if WITH_SMP
+
+struct mp_state {
+	volatile mp_cpu_mask_t active_cpus;
+	volatile mp_cpu_mask_t idle_cpus;
+};
+
+extern struct mp_state mp;
+
+void mp_init(void);
+void mp_start_secondary_cpus(void);
+void mp_reschedule(mp_cpu_mask_t target);
+enum handler_return mp_mbx_reschedule_irq(void *arg);
+enum handler_return mp_mbx_tick_irq(void *arg);
+void mp_forward_tick(void);
+
+static inline bool mp_is_cpu_active(uint cpu)
+{
+	return !!(mp.active_cpus & (1U << cpu));
+}
+
+static inline bool mp_is_cpu_idle(uint cpu)
+{
+	return !!(mp.idle_cpus & (1U << cpu));
+}
+
+static inline void mp_set_cpu_idle(uint cpu)
+{
+	atomic_or((volatile int *)&mp.idle_cpus, 1U << cpu);
+}
+
+static inline void mp_set_cpu_busy(uint cpu)
+{
+	atomic_and((volatile int *)&mp.idle_cpus, ~(1U << cpu));
+}
+
+/* called by the arch layer once a secondary cpu has a stack and its mmu/caches on */
+void lk_secondary_cpu_entry(void) __NO_RETURN;
+
+/* arch hooks */
+status_t arch_mp_start_cpu(uint cpu);
+
+/* platform hooks */
+status_t platform_mp_start_cpu(uint cpu, paddr_t entry); /* for arches that leave it to the platform */
+void platform_mp_init_percpu(void);
+status_t platform_mp_send_ipi(mp_cpu_mask_t target, mp_ipi_t ipi);
+
+#else
+
+static inline void mp_init(void) {}
+static inline void mp_start_secondary_cpus(void) {}
+static inline void mp_reschedule(mp_cpu_mask_t target) {}
+static inline void mp_forward_tick(void) {}
+static inline bool mp_is_cpu_active(uint cpu) { return cpu == 0; }
+static inline bool mp_is_cpu_idle(uint cpu) { return false; }
+static inline void mp_set_cpu_idle(uint cpu) {}
+static inline void mp_set_cpu_busy(uint cpu) {}
+
+#endif
+
+#endif
@@ -30,6 +30,7 @@
 #include <arch/ops.h>
 #include <arch/thread.h>
 #include <kernel/wait.h>
+#include <kernel/mp.h>
 #include <debug.h>
 
 enum thread_state {
@@ -51,6 +52,7 @@ enum thread_tls_list {
 #define THREAD_FLAG_DETACHED 0x1
 #define THREAD_FLAG_FREE_STACK 0x2
 #define THREAD_FLAG_FREE_STRUCT 0x4
+#define THREAD_FLAG_IDLE 0x8
 
 #define THREAD_MAGIC 'thrd'
 
@@ -65,6 +67,8 @@ typedef struct thread {
 	int saved_critical_section_count;
 	int remaining_quantum;
 	unsigned int flags;
+	int curr_cpu;
+	int pinned_cpu; /* only run on pinned_cpu if >= 0 */
 
 	/* if blocked, a pointer to the wait queue */
 	struct wait_queue *blocking_wait_queue;
@@ -112,8 +116,10 @@ typedef struct thread {
 void thread_init_early(void);
 void thread_init(void);
 void thread_become_idle(void) __NO_RETURN;
+void thread_secondary_cpu_init_early(void);
 void thread_set_name(const char *name);
 void thread_set_priority(int priority);
+void thread_set_pinned_cpu(thread_t *t, int cpu);
 thread_t *thread_create(const char *name, thread_start_routine entry, void *arg, int priority, size_t stack_size);
 thread_t *thread_create_etc(thread_t *t, const char *name, thread_start_routine entry, void *arg, int priority, void *stack, size_t stack_size);
 status_t thread_resume(thread_t *);
@@ -139,6 +145,55 @@ thread_t *get_current_thread(void);
 void set_current_thread(thread_t *);
 
 /* critical sections */
+#if WITH_SMP
+/* On SMP a critical section also holds thread_lock, a single lock that
+ * serializes every cpu through the kernel. The nesting count is per cpu;
+ * a thread that switches out inside a critical section hands the lock
+ * to whichever thread the cpu switches to.
+ */
+extern int critical_section_count_percpu[SMP_MAX_CPUS];
+extern spin_lock_t thread_lock;
+
+#define critical_section_count (critical_section_count_percpu[arch_curr_cpu_num()])
+
+static inline __ALWAYS_INLINE void enter_critical_section(void)
+{
+	CF;
+	if (critical_section_count == 0) {
+		arch_disable_ints();
+		spin_lock(&thread_lock);
+	}
+	critical_section_count++;
+	CF;
+}
+
+static inline __ALWAYS_INLINE void exit_critical_section(void)
+{
+	CF;
+	if (--critical_section_count == 0) {
+		spin_unlock(&thread_lock);
+		arch_enable_ints();
+	}
+	CF;
+}
+
+/* only used by interrupt glue */
+static inline void inc_critical_section(void)
+{
+	if (critical_section_count++ == 0)
+		spin_lock(&thread_lock);
+}
+
+static inline void dec_critical_section(void)
+{
+	if (--critical_section_count == 0)
+		spin_unlock(&thread_lock);
+}
+
+/* out of line versions for the assembly interrupt glue */
+void thread_irq_enter(void);
+void thread_irq_exit(void);
+#else
 extern int critical_section_count;
 
 static inline __ALWAYS_INLINE void enter_critical_section(void)
@@ -159,16 +214,17 @@ static inline __ALWAYS_INLINE void exit_critical_section(void)
 	CF;
 }
 
+/* only used by interrupt glue */
+static inline void inc_critical_section(void) { critical_section_count++; }
+static inline void dec_critical_section(void) { critical_section_count--; }
+#endif
+
 static inline __ALWAYS_INLINE bool in_critical_section(void)
 {
 	CF;
 	return critical_section_count > 0;
 }
 
-/* only used by interrupt glue */
-static inline void inc_critical_section(void) { critical_section_count++; }
-static inline void dec_critical_section(void) { critical_section_count--; }
-
 /* thread local storage */
 static inline __ALWAYS_INLINE uint32_t tls_get(uint entry)
 {
@@ -201,9 +257,9 @@ struct thread_stats {
 	int timers; /* timer code increment this */
 };
 
-extern struct thread_stats thread_stats;
+extern struct thread_stats thread_stats[SMP_MAX_CPUS];
 
-#define THREAD_STATS_INC(name) do { thread_stats.name++; } while(0)
+#define THREAD_STATS_INC(name) do { thread_stats[arch_curr_cpu_num()].name++; } while(0)
 
 #else
 
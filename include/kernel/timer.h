@@ -35,7 +35,12 @@ typedef enum handler_return (*timer_callback)(struct timer *, lk_time_t now, voi
 
 typedef struct timer {
 	int magic;
-	struct list_node node;
+
+	/* links in the pairing heap of pending timers */
+	struct timer *heap_child;
+	struct timer *heap_sibling;
+	struct timer *heap_prev;	/* previous sibling, or parent of a first child */
+	bool queued;
 
 	lk_time_t scheduled_time;
 	lk_time_t periodic_time;
@@ -47,7 +52,10 @@ typedef struct timer {
 #define TIMER_INITIAL_VALUE(t) \
 { \
 	.magic = TIMER_MAGIC, \
-	.node = LIST_INITIAL_CLEARED_VALUE, \
+	.heap_child = NULL, \
+	.heap_sibling = NULL, \
+	.heap_prev = NULL, \
+	.queued = false, \
 	.scheduled_time = 0, \
 	.periodic_time = 0, \
 	.callback = NULL, \
@@ -58,7 +66,8 @@ typedef struct timer {
  * - Timer callbacks occur from interrupt context
  * - Timers may be programmed or canceled from interrupt or thread context
  * - Timers may be canceled or reprogrammed from within their callback
- * - Timers currently are dispatched from a 10ms periodic tick
+ * - Timers are dispatched from a 10ms periodic tick, or with PLATFORM_HAS_DYNAMIC_TIMER
+ *   from a oneshot timer programmed for the earliest deadline only
 */
 void timer_initialize(timer_t *);
 void timer_set_oneshot(timer_t *, lk_time_t delay, timer_callback, void *arg);
@@ -27,6 +27,11 @@
 
 typedef void * bcache_t;
 
+enum bcache_write_policy {
+	BCACHE_WRITE_BACK,		/* dirty blocks are written on eviction or flush */
+	BCACHE_WRITE_THROUGH,	/* dirty blocks are written as soon as they are marked */
+};
+
 bcache_t bcache_create(bdev_t *dev, size_t block_size, int block_count);
 void bcache_destroy(bcache_t);
 
@@ -36,5 +41,15 @@ int bcache_read_block(bcache_t, void *, uint block);
 int bcache_get_block(bcache_t, void **, uint block);
 int bcache_put_block(bcache_t, uint block);
 
+int bcache_mark_block_dirty(bcache_t, uint block);
+int bcache_zero_block(bcache_t, uint block);
+void bcache_set_write_policy(bcache_t, enum bcache_write_policy policy);
+
+// write back every dirty block, coalescing adjacent ones
+int bcache_flush_all(bcache_t);
+int bcache_flush(bcache_t);
+
+void bcache_dump(bcache_t, const char *name);
+
 #endif
 
@@ -27,6 +27,13 @@
 
 typedef uint32_t bnum_t;
 
+struct bio_op_stats {
+	uint32_t ops;
+	uint32_t errors;
+	uint64_t bytes;
+	lk_bigtime_t usecs;
+};
+
 typedef struct bdev {
 	struct list_node node;
 	volatile int ref;
@@ -46,8 +53,27 @@ typedef struct bdev {
 	ssize_t (*erase)(struct bdev *, off_t offset, size_t len);
 	int (*ioctl)(struct bdev *, int request, void *argp);
 	void (*close)(struct bdev *);
+
+	/* counted at the bio_* entry points for whoever calls them, a
+	 * subdevice's traffic shows up on its parent as well */
+	struct {
+		struct bio_op_stats read;
+		struct bio_op_stats write;
+		struct bio_op_stats erase;
+	} stats;
 } bdev_t;
 
+/* ioctl requests */
+enum bio_ioctl_num {
+	BIO_IOCTL_NULL = 0,
+	BIO_IOCTL_DISCARD,	/* argp: struct bio_discard_range *, block aligned, reads back as zero */
+};
+
+struct bio_discard_range {
+	off_t offset;
+	size_t len;
+};
+
 /* user api */
 bdev_t *bio_open(const char *name);
 void bio_close(bdev_t *dev);
@@ -67,6 +93,7 @@ void bio_initialize_bdev(bdev_t *dev, const char *name, size_t block_size, bnum_
 
 /* debug stuff */
 void bio_dump_devices(void);
+void bio_dump_stats(void);
 
 /* subdevice support */
 status_t bio_publish_subdevice(const char *parent_dev, const char *subdev, bnum_t startblock, bnum_t block_count);
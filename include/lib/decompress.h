@@ -0,0 +1,73 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LIB_DECOMPRESS_H
+#define __LIB_DECOMPRESS_H
+
+#include <sys/types.h>
+
+/*
+ * One shot decompression of a payload held entirely in memory into a
+ * caller supplied buffer, for loading compressed kernel images.
+ *
+ * All decoders share the same conventions: out_size bounds every write,
+ * *out_len is set to the number of bytes produced and *in_used (if not
+ * NULL) to the length of the compressed stream, so that data appended
+ * after it (a device tree, say) can be found. They return NO_ERROR,
+ * ERR_NOT_VALID for a corrupt or unsupported stream, ERR_NOT_ENOUGH_BUFFER
+ * if the output does not fit, or ERR_CRC_FAIL/ERR_CHECKSUM_FAIL when the
+ * stream's own check does not match. On ERR_NOT_ENOUGH_BUFFER the first
+ * out_size bytes of the output have been written.
+ */
+
+enum decompress_type {
+	DECOMPRESS_NONE = 0,
+	DECOMPRESS_GZIP,
+	DECOMPRESS_LZ4,		/* lz4 frame format */
+	DECOMPRESS_LZ4_LEGACY,	/* lz4 -l, as used for arm64 Image.lz4 */
+};
+
+/* look at the magic at the start of buf */
+enum decompress_type decompress_detect(const void *buf, size_t len);
+const char *decompress_type_name(enum decompress_type type);
+
+status_t decompress(const void *in, size_t in_len, void *out, size_t out_size,
+                    size_t *out_len, size_t *in_used);
+
+status_t gunzip(const void *in, size_t in_len, void *out, size_t out_size,
+                size_t *out_len, size_t *in_used);
+
+/* raw deflate stream, no gzip header or trailer */
+status_t inflate_raw(const void *in, size_t in_len, void *out, size_t out_size,
+                     size_t *out_len, size_t *in_used);
+
+/* lz4 frame or legacy format */
+status_t unlz4(const void *in, size_t in_len, void *out, size_t out_size,
+               size_t *out_len, size_t *in_used);
+
+#endif
@@ -46,4 +46,17 @@ void heap_get_stats(struct heap_stats *ptr);
 /* critical section time delayed free */
 void heap_delayed_free(void *);
 
+/*
+ * One recorded heap call: size bytes aligned to align (0 for malloc) are
+ * allocated into slot, or the slot is freed when size is 0.
+ */
+struct heap_trace_op {
+	uint16_t slot;
+	uint16_t align;
+	uint32_t size;
+};
+
+/* stop recording and return the calls seen since heap_init, HEAP_TRACE only */
+size_t heap_trace_get(const struct heap_trace_op **ops);
+
 #endif
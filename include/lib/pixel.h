@@ -0,0 +1,92 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LIB_PIXEL_H
+#define __LIB_PIXEL_H
+
+#include <sys/types.h>
+
+/*
+ * Pixel run kernels shared by lib/gfx, fbcon and the splash loaders.
+ *
+ * Each call works on a run of count pixels, so callers walk their own
+ * strides. 32 bit pixels are ARGB8888 (or xRGB8888) in native order,
+ * 16 bit pixels RGB565. The implementation is picked at the first call:
+ * NEON on ARMv7/ARMv8 cores that have it, SSE2 on x86 when the OS bits
+ * for it are set, portable C otherwise.
+ */
+struct pixel_ops {
+	const char *name;
+
+	void (*fill16)(uint16_t *dst, uint16_t color, size_t count);
+	void (*fill32)(uint32_t *dst, uint32_t color, size_t count);
+	/* source over destination, ignoring the destination alpha */
+	void (*blend32)(uint32_t *dst, const uint32_t *src, size_t count);
+	void (*rgb565_to_argb8888)(uint32_t *dst, const uint16_t *src, size_t count);
+	void (*argb8888_to_rgb565)(uint16_t *dst, const uint32_t *src, size_t count);
+	/* RGB888 <-> BGR888, in place */
+	void (*swap_rgb888)(uint8_t *buf, size_t count);
+};
+
+extern const struct pixel_ops pixel_ops_c;
+
+const struct pixel_ops *pixel_get_ops(void);
+/* override the selection, e.g. to benchmark against pixel_ops_c */
+void pixel_set_ops(const struct pixel_ops *ops);
+
+static inline void pixel_fill16(uint16_t *dst, uint16_t color, size_t count)
+{
+	pixel_get_ops()->fill16(dst, color, count);
+}
+
+static inline void pixel_fill32(uint32_t *dst, uint32_t color, size_t count)
+{
+	pixel_get_ops()->fill32(dst, color, count);
+}
+
+static inline void pixel_blend32(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	pixel_get_ops()->blend32(dst, src, count);
+}
+
+static inline void pixel_rgb565_to_argb8888(uint32_t *dst, const uint16_t *src, size_t count)
+{
+	pixel_get_ops()->rgb565_to_argb8888(dst, src, count);
+}
+
+static inline void pixel_argb8888_to_rgb565(uint16_t *dst, const uint32_t *src, size_t count)
+{
+	pixel_get_ops()->argb8888_to_rgb565(dst, src, count);
+}
+
+static inline void pixel_swap_rgb888(uint8_t *buf, size_t count)
+{
+	pixel_get_ops()->swap_rgb888(buf, count);
+}
+
+#endif
@@ -0,0 +1,93 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LIB_POOL_H
+#define __LIB_POOL_H
+
+#include <sys/types.h>
+#include <list.h>
+
+/*
+ * Fixed size object pools. Objects are carved out of slabs taken from the
+ * heap and recycled through a free list, so once a pool has grown to its
+ * working set both pool_alloc and pool_free are a list push or pop.
+ * Slabs are only returned to the heap by pool_destroy.
+ */
+
+/* objects are cache line aligned and padded, safe to hand to dma */
+#define POOL_FLAG_DMA       (1 << 0)
+/* fill free objects with a pattern and check it on the next allocation */
+#define POOL_FLAG_POISON    (1 << 1)
+
+/* per pool statistics, disable with POOL_STATS=0 */
+#ifndef POOL_STATS
+#define POOL_STATS 1
+#endif
+
+struct pool_stats {
+	uint32_t allocs;
+	uint32_t frees;
+	uint32_t in_use;
+	uint32_t peak;
+	uint32_t slabs;
+};
+
+typedef struct pool {
+	struct list_node node;
+	const char *name;
+	size_t obj_size;
+	size_t align;
+	uint flags;
+	void *free_list;
+	void *slabs;
+#if POOL_STATS
+	struct pool_stats stats;
+#endif
+} pool_t;
+
+#define POOL_INITIAL_VALUE(pool, _name, _obj_size, _align, _flags) \
+{ \
+	.node = { 0, 0 }, \
+	.name = (_name), \
+	.obj_size = (_obj_size), \
+	.align = (_align), \
+	.flags = (_flags), \
+	.free_list = NULL, \
+	.slabs = NULL, \
+}
+
+void pool_init(pool_t *pool, const char *name, size_t obj_size, size_t align, uint flags);
+void pool_destroy(pool_t *pool);
+
+void *pool_alloc(pool_t *pool);
+void *pool_zalloc(pool_t *pool);
+void pool_free(pool_t *pool, void *obj);
+
+void pool_dump(pool_t *pool);
+
+#endif
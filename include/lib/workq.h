@@ -0,0 +1,74 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __LIB_WORKQ_H
+#define __LIB_WORKQ_H
+
+#include <sys/types.h>
+#include <kernel/event.h>
+
+/*
+ * Work queue for fanning cpu bound jobs out over every cpu the kernel runs
+ * on. There is one worker thread pinned to each active cpu, each with its own
+ * queue. workq_submit puts the work on the queue of the submitting cpu and
+ * idle workers steal from the other queues, so a burst of work spreads out
+ * without a central lock hand-off per item.
+ *
+ * Callbacks run in thread context at DEFAULT_PRIORITY and may block.
+ */
+
+typedef void (*workq_callback)(void *arg);
+
+/* completion group, counts the outstanding work submitted against it */
+typedef struct workq_group {
+	volatile int pending;
+	event_t done;
+} workq_group_t;
+
+void workq_group_init(workq_group_t *group);
+
+/* wait for everything submitted against the group, running queued work meanwhile */
+void workq_group_wait(workq_group_t *group);
+
+/* group may be NULL for fire and forget work */
+status_t workq_submit(workq_group_t *group, workq_callback cb, void *arg);
+
+/* number of worker threads, one per cpu that was active at init */
+uint workq_num_workers(void);
+
+typedef void (*parallel_for_callback)(size_t start, size_t end, void *arg);
+
+/*
+ * Call cb over [start, end) in pieces of at most chunk items, spread over
+ * the workers and the calling thread. A chunk of 0 picks a size giving a few
+ * pieces per worker. Returns once every piece has completed.
+ */
+void parallel_for(size_t start, size_t end, size_t chunk,
+                  parallel_for_callback cb, void *arg);
+
+#endif
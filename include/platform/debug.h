@@ -33,6 +33,7 @@ __BEGIN_CDECLS
 void platform_halt(void);
 
 void platform_dputc(char c);
+void platform_dflush(void);
 int platform_dgetc(char *c, bool wait);
 
 __END_CDECLS
@@ -73,28 +73,34 @@ static int cmd_threads(int argc, const cmd_args *argv)
 #if THREAD_STATS
 static int cmd_threadstats(int argc, const cmd_args *argv)
 {
-	printf("thread stats:\n");
-	printf("\ttotal idle time: %lld\n", thread_stats.idle_time);
-	printf("\ttotal busy time: %lld\n", current_time_hires() - thread_stats.idle_time);
-	printf("\treschedules: %d\n", thread_stats.reschedules);
-	printf("\tcontext_switches: %d\n", thread_stats.context_switches);
-	printf("\tpreempts: %d\n", thread_stats.preempts);
-	printf("\tyields: %d\n", thread_stats.yields);
-	printf("\tinterrupts: %d\n", thread_stats.interrupts);
-	printf("\ttimer interrupts: %d\n", thread_stats.timer_ints);
-	printf("\ttimers: %d\n", thread_stats.timers);
+	for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+		if (!mp_is_cpu_active(i))
+			continue;
+
+		printf("thread stats (cpu %u):\n", i);
+		printf("\ttotal idle time: %lld\n", thread_stats[i].idle_time);
+		printf("\ttotal busy time: %lld\n", current_time_hires() - thread_stats[i].idle_time);
+		printf("\treschedules: %d\n", thread_stats[i].reschedules);
+		printf("\tcontext_switches: %d\n", thread_stats[i].context_switches);
+		printf("\tpreempts: %d\n", thread_stats[i].preempts);
+		printf("\tyields: %d\n", thread_stats[i].yields);
+		printf("\tinterrupts: %d\n", thread_stats[i].interrupts);
+		printf("\ttimer interrupts: %d\n", thread_stats[i].timer_ints);
+		printf("\ttimers: %d\n", thread_stats[i].timers);
+	}
 
 	return 0;
 }
 
 static enum handler_return threadload(struct timer *t, lk_time_t now, void *arg)
 {
+	/* the timer runs on the boot cpu, so this is its load */
 	static struct thread_stats old_stats;
 	static lk_bigtime_t last_idle_time;
 
-	lk_bigtime_t idle_time = thread_stats.idle_time;
+	lk_bigtime_t idle_time = thread_stats[0].idle_time;
 	if (get_current_thread()->priority == IDLE_PRIORITY) {
-		idle_time += current_time_hires() - thread_stats.last_idle_timestamp;
+		idle_time += current_time_hires() - thread_stats[0].last_idle_timestamp;
 	}
 	lk_bigtime_t delta_time = idle_time - last_idle_time;
 	lk_bigtime_t busy_time = 1000000ULL - (delta_time > 1000000ULL ? 1000000ULL : delta_time);
@@ -103,12 +109,12 @@ static enum handler_return threadload(struct timer *t, lk_time_t now, void *arg)
 
 //	printf("idle_time %lld, busytime %lld\n", idle_time - last_idle_time, busy_time);
 	printf("LOAD: %d.%02d%%, cs %d, ints %d, timer ints %d, timers %d\n", busypercent / 100, busypercent % 100,
-	       thread_stats.context_switches - old_stats.context_switches,
-	       thread_stats.interrupts - old_stats.interrupts,
-	       thread_stats.timer_ints - old_stats.timer_ints,
-	       thread_stats.timers - old_stats.timers);
+	       thread_stats[0].context_switches - old_stats.context_switches,
+	       thread_stats[0].interrupts - old_stats.interrupts,
+	       thread_stats[0].timer_ints - old_stats.timer_ints,
+	       thread_stats[0].timers - old_stats.timers);
 
-	old_stats = thread_stats;
+	old_stats = thread_stats[0];
 	last_idle_time = idle_time;
 
 	return INT_NO_RESCHEDULE;
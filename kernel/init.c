@@ -25,6 +25,7 @@
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/debug.h>
+#include <kernel/mp.h>
 
 void kernel_init(void)
 {
@@ -35,6 +36,9 @@ void kernel_init(void)
 	dprintf(SPEW, "initializing threads\n");
 	thread_init();
 
+	// mark the boot cpu active, the others come up in bootstrap2
+	mp_init();
+
 	// initialize kernel timers
 	dprintf(SPEW, "initializing timers\n");
 	timer_init();
@@ -0,0 +1,121 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <stdio.h>
+#include <kernel/thread.h>
+#include <kernel/mp.h>
+#include <platform.h>
+
+struct mp_state mp;
+
+/* called once on the boot cpu from kernel_init() */
+void mp_init(void)
+{
+	mp.active_cpus = 1U << arch_curr_cpu_num();
+	mp.idle_cpus = 0;
+}
+
+/**
+ * @brief  Power up the secondary cpus
+ *
+ * Asks the arch layer to start every cpu up to SMP_MAX_CPUS and waits a
+ * short while for them to reach their idle threads. Cpus that fail to start
+ * or to check in are left out; the scheduler only ever uses active ones.
+ */
+void mp_start_secondary_cpus(void)
+{
+	uint cpu;
+	int i;
+
+	for (cpu = 1; cpu < SMP_MAX_CPUS; cpu++) {
+		status_t err = arch_mp_start_cpu(cpu);
+		if (err < 0)
+			dprintf(INFO, "mp: failed to start cpu %u: %d\n", cpu, err);
+	}
+
+	for (i = 0; i < 100 && mp.active_cpus != MP_CPU_ALL; i++)
+		thread_sleep(1);
+
+	dprintf(INFO, "mp: %d of %d cpus active (0x%x)\n",
+			__builtin_popcount(mp.active_cpus), SMP_MAX_CPUS, mp.active_cpus);
+}
+
+/* ask the cpus in target to run their scheduler */
+void mp_reschedule(mp_cpu_mask_t target)
+{
+	target &= mp.active_cpus & ~(1U << arch_curr_cpu_num());
+	if (target)
+		platform_mp_send_ipi(target, MP_IPI_RESCHEDULE);
+}
+
+/* the reschedule ipi handler, the irq glue preempts the current thread */
+enum handler_return mp_mbx_reschedule_irq(void *arg)
+{
+	return INT_RESCHEDULE;
+}
+
+/*
+ * Timers only fire on the boot cpu, so its preemption tick is passed on
+ * to the other cpus that are running something, to expire their quanta.
+ */
+void mp_forward_tick(void)
+{
+	mp_cpu_mask_t target = mp.active_cpus & ~mp.idle_cpus & ~(1U << arch_curr_cpu_num());
+
+	if (target)
+		platform_mp_send_ipi(target, MP_IPI_TICK);
+}
+
+enum handler_return mp_mbx_tick_irq(void *arg)
+{
+	return thread_timer_tick();
+}
+
+#if defined(WITH_LIB_CONSOLE)
+#include <lib/console.h>
+
+static int cmd_mp(int argc, const cmd_args *argv)
+{
+	uint cpu;
+
+	printf("active 0x%x idle 0x%x\n", mp.active_cpus, mp.idle_cpus);
+	for (cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+		printf("cpu %u: %s\n", cpu,
+			   !mp_is_cpu_active(cpu) ? "offline" :
+			   mp_is_cpu_idle(cpu) ? "idle" : "busy");
+	}
+
+	return 0;
+}
+
+STATIC_COMMAND_START
+STATIC_COMMAND("mp", "show cpu state", &cmd_mp)
+STATIC_COMMAND_END(mp);
+#endif
@@ -17,4 +17,17 @@ MODULE_SRCS := \
 	$(LOCAL_DIR)/semaphore.c \
 	
 
+ifeq ($(WITH_SMP),1)
+SMP_MAX_CPUS ?= 4
+SMP_CPUS_PER_CLUSTER ?= 4
+
+GLOBAL_DEFINES += \
+	WITH_SMP=1 \
+	SMP_MAX_CPUS=$(SMP_MAX_CPUS) \
+	SMP_CPUS_PER_CLUSTER=$(SMP_CPUS_PER_CLUSTER)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/mp.c
+endif
+
 include make/module.mk
@@ -34,12 +34,14 @@
 #include <assert.h>
 #include <list.h>
 #include <malloc.h>
+#include <stdio.h>
 #include <string.h>
 #include <err.h>
 #include <lib/dpc.h>
 #include <kernel/thread.h>
 #include <kernel/timer.h>
 #include <kernel/debug.h>
+#include <kernel/mp.h>
 #include <platform.h>
 #include <target.h>
 #include <lib/heap.h>
@@ -49,24 +51,39 @@
 #endif
 
 #if THREAD_STATS
-struct thread_stats thread_stats;
+struct thread_stats thread_stats[SMP_MAX_CPUS];
 #endif
 
 /* global thread list */
 static struct list_node thread_list;
 
+#if WITH_SMP
+/* the per cpu critical section count and the lock it guards */
+int critical_section_count_percpu[SMP_MAX_CPUS];
+spin_lock_t thread_lock;
+#else
 /* the global critical section count */
 int critical_section_count;
+#endif
+
+/* the run queues, one set per cpu */
+struct run_queue {
+	struct list_node list[NUM_PRIORITIES];
+	uint32_t bitmap;
+};
 
-/* the run queue */
-static struct list_node run_queue[NUM_PRIORITIES];
-static uint32_t run_queue_bitmap;
+static struct run_queue run_queues[SMP_MAX_CPUS];
 
 /* the bootstrap thread (statically allocated) */
 static thread_t bootstrap_thread;
 
-/* the idle thread */
-static thread_t *idle_thread;
+#if WITH_SMP
+/* the threads the secondary cpus boot on, later their idle threads */
+static thread_t secondary_bootstrap_threads[SMP_MAX_CPUS];
+#endif
+
+/* the idle thread for each cpu */
+static thread_t *idle_threads[SMP_MAX_CPUS];
 
 /* local routines */
 static void thread_resched(void);
@@ -75,8 +92,48 @@ static void idle_thread_routine(void) __NO_RETURN;
 #if PLATFORM_HAS_DYNAMIC_TIMER
 /* preemption timer */
 static timer_t preempt_timer;
+static bool preempt_timer_running;
 #endif
 
+static inline int highest_run_queue(uint32_t bitmap)
+{
+	// at the moment, can't deal with more than 32 priority levels
+	return HIGHEST_PRIORITY - __builtin_clz(bitmap) - (32 - NUM_PRIORITIES);
+}
+
+/* pick the cpu whose run queue a newly runnable thread goes on */
+static uint thread_target_cpu(thread_t *t)
+{
+	uint curr_cpu = arch_curr_cpu_num();
+
+#if WITH_SMP
+	if (t->pinned_cpu >= 0 && mp_is_cpu_active(t->pinned_cpu))
+		return t->pinned_cpu;
+
+	/* a thread giving up the cpu stays where it is */
+	if (t == get_current_thread())
+		return curr_cpu;
+
+	/* otherwise prefer an idle cpu, this one first */
+	mp_cpu_mask_t idle = mp.idle_cpus & mp.active_cpus;
+	if (idle & (1U << curr_cpu))
+		return curr_cpu;
+	if (idle)
+		return __builtin_ctz(idle);
+#endif
+
+	return curr_cpu;
+}
+
+/* get an idle cpu to pick up a thread just queued on it */
+static void thread_kick_cpu(uint cpu)
+{
+	if (cpu != arch_curr_cpu_num() && mp_is_cpu_idle(cpu)) {
+		mp_set_cpu_busy(cpu);
+		mp_reschedule(1U << cpu);
+	}
+}
+
 /* run queue manipulation */
 static void insert_in_run_queue_head(thread_t *t)
 {
@@ -87,8 +144,18 @@ static void insert_in_run_queue_head(thread_t *t)
 	ASSERT(in_critical_section());
 #endif
 
-	list_add_head(&run_queue[t->priority], &t->queue_node);
-	run_queue_bitmap |= (1<<t->priority);
+	/* idle threads are never queued, a cpu falls back to its own when its queue is empty */
+	if (t->flags & THREAD_FLAG_IDLE)
+		return;
+
+	uint cpu = thread_target_cpu(t);
+	struct run_queue *rq = &run_queues[cpu];
+
+	list_add_head(&rq->list[t->priority], &t->queue_node);
+	rq->bitmap |= (1<<t->priority);
+	t->curr_cpu = cpu;
+
+	thread_kick_cpu(cpu);
 }
 
 static void insert_in_run_queue_tail(thread_t *t)
@@ -100,14 +167,89 @@ static void insert_in_run_queue_tail(thread_t *t)
 	ASSERT(in_critical_section());
 #endif
 
-	list_add_tail(&run_queue[t->priority], &t->queue_node);
-	run_queue_bitmap |= (1<<t->priority);
+	if (t->flags & THREAD_FLAG_IDLE)
+		return;
+
+	uint cpu = thread_target_cpu(t);
+	struct run_queue *rq = &run_queues[cpu];
+
+	list_add_tail(&rq->list[t->priority], &t->queue_node);
+	rq->bitmap |= (1<<t->priority);
+	t->curr_cpu = cpu;
+
+	thread_kick_cpu(cpu);
+}
+
+static void remove_from_run_queue(thread_t *t)
+{
+	struct run_queue *rq = &run_queues[t->curr_cpu];
+
+	list_delete(&t->queue_node);
+	if (list_is_empty(&rq->list[t->priority]))
+		rq->bitmap &= ~(1<<t->priority);
+}
+
+/*
+ * Take the next thread for a cpu off the run queues. The cpu's own queue
+ * wins ties; a strictly higher priority thread queued behind a busy cpu
+ * is stolen unless it is pinned there. Returns NULL if there is nothing
+ * to run besides the idle thread.
+ */
+static thread_t *get_top_thread(uint cpu)
+{
+	struct run_queue *rq = &run_queues[cpu];
+	thread_t *t = NULL;
+	int prio = rq->bitmap ? highest_run_queue(rq->bitmap) : -1;
+
+#if WITH_SMP
+	for (uint i = 0; i < SMP_MAX_CPUS; i++) {
+		uint32_t bitmap = run_queues[i].bitmap;
+
+		if (i == cpu)
+			continue;
+
+		while (bitmap) {
+			int p = highest_run_queue(bitmap);
+			thread_t *candidate;
+
+			if (p <= prio)
+				break;
+
+			list_for_every_entry(&run_queues[i].list[p], candidate, thread_t, queue_node) {
+				if (candidate->pinned_cpu < 0) {
+					t = candidate;
+					prio = p;
+					break;
+				}
+			}
+			if (t && prio == p)
+				break;
+
+			bitmap &= ~(1<<p);
+		}
+	}
+
+	if (t) {
+		remove_from_run_queue(t);
+		return t;
+	}
+#endif
+
+	if (prio < 0)
+		return NULL;
+
+	t = list_remove_head_type(&rq->list[prio], thread_t, queue_node);
+	if (list_is_empty(&rq->list[prio]))
+		rq->bitmap &= ~(1<<prio);
+
+	return t;
 }
 
 static void init_thread_struct(thread_t *t, const char *name)
 {
 	memset(t, 0, sizeof(thread_t));
 	t->magic = THREAD_MAGIC;
+	t->pinned_cpu = -1;
 	strlcpy(t->name, name, sizeof(t->name));
 }
 
@@ -385,6 +527,7 @@ void thread_resched(void)
 	thread_t *newthread;
 
 	thread_t *current_thread = get_current_thread();
+	uint cpu = arch_curr_cpu_num();
 
 //	printf("thread_resched: current %p: ", current_thread);
 //	dump_thread(current_thread);
@@ -400,18 +543,9 @@ void thread_resched(void)
 	// at the moment, can't deal with more than 32 priority levels
 	ASSERT(NUM_PRIORITIES <= 32);
 
-	// should at least find the idle thread
-#if THREAD_CHECKS
-	ASSERT(run_queue_bitmap != 0);
-#endif
-
-	int next_queue = HIGHEST_PRIORITY - __builtin_clz(run_queue_bitmap) - (32 - NUM_PRIORITIES);
-	//dprintf(SPEW, "bitmap 0x%x, next %d\n", run_queue_bitmap, next_queue);
-
-	newthread = list_remove_head_type(&run_queue[next_queue], thread_t, queue_node);
-
-	if (list_is_empty(&run_queue[next_queue]))
-		run_queue_bitmap &= ~(1<<next_queue);
+	newthread = get_top_thread(cpu);
+	if (!newthread)
+		newthread = idle_threads[cpu];
 
 #if THREAD_CHECKS
 	ASSERT(newthread);
@@ -421,6 +555,12 @@ void thread_resched(void)
 //	dump_thread(newthread);
 
 	newthread->state = THREAD_RUNNING;
+	newthread->curr_cpu = cpu;
+
+	if (newthread->flags & THREAD_FLAG_IDLE)
+		mp_set_cpu_idle(cpu);
+	else
+		mp_set_cpu_busy(cpu);
 
 	if (newthread == oldthread)
 		return;
@@ -433,12 +573,12 @@ void thread_resched(void)
 #if THREAD_STATS
 	THREAD_STATS_INC(context_switches);
 
-	if (oldthread == idle_thread) {
+	if (oldthread->flags & THREAD_FLAG_IDLE) {
 		lk_bigtime_t now = current_time_hires();
-		thread_stats.idle_time += now - thread_stats.last_idle_timestamp;
+		thread_stats[cpu].idle_time += now - thread_stats[cpu].last_idle_timestamp;
 	}
-	if (newthread == idle_thread) {
-		thread_stats.last_idle_timestamp = current_time_hires();
+	if (newthread->flags & THREAD_FLAG_IDLE) {
+		thread_stats[cpu].last_idle_timestamp = current_time_hires();
 	}
 #endif
 
@@ -451,17 +591,27 @@ void thread_resched(void)
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
 	/* if we're switching from idle to a real thread, set up a periodic
-	 * timer to run our preemption tick.
+	 * timer to run our preemption tick. Timers only fire on the boot cpu,
+	 * so that is the only one that gets one. With SMP it also ticks the
+	 * other cpus, so it is left running while the boot cpu idles.
 	 */
-	if (oldthread == idle_thread) {
-		timer_set_periodic(&preempt_timer, 10, (timer_callback)thread_timer_tick, NULL);
-	} else if (newthread == idle_thread) {
-		timer_cancel(&preempt_timer);
+	if (cpu == 0) {
+		if ((oldthread->flags & THREAD_FLAG_IDLE) && !preempt_timer_running) {
+			timer_set_periodic(&preempt_timer, 10, (timer_callback)thread_timer_tick, NULL);
+			preempt_timer_running = true;
+		}
+#if !WITH_SMP
+		else if (newthread->flags & THREAD_FLAG_IDLE) {
+			timer_cancel(&preempt_timer);
+			preempt_timer_running = false;
+		}
+#endif
 	}
 #endif
 
 	/* set some optional target debug leds */
-	target_set_debug_led(0, newthread != idle_thread);
+	if (cpu == 0)
+		target_set_debug_led(0, !(newthread->flags & THREAD_FLAG_IDLE));
 
 	/* do the switch */
 	oldthread->saved_critical_section_count = critical_section_count;
@@ -528,7 +678,7 @@ void thread_preempt(void)
 	enter_critical_section();
 
 #if THREAD_STATS
-	if (current_thread != idle_thread)
+	if (!(current_thread->flags & THREAD_FLAG_IDLE))
 		THREAD_STATS_INC(preempts); /* only track when a meaningful preempt happens */
 #endif
 
@@ -576,7 +726,10 @@ enum handler_return thread_timer_tick(void)
 {
 	thread_t *current_thread = get_current_thread();
 
-	if (current_thread == idle_thread)
+	if (arch_curr_cpu_num() == 0)
+		mp_forward_tick();
+
+	if (current_thread->flags & THREAD_FLAG_IDLE)
 		return INT_NO_RESCHEDULE;
 
 	current_thread->remaining_quantum--;
@@ -640,10 +793,13 @@ void thread_sleep(lk_time_t delay)
 void thread_init_early(void)
 {
 	int i;
+	uint cpu;
 
 	/* initialize the run queues */
-	for (i=0; i < NUM_PRIORITIES; i++)
-		list_initialize(&run_queue[i]);
+	for (cpu=0; cpu < SMP_MAX_CPUS; cpu++) {
+		for (i=0; i < NUM_PRIORITIES; i++)
+			list_initialize(&run_queues[cpu].list[i]);
+	}
 
 	/* initialize the thread list */
 	list_initialize(&thread_list);
@@ -662,6 +818,48 @@ void thread_init_early(void)
 	set_current_thread(t);
 }
 
+#if WITH_SMP
+/**
+ * @brief  Give a secondary cpu a thread context
+ *
+ * Called on each secondary cpu as it comes up, inside the critical section
+ * it entered with. The thread created here goes on to become the cpu's
+ * idle thread.
+ */
+void thread_secondary_cpu_init_early(void)
+{
+	uint cpu = arch_curr_cpu_num();
+
+	ASSERT(cpu > 0 && cpu < SMP_MAX_CPUS);
+
+	thread_t *t = &secondary_bootstrap_threads[cpu];
+	char name[16];
+	snprintf(name, sizeof(name), "cpu%u bootstrap", cpu);
+	init_thread_struct(t, name);
+
+	t->priority = HIGHEST_PRIORITY;
+	t->state = THREAD_RUNNING;
+	t->saved_critical_section_count = 1;
+	t->flags = THREAD_FLAG_DETACHED;
+	t->curr_cpu = cpu;
+	t->pinned_cpu = cpu;
+	wait_queue_init(&t->retcode_wait_queue);
+	list_add_head(&thread_list, &t->thread_list_node);
+	set_current_thread(t);
+}
+
+/* the assembly interrupt glue can't use the inline versions */
+void thread_irq_enter(void)
+{
+	inc_critical_section();
+}
+
+void thread_irq_exit(void)
+{
+	dec_critical_section();
+}
+#endif
+
 /**
  * @brief Complete thread initialization
  *
@@ -697,6 +895,44 @@ void thread_set_priority(int priority)
 	get_current_thread()->priority = priority;
 }
 
+/**
+ * @brief Restrict a thread to one cpu
+ *
+ * @param t    Thread to pin
+ * @param cpu  Cpu to run it on, or -1 to let it run anywhere
+ *
+ * A ready thread moves to the new cpu's run queue immediately, the current
+ * thread moves by rescheduling. A thread running on another cpu moves the
+ * next time it is scheduled out.
+ */
+void thread_set_pinned_cpu(thread_t *t, int cpu)
+{
+#if THREAD_CHECKS
+	ASSERT(t->magic == THREAD_MAGIC);
+#endif
+	ASSERT(cpu >= -1 && cpu < SMP_MAX_CPUS);
+
+	enter_critical_section();
+
+	t->pinned_cpu = cpu;
+
+#if WITH_SMP
+	/* with a single cpu every thread already is where it's pinned */
+	if (cpu >= 0 && t->curr_cpu != cpu) {
+		if (t->state == THREAD_READY) {
+			remove_from_run_queue(t);
+			insert_in_run_queue_tail(t);
+		} else if (t == get_current_thread()) {
+			t->state = THREAD_READY;
+			insert_in_run_queue_tail(t);
+			thread_resched();
+		}
+	}
+#endif
+
+	exit_critical_section();
+}
+
 /**
  * @brief  Become an idle thread
  *
@@ -706,9 +942,21 @@ void thread_set_priority(int priority)
  */
 void thread_become_idle(void)
 {
+	thread_t *t = get_current_thread();
+	uint cpu = arch_curr_cpu_num();
+
+#if WITH_SMP
+	char name[16];
+	snprintf(name, sizeof(name), "idle %u", cpu);
+	thread_set_name(name);
+#else
 	thread_set_name("idle");
+#endif
 	thread_set_priority(IDLE_PRIORITY);
-	idle_thread = get_current_thread();
+	t->flags |= THREAD_FLAG_IDLE;
+	t->curr_cpu = cpu;
+	t->pinned_cpu = cpu;
+	idle_threads[cpu] = t;
 
 	/* release the implicit boot critical section and yield to the scheduler */
 	exit_critical_section();
@@ -739,6 +987,9 @@ void dump_thread(thread_t *t)
 	dprintf(INFO, "\tstate %s, priority %d, remaining quantum %d, critical section %d\n",
 				  thread_state_to_str(t->state), t->priority, t->remaining_quantum,
 				  t->saved_critical_section_count);
+#if WITH_SMP
+	dprintf(INFO, "\tcpu %d, pinned cpu %d\n", t->curr_cpu, t->pinned_cpu);
+#endif
 	dprintf(INFO, "\tstack %p, stack_size %zd\n", t->stack, t->stack_size);
 	dprintf(INFO, "\tentry %p, arg %p, flags 0x%x\n", t->entry, t->arg, t->flags);
 	dprintf(INFO, "\twait queue %p, wait queue ret %d\n", t->blocking_wait_queue, t->wait_queue_block_ret);
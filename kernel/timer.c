@@ -46,7 +46,8 @@
 
 #define LOCAL_TRACE 0
 
-static struct list_node timer_queue;
+/* root of the pairing heap of pending timers, the earliest deadline */
+static timer_t *timer_heap;
 
 static enum handler_return timer_tick(void *arg, lk_time_t now);
 
@@ -58,21 +59,101 @@ void timer_initialize(timer_t *timer)
 	*timer = (timer_t)TIMER_INITIAL_VALUE(*timer);
 }
 
-static void insert_timer_in_queue(timer_t *timer)
+/* make the later of two detached heaps the first child of the earlier one */
+static timer_t *timer_heap_meld(timer_t *a, timer_t *b)
 {
-	timer_t *entry;
+	timer_t *t;
 
-	LTRACEF("timer %p, scheduled %lu, periodic %lu\n", timer, timer->scheduled_time, timer->periodic_time);
+	if (!a)
+		return b;
+	if (!b)
+		return a;
+
+	if (TIME_LT(b->scheduled_time, a->scheduled_time)) {
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	b->heap_prev = a;
+	b->heap_sibling = a->heap_child;
+	if (a->heap_child)
+		a->heap_child->heap_prev = b;
+	a->heap_child = b;
+
+	return a;
+}
 
-	list_for_every_entry(&timer_queue, entry, timer_t, node) {
-		if (TIME_GT(entry->scheduled_time, timer->scheduled_time)) {
-			list_add_before(&entry->node, &timer->node);
-			return;
+/* meld a list of siblings into one heap, pairing them left to right then folding right to left */
+static timer_t *timer_heap_merge_pairs(timer_t *first)
+{
+	timer_t *a, *b, *next;
+	timer_t *pairs = NULL;
+	timer_t *root = NULL;
+
+	while (first) {
+		a = first;
+		b = a->heap_sibling;
+		next = b ? b->heap_sibling : NULL;
+
+		a->heap_sibling = a->heap_prev = NULL;
+		if (b) {
+			b->heap_sibling = b->heap_prev = NULL;
+			a = timer_heap_meld(a, b);
 		}
+
+		/* stack the melded pairs through their sibling link */
+		a->heap_sibling = pairs;
+		pairs = a;
+		first = next;
+	}
+
+	while (pairs) {
+		next = pairs->heap_sibling;
+		pairs->heap_sibling = NULL;
+		root = timer_heap_meld(root, pairs);
+		pairs = next;
+	}
+
+	if (root)
+		root->heap_prev = NULL;
+
+	return root;
+}
+
+static void insert_timer_in_queue(timer_t *timer)
+{
+	LTRACEF("timer %p, scheduled %lu, periodic %lu\n", timer, timer->scheduled_time, timer->periodic_time);
+
+	timer->heap_child = timer->heap_sibling = timer->heap_prev = NULL;
+	timer->queued = true;
+
+	timer_heap = timer_heap_meld(timer_heap, timer);
+}
+
+static void remove_timer_from_queue(timer_t *timer)
+{
+	timer_t *sub;
+
+	DEBUG_ASSERT(timer->queued);
+
+	if (timer == timer_heap) {
+		timer_heap = timer_heap_merge_pairs(timer->heap_child);
+	} else {
+		/* unlink from the siblings, then meld its children back in */
+		if (timer->heap_prev->heap_child == timer)
+			timer->heap_prev->heap_child = timer->heap_sibling;
+		else
+			timer->heap_prev->heap_sibling = timer->heap_sibling;
+		if (timer->heap_sibling)
+			timer->heap_sibling->heap_prev = timer->heap_prev;
+
+		sub = timer_heap_merge_pairs(timer->heap_child);
+		timer_heap = timer_heap_meld(timer_heap, sub);
 	}
 
-	/* walked off the end of the list */
-	list_add_tail(&timer_queue, &timer->node);
+	timer->heap_child = timer->heap_sibling = timer->heap_prev = NULL;
+	timer->queued = false;
 }
 
 static void timer_set(timer_t *timer, lk_time_t delay, lk_time_t period, timer_callback callback, void *arg)
@@ -83,7 +164,7 @@ static void timer_set(timer_t *timer, lk_time_t delay, lk_time_t period, timer_c
 
 	DEBUG_ASSERT(timer->magic == TIMER_MAGIC);
 
-	if (list_in_list(&timer->node)) {
+	if (timer->queued) {
 		panic("timer %p already in list\n", timer);
 	}
 
@@ -100,7 +181,7 @@ static void timer_set(timer_t *timer, lk_time_t delay, lk_time_t period, timer_c
 	insert_timer_in_queue(timer);
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
-	if (list_peek_head_type(&timer_queue, timer_t, node) == timer) {
+	if (timer_heap == timer) {
 		/* we just modified the head of the timer queue */
 		LTRACEF("setting new timer for %u msecs\n", (uint)delay);
 		platform_set_oneshot_timer(timer_tick, NULL, delay);
@@ -162,11 +243,11 @@ void timer_cancel(timer_t *timer)
 	enter_critical_section();
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
-	timer_t *oldhead = list_peek_head_type(&timer_queue, timer_t, node);
+	timer_t *oldhead = timer_heap;
 #endif
 
-	if (list_in_list(&timer->node))
-		list_delete(&timer->node);
+	if (timer->queued)
+		remove_timer_from_queue(timer);
 
 	/* to keep it from being reinserted into the queue if called from
 	 * periodic timer callback.
@@ -177,7 +258,7 @@ void timer_cancel(timer_t *timer)
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
 	/* see if we've just modified the head of the timer queue */
-	timer_t *newhead = list_peek_head_type(&timer_queue, timer_t, node);
+	timer_t *newhead = timer_heap;
 	if (newhead == NULL) {
 		LTRACEF("clearing old hw timer, nothing in the queue\n");
 		platform_stop_timer();
@@ -211,7 +292,7 @@ static enum handler_return timer_tick(void *arg, lk_time_t now)
 
 	for (;;) {
 		/* see if there's an event to process */
-		timer = list_peek_head_type(&timer_queue, timer_t, node);
+		timer = timer_heap;
 		if (likely(timer == 0))
 			break;
 		LTRACEF("next item on timer queue %p at %lu now %lu (%p, arg %p)\n", timer, timer->scheduled_time, now, timer->callback, timer->arg);
@@ -221,7 +302,7 @@ static enum handler_return timer_tick(void *arg, lk_time_t now)
 		/* process it */
 		LTRACEF("timer %p\n", timer);
 		DEBUG_ASSERT(timer && timer->magic == TIMER_MAGIC);
-		list_delete(&timer->node);
+		remove_timer_from_queue(timer);
 
 		LTRACEF("dequeued timer %p, scheduled %lu periodic %lu\n", timer, timer->scheduled_time, timer->periodic_time);
 
@@ -237,7 +318,7 @@ static enum handler_return timer_tick(void *arg, lk_time_t now)
 		/* if it was a periodic timer and it hasn't been requeued
 		 * by the callback put it back in the list
 		 */
-		if (periodic && !list_in_list(&timer->node) && timer->periodic_time > 0) {
+		if (periodic && !timer->queued && timer->periodic_time > 0) {
 			LTRACEF("periodic timer, period %u\n", (uint)timer->periodic_time);
 			timer->scheduled_time = now + timer->periodic_time;
 			insert_timer_in_queue(timer);
@@ -246,7 +327,7 @@ static enum handler_return timer_tick(void *arg, lk_time_t now)
 
 #if PLATFORM_HAS_DYNAMIC_TIMER
 	/* reset the timer to the next event */
-	timer = list_peek_head_type(&timer_queue, timer_t, node);
+	timer = timer_heap;
 	if (timer) {
 		/* has to be the case or it would have fired already */
 		DEBUG_ASSERT(TIME_GT(timer->scheduled_time, now));
@@ -269,7 +350,7 @@ static enum handler_return timer_tick(void *arg, lk_time_t now)
 
 void timer_init(void)
 {
-	list_initialize(&timer_queue);
+	timer_heap = NULL;
 
 #if !PLATFORM_HAS_DYNAMIC_TIMER
 	/* register for a periodic timer tick */
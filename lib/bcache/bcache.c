@@ -22,6 +22,7 @@
  */
 #include <list.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <assert.h>
 #include <string.h>
 #include <sys/types.h>
@@ -29,11 +30,17 @@
 #include <trace.h>
 #include <lib/bcache.h>
 #include <lib/bio.h>
+#include <lib/console.h>
 
 #define LOCAL_TRACE 0
 
+/* max number of adjacent dirty blocks written with one bio call */
+#define BCACHE_FLUSH_BATCH 16
+
 struct bcache_block {
-	struct list_node node;
+	struct list_node node;		/* free list or lru (unreferenced blocks only) */
+	struct list_node hash_node;
+	struct list_node dirty_node;
 	bnum_t blocknum;
 	int ref_count;
 	bool is_dirty;
@@ -49,30 +56,64 @@ struct bcache_stats {
 };
 
 struct bcache {
+	struct list_node node;
 	bdev_t *dev;
 	size_t block_size;
 	int count;
+	enum bcache_write_policy policy;
 	struct bcache_stats stats;
 
 	struct list_node free_list;
 	struct list_node lru_list;
+	struct list_node dirty_list;
+
+	/* blocknum hash, 1 << hash_bits buckets */
+	struct list_node *hash;
+	uint hash_bits;
 
 	struct bcache_block *blocks;
+
+	/* scratch for bcache_flush_all */
+	struct bcache_block **sort;
+	void *flush_buf;
 };
 
+static struct list_node bcache_list = LIST_INITIAL_VALUE(bcache_list);
+
+static inline struct list_node *hash_bucket(struct bcache *cache, bnum_t blocknum)
+{
+	/* fibonacci hashing, the top bits of the product are the well mixed ones */
+	if (cache->hash_bits == 0)
+		return &cache->hash[0];
+	return &cache->hash[(uint32_t)(blocknum * 2654435761U) >> (32 - cache->hash_bits)];
+}
+
 bcache_t bcache_create(bdev_t *dev, size_t block_size, int block_count)
 {
 	struct bcache *cache;
+	uint buckets;
+	uint bits;
 
 	cache = malloc(sizeof(struct bcache));
 
 	cache->dev = dev;
 	cache->block_size = block_size;
 	cache->count = block_count;
+	cache->policy = BCACHE_WRITE_BACK;
 	memset(&cache->stats, 0, sizeof(cache->stats));
 
 	list_initialize(&cache->free_list);
 	list_initialize(&cache->lru_list);
+	list_initialize(&cache->dirty_list);
+
+	/* keep the chains around one block long */
+	for (bits = 0, buckets = 1; buckets < (uint)block_count; bits++, buckets <<= 1)
+		;
+	cache->hash_bits = bits;
+	cache->hash = malloc(sizeof(struct list_node) * buckets);
+	uint b;
+	for (b = 0; b < buckets; b++)
+		list_initialize(&cache->hash[b]);
 
 	cache->blocks = malloc(sizeof(struct bcache_block) * block_count);
 	int i;
@@ -80,24 +121,64 @@ bcache_t bcache_create(bdev_t *dev, size_t block_size, int block_count)
 		cache->blocks[i].ref_count = 0;
 		cache->blocks[i].is_dirty = false;
 		cache->blocks[i].ptr = malloc(block_size);
+		list_clear_node(&cache->blocks[i].hash_node);
+		list_clear_node(&cache->blocks[i].dirty_node);
 		// add to the free list
 		list_add_head(&cache->free_list, &cache->blocks[i].node);
 	}
 
+	cache->sort = NULL;
+	cache->flush_buf = NULL;
+
+	list_add_tail(&bcache_list, &cache->node);
+
 	return (bcache_t)cache;
 }
 
+void bcache_set_write_policy(bcache_t _cache, enum bcache_write_policy policy)
+{
+	struct bcache *cache = _cache;
+
+	cache->policy = policy;
+	if (policy == BCACHE_WRITE_THROUGH)
+		bcache_flush_all(cache);
+}
+
+static void mark_clean(struct bcache_block *block)
+{
+	if (block->is_dirty) {
+		block->is_dirty = false;
+		list_delete(&block->dirty_node);
+	}
+}
+
+static void mark_dirty(struct bcache *cache, struct bcache_block *block)
+{
+	if (!block->is_dirty) {
+		block->is_dirty = true;
+		list_add_tail(&cache->dirty_list, &block->dirty_node);
+	}
+}
+
+static ssize_t write_blocks(struct bcache *cache, const void *buf, bnum_t blocknum, uint count)
+{
+	if (cache->block_size == cache->dev->block_size)
+		return bio_write_block(cache->dev, buf, blocknum, count);
+
+	return bio_write(cache->dev, buf,
+	                 (off_t)blocknum * cache->block_size,
+	                 cache->block_size * count);
+}
+
 static int flush_block(struct bcache *cache, struct bcache_block *block)
 {
 	int rc;
 
-	rc = bio_write(cache->dev, block->ptr,
-	               (off_t)block->blocknum * cache->block_size,
-	               cache->block_size);
+	rc = write_blocks(cache, block->ptr, block->blocknum, 1);
 	if (rc < 0)
 		goto exit;
 
-	block->is_dirty = false;
+	mark_clean(block);
 	cache->stats.writes++;
 	rc = 0;
 exit:
@@ -109,6 +190,8 @@ void bcache_destroy(bcache_t _cache)
 	struct bcache *cache = _cache;
 	int i;
 
+	list_delete(&cache->node);
+
 	for (i=0; i < cache->count; i++) {
 		DEBUG_ASSERT(cache->blocks[i].ref_count == 0);
 
@@ -119,6 +202,10 @@ void bcache_destroy(bcache_t _cache)
 		free(cache->blocks[i].ptr);
 	}
 
+	free(cache->blocks);
+	free(cache->hash);
+	free(cache->sort);
+	free(cache->flush_buf);
 	free(cache);
 }
 
@@ -131,13 +218,16 @@ static struct bcache_block *find_block(struct bcache *cache, uint blocknum)
 	LTRACEF("num %u\n", blocknum);
 
 	block = NULL;
-	list_for_every_entry(&cache->lru_list, block, struct bcache_block, node) {
+	list_for_every_entry(hash_bucket(cache, blocknum), block, struct bcache_block, hash_node) {
 		LTRACEF("looking at entry %p, num %u\n", block, block->blocknum);
 		depth++;
 
 		if (block->blocknum == blocknum) {
-			list_delete(&block->node);
-			list_add_tail(&cache->lru_list, &block->node);
+			/* referenced blocks are off the lru until put back */
+			if (block->ref_count == 0) {
+				list_delete(&block->node);
+				list_add_tail(&cache->lru_list, &block->node);
+			}
 			cache->stats.hits++;
 			cache->stats.depth += depth;
 			return block;
@@ -148,8 +238,8 @@ static struct bcache_block *find_block(struct bcache *cache, uint blocknum)
 	return NULL;
 }
 
-/* allocate a new block */
-static struct bcache_block *alloc_block(struct bcache *cache)
+/* allocate a new block and hash it under blocknum */
+static struct bcache_block *alloc_block(struct bcache *cache, uint blocknum)
 {
 	int err;
 	struct bcache_block *block;
@@ -157,30 +247,40 @@ static struct bcache_block *alloc_block(struct bcache *cache)
 	/* pop one off the free list if it's present */
 	block = list_remove_head_type(&cache->free_list, struct bcache_block, node);
 	if (block) {
-		block->ref_count = 0;
-		list_add_tail(&cache->lru_list, &block->node);
 		LTRACEF("found block %p on free list\n", block);
-		return block;
-	}
-
-	/* walk the lru, looking for a free block */
-	list_for_every_entry(&cache->lru_list, block, struct bcache_block, node) {
-		LTRACEF("looking at %p, num %u\n", block, block->blocknum);
-		if (block->ref_count == 0) {
-			if (block->is_dirty) {
-				err = flush_block(cache, block);
-				if (err)
-					return NULL;
-			}
+	} else {
+		/* the lru only holds unreferenced blocks, its head is the victim */
+		block = list_peek_head_type(&cache->lru_list, struct bcache_block, node);
+		if (!block)
+			return NULL;
 
-			// add it to the tail of the lru
-			list_delete(&block->node);
-			list_add_tail(&cache->lru_list, &block->node);
-			return block;
+		LTRACEF("evicting %p, num %u\n", block, block->blocknum);
+		if (block->is_dirty) {
+			err = flush_block(cache, block);
+			if (err)
+				return NULL;
 		}
+
+		list_delete(&block->node);
+		list_delete(&block->hash_node);
 	}
 
-	return NULL;
+	block->ref_count = 0;
+	block->blocknum = blocknum;
+	list_add_tail(&cache->lru_list, &block->node);
+	list_add_head(hash_bucket(cache, blocknum), &block->hash_node);
+
+	return block;
+}
+
+static void free_block(struct bcache *cache, struct bcache_block *block)
+{
+	DEBUG_ASSERT(block->ref_count == 0);
+
+	mark_clean(block);
+	list_delete(&block->node);
+	list_delete(&block->hash_node);
+	list_add_tail(&cache->free_list, &block->node);
 }
 
 static struct bcache_block *find_or_fill_block(struct bcache *cache, uint blocknum)
@@ -195,16 +295,15 @@ static struct bcache_block *find_or_fill_block(struct bcache *cache, uint blockn
 		LTRACEF("wasn't allocated\n");
 
 		/* allocate a new block and fill it */
-		block = alloc_block(cache);
+		block = alloc_block(cache, blocknum);
 		DEBUG_ASSERT(block);
 
 		LTRACEF("wasn't allocated, new block %p\n", block);
 
-		block->blocknum = blocknum;
 		err = bio_read(cache->dev, block->ptr, (off_t)blocknum * cache->block_size, cache->block_size);
 		if (err < 0) {
 			/* free the block, return an error */
-			list_add_tail(&cache->free_list, &block->node);
+			free_block(cache, block);
 			return NULL;
 		}
 
@@ -246,8 +345,9 @@ int bcache_get_block(bcache_t _cache, void **ptr, uint blocknum)
 		return -1;
 	}
 
-	/* increment the ref count to keep it from being freed */
-	block->ref_count++;
+	/* increment the ref count and pull it off the lru to keep it from being freed */
+	if (block->ref_count++ == 0)
+		list_delete(&block->node);
 	*ptr = block->ptr;
 
 	return 0;
@@ -265,7 +365,8 @@ int bcache_put_block(bcache_t _cache, uint blocknum)
 	DEBUG_ASSERT(block);
 	DEBUG_ASSERT(block->ref_count > 0);
 
-	block->ref_count--;
+	if (--block->ref_count == 0)
+		list_add_tail(&cache->lru_list, &block->node);
 
 	return 0;
 }
@@ -282,8 +383,10 @@ int bcache_mark_block_dirty(bcache_t priv, uint blocknum)
 		goto exit;
 	}
 
-	block->is_dirty = true;
+	mark_dirty(cache, block);
 	err = 0;
+	if (cache->policy == BCACHE_WRITE_THROUGH)
+		err = flush_block(cache, block);
 exit:
 	return (err);
 }
@@ -296,41 +399,106 @@ int bcache_zero_block(bcache_t priv, uint blocknum)
 
 	block = find_block(cache, blocknum);
 	if (!block) {
-		block = alloc_block(cache);
+		block = alloc_block(cache, blocknum);
 		if (!block) {
 			err = -1;
 			goto exit;
 		}
-
-		block->blocknum = blocknum;
 	}
 
 	memset(block->ptr, 0, cache->block_size);
-	block->is_dirty = true;
+	mark_dirty(cache, block);
 	err = 0;
+	if (cache->policy == BCACHE_WRITE_THROUGH)
+		err = flush_block(cache, block);
 exit:
 	return (err);
 }
 
-int bcache_flush(bcache_t priv)
+/* shell sort the dirty blocks by block number */
+static void sort_blocks(struct bcache_block **b, int n)
 {
-	int err;
+	int gap, i, j;
+	struct bcache_block *t;
+
+	for (gap = n / 2; gap > 0; gap /= 2) {
+		for (i = gap; i < n; i++) {
+			t = b[i];
+			for (j = i; j >= gap && b[j - gap]->blocknum > t->blocknum; j -= gap)
+				b[j] = b[j - gap];
+			b[j] = t;
+		}
+	}
+}
+
+int bcache_flush_all(bcache_t priv)
+{
+	int err = 0;
 	struct bcache *cache = priv;
 	struct bcache_block *block;
+	int n, i, run;
 
-	list_for_every_entry(&cache->lru_list, block, struct bcache_block, node) {
-		if (block->is_dirty) {
+	if (list_is_empty(&cache->dirty_list))
+		return 0;
+
+	if (!cache->sort)
+		cache->sort = malloc(sizeof(struct bcache_block *) * cache->count);
+	if (!cache->flush_buf)
+		cache->flush_buf = malloc(cache->block_size * BCACHE_FLUSH_BATCH);
+
+	/* out of memory, fall back to one write per block */
+	if (!cache->sort || !cache->flush_buf) {
+		while ((block = list_peek_head_type(&cache->dirty_list, struct bcache_block, dirty_node))) {
 			err = flush_block(cache, block);
 			if (err)
-				goto exit;
+				break;
 		}
+		return err;
+	}
+
+	n = 0;
+	list_for_every_entry(&cache->dirty_list, block, struct bcache_block, dirty_node)
+		cache->sort[n++] = block;
+
+	sort_blocks(cache->sort, n);
+
+	for (i = 0; i < n; i += run) {
+		/* collect a run of consecutive block numbers */
+		for (run = 1; i + run < n && run < BCACHE_FLUSH_BATCH; run++) {
+			if (cache->sort[i + run]->blocknum != cache->sort[i]->blocknum + run)
+				break;
+		}
+
+		if (run == 1) {
+			err = flush_block(cache, cache->sort[i]);
+			if (err)
+				break;
+			continue;
+		}
+
+		int j;
+		for (j = 0; j < run; j++)
+			memcpy((uint8_t *)cache->flush_buf + j * cache->block_size,
+			       cache->sort[i + j]->ptr, cache->block_size);
+
+		if (write_blocks(cache, cache->flush_buf, cache->sort[i]->blocknum, run) < 0) {
+			err = -1;
+			break;
+		}
+
+		for (j = 0; j < run; j++)
+			mark_clean(cache->sort[i + j]);
+		cache->stats.writes++;
 	}
 
-	err = 0;
-exit:
 	return (err);
 }
 
+int bcache_flush(bcache_t priv)
+{
+	return bcache_flush_all(priv);
+}
+
 void bcache_dump(bcache_t priv, const char *name)
 {
 	uint32_t finds;
@@ -348,3 +516,38 @@ void bcache_dump(bcache_t priv, const char *name)
 	       cache->stats.reads,
 	       cache->stats.writes);
 }
+
+#if defined(WITH_LIB_CONSOLE)
+
+static int cmd_bcache(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+STATIC_COMMAND("bcache", "block cache statistics", &cmd_bcache)
+STATIC_COMMAND_END(bcache);
+
+static int cmd_bcache(int argc, const cmd_args *argv)
+{
+	struct bcache *cache;
+	bool reset = (argc >= 2 && !strcmp(argv[1].str, "reset"));
+
+	if (argc >= 2 && !reset) {
+		printf("usage: %s [reset]\n", argv[0].str);
+		return -1;
+	}
+
+	list_for_every_entry(&bcache_list, cache, struct bcache, node) {
+		if (reset) {
+			memset(&cache->stats, 0, sizeof(cache->stats));
+			continue;
+		}
+
+		bcache_dump(cache, cache->dev->name);
+		printf("\tblocks=%d block_size=%zu buckets=%u policy=%s\n",
+		       cache->count, cache->block_size, 1U << cache->hash_bits,
+		       cache->policy == BCACHE_WRITE_THROUGH ? "write-through" : "write-back");
+	}
+
+	return 0;
+}
+
+#endif
@@ -31,6 +31,7 @@
 #include <lib/bio.h>
 #include <kernel/mutex.h>
 #include <lk/init.h>
+#include <platform.h>
 
 #define LOCAL_TRACE 0
 
@@ -41,6 +42,16 @@ struct bdev_struct {
 
 static struct bdev_struct *bdevs;
 
+static void bio_stat(struct bio_op_stats *stat, ssize_t ret, lk_bigtime_t start)
+{
+	stat->ops++;
+	if (ret < 0)
+		stat->errors++;
+	else
+		stat->bytes += ret;
+	stat->usecs += current_time_hires() - start;
+}
+
 /* default implementation is to use the read_block hook to 'deblock' the device */
 static ssize_t bio_default_read(struct bdev *dev, void *_buf, off_t offset, size_t len)
 {
@@ -57,7 +68,7 @@ static ssize_t bio_default_read(struct bdev *dev, void *_buf, off_t offset, size
 	/* handle partial first block */
 	if ((offset % dev->block_size) != 0) {
 		/* read in the block */
-		err = bio_read_block(dev, temp, block, 1);
+		err = dev->read_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -78,7 +89,7 @@ static ssize_t bio_default_read(struct bdev *dev, void *_buf, off_t offset, size
 	if (len >= dev->block_size) {
 		/* do the middle reads */
 		size_t block_count = len / dev->block_size;
-		err = bio_read_block(dev, buf, block, block_count);
+		err = dev->read_block(dev, buf, block, block_count);
 		if (err < 0)
 			goto err;
 
@@ -96,7 +107,7 @@ static ssize_t bio_default_read(struct bdev *dev, void *_buf, off_t offset, size
 	/* handle partial last block */
 	if (len > 0) {
 		/* read the block */
-		err = bio_read_block(dev, temp, block, 1);
+		err = dev->read_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -126,7 +137,7 @@ static ssize_t bio_default_write(struct bdev *dev, const void *_buf, off_t offse
 	/* handle partial first block */
 	if ((offset % dev->block_size) != 0) {
 		/* read in the block */
-		err = bio_read_block(dev, temp, block, 1);
+		err = dev->read_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -136,7 +147,7 @@ static ssize_t bio_default_write(struct bdev *dev, const void *_buf, off_t offse
 		memcpy(temp + block_offset, buf, tocopy);
 
 		/* write it back out */
-		err = bio_write_block(dev, temp, block, 1);
+		err = dev->write_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -152,7 +163,7 @@ static ssize_t bio_default_write(struct bdev *dev, const void *_buf, off_t offse
 	if (len >= dev->block_size) {
 		/* do the middle writes */
 		size_t block_count = len / dev->block_size;
-		err = bio_write_block(dev, buf, block, block_count);
+		err = dev->write_block(dev, buf, block, block_count);
 		if (err < 0)
 			goto err;
 
@@ -170,7 +181,7 @@ static ssize_t bio_default_write(struct bdev *dev, const void *_buf, off_t offse
 	/* handle partial last block */
 	if (len > 0) {
 		/* read the block */
-		err = bio_read_block(dev, temp, block, 1);
+		err = dev->read_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -178,7 +189,7 @@ static ssize_t bio_default_write(struct bdev *dev, const void *_buf, off_t offse
 		memcpy(temp, buf, len);
 
 		/* write it back out */
-		err = bio_write_block(dev, temp, block, 1);
+		err = dev->write_block(dev, temp, block, 1);
 		if (err < 0)
 			goto err;
 
@@ -203,7 +214,7 @@ static ssize_t bio_default_erase(struct bdev *dev, off_t offset, size_t len)
 	while (remaining > 0) {
 		ssize_t towrite = MIN(remaining, ERASE_BUF_SIZE);
 
-		ssize_t written = bio_write(dev, zero_buf, pos, towrite);
+		ssize_t written = dev->write(dev, zero_buf, pos, towrite);
 		if (written < 0)
 			return pos;
 
@@ -306,6 +317,9 @@ void bio_close(bdev_t *dev)
 
 ssize_t bio_read(bdev_t *dev, void *buf, off_t offset, size_t len)
 {
+	lk_bigtime_t t;
+	ssize_t ret;
+
 	LTRACEF("dev '%s', buf %p, offset %lld, len %zd\n", dev->name, buf, offset, len);
 
 	DEBUG_ASSERT(dev->ref > 0);
@@ -315,11 +329,18 @@ ssize_t bio_read(bdev_t *dev, void *buf, off_t offset, size_t len)
 	if (len == 0)
 		return 0;
 
-	return dev->read(dev, buf, offset, len);
+	t = current_time_hires();
+	ret = dev->read(dev, buf, offset, len);
+	bio_stat(&dev->stats.read, ret, t);
+
+	return ret;
 }
 
 ssize_t bio_read_block(bdev_t *dev, void *buf, bnum_t block, uint count)
 {
+	lk_bigtime_t t;
+	ssize_t ret;
+
 	LTRACEF("dev '%s', buf %p, block %d, count %u\n", dev->name, buf, block, count);
 
 	DEBUG_ASSERT(dev->ref > 0);
@@ -329,11 +350,18 @@ ssize_t bio_read_block(bdev_t *dev, void *buf, bnum_t block, uint count)
 	if (count == 0)
 		return 0;
 
-	return dev->read_block(dev, buf, block, count);
+	t = current_time_hires();
+	ret = dev->read_block(dev, buf, block, count);
+	bio_stat(&dev->stats.read, ret, t);
+
+	return ret;
 }
 
 ssize_t bio_write(bdev_t *dev, const void *buf, off_t offset, size_t len)
 {
+	lk_bigtime_t t;
+	ssize_t ret;
+
 	LTRACEF("dev '%s', buf %p, offset %lld, len %zd\n", dev->name, buf, offset, len);
 
 	DEBUG_ASSERT(dev->ref > 0);
@@ -343,11 +371,18 @@ ssize_t bio_write(bdev_t *dev, const void *buf, off_t offset, size_t len)
 	if (len == 0)
 		return 0;
 
-	return dev->write(dev, buf, offset, len);
+	t = current_time_hires();
+	ret = dev->write(dev, buf, offset, len);
+	bio_stat(&dev->stats.write, ret, t);
+
+	return ret;
 }
 
 ssize_t bio_write_block(bdev_t *dev, const void *buf, bnum_t block, uint count)
 {
+	lk_bigtime_t t;
+	ssize_t ret;
+
 	LTRACEF("dev '%s', buf %p, block %d, count %u\n", dev->name, buf, block, count);
 
 	DEBUG_ASSERT(dev->ref > 0);
@@ -357,11 +392,18 @@ ssize_t bio_write_block(bdev_t *dev, const void *buf, bnum_t block, uint count)
 	if (count == 0)
 		return 0;
 
-	return dev->write_block(dev, buf, block, count);
+	t = current_time_hires();
+	ret = dev->write_block(dev, buf, block, count);
+	bio_stat(&dev->stats.write, ret, t);
+
+	return ret;
 }
 
 ssize_t bio_erase(bdev_t *dev, off_t offset, size_t len)
 {
+	lk_bigtime_t t;
+	ssize_t ret;
+
 	LTRACEF("dev '%s', offset %lld, len %zd\n", dev->name, offset, len);
 
 	DEBUG_ASSERT(dev->ref > 0);
@@ -371,7 +413,11 @@ ssize_t bio_erase(bdev_t *dev, off_t offset, size_t len)
 	if (len == 0)
 		return 0;
 
-	return dev->erase(dev, offset, len);
+	t = current_time_hires();
+	ret = dev->erase(dev, offset, len);
+	bio_stat(&dev->stats.erase, ret, t);
+
+	return ret;
 }
 
 int bio_ioctl(bdev_t *dev, int request, void *argp)
@@ -398,6 +444,7 @@ void bio_initialize_bdev(bdev_t *dev, const char *name, size_t block_size, bnum_
 	dev->block_count = block_count;
 	dev->size = (off_t)block_count * block_size;
 	dev->ref = 0;
+	memset(&dev->stats, 0, sizeof(dev->stats));
 
 	/* set up the default hooks, the sub driver should override the block operations at least */
 	dev->read = bio_default_read;
@@ -405,6 +452,7 @@ void bio_initialize_bdev(bdev_t *dev, const char *name, size_t block_size, bnum_
 	dev->write = bio_default_write;
 	dev->write_block = bio_default_write_block;
 	dev->erase = bio_default_erase;
+	dev->ioctl = NULL;
 	dev->close = NULL;
 }
 
@@ -446,6 +494,29 @@ void bio_dump_devices(void)
 	mutex_release(&bdevs->lock);
 }
 
+static void bio_dump_op_stats(const char *op, const struct bio_op_stats *stat)
+{
+	printf("\t\t%-5s %8u ops %8u errors %12llu bytes %10llu usecs", op,
+	       stat->ops, stat->errors, stat->bytes, stat->usecs);
+	if (stat->usecs)
+		printf(" %6llu KB/s", stat->bytes * 1000000 / 1024 / stat->usecs);
+	printf("\n");
+}
+
+void bio_dump_stats(void)
+{
+	printf("block device statistics:\n");
+	bdev_t *entry;
+	mutex_acquire(&bdevs->lock);
+	list_for_every_entry(&bdevs->list, entry, bdev_t, node) {
+		printf("\t%s\n", entry->name);
+		bio_dump_op_stats("read", &entry->stats.read);
+		bio_dump_op_stats("write", &entry->stats.write);
+		bio_dump_op_stats("erase", &entry->stats.erase);
+	}
+	mutex_release(&bdevs->lock);
+}
+
 static void bio_init(uint level)
 {
 	bdevs = malloc(sizeof(*bdevs));
@@ -51,6 +51,7 @@ notenoughargs:
 		printf("not enough arguments:\n");
 usage:
 		printf("%s list\n", argv[0].str);
+		printf("%s stats\n", argv[0].str);
 		printf("%s read <device> <address> <offset> <len>\n", argv[0].str);
 		printf("%s write <device> <address> <offset> <len>\n", argv[0].str);
 		printf("%s erase <device> <offset> <len>\n", argv[0].str);
@@ -67,6 +68,8 @@ usage:
 
 	if (!strcmp(argv[1].str, "list")) {
 		bio_dump_devices();
+	} else if (!strcmp(argv[1].str, "stats")) {
+		bio_dump_stats();
 	} else if (!strcmp(argv[1].str, "read")) {
 		if (argc < 6) goto notenoughargs;
 
@@ -23,6 +23,7 @@
 #include <debug.h>
 #include <trace.h>
 #include <stdlib.h>
+#include <err.h>
 #include <lib/bio.h>
 
 #define LOCAL_TRACE 0
@@ -73,6 +74,26 @@ static ssize_t subdev_erase(struct bdev *_dev, off_t offset, size_t len)
 	return bio_erase(subdev->parent, offset + subdev->offset * subdev->dev.block_size, len);
 }
 
+static int subdev_ioctl(struct bdev *_dev, int request, void *argp)
+{
+	subdev_t *subdev = (subdev_t *)_dev;
+	struct bio_discard_range range;
+
+	if (request == BIO_IOCTL_DISCARD) {
+		if (!argp)
+			return ERR_INVALID_ARGS;
+
+		range = *(struct bio_discard_range *)argp;
+		if (bio_trim_range(_dev, range.offset, range.len) != range.len)
+			return ERR_INVALID_ARGS;
+
+		range.offset += (off_t)subdev->offset * subdev->dev.block_size;
+		return bio_ioctl(subdev->parent, request, &range);
+	}
+
+	return bio_ioctl(subdev->parent, request, argp);
+}
+
 static void subdev_close(struct bdev *_dev)
 {
 	subdev_t *subdev = (subdev_t *)_dev;
@@ -104,6 +125,7 @@ status_t bio_publish_subdevice(const char *parent_dev, const char *subdev, bnum_
 	sub->dev.write = &subdev_write;
 	sub->dev.write_block = &subdev_write_block;
 	sub->dev.erase = &subdev_erase;
+	sub->dev.ioctl = &subdev_ioctl;
 	sub->dev.close = &subdev_close;
 
 	bio_register_device(&sub->dev);
@@ -47,6 +47,20 @@
 #  define TBLS 1
 #endif /* BYFOUR */
 
+/* Definitions for doing the crc eight data bytes at a time with eight tables
+   (slicing-by-8), or with the ARMv8 CRC32 instructions when available. */
+#if defined(__ARM_FEATURE_CRC32)
+#  include <arm_acle.h>
+#  define ARMV8_CRC32
+   local unsigned long crc32_armv8 OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+#elif !defined(NOSLICE8) && !defined(BYFOUR) && \
+      defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#  define SLICE8
+   local unsigned long crc32_slice8 OF((unsigned long,
+                        const unsigned char FAR *, unsigned));
+#endif
+
 /* Local functions for crc concatenation */
 local unsigned long gf2_matrix_times OF((unsigned long *mat,
                                          unsigned long vec));
@@ -185,6 +199,10 @@ local void write_table(out, table)
 #include "crc32.h"
 #endif /* DYNAMIC_CRC_TABLE */
 
+#ifdef SLICE8
+#include "crc32_slice8.h"
+#endif /* SLICE8 */
+
 /* =========================================================================
  * This function can be used by asm versions of crc32()
  */
@@ -225,6 +243,12 @@ unsigned long ZEXPORT crc32(crc, buf, len)
             return crc32_big(crc, buf, len);
     }
 #endif /* BYFOUR */
+#ifdef ARMV8_CRC32
+    return crc32_armv8(crc, buf, len);
+#endif /* ARMV8_CRC32 */
+#ifdef SLICE8
+    return crc32_slice8(crc, buf, len);
+#endif /* SLICE8 */
     crc = crc ^ 0xffffffffUL;
     while (len >= 8) {
         DO8;
@@ -322,6 +346,91 @@ local unsigned long crc32_big(crc, buf, len)
 
 #endif /* BYFOUR */
 
+#ifdef SLICE8
+
+/* ========================================================================= */
+#define DOSLICE8 \
+    lo = *buf4++ ^ c; \
+    hi = *buf4++; \
+    c = crc32_slice8_table[7][lo & 0xff] ^ \
+        crc32_slice8_table[6][(lo >> 8) & 0xff] ^ \
+        crc32_slice8_table[5][(lo >> 16) & 0xff] ^ \
+        crc32_slice8_table[4][lo >> 24] ^ \
+        crc32_slice8_table[3][hi & 0xff] ^ \
+        crc32_slice8_table[2][(hi >> 8) & 0xff] ^ \
+        crc32_slice8_table[1][(hi >> 16) & 0xff] ^ \
+        crc32_slice8_table[0][hi >> 24]
+
+/* ========================================================================= */
+local unsigned long crc32_slice8(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
+    register uint32_t c, lo, hi;
+    register const uint32_t FAR *buf4;
+
+    c = ~(uint32_t)crc;
+    while (len && ((uintptr_t)buf & 7)) {
+        c = crc32_slice8_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+        len--;
+    }
+
+    buf4 = (const uint32_t FAR *)(const void FAR *)buf;
+    while (len >= 32) {
+        DOSLICE8; DOSLICE8; DOSLICE8; DOSLICE8;
+        len -= 32;
+    }
+    while (len >= 8) {
+        DOSLICE8;
+        len -= 8;
+    }
+    buf = (const unsigned char FAR *)buf4;
+
+    if (len) do {
+        c = crc32_slice8_table[0][(c ^ *buf++) & 0xff] ^ (c >> 8);
+    } while (--len);
+    return (unsigned long)~c;
+}
+
+#endif /* SLICE8 */
+
+#ifdef ARMV8_CRC32
+
+/* ========================================================================= */
+local unsigned long crc32_armv8(crc, buf, len)
+    unsigned long crc;
+    const unsigned char FAR *buf;
+    unsigned len;
+{
+    register uint32_t c;
+
+    c = ~(uint32_t)crc;
+    while (len && ((uintptr_t)buf & 7)) {
+        c = __crc32b(c, *buf++);
+        len--;
+    }
+    while (len >= 32) {
+        c = __crc32d(c, *(const uint64_t *)(const void *)buf);
+        c = __crc32d(c, *(const uint64_t *)(const void *)(buf + 8));
+        c = __crc32d(c, *(const uint64_t *)(const void *)(buf + 16));
+        c = __crc32d(c, *(const uint64_t *)(const void *)(buf + 24));
+        buf += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        c = __crc32d(c, *(const uint64_t *)(const void *)buf);
+        buf += 8;
+        len -= 8;
+    }
+    if (len) do {
+        c = __crc32b(c, *buf++);
+    } while (--len);
+    return (unsigned long)~c;
+}
+
+#endif /* ARMV8_CRC32 */
+
 #define GF2_DIM 32      /* dimension of GF(2) vectors (length of CRC) */
 
 /* ========================================================================= */
@@ -0,0 +1,77 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <string.h>
+#include <lib/decompress.h>
+
+enum decompress_type decompress_detect(const void *_buf, size_t len)
+{
+	const uint8_t *buf = _buf;
+
+	if (len >= 3 && buf[0] == 0x1f && buf[1] == 0x8b && buf[2] == 0x08)
+		return DECOMPRESS_GZIP;
+
+	if (len >= 4 && buf[0] == 0x04 && buf[1] == 0x22 && buf[2] == 0x4d && buf[3] == 0x18)
+		return DECOMPRESS_LZ4;
+
+	if (len >= 4 && buf[0] == 0x02 && buf[1] == 0x21 && buf[2] == 0x4c && buf[3] == 0x18)
+		return DECOMPRESS_LZ4_LEGACY;
+
+	return DECOMPRESS_NONE;
+}
+
+const char *decompress_type_name(enum decompress_type type)
+{
+	switch (type) {
+		case DECOMPRESS_GZIP:
+			return "gzip";
+		case DECOMPRESS_LZ4:
+			return "lz4";
+		case DECOMPRESS_LZ4_LEGACY:
+			return "lz4 legacy";
+		default:
+			return "none";
+	}
+}
+
+status_t decompress(const void *in, size_t in_len, void *out, size_t out_size,
+                    size_t *out_len, size_t *in_used)
+{
+	switch (decompress_detect(in, in_len)) {
+		case DECOMPRESS_GZIP:
+			return gunzip(in, in_len, out, out_size, out_len, in_used);
+		case DECOMPRESS_LZ4:
+		case DECOMPRESS_LZ4_LEGACY:
+			return unlz4(in, in_len, out, out_size, out_len, in_used);
+		default:
+			*out_len = 0;
+			return ERR_NOT_VALID;
+	}
+}
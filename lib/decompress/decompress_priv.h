@@ -0,0 +1,68 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __DECOMPRESS_PRIV_H
+#define __DECOMPRESS_PRIV_H
+
+#include <string.h>
+#include <sys/types.h>
+
+#define COPY_WORD sizeof(unsigned long)
+
+/*
+ * Copy a back reference of len bytes from dist bytes behind out. With a
+ * distance of at least a word each word is read before anything can
+ * overwrite it, so the copy goes a word at a time, possibly writing up to
+ * a word past out + len: the caller's data follows and overwrites it.
+ */
+static inline void copy_match(uint8_t *out, size_t dist, size_t len, const uint8_t *out_end)
+{
+	const uint8_t *src = out - dist;
+	uint8_t *end = out + len;
+	unsigned long w;
+
+	if (dist >= COPY_WORD && (size_t)(out_end - out) >= len + COPY_WORD) {
+		do {
+			memcpy(&w, src, COPY_WORD);
+			memcpy(out, &w, COPY_WORD);
+			src += COPY_WORD;
+			out += COPY_WORD;
+		} while (out < end);
+		return;
+	}
+
+	if (dist == 1) {
+		memset(out, *src, len);
+		return;
+	}
+
+	while (out < end)
+		*out++ = *src++;
+}
+
+#endif
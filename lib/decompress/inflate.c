@@ -0,0 +1,603 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Deflate (RFC 1951) and gzip (RFC 1952) decoder.
+ *
+ * Huffman codes are decoded with a FAST_BITS wide lookup table indexed by
+ * the next input bits; the rare longer codes fall back to a canonical
+ * decode a bit at a time. Back references are copied a word at a time
+ * whenever the distance and the space left in the output allow it.
+ */
+
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <malloc.h>
+#include <lib/cksum.h>
+#include <lib/decompress.h>
+#include "decompress_priv.h"
+
+#define LOCAL_TRACE 0
+
+#define MAX_BITS        15      /* longest code deflate allows */
+#define MAX_LCODES      286     /* literal/length codes */
+#define MAX_DCODES      30      /* distance codes */
+#define FIXED_LCODES    288     /* the fixed code defines two unused codes */
+#define FAST_BITS       10
+
+/* fast table entries: symbol << 4 | code length, 0 when the code is longer */
+#define FAST_SYM(e)     ((e) >> 4)
+#define FAST_LEN(e)     ((e) & 0xf)
+
+struct huffman {
+	uint16_t fast[1 << FAST_BITS];
+	uint16_t count[MAX_BITS + 1];	/* codes of each length */
+	uint16_t symbol[FIXED_LCODES];	/* symbols in canonical order */
+};
+
+struct inflate_state {
+	const uint8_t *in;
+	const uint8_t *in_end;
+	uint32_t bitbuf;
+	uint bitcnt;
+
+	uint8_t *out_start;
+	uint8_t *out;
+	uint8_t *out_end;
+
+	struct huffman lencode;
+	struct huffman distcode;
+};
+
+static const uint16_t len_base[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t len_extra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t dist_base[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577
+};
+static const uint8_t dist_extra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+/* top the bit buffer up to at least 25 bits, as long as there is input */
+static inline void refill(struct inflate_state *s)
+{
+	while (s->bitcnt <= 24 && s->in < s->in_end) {
+		s->bitbuf |= (uint32_t)*s->in++ << s->bitcnt;
+		s->bitcnt += 8;
+	}
+}
+
+/* n <= 24; returns -1 once the input has run out */
+static inline int getbits(struct inflate_state *s, uint n)
+{
+	int val;
+
+	if (s->bitcnt < n) {
+		refill(s);
+		if (s->bitcnt < n)
+			return -1;
+	}
+
+	val = s->bitbuf & ((1U << n) - 1);
+	s->bitbuf >>= n;
+	s->bitcnt -= n;
+
+	return val;
+}
+
+/* build the decoding tables for a code given by its code lengths */
+static int huffman_build(struct huffman *h, const uint8_t *length, uint n)
+{
+	uint16_t offs[MAX_BITS + 1];
+	uint sym, len, left;
+	uint code;
+
+	memset(h->count, 0, sizeof(h->count));
+	for (sym = 0; sym < n; sym++)
+		h->count[length[sym]]++;
+
+	if (h->count[0] == n)	/* no codes, only an error if used */
+		left = 0;
+	else {
+		/* reject over subscribed codes, incomplete ones are allowed */
+		left = 1;
+		for (len = 1; len <= MAX_BITS; len++) {
+			left <<= 1;
+			if (left < h->count[len])
+				return ERR_NOT_VALID;
+			left -= h->count[len];
+		}
+	}
+
+	offs[1] = 0;
+	for (len = 1; len < MAX_BITS; len++)
+		offs[len + 1] = offs[len] + h->count[len];
+
+	for (sym = 0; sym < n; sym++) {
+		if (length[sym])
+			h->symbol[offs[length[sym]]++] = sym;
+	}
+
+	/* walk the codes in canonical order, filling every fast table slot
+	 * whose low bits (deflate sends codes msb first) match the code */
+	memset(h->fast, 0, sizeof(h->fast));
+	code = 0;
+	sym = 0;
+	for (len = 1; len <= FAST_BITS; len++) {
+		for (uint i = 0; i < h->count[len]; i++, sym++, code++) {
+			uint rev = 0;
+
+			for (uint b = 0; b < len; b++)
+				rev |= ((code >> b) & 1) << (len - 1 - b);
+
+			for (uint j = rev; j < (1U << FAST_BITS); j += 1U << len)
+				h->fast[j] = (h->symbol[sym] << 4) | len;
+		}
+		code <<= 1;
+	}
+
+	return NO_ERROR;
+}
+
+/* canonical decode a bit at a time, for codes longer than FAST_BITS */
+static int huffman_decode_slow(struct inflate_state *s, const struct huffman *h)
+{
+	int code = 0, first = 0, index = 0;
+	int bit;
+
+	for (uint len = 1; len <= MAX_BITS; len++) {
+		bit = getbits(s, 1);
+		if (bit < 0)
+			return -1;
+		code |= bit;
+
+		int count = h->count[len];
+		if (code - count < first)
+			return h->symbol[index + (code - first)];
+
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+
+	return -1;
+}
+
+static inline int huffman_decode(struct inflate_state *s, const struct huffman *h)
+{
+	uint16_t e;
+
+	if (s->bitcnt < FAST_BITS)
+		refill(s);
+
+	e = h->fast[s->bitbuf & ((1U << FAST_BITS) - 1)];
+	if (e && FAST_LEN(e) <= s->bitcnt) {
+		s->bitbuf >>= FAST_LEN(e);
+		s->bitcnt -= FAST_LEN(e);
+		return FAST_SYM(e);
+	}
+
+	return huffman_decode_slow(s, h);
+}
+
+static int inflate_stored(struct inflate_state *s)
+{
+	uint len, nlen;
+
+	/* drop to a byte boundary, then give back any whole bytes buffered */
+	s->bitbuf >>= s->bitcnt & 7;
+	s->bitcnt &= ~7;
+	while (s->bitcnt >= 8) {
+		s->in--;
+		s->bitcnt -= 8;
+	}
+	s->bitbuf = 0;
+
+	if (s->in_end - s->in < 4)
+		return ERR_NOT_VALID;
+
+	len = s->in[0] | (s->in[1] << 8);
+	nlen = s->in[2] | (s->in[3] << 8);
+	s->in += 4;
+	if (len != (~nlen & 0xffff))
+		return ERR_NOT_VALID;
+
+	if ((size_t)(s->in_end - s->in) < len) {
+		/* truncated, still hand out what is there */
+		len = MIN((size_t)(s->in_end - s->in), (size_t)(s->out_end - s->out));
+		memcpy(s->out, s->in, len);
+		s->in += len;
+		s->out += len;
+		return ERR_NOT_VALID;
+	}
+	if ((size_t)(s->out_end - s->out) < len) {
+		memcpy(s->out, s->in, s->out_end - s->out);
+		s->out = s->out_end;
+		return ERR_NOT_ENOUGH_BUFFER;
+	}
+
+	memcpy(s->out, s->in, len);
+	s->in += len;
+	s->out += len;
+
+	return NO_ERROR;
+}
+
+static int inflate_codes(struct inflate_state *s)
+{
+	const struct huffman *lencode = &s->lencode;
+	const struct huffman *distcode = &s->distcode;
+	uint8_t *out = s->out;
+	uint8_t *out_end = s->out_end;
+	int sym, extra;
+	uint len, dist;
+
+	for (;;) {
+		sym = huffman_decode(s, lencode);
+		if (sym < 0)
+			goto corrupt;
+
+		if (sym < 256) {
+			if (out == out_end)
+				goto full;
+			*out++ = sym;
+			continue;
+		}
+
+		if (sym == 256)
+			break;
+
+		sym -= 257;
+		if (sym >= 29)
+			goto corrupt;
+		extra = getbits(s, len_extra[sym]);
+		if (extra < 0)
+			goto corrupt;
+		len = len_base[sym] + extra;
+
+		sym = huffman_decode(s, distcode);
+		if (sym < 0 || sym >= MAX_DCODES)
+			goto corrupt;
+		extra = getbits(s, dist_extra[sym]);
+		if (extra < 0)
+			goto corrupt;
+		dist = dist_base[sym] + extra;
+
+		if (dist > (size_t)(out - s->out_start))
+			goto corrupt;
+
+		if ((size_t)(out_end - out) < len) {
+			/* fill what fits so the caller sees a consistent prefix */
+			len = out_end - out;
+			copy_match(out, dist, len, out_end);
+			out += len;
+			goto full;
+		}
+
+		copy_match(out, dist, len, out_end);
+		out += len;
+	}
+
+	s->out = out;
+	return NO_ERROR;
+
+full:
+	s->out = out;
+	return ERR_NOT_ENOUGH_BUFFER;
+
+corrupt:
+	s->out = out;
+	return ERR_NOT_VALID;
+}
+
+static int inflate_fixed(struct inflate_state *s)
+{
+	uint8_t lengths[FIXED_LCODES];
+	uint sym;
+
+	for (sym = 0; sym < 144; sym++)
+		lengths[sym] = 8;
+	for (; sym < 256; sym++)
+		lengths[sym] = 9;
+	for (; sym < 280; sym++)
+		lengths[sym] = 7;
+	for (; sym < FIXED_LCODES; sym++)
+		lengths[sym] = 8;
+	huffman_build(&s->lencode, lengths, FIXED_LCODES);
+
+	for (sym = 0; sym < MAX_DCODES; sym++)
+		lengths[sym] = 5;
+	huffman_build(&s->distcode, lengths, MAX_DCODES);
+
+	return inflate_codes(s);
+}
+
+static int inflate_dynamic(struct inflate_state *s)
+{
+	static const uint8_t order[19] = {
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+	uint8_t lengths[MAX_LCODES + MAX_DCODES];
+	int nlen, ndist, ncode;
+	int index, sym, len, rep;
+	int err;
+
+	nlen = getbits(s, 5);
+	ndist = getbits(s, 5);
+	ncode = getbits(s, 4);
+	if (nlen < 0 || ndist < 0 || ncode < 0)
+		return ERR_NOT_VALID;
+	nlen += 257;
+	ndist += 1;
+	ncode += 4;
+	if (nlen > MAX_LCODES || ndist > MAX_DCODES)
+		return ERR_NOT_VALID;
+
+	/* code length code lengths, in their odd order */
+	for (index = 0; index < ncode; index++) {
+		len = getbits(s, 3);
+		if (len < 0)
+			return ERR_NOT_VALID;
+		lengths[order[index]] = len;
+	}
+	for (; index < 19; index++)
+		lengths[order[index]] = 0;
+
+	err = huffman_build(&s->lencode, lengths, 19);
+	if (err < 0)
+		return err;
+
+	/* literal/length and distance code lengths, run length coded */
+	index = 0;
+	while (index < nlen + ndist) {
+		sym = huffman_decode(s, &s->lencode);
+		if (sym < 0)
+			return ERR_NOT_VALID;
+
+		if (sym < 16) {
+			lengths[index++] = sym;
+			continue;
+		}
+
+		len = 0;
+		if (sym == 16) {
+			if (index == 0)
+				return ERR_NOT_VALID;
+			len = lengths[index - 1];
+			rep = getbits(s, 2);
+			if (rep < 0)
+				return ERR_NOT_VALID;
+			rep += 3;
+		} else if (sym == 17) {
+			rep = getbits(s, 3);
+			if (rep < 0)
+				return ERR_NOT_VALID;
+			rep += 3;
+		} else {
+			rep = getbits(s, 7);
+			if (rep < 0)
+				return ERR_NOT_VALID;
+			rep += 11;
+		}
+
+		if (index + rep > nlen + ndist)
+			return ERR_NOT_VALID;
+		while (rep--)
+			lengths[index++] = len;
+	}
+
+	/* a block without an end of block code can't be decoded */
+	if (lengths[256] == 0)
+		return ERR_NOT_VALID;
+
+	err = huffman_build(&s->lencode, lengths, nlen);
+	if (err < 0)
+		return err;
+
+	err = huffman_build(&s->distcode, lengths + nlen, ndist);
+	if (err < 0)
+		return err;
+
+	return inflate_codes(s);
+}
+
+static status_t inflate_stream(struct inflate_state *s)
+{
+	int last, type;
+	int err;
+
+	do {
+		last = getbits(s, 1);
+		type = getbits(s, 2);
+		if (last < 0 || type < 0)
+			return ERR_NOT_VALID;
+
+		switch (type) {
+			case 0:
+				err = inflate_stored(s);
+				break;
+			case 1:
+				err = inflate_fixed(s);
+				break;
+			case 2:
+				err = inflate_dynamic(s);
+				break;
+			default:
+				err = ERR_NOT_VALID;
+				break;
+		}
+
+		if (err < 0)
+			return err;
+	} while (!last);
+
+	/* hand back whole bytes still sitting in the bit buffer */
+	while (s->bitcnt >= 8) {
+		s->in--;
+		s->bitcnt -= 8;
+	}
+
+	return NO_ERROR;
+}
+
+static status_t inflate_run(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size,
+                            size_t *out_len, const uint8_t **in_next)
+{
+	struct inflate_state *s;
+	status_t err;
+
+	s = malloc(sizeof(*s));
+	if (!s)
+		return ERR_NO_MEMORY;
+
+	s->in = in;
+	s->in_end = in + in_len;
+	s->bitbuf = 0;
+	s->bitcnt = 0;
+	s->out_start = out;
+	s->out = out;
+	s->out_end = out + out_size;
+
+	err = inflate_stream(s);
+
+	*out_len = s->out - out;
+	*in_next = s->in;
+	free(s);
+
+	LTRACEF("in %zu out %zu err %d\n", (size_t)(*in_next - in), *out_len, err);
+
+	return err;
+}
+
+status_t inflate_raw(const void *in, size_t in_len, void *out, size_t out_size,
+                     size_t *out_len, size_t *in_used)
+{
+	const uint8_t *next;
+	status_t err;
+
+	err = inflate_run(in, in_len, out, out_size, out_len, &next);
+	if (in_used)
+		*in_used = next - (const uint8_t *)in;
+
+	return err;
+}
+
+#define GZIP_FHCRC      (1 << 1)
+#define GZIP_FEXTRA     (1 << 2)
+#define GZIP_FNAME      (1 << 3)
+#define GZIP_FCOMMENT   (1 << 4)
+#define GZIP_FRESERVED  0xe0
+
+status_t gunzip(const void *_in, size_t in_len, void *out, size_t out_size,
+                size_t *out_len, size_t *in_used)
+{
+	const uint8_t *in = _in;
+	const uint8_t *p = in;
+	const uint8_t *end = in + in_len;
+	const uint8_t *next;
+	uint32_t crc, isize;
+	uint flags;
+	status_t err;
+
+	*out_len = 0;
+
+	if (in_len < 18 || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8)
+		return ERR_NOT_VALID;
+
+	flags = p[3];
+	if (flags & GZIP_FRESERVED)
+		return ERR_NOT_VALID;
+
+	/* skip mtime, xfl and os */
+	p += 10;
+
+	if (flags & GZIP_FEXTRA) {
+		size_t xlen;
+
+		if (end - p < 2)
+			return ERR_NOT_VALID;
+		xlen = p[0] | (p[1] << 8);
+		p += 2;
+		if ((size_t)(end - p) < xlen)
+			return ERR_NOT_VALID;
+		p += xlen;
+	}
+
+	if (flags & GZIP_FNAME) {
+		while (p < end && *p)
+			p++;
+		p++;
+	}
+
+	if (flags & GZIP_FCOMMENT) {
+		while (p < end && *p)
+			p++;
+		p++;
+	}
+
+	if (flags & GZIP_FHCRC)
+		p += 2;
+
+	if (p >= end)
+		return ERR_NOT_VALID;
+
+	err = inflate_run(p, end - p, out, out_size, out_len, &next);
+	if (in_used)
+		*in_used = next - in;
+	if (err < 0)
+		return err;
+
+	if (end - next < 8)
+		return ERR_NOT_VALID;
+
+	crc = next[0] | (next[1] << 8) | (next[2] << 16) | ((uint32_t)next[3] << 24);
+	isize = next[4] | (next[5] << 8) | (next[6] << 16) | ((uint32_t)next[7] << 24);
+	if (in_used)
+		*in_used += 8;
+
+	if (isize != (uint32_t)*out_len)
+		return ERR_NOT_VALID;
+
+	if (crc != (uint32_t)crc32(0, out, *out_len))
+		return ERR_CRC_FAIL;
+
+	return NO_ERROR;
+}
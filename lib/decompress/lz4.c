@@ -0,0 +1,384 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * LZ4 decoder for the frame format and for the legacy format written by
+ * "lz4 -l", which is what the arm64 kernel build produces for Image.lz4.
+ * Blocks are decoded into the one output buffer, so linked blocks can
+ * refer back into the previous ones without a separate window.
+ */
+
+#include <debug.h>
+#include <trace.h>
+#include <err.h>
+#include <string.h>
+#include <stdlib.h>
+#include <lib/decompress.h>
+#include "decompress_priv.h"
+
+#define LOCAL_TRACE 0
+
+#define LZ4_FRAME_MAGIC         0x184d2204
+#define LZ4_LEGACY_MAGIC        0x184c2102
+
+#define LZ4_MIN_MATCH           4
+#define LZ4_LEGACY_BLOCK_SIZE   (8 * 1024 * 1024)
+#define LZ4_COMPRESS_BOUND(n)   ((n) + (n) / 255 + 16)
+
+/* frame descriptor flags */
+#define LZ4_FLG_VERSION_MASK    0xc0
+#define LZ4_FLG_VERSION         0x40
+#define LZ4_FLG_BLOCK_CHECKSUM  (1 << 4)
+#define LZ4_FLG_CONTENT_SIZE    (1 << 3)
+#define LZ4_FLG_CONTENT_CHECKSUM (1 << 2)
+#define LZ4_FLG_DICT_ID         (1 << 0)
+
+#define LZ4_BLOCK_UNCOMPRESSED  0x80000000
+
+#define XXH_PRIME1 2654435761U
+#define XXH_PRIME2 2246822519U
+#define XXH_PRIME3 3266489917U
+#define XXH_PRIME4  668265263U
+#define XXH_PRIME5  374761393U
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t rotl32(uint32_t x, uint r)
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline uint32_t xxh32_round(uint32_t acc, uint32_t input)
+{
+	acc += input * XXH_PRIME2;
+	acc = rotl32(acc, 13);
+	return acc * XXH_PRIME1;
+}
+
+static uint32_t xxh32(const uint8_t *p, size_t len, uint32_t seed)
+{
+	const uint8_t *end = p + len;
+	uint32_t h;
+
+	if (len >= 16) {
+		const uint8_t *limit = end - 16;
+		uint32_t v1 = seed + XXH_PRIME1 + XXH_PRIME2;
+		uint32_t v2 = seed + XXH_PRIME2;
+		uint32_t v3 = seed;
+		uint32_t v4 = seed - XXH_PRIME1;
+
+		do {
+			v1 = xxh32_round(v1, get_le32(p));
+			v2 = xxh32_round(v2, get_le32(p + 4));
+			v3 = xxh32_round(v3, get_le32(p + 8));
+			v4 = xxh32_round(v4, get_le32(p + 12));
+			p += 16;
+		} while (p <= limit);
+
+		h = rotl32(v1, 1) + rotl32(v2, 7) + rotl32(v3, 12) + rotl32(v4, 18);
+	} else {
+		h = seed + XXH_PRIME5;
+	}
+
+	h += (uint32_t)len;
+
+	while (p + 4 <= end) {
+		h += get_le32(p) * XXH_PRIME3;
+		h = rotl32(h, 17) * XXH_PRIME4;
+		p += 4;
+	}
+
+	while (p < end) {
+		h += *p * XXH_PRIME5;
+		h = rotl32(h, 11) * XXH_PRIME1;
+		p++;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_PRIME2;
+	h ^= h >> 13;
+	h *= XXH_PRIME3;
+	h ^= h >> 16;
+
+	return h;
+}
+
+/*
+ * Decode one block from in into out. out_start is where the frame's output
+ * began, matches may reach back that far.
+ */
+static status_t lz4_block(const uint8_t *in, size_t in_len, uint8_t *out_start,
+                          uint8_t **outp, uint8_t *out_end)
+{
+	const uint8_t *ip = in;
+	const uint8_t *in_end = in + in_len;
+	uint8_t *op = *outp;
+	size_t len, offset;
+	uint token;
+	uint b;
+
+	while (ip < in_end) {
+		token = *ip++;
+
+		/* literals */
+		len = token >> 4;
+		if (len == 15) {
+			do {
+				if (ip >= in_end)
+					goto corrupt;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+
+		if ((size_t)(in_end - ip) < len) {
+			/* truncated, still hand out what is there */
+			len = MIN((size_t)(in_end - ip), (size_t)(out_end - op));
+			memcpy(op, ip, len);
+			op += len;
+			goto corrupt;
+		}
+		if ((size_t)(out_end - op) < len) {
+			memcpy(op, ip, out_end - op);
+			op = out_end;
+			goto full;
+		}
+
+		memcpy(op, ip, len);
+		ip += len;
+		op += len;
+
+		/* the last sequence is literals only */
+		if (ip == in_end)
+			break;
+
+		/* match */
+		if (in_end - ip < 2)
+			goto corrupt;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t)(op - out_start))
+			goto corrupt;
+
+		len = token & 15;
+		if (len == 15) {
+			do {
+				if (ip >= in_end)
+					goto corrupt;
+				b = *ip++;
+				len += b;
+			} while (b == 255);
+		}
+		len += LZ4_MIN_MATCH;
+
+		if ((size_t)(out_end - op) < len) {
+			len = out_end - op;
+			copy_match(op, offset, len, out_end);
+			op += len;
+			goto full;
+		}
+
+		copy_match(op, offset, len, out_end);
+		op += len;
+	}
+
+	*outp = op;
+	return NO_ERROR;
+
+full:
+	*outp = op;
+	return ERR_NOT_ENOUGH_BUFFER;
+
+corrupt:
+	*outp = op;
+	return ERR_NOT_VALID;
+}
+
+static status_t lz4_frame(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size,
+                          size_t *out_len, size_t *in_used)
+{
+	const uint8_t *p = in + 4;
+	const uint8_t *end = in + in_len;
+	const uint8_t *desc;
+	uint8_t *op = out;
+	uint8_t *out_end = out + out_size;
+	uint32_t block;
+	size_t len;
+	uint flg;
+	status_t err = NO_ERROR;
+
+	if (end - p < 3)
+		return ERR_NOT_VALID;
+
+	desc = p;
+	flg = p[0];
+	if ((flg & LZ4_FLG_VERSION_MASK) != LZ4_FLG_VERSION)
+		return ERR_NOT_VALID;
+	if (flg & LZ4_FLG_DICT_ID)
+		return ERR_NOT_VALID;	/* no dictionaries to offer */
+	p += 2;
+
+	if (flg & LZ4_FLG_CONTENT_SIZE) {
+		if (end - p < 9)
+			return ERR_NOT_VALID;
+		p += 8;
+	}
+
+	/* header checksum is the second byte of the descriptor's xxh32 */
+	if (*p != ((xxh32(desc, p - desc, 0) >> 8) & 0xff))
+		return ERR_CHECKSUM_FAIL;
+	p++;
+
+	for (;;) {
+		if (end - p < 4) {
+			err = ERR_NOT_VALID;
+			break;
+		}
+		block = get_le32(p);
+		p += 4;
+
+		if (block == 0)
+			break;
+
+		len = block & ~LZ4_BLOCK_UNCOMPRESSED;
+		if ((size_t)(end - p) < len) {
+			/* decode what there is of a truncated block for its prefix */
+			if (block & LZ4_BLOCK_UNCOMPRESSED) {
+				len = MIN((size_t)(end - p), (size_t)(out_end - op));
+				memcpy(op, p, len);
+				op += len;
+			} else {
+				lz4_block(p, end - p, out, &op, out_end);
+			}
+			err = ERR_NOT_VALID;
+			break;
+		}
+
+		if (block & LZ4_BLOCK_UNCOMPRESSED) {
+			if ((size_t)(out_end - op) < len) {
+				memcpy(op, p, out_end - op);
+				op = out_end;
+				err = ERR_NOT_ENOUGH_BUFFER;
+				break;
+			}
+			memcpy(op, p, len);
+			op += len;
+		} else {
+			err = lz4_block(p, len, out, &op, out_end);
+			if (err < 0)
+				break;
+		}
+		p += len;
+
+		/* block checksums are not checked, the content checksum covers it all */
+		if (flg & LZ4_FLG_BLOCK_CHECKSUM)
+			p += 4;
+	}
+
+	if (err == NO_ERROR && (flg & LZ4_FLG_CONTENT_CHECKSUM)) {
+		if (end - p < 4)
+			err = ERR_NOT_VALID;
+		else if (get_le32(p) != xxh32(out, op - out, 0))
+			err = ERR_CHECKSUM_FAIL;
+		p += 4;
+	}
+
+	*out_len = op - out;
+	if (in_used)
+		*in_used = p - in;
+
+	return err;
+}
+
+static status_t lz4_legacy(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size,
+                           size_t *out_len, size_t *in_used)
+{
+	const uint8_t *p = in + 4;
+	const uint8_t *end = in + in_len;
+	uint8_t *op = out;
+	uint32_t len;
+	status_t err = ERR_NOT_VALID;
+
+	/* The format has no end mark. Stop at the end of the input, or at
+	 * anything that can't be a block size: that is whatever was appended
+	 * to the stream. Another legacy magic starts a concatenated stream.
+	 * A stream without a single block, or a block running past the end
+	 * of the input, is a truncated one. */
+	while (end - p >= 4) {
+		len = get_le32(p);
+
+		if (len == LZ4_LEGACY_MAGIC) {
+			p += 4;
+			continue;
+		}
+
+		if (len == 0 || len > LZ4_COMPRESS_BOUND(LZ4_LEGACY_BLOCK_SIZE))
+			break;
+
+		if (len > (size_t)(end - p - 4)) {
+			/* decode what is there so *out_len shows how far it got */
+			lz4_block(p + 4, end - p - 4, out, &op, out + out_size);
+			err = ERR_NOT_VALID;
+			break;
+		}
+
+		err = lz4_block(p + 4, len, out, &op, out + out_size);
+		if (err < 0)
+			break;
+		p += 4 + len;
+	}
+
+	*out_len = op - out;
+	if (in_used)
+		*in_used = p - in;
+
+	return err;
+}
+
+status_t unlz4(const void *_in, size_t in_len, void *out, size_t out_size,
+               size_t *out_len, size_t *in_used)
+{
+	const uint8_t *in = _in;
+
+	*out_len = 0;
+
+	if (in_len < 4)
+		return ERR_NOT_VALID;
+
+	switch (get_le32(in)) {
+		case LZ4_FRAME_MAGIC:
+			return lz4_frame(in, in_len, out, out_size, out_len, in_used);
+		case LZ4_LEGACY_MAGIC:
+			return lz4_legacy(in, in_len, out, out_size, out_len, in_used);
+		default:
+			return ERR_NOT_VALID;
+	}
+}
@@ -0,0 +1,13 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_DEPS += \
+	lib/cksum
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/inflate.c \
+	$(LOCAL_DIR)/lz4.c \
+	$(LOCAL_DIR)/decompress.c
+
+include make/module.mk
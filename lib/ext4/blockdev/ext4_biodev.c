@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2013 Grzegorz Kostka (kostka.grzegorz@gmail.com)
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * - Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <ext4_config.h>
+#include <ext4_blockdev.h>
+#include <ext4_errno.h>
+#include <ext4_biodev.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <malloc.h>
+
+#if WITH_LIB_BIO
+#include <lib/bio.h>
+
+/**********************BLOCKDEV INTERFACE**************************************/
+static int biodev_open(struct ext4_blockdev *bdev);
+static int biodev_bread(struct ext4_blockdev *bdev, void *buf, uint64_t blk_id,
+    uint32_t blk_cnt);
+static int biodev_bwrite(struct ext4_blockdev *bdev, const void *buf,
+    uint64_t blk_id, uint32_t blk_cnt);
+static int biodev_close(struct  ext4_blockdev *bdev);
+
+/******************************************************************************/
+static struct private_bio_data* biodev_get_privatedata(struct ext4_blockdev *bdev) {
+	return (struct private_bio_data*)bdev->private_data;
+}
+
+/******************************************************************************/
+static int biodev_open(struct ext4_blockdev *bdev)
+{
+	struct private_bio_data* biodata = biodev_get_privatedata(bdev);
+	bdev_t *dev;
+
+	dev = bio_open(biodata->bdevname);
+	if(!dev) return EIO;
+
+	bdev->ph_bbuf = (uint8_t*)malloc(sizeof(uint8_t)*dev->block_size);
+	if(!bdev->ph_bbuf){
+		bio_close(dev);
+		return ENOMEM;
+	}
+
+	biodata->bdev = dev;
+	bdev->ph_bsize = dev->block_size;
+	bdev->ph_bcnt = dev->block_count;
+
+	return EOK;
+}
+
+/******************************************************************************/
+
+static int biodev_bread(struct  ext4_blockdev *bdev, void *buf, uint64_t blk_id,
+    uint32_t blk_cnt)
+{
+	struct private_bio_data* biodata = biodev_get_privatedata(bdev);
+	ssize_t len = bdev->ph_bsize * blk_cnt;
+
+	if (bio_read_block(biodata->bdev, buf, blk_id, blk_cnt) != len)
+	{
+		dprintf(CRITICAL, "ERROR: bio_read_block() fail.\n");
+		return EIO;
+	}
+
+	return EOK;
+}
+
+/******************************************************************************/
+static int biodev_bwrite(struct ext4_blockdev *bdev, const void *buf,
+    uint64_t blk_id, uint32_t blk_cnt)
+{
+	struct private_bio_data* biodata = biodev_get_privatedata(bdev);
+	ssize_t len = bdev->ph_bsize * blk_cnt;
+
+	if (bio_write_block(biodata->bdev, buf, blk_id, blk_cnt) != len)
+		return EIO;
+
+	return EOK;
+}
+/******************************************************************************/
+static int biodev_close(struct  ext4_blockdev *bdev)
+{
+	struct private_bio_data* biodata = biodev_get_privatedata(bdev);
+
+	free(bdev->ph_bbuf);
+	bio_close(biodata->bdev);
+	biodata->bdev = 0;
+	return EOK;
+}
+
+/******************************************************************************/
+struct ext4_blockdev* ext4_biodev_get(const char *bdevname)
+{
+	struct ext4_blockdev *dev = (void*)malloc(sizeof(struct ext4_blockdev));
+	if(!dev) return NULL;
+	memset(dev, 0, sizeof(struct ext4_blockdev));
+
+	dev->open = biodev_open;
+	dev->bread = biodev_bread;
+	dev->bwrite = biodev_bwrite;
+	dev->close = biodev_close;
+	dev->ph_bcnt = 0;
+	dev->ph_bbuf = 0;
+
+	struct private_bio_data *biodata = (void*) malloc(sizeof(struct private_bio_data));
+	if(!biodata){
+		free(dev);
+		return NULL;
+	}
+	dev->private_data = biodata;
+	biodata->bdevname = bdevname;
+	biodata->bdev = 0;
+
+	return dev;
+}
+/******************************************************************************/
+
+#endif /* WITH_LIB_BIO */
@@ -805,13 +805,11 @@ int ext4_fread(ext4_file *f, void *buf, uint32_t size, uint32_t *rcnt)
     int r = EOK;
     uint32_t u;
     uint32_t fblock;
-    uint32_t fblock_start;
     uint32_t fblock_cnt;
     struct ext4_block b;
     uint8_t *u8_buf = buf;
     struct ext4_inode_ref ref;
     uint32_t sblock;
-    uint32_t sblock_end;
     uint32_t block_size;
 
     ext4_assert(f && f->mp);
@@ -840,7 +838,6 @@ int ext4_fread(ext4_file *f, void *buf, uint32_t size, uint32_t *rcnt)
     block_size = ext4_sb_get_block_size(&f->mp->fs.sb);
     size = size > (f->fsize - f->fpos) ? (f->fsize - f->fpos) : size;
     sblock = (f->fpos) / block_size;
-    sblock_end = (f->fpos + size) / block_size;
     u = (f->fpos) % block_size;
 
 
@@ -848,19 +845,25 @@ int ext4_fread(ext4_file *f, void *buf, uint32_t size, uint32_t *rcnt)
 
         uint32_t ll = size > (block_size - u) ? (block_size - u) : size;
 
-        r = ext4_fs_get_inode_data_block_index(&ref, sblock, &fblock);
+        r = ext4_fs_get_inode_data_block_run(&ref, sblock, 1, &fblock,
+                &fblock_cnt);
         if(r != EOK)
             goto Finish;
 
-        r = ext4_block_get(f->mp->fs.bdev, &b, fblock);
-        if(r != EOK)
-            goto Finish;
+        if(fblock){
+            r = ext4_block_get(f->mp->fs.bdev, &b, fblock);
+            if(r != EOK)
+                goto Finish;
 
-        memcpy(u8_buf, b.data + u, ll);
+            memcpy(u8_buf, b.data + u, ll);
 
-        r = ext4_block_set(f->mp->fs.bdev, &b);
-        if(r != EOK)
-            goto Finish;
+            r = ext4_block_set(f->mp->fs.bdev, &b);
+            if(r != EOK)
+                goto Finish;
+        } else {
+            /*Hole*/
+            memset(u8_buf, 0, ll);
+        }
 
         u8_buf  += ll;
         size    -= ll;
@@ -872,55 +875,53 @@ int ext4_fread(ext4_file *f, void *buf, uint32_t size, uint32_t *rcnt)
         sblock++;
     }
 
-    fblock_start = 0;
-    fblock_cnt = 0;
+    /*Whole blocks: one direct read per physically contiguous run (extent),
+     * straight into the caller buffer, bypassing the block cache*/
     while(size >= block_size){
-        while(sblock < sblock_end){
-            r = ext4_fs_get_inode_data_block_index(&ref, sblock, &fblock);
+        r = ext4_fs_get_inode_data_block_run(&ref, sblock, size / block_size,
+                &fblock, &fblock_cnt);
+        if(r != EOK)
+            goto Finish;
+
+        if(fblock){
+            r = ext4_blocks_get_direct(f->mp->fs.bdev, u8_buf, fblock,
+                    fblock_cnt);
             if(r != EOK)
                 goto Finish;
-
-            sblock++;
-
-            if(!fblock_start){
-                fblock_start = fblock;
-            }
-
-            if((fblock_start + fblock_cnt) != fblock)
-                break;
-
-            fblock_cnt++;
+        } else {
+            /*Hole*/
+            memset(u8_buf, 0, block_size * fblock_cnt);
         }
 
-        r = ext4_blocks_get_direct(f->mp->fs.bdev, u8_buf, fblock_start, fblock_cnt);
-        if(r != EOK)
-            goto Finish;
-
         size    -= block_size * fblock_cnt;
         u8_buf  += block_size * fblock_cnt;
         f->fpos += block_size * fblock_cnt;
+        sblock  += fblock_cnt;
 
         if(rcnt)
             *rcnt += block_size * fblock_cnt;
-
-        fblock_start = fblock;
-        fblock_cnt = 1;
     }
 
     if(size){
-        r = ext4_fs_get_inode_data_block_index(&ref, sblock, &fblock);
+        r = ext4_fs_get_inode_data_block_run(&ref, sblock, 1, &fblock,
+                &fblock_cnt);
         if(r != EOK)
             goto Finish;
 
-        r = ext4_block_get(f->mp->fs.bdev, &b, fblock);
-        if(r != EOK)
-            goto Finish;
+        if(fblock){
+            r = ext4_block_get(f->mp->fs.bdev, &b, fblock);
+            if(r != EOK)
+                goto Finish;
 
-        memcpy(u8_buf, b.data , size);
+            memcpy(u8_buf, b.data , size);
 
-        r = ext4_block_set(f->mp->fs.bdev, &b);
-        if(r != EOK)
-            goto Finish;
+            r = ext4_block_set(f->mp->fs.bdev, &b);
+            if(r != EOK)
+                goto Finish;
+        } else {
+            /*Hole*/
+            memset(u8_buf, 0, size);
+        }
 
         f->fpos += size;
 
@@ -43,10 +43,94 @@
 #include <stdlib.h>
 
 
+/*Cache ids are stored + 1 in the hash and LRU links, 0 terminates.*/
+#define EXT4_BCACHE_HASH(lba)   ((uint32_t)(lba) & (CONFIG_BLOCK_DEV_CACHE_HASH - 1))
+
+static void ext4_bcache_hash_add(struct ext4_bcache *bc, uint32_t id)
+{
+    uint32_t h = EXT4_BCACHE_HASH(bc->lba[id]);
+
+    bc->hash_next[id] = bc->hash_head[h];
+    bc->hash_head[h] = id + 1;
+}
+
+static void ext4_bcache_hash_del(struct ext4_bcache *bc, uint32_t id)
+{
+    uint32_t *link = &bc->hash_head[EXT4_BCACHE_HASH(bc->lba[id])];
+
+    while (*link) {
+        if(*link == id + 1){
+            *link = bc->hash_next[id];
+            break;
+        }
+        link = &bc->hash_next[*link - 1];
+    }
+    bc->hash_next[id] = 0;
+}
+
+static uint32_t ext4_bcache_hash_find(struct ext4_bcache *bc, uint64_t lba)
+{
+    uint32_t n = bc->hash_head[EXT4_BCACHE_HASH(lba)];
+
+    while (n) {
+        if(bc->lba[n - 1] == lba)
+            return n - 1;
+        n = bc->hash_next[n - 1];
+    }
+    return bc->cnt;
+}
+
+/*Unreferenced blocks go to the tail, eviction takes the head.*/
+static void ext4_bcache_lru_add(struct ext4_bcache *bc, uint32_t id)
+{
+    bc->lru_next[id] = 0;
+    bc->lru_prev[id] = bc->lru_tail;
+    if(bc->lru_tail)
+        bc->lru_next[bc->lru_tail - 1] = id + 1;
+    else
+        bc->lru_head = id + 1;
+    bc->lru_tail = id + 1;
+}
+
+static void ext4_bcache_lru_del(struct ext4_bcache *bc, uint32_t id)
+{
+    if(bc->lru_prev[id])
+        bc->lru_next[bc->lru_prev[id] - 1] = bc->lru_next[id];
+    else
+        bc->lru_head = bc->lru_next[id];
+
+    if(bc->lru_next[id])
+        bc->lru_prev[bc->lru_next[id] - 1] = bc->lru_prev[id];
+    else
+        bc->lru_tail = bc->lru_prev[id];
+
+    bc->lru_prev[id] = 0;
+    bc->lru_next[id] = 0;
+}
+
+/*Take a never used item or evict the least recently used one.*/
+static uint32_t ext4_bcache_victim(struct ext4_bcache *bc)
+{
+    uint32_t id;
+
+    if(bc->used < bc->cnt)
+        return bc->used++;
+
+    if(!bc->lru_head)
+        return bc->cnt;
+
+    id = bc->lru_head - 1;
+    ext4_bcache_lru_del(bc, id);
+    ext4_bcache_hash_del(bc, id);
+    bc->dirty[id] = false;
+    return id;
+}
+
 int ext4_bcache_init_dynamic(struct ext4_bcache *bc, uint32_t cnt,
     uint32_t itemsize)
 {
     ext4_assert(bc && cnt && itemsize);
+    ext4_assert(cnt <= CONFIG_BLOCK_DEV_CACHE_SIZE);
 
     memset(bc, 0, sizeof(struct ext4_bcache));
 
@@ -85,7 +169,7 @@ int ext4_bcache_fini_dynamic(struct ext4_bcache *bc)
 int ext4_bcache_alloc(struct ext4_bcache *bc, struct ext4_block *b,
     bool *is_new)
 {
-    uint32_t i;
+    uint32_t cache_id;
     ext4_assert(bc && b && is_new);
 
     /*Check if valid.*/
@@ -94,65 +178,37 @@ int ext4_bcache_alloc(struct ext4_bcache *bc, struct ext4_block *b,
         ext4_assert(b->lb_id);
     }
 
-    uint32_t cache_id = bc->cnt;
-    uint32_t alloc_id = 0;
-
     *is_new = false;
 
-    /*Find in free blocks (Last Recently Used).*/
-    for (i = 0; i < bc->cnt; ++i) {
-
-        /*Check if block is already in cache*/
-        if(b->lb_id == bc->lba[i]){
-
-            if(!bc->refctr[i] && !bc->free_delay[i])
-                bc->ref_blocks++;
-
-            /*Update reference counter*/
-            bc->refctr[i]++;
-
-            /*Update usage marker*/
-            bc->lru_id[i] = ++bc->lru_ctr;
-
-            /*Set valid cache data and id*/
-            b->data = bc->data + i * bc->itemsize;
-            b->cache_id = i;
+    /*Check if block is already in cache*/
+    cache_id = ext4_bcache_hash_find(bc, b->lb_id);
+    if(cache_id != bc->cnt){
 
-            return EOK;
+        if(!bc->refctr[cache_id] && !bc->free_delay[cache_id]){
+            bc->ref_blocks++;
+            ext4_bcache_lru_del(bc, cache_id);
         }
 
-        /*Best fit calculations.*/
-        if(bc->refctr[i])
-            continue;
-
-        if(bc->free_delay[i])
-            continue;
+        /*Update reference counter*/
+        bc->refctr[cache_id]++;
 
-        /*Block is unreferenced, but it may exist block with
-         * lower usage marker*/
-
-        /*First find.*/
-        if(cache_id == bc->cnt){
-            cache_id = i;
-            alloc_id = bc->lru_id[i];
-            continue;
-        }
+        /*Update usage marker*/
+        bc->lru_id[cache_id] = ++bc->lru_ctr;
 
-        /*Next find*/
-        if(alloc_id <= bc->lru_id[i])
-            continue;
+        /*Set valid cache data and id*/
+        b->data = bc->data + cache_id * bc->itemsize;
+        b->cache_id = cache_id;
 
-        /*This block has lower alloc id marker*/
-        cache_id = i;
-        alloc_id = bc->lru_id[i];
+        return EOK;
     }
 
-
+    cache_id = ext4_bcache_victim(bc);
     if(cache_id != bc->cnt){
         /*There was unreferenced block*/
         bc->lba[cache_id] = b->lb_id;
         bc->refctr[cache_id] = 1;
         bc->lru_id[cache_id] = ++bc->lru_ctr;
+        ext4_bcache_hash_add(bc, cache_id);
 
         /*Set valid cache data and id*/
         b->data = bc->data + cache_id * bc->itemsize;
@@ -175,6 +231,66 @@ int ext4_bcache_alloc(struct ext4_bcache *bc, struct ext4_block *b,
     return ENOMEM;
 }
 
+int ext4_bcache_insert(struct ext4_bcache *bc, uint64_t lba, uint8_t **data)
+{
+    uint32_t cache_id;
+    ext4_assert(bc && lba && data);
+
+    if(ext4_bcache_hash_find(bc, lba) != bc->cnt)
+        return EEXIST;
+
+    cache_id = ext4_bcache_victim(bc);
+    if(cache_id == bc->cnt)
+        return ENOMEM;
+
+    bc->lba[cache_id] = lba;
+    bc->refctr[cache_id] = 0;
+    bc->lru_id[cache_id] = ++bc->lru_ctr;
+    ext4_bcache_hash_add(bc, cache_id);
+    ext4_bcache_lru_add(bc, cache_id);
+
+    *data = bc->data + cache_id * bc->itemsize;
+    return EOK;
+}
+
+bool ext4_bcache_find(struct ext4_bcache *bc, uint64_t lba)
+{
+    return ext4_bcache_hash_find(bc, lba) != bc->cnt;
+}
+
+void ext4_bcache_invalidate(struct ext4_bcache *bc, uint32_t cache_id)
+{
+    ext4_assert(cache_id < bc->cnt);
+
+    ext4_bcache_hash_del(bc, cache_id);
+    bc->lba[cache_id] = 0;
+
+    /*Unreferenced, make it the next victim.*/
+    if(!bc->refctr[cache_id] && !bc->free_delay[cache_id]){
+        ext4_bcache_lru_del(bc, cache_id);
+        bc->lru_next[cache_id] = bc->lru_head;
+        if(bc->lru_head)
+            bc->lru_prev[bc->lru_head - 1] = cache_id + 1;
+        else
+            bc->lru_tail = cache_id + 1;
+        bc->lru_head = cache_id + 1;
+    }
+}
+
+void ext4_bcache_delay_done(struct ext4_bcache *bc, uint32_t cache_id)
+{
+    ext4_assert(cache_id < bc->cnt && bc->free_delay[cache_id]);
+
+    /*No delayed anymore*/
+    bc->free_delay[cache_id] = 0;
+
+    /*Reduce refered block count*/
+    bc->ref_blocks--;
+
+    if(!bc->refctr[cache_id])
+        ext4_bcache_lru_add(bc, cache_id);
+}
+
 int ext4_bcache_free (struct ext4_bcache *bc, struct ext4_block *b,
     uint8_t free_delay)
 {
@@ -197,8 +313,10 @@ int ext4_bcache_free (struct ext4_bcache *bc, struct ext4_block *b,
         bc->free_delay[b->cache_id] = free_delay;
 
     /*Update statistics*/
-    if(!bc->refctr[b->cache_id] && !bc->free_delay[b->cache_id])
+    if(!bc->refctr[b->cache_id] && !bc->free_delay[b->cache_id]){
         bc->ref_blocks--;
+        ext4_bcache_lru_add(bc, b->cache_id);
+    }
 
     b->lb_id = 0;
     b->data = 0;
@@ -85,6 +85,23 @@ struct ext4_bcache {
     /**@brief   Dirty mark (cnt).*/
     bool dirty[CONFIG_BLOCK_DEV_CACHE_SIZE];
 
+    /**@brief   Hash chain heads by lba, cache id + 1 (0 terminates)*/
+    uint32_t hash_head[CONFIG_BLOCK_DEV_CACHE_HASH];
+
+    /**@brief   Hash chain links (cnt), cache id + 1*/
+    uint32_t hash_next[CONFIG_BLOCK_DEV_CACHE_SIZE];
+
+    /**@brief   Unreferenced blocks LRU list links (cnt), cache id + 1*/
+    uint32_t lru_prev[CONFIG_BLOCK_DEV_CACHE_SIZE];
+    uint32_t lru_next[CONFIG_BLOCK_DEV_CACHE_SIZE];
+
+    /**@brief   Least (head) and most (tail) recently used, cache id + 1*/
+    uint32_t lru_head;
+    uint32_t lru_tail;
+
+    /**@brief   Count of cache items taken into use so far*/
+    uint32_t used;
+
     /**@brief   Cache data buffers (cnt * itemsize)*/
     uint8_t *data;
 
@@ -130,6 +147,31 @@ int ext4_bcache_fini_dynamic(struct ext4_bcache *bc);
 int ext4_bcache_alloc(struct ext4_bcache *bc, struct ext4_block *b,
     bool *is_new);
 
+/**@brief   Put an unreferenced block in cache (read-ahead).
+ *          Fails if the block is already cached or no item is free.
+ * @param   bc block cache descriptor
+ * @param   lba logical block id
+ * @param   data output, item data buffer to fill
+ * @return  standard error code*/
+int ext4_bcache_insert(struct ext4_bcache *bc, uint64_t lba, uint8_t **data);
+
+/**@brief   Check if block is in cache.
+ * @param   bc block cache descriptor
+ * @param   lba logical block id
+ * @return  true if cached*/
+bool ext4_bcache_find(struct ext4_bcache *bc, uint64_t lba);
+
+/**@brief   Drop block from cache (e.g. after a failed read).
+ * @param   bc block cache descriptor
+ * @param   cache_id cache item id*/
+void ext4_bcache_invalidate(struct ext4_bcache *bc, uint32_t cache_id);
+
+/**@brief   Writeback of a delayed free block is done, the block may be
+ *          evicted now.
+ * @param   bc block cache descriptor
+ * @param   cache_id cache item id*/
+void ext4_bcache_delay_done(struct ext4_bcache *bc, uint32_t cache_id);
+
 /**@brief   Free block from cache memory (decrement reference counter).
  * @param   bc block cache descriptor
  * @param   b block to free
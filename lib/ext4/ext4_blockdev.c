@@ -76,6 +76,10 @@ void ext4_block_set_lb_size(struct ext4_blockdev *bdev, uint64_t lb_bsize)
     bdev->lg_bsize = lb_bsize;
     bdev->lg_bcnt = (bdev->ph_bcnt * bdev->ph_bsize) / lb_bsize;
 
+    /*Read-ahead buffer is sized by the logical block*/
+    free(bdev->ra_buf);
+    bdev->ra_buf = 0;
+
 }
 
 int ext4_block_fini(struct ext4_blockdev *bdev)
@@ -84,11 +88,78 @@ int ext4_block_fini(struct ext4_blockdev *bdev)
 
     bdev->flags &= ~(EXT4_BDEV_INITIALIZED);
 
+    free(bdev->ra_buf);
+    bdev->ra_buf = 0;
+    bdev->ra_last = 0;
+    bdev->ra_win = 0;
+
     /*Low level block fini*/
     return bdev->close(bdev);
 }
 
 
+#if CONFIG_BLOCK_DEV_READAHEAD
+/*Read-ahead window: starts small once two consecutive blocks were requested,
+ * doubles while the access stays sequential, limited to a quarter of the
+ * cache so it doesn't evict the metadata working set.*/
+static uint32_t ext4_block_ra_window(struct ext4_blockdev *bdev, uint64_t lba)
+{
+    uint32_t max = bdev->bc->cnt / 4;
+    uint32_t win;
+    uint32_t i;
+
+    if(max > CONFIG_BLOCK_DEV_READAHEAD)
+        max = CONFIG_BLOCK_DEV_READAHEAD;
+
+    if(lba != bdev->ra_last + 1 || max < 2){
+        bdev->ra_win = 0;
+        return 1;
+    }
+
+    bdev->ra_win = bdev->ra_win ? bdev->ra_win * 2 : 4;
+    if(bdev->ra_win > max)
+        bdev->ra_win = max;
+
+    /*Stop at the device end or at the first block already cached*/
+    win = bdev->ra_win;
+    if(win > bdev->lg_bcnt - lba)
+        win = bdev->lg_bcnt - lba;
+    for (i = 1; i < win; ++i) {
+        if(ext4_bcache_find(bdev->bc, lba + i))
+            break;
+    }
+    return i;
+}
+
+/*Read lba into b->data along with the blocks following it in one device
+ * request, the extra blocks are left unreferenced in cache.*/
+static int ext4_block_ra_read(struct ext4_blockdev *bdev, struct ext4_block *b,
+    uint64_t lba, uint32_t cnt)
+{
+    uint8_t *data;
+    uint32_t i;
+    int r;
+
+    if(!bdev->ra_buf){
+        bdev->ra_buf = malloc(CONFIG_BLOCK_DEV_READAHEAD * bdev->lg_bsize);
+        if(!bdev->ra_buf)
+            return ext4_blocks_get_direct(bdev, b->data, lba, 1);
+    }
+
+    r = ext4_blocks_get_direct(bdev, bdev->ra_buf, lba, cnt);
+    if(r != EOK)
+        return r;
+
+    memcpy(b->data, bdev->ra_buf, bdev->lg_bsize);
+    for (i = 1; i < cnt; ++i) {
+        if(ext4_bcache_insert(bdev->bc, lba + i, &data) != EOK)
+            break;
+        memcpy(data, bdev->ra_buf + i * bdev->lg_bsize, bdev->lg_bsize);
+    }
+    return EOK;
+}
+#endif
+
 int ext4_block_get(struct ext4_blockdev *bdev, struct ext4_block *b,
     uint64_t lba)
 {
@@ -140,10 +211,7 @@ int ext4_block_get(struct ext4_blockdev *bdev, struct ext4_block *b,
                 return r;
 
             /*No delayed anymore*/
-            bdev->bc->free_delay[free_candidate] = 0;
-
-            /*Reduce refered block count*/
-            bdev->bc->ref_blocks--;
+            ext4_bcache_delay_done(bdev->bc, free_candidate);
         }
     }
 
@@ -155,24 +223,43 @@ int ext4_block_get(struct ext4_blockdev *bdev, struct ext4_block *b,
 
     if(!is_new){
         /*Block is in cache. Read from physical device is not required*/
+        bdev->ra_last = lba;
         return EOK;
     }
 
     if(!b->data)
         return ENOMEM;
 
+#if CONFIG_BLOCK_DEV_READAHEAD
+    uint32_t ra_cnt = ext4_block_ra_window(bdev, lba);
+
+    bdev->ra_last = lba;
+    if(ra_cnt > 1){
+        r = ext4_block_ra_read(bdev, b, lba, ra_cnt);
+        goto read_done;
+    }
+#endif
+
     pba = (lba * bdev->lg_bsize) / bdev->ph_bsize;
     pb_cnt = bdev->lg_bsize / bdev->ph_bsize;
 
     r = bdev->bread(bdev, b->data, pba, pb_cnt);
+    if(r == EOK)
+        bdev->bread_ctr++;
 
+#if CONFIG_BLOCK_DEV_READAHEAD
+read_done:
+#endif
     if(r != EOK){
+        uint32_t cache_id = b->cache_id;
+
         ext4_bcache_free(bdev->bc, b, 0);
+        /*Don't leave the unread block looking valid*/
+        ext4_bcache_invalidate(bdev->bc, cache_id);
         b->lb_id = 0;
         return r;
     }
 
-    bdev->bread_ctr++;
     return EOK;
 }
 
@@ -445,10 +532,7 @@ int ext4_block_cache_write_back(struct ext4_blockdev *bdev,
                 return r;
 
             /*No delayed anymore*/
-            bdev->bc->free_delay[i] = 0;
-
-            /*Reduce refered block count*/
-            bdev->bc->ref_blocks--;
+            ext4_bcache_delay_done(bdev->bc, i);
         }
     }
     return EOK;
@@ -104,6 +104,15 @@ struct ext4_blockdev  {
     /**@brief   Physical write counter*/
     uint32_t    bwrite_ctr;
 
+    /**@brief   Last logical block requested (read-ahead detection)*/
+    uint64_t    ra_last;
+
+    /**@brief   Current read-ahead window (blocks)*/
+    uint32_t    ra_win;
+
+    /**@brief   Read-ahead buffer (CONFIG_BLOCK_DEV_READAHEAD blocks)*/
+    uint8_t     *ra_buf;
+
     /**@brief   Private data for blockdev driver*/
     void* private_data;
 };
@@ -83,7 +83,17 @@
 
 /**@brief   Cache size of block device.*/
 #ifndef CONFIG_BLOCK_DEV_CACHE_SIZE
-#define CONFIG_BLOCK_DEV_CACHE_SIZE     8
+#define CONFIG_BLOCK_DEV_CACHE_SIZE     64
+#endif
+
+/**@brief   Hash buckets of block device cache (power of two).*/
+#ifndef CONFIG_BLOCK_DEV_CACHE_HASH
+#define CONFIG_BLOCK_DEV_CACHE_HASH     64
+#endif
+
+/**@brief   Maximum sequential read-ahead window (blocks), 0 disables.*/
+#ifndef CONFIG_BLOCK_DEV_READAHEAD
+#define CONFIG_BLOCK_DEV_READAHEAD      16
 #endif
 
 
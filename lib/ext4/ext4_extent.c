@@ -252,8 +252,8 @@ static void ext4_extent_binsearch(struct ext4_extent_header *header,
 }
 
 
-int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
-    uint32_t *fblock)
+static int ext4_extent_find(struct ext4_inode_ref *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count, bool *unwritten)
 {
     int rc;
     /* Compute bound defined by i-node size */
@@ -265,6 +265,9 @@ int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
 
     uint32_t last_idx = (inode_size - 1) / block_size;
 
+    *count = 0;
+    *unwritten = false;
+
     /* Check if requested iblock is not over size of i-node */
     if (iblock > last_idx) {
         *fblock = 0;
@@ -311,9 +314,24 @@ int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
         /* Compute requested physical block address */
         uint32_t phys_block;
         uint32_t first = ext4_extent_get_first_block(extent);
+        uint32_t len = ext4_extent_get_block_count(extent);
+
+        /* Uninitialized extents keep the length with an offset */
+        if (len > EXT4_EXTENT_MAX_INIT_LEN) {
+            len -= EXT4_EXTENT_MAX_INIT_LEN;
+            *unwritten = true;
+        }
+
         phys_block = ext4_extent_get_start(extent) + iblock - first;
 
         *fblock = phys_block;
+
+        /* Blocks left in this extent, within the i-node size */
+        if (iblock - first < len) {
+            *count = first + len - iblock;
+            if (*count > last_idx - iblock + 1)
+                *count = last_idx - iblock + 1;
+        }
     }
 
     /* Cleanup */
@@ -326,6 +344,30 @@ int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
     return EOK;
 }
 
+int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
+    uint32_t *fblock)
+{
+    uint32_t count;
+    bool unwritten;
+
+    return ext4_extent_find(inode_ref, iblock, fblock, &count, &unwritten);
+}
+
+int ext4_extent_find_run(struct ext4_inode_ref *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count)
+{
+    bool unwritten;
+    int rc;
+
+    rc = ext4_extent_find(inode_ref, iblock, fblock, count, &unwritten);
+
+    /* Allocated but never written, reads back as zeroes like a hole */
+    if (rc == EOK && unwritten)
+        *fblock = 0;
+
+    return rc;
+}
+
 /**@brief Find extent for specified iblock.
  * This function is used for finding block in the extent tree with
  * saving the path through the tree for possible future modifications.
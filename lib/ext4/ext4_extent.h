@@ -163,6 +163,17 @@ void ext4_extent_header_set_generation(struct ext4_extent_header *header,
 int ext4_extent_find_block(struct ext4_inode_ref *inode_ref, uint32_t iblock,
     uint32_t *fblock);
 
+/**@brief Find the physically contiguous run of blocks starting at iblock.
+ * @param inode_ref I-node to load block from
+ * @param iblock    Logical block number to find
+ * @param fblock    Output value for physical block number
+ * @param count     Output value for the blocks left in the extent
+ *                  (0 if iblock is not mapped)
+ * Blocks of an unwritten extent are returned as a hole (fblock 0).
+ * @return Error code*/
+int ext4_extent_find_run(struct ext4_inode_ref *inode_ref, uint32_t iblock,
+    uint32_t *fblock, uint32_t *count);
+
 /**@brief Release all data blocks starting from specified logical block.
  * @param inode_ref   I-node to release blocks from
  * @param iblock_from First logical block to release
@@ -941,6 +941,58 @@ int ext4_fs_truncate_inode(struct ext4_inode_ref *inode_ref,
     return EOK;
 }
 
+int ext4_fs_get_inode_data_block_run(struct ext4_inode_ref *inode_ref,
+    uint64_t iblock, uint32_t max, uint32_t *fblock, uint32_t *count)
+{
+    struct ext4_fs *fs = inode_ref->fs;
+    uint32_t next;
+    int rc;
+
+    ext4_assert(max);
+
+#if CONFIG_EXTENT_ENABLE
+    /* Handle i-node using extents, whole run comes from one extent */
+    if ((ext4_sb_check_feature_incompatible(&fs->sb,
+            EXT4_FEATURE_INCOMPAT_EXTENTS)) &&
+            (ext4_inode_has_flag(inode_ref->inode, EXT4_INODE_FLAG_EXTENTS)) &&
+            ext4_inode_get_size(&fs->sb, inode_ref->inode)) {
+
+        rc = ext4_extent_find_run(inode_ref, iblock, fblock, count);
+        if (rc != EOK)
+            return rc;
+
+        /* Unmapped block is a hole of one block */
+        if (*count == 0) {
+            *fblock = 0;
+            *count = 1;
+        }
+        if (*count > max)
+            *count = max;
+        return EOK;
+    }
+#endif
+
+    /* Block mapped i-node, coalesce block by block */
+    rc = ext4_fs_get_inode_data_block_index(inode_ref, iblock, fblock);
+    if (rc != EOK)
+        return rc;
+
+    *count = 1;
+    while (*fblock && *count < max) {
+        rc = ext4_fs_get_inode_data_block_index(inode_ref,
+                iblock + *count, &next);
+        if (rc != EOK)
+            return rc;
+
+        if (next != *fblock + *count)
+            break;
+
+        (*count)++;
+    }
+
+    return EOK;
+}
+
 int ext4_fs_get_inode_data_block_index(struct ext4_inode_ref *inode_ref,
     uint64_t iblock, uint32_t *fblock)
 {
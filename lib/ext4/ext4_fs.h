@@ -149,6 +149,19 @@ int ext4_fs_truncate_inode(struct ext4_inode_ref *inode_ref,
 int ext4_fs_get_inode_data_block_index(struct ext4_inode_ref *inode_ref,
     uint64_t iblock, uint32_t *fblock);
 
+/**@brief Get the physically contiguous run of blocks starting at a logical
+ *        index of the i-node data.
+ * @param inode_ref I-node to read block address from
+ * @param iblock    Logical index of the first block
+ * @param max       Maximum run length wanted
+ * @param fblock    Output pointer for physical address of the first block
+ *                  (0 for a hole or an unwritten extent)
+ * @param count     Output pointer for run length, 1 to max blocks
+ * @return Error code
+ */
+int ext4_fs_get_inode_data_block_run(struct ext4_inode_ref *inode_ref,
+    uint64_t iblock, uint32_t max, uint32_t *fblock, uint32_t *count);
+
 /**@brief Set physical block address for the block logical address into the i-node.
  * @param inode_ref I-node to set block address to
  * @param iblock    Logical index of block
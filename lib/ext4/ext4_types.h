@@ -538,6 +538,9 @@ struct ext4_extent_path {
 
 #define EXT4_EXTENT_MAGIC  0xF30A
 
+/* Longer block_count marks an uninitialized extent of block_count - this */
+#define EXT4_EXTENT_MAX_INIT_LEN  32768
+
 #define EXT4_EXTENT_FIRST(header) \
         ((struct ext4_extent *) (((char *) (header)) + sizeof(struct ext4_extent_header)))
 
@@ -18,7 +18,8 @@ EXT4_SRCS = \
 	ext4_balloc.c \
 	ext4_blockdev.c \
 	ext4_inode.c \
-	blockdev/ext4_mmcdev.c
+	blockdev/ext4_mmcdev.c \
+	blockdev/ext4_biodev.c
 
 GLOBAL_INCLUDES += \
 	$(LOCAL_DIR) \
@@ -179,7 +179,7 @@ int ext2_mount(bdev_t *dev, fscookie *cookie)
 	}
 
 	/* initialize the block cache */
-	ext2->cache = bcache_create(ext2->dev, EXT2_BLOCK_SIZE(ext2->sb), 4);
+	ext2->cache = bcache_create(ext2->dev, EXT2_BLOCK_SIZE(ext2->sb), 64);
 
 	/* load the first inode */
 	err = ext2_load_inode(ext2, EXT2_ROOT_INO, &ext2->root_inode);
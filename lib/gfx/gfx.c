@@ -40,6 +40,7 @@
 #include <arch/ops.h>
 #include <sys/types.h>
 #include <lib/gfx.h>
+#include <lib/pixel.h>
 #include <dev/display.h>
 
 #define LOCAL_TRACE 0
@@ -140,107 +141,48 @@ static void putpixel32(gfx_surface *surface, uint x, uint y, uint color)
 	*dest = color;
 }
 
-static void copyrect16(gfx_surface *surface, uint x, uint y, uint width, uint height, uint x2, uint y2)
+static void copyrect(gfx_surface *surface, uint x, uint y, uint width, uint height, uint x2, uint y2)
 {
-	// copy
-	const uint16_t *src = &((const uint16_t *)surface->ptr)[x + y * surface->stride];
-	uint16_t *dest = &((uint16_t *)surface->ptr)[x2 + y2 * surface->stride];
-	uint stride_diff = surface->stride - width;
+	uint8_t *src = (uint8_t *)surface->ptr + (x + y * surface->stride) * surface->pixelsize;
+	uint8_t *dest = (uint8_t *)surface->ptr + (x2 + y2 * surface->stride) * surface->pixelsize;
+	size_t pitch = surface->stride * surface->pixelsize;
+	size_t len = width * surface->pixelsize;
+	uint i;
 
 	if (dest < src) {
-		uint i, j;
 		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest++;
-				src++;
-			}
-			dest += stride_diff;
-			src += stride_diff;
+			memmove(dest, src, len);
+			dest += pitch;
+			src += pitch;
 		}
 	} else {
-		// copy backwards
-		src += height * surface->stride + width;
-		dest += height * surface->stride + width;
-
-		uint i, j;
-		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest--;
-				src--;
-			}
-			dest -= stride_diff;
-			src -= stride_diff;
-		}
+		// copy backwards, a row at a time
+		for (i=height; i > 0; i--)
+			memmove(dest + (i - 1) * pitch, src + (i - 1) * pitch, len);
 	}
 }
 
 static void fillrect16(gfx_surface *surface, uint x, uint y, uint width, uint height, uint color)
 {
 	uint16_t *dest = &((uint16_t *)surface->ptr)[x + y * surface->stride];
-	uint stride_diff = surface->stride - width;
 
 	uint16_t color16 = ARGB8888_to_RGB565(color);
 
-	uint i, j;
+	uint i;
 	for (i=0; i < height; i++) {
-		for (j=0; j < width; j++) {
-			*dest = color16;
-			dest++;
-		}
-		dest += stride_diff;
-	}
-}
-
-static void copyrect32(gfx_surface *surface, uint x, uint y, uint width, uint height, uint x2, uint y2)
-{
-	// copy
-	const uint32_t *src = &((const uint32_t *)surface->ptr)[x + y * surface->stride];
-	uint32_t *dest = &((uint32_t *)surface->ptr)[x2 + y2 * surface->stride];
-	uint stride_diff = surface->stride - width;
-
-	if (dest < src) {
-		uint i, j;
-		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest++;
-				src++;
-			}
-			dest += stride_diff;
-			src += stride_diff;
-		}
-	} else {
-		// copy backwards
-		src += height * surface->stride + width;
-		dest += height * surface->stride + width;
-
-		uint i, j;
-		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest--;
-				src--;
-			}
-			dest -= stride_diff;
-			src -= stride_diff;
-		}
+		pixel_fill16(dest, color16, width);
+		dest += surface->stride;
 	}
 }
 
 static void fillrect32(gfx_surface *surface, uint x, uint y, uint width, uint height, uint color)
 {
 	uint32_t *dest = &((uint32_t *)surface->ptr)[x + y * surface->stride];
-	uint stride_diff = surface->stride - width;
 
-	uint i, j;
+	uint i;
 	for (i=0; i < height; i++) {
-		for (j=0; j < width; j++) {
-			*dest = color;
-			dest++;
-		}
-		dest += stride_diff;
+		pixel_fill32(dest, color, width);
+		dest += surface->stride;
 	}
 }
 
@@ -306,63 +248,33 @@ void gfx_surface_blend(struct gfx_surface *target, struct gfx_surface *source, u
 		height = target->height - desty;
 
 	// XXX total hack to deal with various blends
-	if (source->format == GFX_FORMAT_RGB_565 && target->format == GFX_FORMAT_RGB_565) {
-		// 16 bit to 16 bit
-		const uint16_t *src = (const uint16_t *)source->ptr;
-		uint16_t *dest = &((uint16_t *)target->ptr)[destx + desty * target->stride];
-		uint dest_stride_diff = target->stride - width;
-		uint source_stride_diff = source->stride - width;
-
-		LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, dest_stride_diff, source_stride_diff);
-
-		uint i, j;
-		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest++;
-				src++;
-			}
-			dest += dest_stride_diff;
-			src += source_stride_diff;
-		}
-	} else if (source->format == GFX_FORMAT_ARGB_8888 && target->format == GFX_FORMAT_ARGB_8888) {
+	if (source->format == GFX_FORMAT_ARGB_8888 && target->format == GFX_FORMAT_ARGB_8888) {
 		// both are 32 bit modes, both alpha
 		const uint32_t *src = (const uint32_t *)source->ptr;
 		uint32_t *dest = &((uint32_t *)target->ptr)[destx + desty * target->stride];
-		uint dest_stride_diff = target->stride - width;
-		uint source_stride_diff = source->stride - width;
 
-		LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, dest_stride_diff, source_stride_diff);
+		LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, target->stride, source->stride);
 
-		uint i, j;
+		uint i;
 		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				// XXX ignores destination alpha
-				*dest = alpha32_add_ignore_destalpha(*dest, *src);
-				dest++;
-				src++;
-			}
-			dest += dest_stride_diff;
-			src += source_stride_diff;
+			// XXX ignores destination alpha
+			pixel_blend32(dest, src, width);
+			dest += target->stride;
+			src += source->stride;
 		}
-	} else if (source->format == GFX_FORMAT_RGB_x888 && target->format == GFX_FORMAT_RGB_x888) {
-		// both are 32 bit modes, no alpha
-		const uint32_t *src = (const uint32_t *)source->ptr;
-		uint32_t *dest = &((uint32_t *)target->ptr)[destx + desty * target->stride];
-		uint dest_stride_diff = target->stride - width;
-		uint source_stride_diff = source->stride - width;
+	} else if ((source->format == GFX_FORMAT_RGB_565 && target->format == GFX_FORMAT_RGB_565) ||
+		   (source->format == GFX_FORMAT_RGB_x888 && target->format == GFX_FORMAT_RGB_x888)) {
+		// same format, no alpha: a plain copy
+		const uint8_t *src = (const uint8_t *)source->ptr;
+		uint8_t *dest = (uint8_t *)target->ptr + (destx + desty * target->stride) * target->pixelsize;
 
-		LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, dest_stride_diff, source_stride_diff);
+		LTRACEF("w %u h %u dstride %u sstride %u\n", width, height, target->stride, source->stride);
 
-		uint i, j;
+		uint i;
 		for (i=0; i < height; i++) {
-			for (j=0; j < width; j++) {
-				*dest = *src;
-				dest++;
-				src++;
-			}
-			dest += dest_stride_diff;
-			src += source_stride_diff;
+			memcpy(dest, src, width * target->pixelsize);
+			dest += target->stride * target->pixelsize;
+			src += source->stride * source->pixelsize;
 		}
 	} else {
 		panic("gfx_surface_blend: unimplemented colorspace combination (source %d target %d)\n", source->format, target->format);
@@ -426,7 +338,7 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
 	// set up some function pointers
 	switch (format) {
 		case GFX_FORMAT_RGB_565:
-			surface->copyrect = &copyrect16;
+			surface->copyrect = &copyrect;
 			surface->fillrect = &fillrect16;
 			surface->putpixel = &putpixel16;
 			surface->pixelsize = 2;
@@ -434,7 +346,7 @@ gfx_surface *gfx_create_surface(void *ptr, uint width, uint height, uint stride,
 			break;
 		case GFX_FORMAT_RGB_x888:
 		case GFX_FORMAT_ARGB_8888:
-			surface->copyrect = &copyrect32;
+			surface->copyrect = &copyrect;
 			surface->fillrect = &fillrect32;
 			surface->putpixel = &putpixel32;
 			surface->pixelsize = 4;
@@ -540,6 +452,7 @@ void gfx_draw_pattern_white(void)
 
 #if LK_DEBUGLEVEL > 1
 #include <lib/console.h>
+#include <platform.h>
 
 static int cmd_gfx(int argc, const cmd_args *argv);
 
@@ -577,16 +490,114 @@ static int gfx_draw_rgb_bars(gfx_surface *surface)
 }
 
 
+#define GFX_BENCH_PIXELS	(512 * 1024)
+#define GFX_BENCH_ROUNDS	16
+
+enum {
+	GFX_BENCH_FILL16,
+	GFX_BENCH_FILL32,
+	GFX_BENCH_BLEND32,
+	GFX_BENCH_RGB565_TO_ARGB8888,
+	GFX_BENCH_ARGB8888_TO_RGB565,
+	GFX_BENCH_SWAP_RGB888,
+	GFX_BENCH_MAX
+};
+
+static const char *gfx_bench_names[GFX_BENCH_MAX] = {
+	"fill rgb565",
+	"fill argb8888",
+	"blend argb8888",
+	"rgb565 -> argb8888",
+	"argb8888 -> rgb565",
+	"rgb888 <-> bgr888",
+};
+
+static lk_bigtime_t gfx_bench_op(const struct pixel_ops *ops, int op, uint32_t *a, uint32_t *b)
+{
+	lk_bigtime_t t;
+	uint i;
+
+	t = current_time_hires();
+	for (i = 0; i < GFX_BENCH_ROUNDS; i++) {
+		switch (op) {
+			case GFX_BENCH_FILL16:
+				ops->fill16((uint16_t *)a, 0xf800, GFX_BENCH_PIXELS);
+				break;
+			case GFX_BENCH_FILL32:
+				ops->fill32(a, 0xffff0000, GFX_BENCH_PIXELS);
+				break;
+			case GFX_BENCH_BLEND32:
+				ops->blend32(a, b, GFX_BENCH_PIXELS);
+				break;
+			case GFX_BENCH_RGB565_TO_ARGB8888:
+				ops->rgb565_to_argb8888(a, (const uint16_t *)b, GFX_BENCH_PIXELS);
+				break;
+			case GFX_BENCH_ARGB8888_TO_RGB565:
+				ops->argb8888_to_rgb565((uint16_t *)a, b, GFX_BENCH_PIXELS);
+				break;
+			case GFX_BENCH_SWAP_RGB888:
+				ops->swap_rgb888((uint8_t *)a, GFX_BENCH_PIXELS);
+				break;
+		}
+	}
+
+	return current_time_hires() - t;
+}
+
+/* Mpixels/s of every pixel kernel, plain C against the one in use */
+static int gfx_bench(void)
+{
+	const struct pixel_ops *ops[2] = { &pixel_ops_c, pixel_get_ops() };
+	uint32_t *a, *b;
+	lk_bigtime_t t;
+	uint i, j, n;
+
+	a = malloc(GFX_BENCH_PIXELS * sizeof(uint32_t));
+	b = malloc(GFX_BENCH_PIXELS * sizeof(uint32_t));
+	if (!a || !b) {
+		printf("gfx bench: out of memory\n");
+		free(a);
+		free(b);
+		return -1;
+	}
+
+	// a spread of alphas, so the blend takes every path
+	for (i = 0; i < GFX_BENCH_PIXELS; i++) {
+		a[i] = i * 0x9e3779b9;
+		b[i] = (i * 0x01000193) ^ (i << 24);
+	}
+
+	n = (ops[1] == ops[0]) ? 1 : 2;
+	for (i = 0; i < GFX_BENCH_MAX; i++) {
+		for (j = 0; j < n; j++) {
+			t = gfx_bench_op(ops[j], i, a, b);
+			printf("%-20s %-6s", gfx_bench_names[i], ops[j]->name);
+			if (t)
+				printf(" %6llu Mpixels/s", (uint64_t)GFX_BENCH_PIXELS * GFX_BENCH_ROUNDS / t);
+			printf("\n");
+		}
+	}
+
+	free(a);
+	free(b);
+
+	return 0;
+}
+
 static int cmd_gfx(int argc, const cmd_args *argv)
 {
 	if (argc < 2) {
 		printf("not enough arguments:\n");
 		printf("%s rgb_bars		: Fill frame buffer with rgb bars\n", argv[0].str);
 		printf("%s fill r g b	: Fill frame buffer with RGB565 value and force update\n", argv[0].str);
+		printf("%s bench		: Time the pixel kernels\n", argv[0].str);
 
 		return -1;
 	}
 
+	if (!strcmp(argv[1].str, "bench"))
+		return gfx_bench();
+
 	struct display_info info;
 	display_get_info(&info);
 
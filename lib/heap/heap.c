@@ -45,6 +45,13 @@
 
 #define HEAP_MAGIC 'HEAP'
 
+// record every heap call from heap_init on, see heap_trace_get()
+#ifndef HEAP_TRACE
+#define HEAP_TRACE 0
+#endif
+#define HEAP_TRACE_OPS 2048
+#define HEAP_TRACE_SLOTS 256
+
 #if WITH_STATIC_HEAP
 
 #if !defined(HEAP_START) || !defined(HEAP_LEN)
@@ -62,24 +69,110 @@ extern void *_heap_end;
 #define HEAP_LEN ((uintptr_t)_heap_end - (uintptr_t)&_end)
 #endif
 
+/*
+ * Every chunk, free or allocated, starts with a boundary tag holding its own
+ * length and the length of the chunk physically before it, so both neighbours
+ * can be found in constant time when it is freed. Free chunks are kept in
+ * segregated size class bins with a bitmap of the non empty ones.
+ */
+struct heap_chunk_tag {
+	size_t prev_len;	// length of the previous chunk, 0 at the start of a block
+	size_t len;			// length of this chunk, HEAP_CHUNK_FREE set when free
+};
+
+#define HEAP_CHUNK_FREE 1
+
 struct free_heap_chunk {
+	struct heap_chunk_tag tag;
 	struct list_node node;
-	size_t len;
 };
 
+// bins 0..HEAP_SMALL_BINS-1 are HEAP_SMALL_STEP apart, the rest split every
+// power of two in HEAP_SUB_BINS classes
+#define HEAP_SMALL_STEP 8
+#define HEAP_SMALL_BINS 32
+#define HEAP_SMALL_LIMIT (HEAP_SMALL_STEP * HEAP_SMALL_BINS)
+#define HEAP_SMALL_SHIFT 8 // log2(HEAP_SMALL_LIMIT)
+#define HEAP_SUB_SHIFT 2
+#define HEAP_SUB_BINS (1 << HEAP_SUB_SHIFT)
+#define HEAP_MAX_SHIFT 31
+#define HEAP_BINS (HEAP_SMALL_BINS + (HEAP_MAX_SHIFT - HEAP_SMALL_SHIFT + 1) * HEAP_SUB_BINS)
+#define HEAP_BITMAP_WORDS ((HEAP_BINS + 31) / 32)
+
 struct heap {
 	void *base;
 	size_t len;
 	size_t remaining;
 	size_t low_watermark;
 	mutex_t lock;
-	struct list_node free_list;
+	struct list_node bins[HEAP_BINS];
+	uint32_t bin_bitmap[HEAP_BITMAP_WORDS];
 	struct list_node delayed_free_list;
 };
 
 // heap static vars
 static struct heap theheap;
 
+#if HEAP_TRACE
+static struct heap_trace_op trace_ops[HEAP_TRACE_OPS];
+static void *trace_slot[HEAP_TRACE_SLOTS];
+static size_t trace_count;
+static bool trace_stopped;
+
+// live allocations take the lowest free slot, so a replay needs as many
+// slots as the peak number of live allocations
+static void heap_trace(void *ptr, size_t size, unsigned int alignment, bool is_free)
+{
+	bool full = false;
+	uint i;
+
+	enter_critical_section();
+	if (trace_stopped)
+		goto out;
+
+	for (i = 0; i < HEAP_TRACE_SLOTS; i++) {
+		if (trace_slot[i] == (is_free ? ptr : NULL))
+			break;
+	}
+	// a pointer allocated while the trace was full
+	if (is_free && i == HEAP_TRACE_SLOTS)
+		goto out;
+
+	if (i == HEAP_TRACE_SLOTS || trace_count == HEAP_TRACE_OPS) {
+		trace_stopped = full = true;
+		goto out;
+	}
+
+	trace_slot[i] = is_free ? NULL : ptr;
+	trace_ops[trace_count].slot = i;
+	trace_ops[trace_count].align = alignment;
+	// zero sized requests still take a chunk, keep 0 for frees
+	trace_ops[trace_count].size = is_free ? 0 : (size ? size : 1);
+	trace_count++;
+
+out:
+	exit_critical_section();
+
+	if (full)
+		dprintf(CRITICAL, "heap trace full after %zu calls\n", trace_count);
+}
+#endif
+
+size_t heap_trace_get(const struct heap_trace_op **ops)
+{
+#if HEAP_TRACE
+	enter_critical_section();
+	trace_stopped = true;
+	exit_critical_section();
+
+	*ops = trace_ops;
+	return trace_count;
+#else
+	*ops = NULL;
+	return 0;
+#endif
+}
+
 // structure placed at the beginning every allocation
 struct alloc_struct_begin {
 #if LK_DEBUGLEVEL > 1
@@ -95,7 +188,9 @@ struct alloc_struct_begin {
 
 static void dump_free_chunk(struct free_heap_chunk *chunk)
 {
-	dprintf(INFO, "\t\tbase %p, end 0x%lx, len 0x%zx\n", chunk, (vaddr_t)chunk + chunk->len, chunk->len);
+	size_t len = chunk->tag.len & ~HEAP_CHUNK_FREE;
+
+	dprintf(INFO, "\t\tbase %p, end 0x%lx, len 0x%zx\n", chunk, (vaddr_t)chunk + len, len);
 }
 
 static void heap_dump(void)
@@ -107,8 +202,11 @@ static void heap_dump(void)
 	mutex_acquire(&theheap.lock);
 
 	struct free_heap_chunk *chunk;
-	list_for_every_entry(&theheap.free_list, chunk, struct free_heap_chunk, node) {
-		dump_free_chunk(chunk);
+	uint bin;
+	for (bin = 0; bin < HEAP_BINS; bin++) {
+		list_for_every_entry(&theheap.bins[bin], chunk, struct free_heap_chunk, node) {
+			dump_free_chunk(chunk);
+		}
 	}
 
 	dprintf(INFO, "\tdelayed free list:\n");
@@ -170,65 +268,122 @@ static void heap_test(void)
 	heap_dump();
 }
 
-// try to insert this free chunk into the free list, consuming the chunk by merging it with
-// nearby ones if possible. Returns base of whatever chunk it became in the list.
-static struct free_heap_chunk *heap_insert_free_chunk(struct free_heap_chunk *chunk)
+static inline uint heap_fls(size_t x)
 {
-#if LK_DEBUGLEVEL > INFO
-	vaddr_t chunk_end = (vaddr_t)chunk + chunk->len;
-#endif
+	if (x >> HEAP_MAX_SHIFT)
+		return HEAP_MAX_SHIFT;
+
+	return 31 - __builtin_clz((uint32_t)x);
+}
 
-//	dprintf("%s: chunk ptr %p, size 0x%lx, chunk_end 0x%x\n", __FUNCTION__, chunk, chunk->len, chunk_end);
+// the size class holding chunks of length len
+static uint heap_bin_index(size_t len)
+{
+	uint shift;
 
-	struct free_heap_chunk *next_chunk;
-	struct free_heap_chunk *last_chunk;
+	if (len < HEAP_SMALL_LIMIT)
+		return len / HEAP_SMALL_STEP;
 
-	mutex_acquire(&theheap.lock);
+	shift = heap_fls(len);
+	return HEAP_SMALL_BINS + (shift - HEAP_SMALL_SHIFT) * HEAP_SUB_BINS +
+	       ((len >> (shift - HEAP_SUB_SHIFT)) & (HEAP_SUB_BINS - 1));
+}
 
-	theheap.remaining += chunk->len;
+// the smallest chunk length held by a size class
+static size_t heap_bin_min(uint bin)
+{
+	uint shift;
 
-	// walk through the list, finding the node to insert before
-	list_for_every_entry(&theheap.free_list, next_chunk, struct free_heap_chunk, node) {
-		if (chunk < next_chunk) {
-			DEBUG_ASSERT(chunk_end <= (vaddr_t)next_chunk);
+	if (bin < HEAP_SMALL_BINS)
+		return bin * HEAP_SMALL_STEP;
 
-			list_add_before(&next_chunk->node, &chunk->node);
+	bin -= HEAP_SMALL_BINS;
+	shift = HEAP_SMALL_SHIFT + bin / HEAP_SUB_BINS;
+	return ((size_t)1 << shift) + (bin % HEAP_SUB_BINS) * ((size_t)1 << (shift - HEAP_SUB_SHIFT));
+}
 
-			goto try_merge;
-		}
+// first non empty bin at or above bin, HEAP_BINS if there is none
+static uint heap_find_bin(uint bin)
+{
+	uint word = bin / 32;
+	uint32_t bits;
+
+	if (bin >= HEAP_BINS)
+		return HEAP_BINS;
+
+	bits = theheap.bin_bitmap[word] & (~0U << (bin % 32));
+	while (!bits) {
+		if (++word == HEAP_BITMAP_WORDS)
+			return HEAP_BINS;
+		bits = theheap.bin_bitmap[word];
 	}
 
-	// walked off the end of the list, add it at the tail
-	list_add_tail(&theheap.free_list, &chunk->node);
+	return word * 32 + __builtin_ctz(bits);
+}
+
+static inline struct heap_chunk_tag *heap_next_tag(struct heap_chunk_tag *tag)
+{
+	return (struct heap_chunk_tag *)((vaddr_t)tag + (tag->len & ~HEAP_CHUNK_FREE));
+}
+
+static inline struct heap_chunk_tag *heap_prev_tag(struct heap_chunk_tag *tag)
+{
+	return (struct heap_chunk_tag *)((vaddr_t)tag - tag->prev_len);
+}
 
-	// try to merge with the previous chunk
-try_merge:
-	last_chunk = list_prev_type(&theheap.free_list, &chunk->node, struct free_heap_chunk, node);
-	if (last_chunk) {
-		if ((vaddr_t)last_chunk + last_chunk->len == (vaddr_t)chunk) {
-			// easy, just extend the previous chunk
-			last_chunk->len += chunk->len;
+static void heap_bin_add(struct free_heap_chunk *chunk)
+{
+	uint bin = heap_bin_index(chunk->tag.len);
 
-			// remove ourself from the list
-			list_delete(&chunk->node);
+	chunk->tag.len |= HEAP_CHUNK_FREE;
+	list_add_head(&theheap.bins[bin], &chunk->node);
+	theheap.bin_bitmap[bin / 32] |= 1U << (bin % 32);
+}
 
-			// set the chunk pointer to the newly extended chunk, in case
-			// it needs to merge with the next chunk below
-			chunk = last_chunk;
-		}
-	}
+static void heap_bin_remove(struct free_heap_chunk *chunk)
+{
+	chunk->tag.len &= ~HEAP_CHUNK_FREE;
 
-	// try to merge with the next chunk
-	if (next_chunk) {
-		if ((vaddr_t)chunk + chunk->len == (vaddr_t)next_chunk) {
-			// extend our chunk
-			chunk->len += next_chunk->len;
+	uint bin = heap_bin_index(chunk->tag.len);
+
+	list_delete(&chunk->node);
+	if (list_is_empty(&theheap.bins[bin]))
+		theheap.bin_bitmap[bin / 32] &= ~(1U << (bin % 32));
+}
+
+// try to insert this free chunk into the free bins, consuming the chunk by merging it with
+// its neighbours if they are free. Returns base of whatever chunk it became in the bins.
+static struct free_heap_chunk *heap_insert_free_chunk(struct free_heap_chunk *chunk)
+{
+	struct heap_chunk_tag *next;
+	struct heap_chunk_tag *prev;
 
-			// remove them from the list
-			list_delete(&next_chunk->node);
+	DEBUG_ASSERT(!(chunk->tag.len & HEAP_CHUNK_FREE));
+
+	mutex_acquire(&theheap.lock);
+
+	theheap.remaining += chunk->tag.len;
+
+	// merge with the next chunk, the tag at the end of each block is never free
+	next = heap_next_tag(&chunk->tag);
+	if (next->len & HEAP_CHUNK_FREE) {
+		heap_bin_remove((struct free_heap_chunk *)next);
+		chunk->tag.len += next->len;
+	}
+
+	// merge into the previous chunk
+	if (chunk->tag.prev_len) {
+		prev = heap_prev_tag(&chunk->tag);
+		if (prev->len & HEAP_CHUNK_FREE) {
+			heap_bin_remove((struct free_heap_chunk *)prev);
+			prev->len += chunk->tag.len;
+			chunk = (struct free_heap_chunk *)prev;
 		}
 	}
 
+	heap_next_tag(&chunk->tag)->prev_len = chunk->tag.len;
+	heap_bin_add(chunk);
+
 	mutex_release(&theheap.lock);
 
 	return chunk;
@@ -238,13 +393,14 @@ static struct free_heap_chunk *heap_create_free_chunk(void *ptr, size_t len, boo
 {
 	DEBUG_ASSERT((len % sizeof(void *)) == 0); // size must be aligned on pointer boundary
 
+	struct free_heap_chunk *chunk = (struct free_heap_chunk *)ptr;
+
 #if DEBUG_HEAP
 	if (allow_debug)
-		memset(ptr, FREE_FILL, len);
+		memset(chunk + 1, FREE_FILL, len - sizeof(*chunk));
 #endif
 
-	struct free_heap_chunk *chunk = (struct free_heap_chunk *)ptr;
-	chunk->len = len;
+	chunk->tag.len = len;
 
 	return chunk;
 }
@@ -272,9 +428,12 @@ static void heap_free_delayed_list(void)
 void *heap_alloc(size_t size, unsigned int alignment)
 {
 	void *ptr;
-#if DEBUG_HEAP
+#if DEBUG_HEAP || HEAP_TRACE
 	size_t original_size = size;
 #endif
+#if HEAP_TRACE
+	unsigned int original_alignment = alignment;
+#endif
 
 	LTRACEF("size %zd, align %d\n", size, alignment);
 
@@ -292,8 +451,8 @@ void *heap_alloc(size_t size, unsigned int alignment)
 		dprintf(CRITICAL, "invalid input size\n");
 		return NULL;
 	}
-	// we always put a size field + base pointer + magic in front of the allocation
-	size += sizeof(struct alloc_struct_begin);
+	// we always put a boundary tag and a size field + base pointer + magic in front of the allocation
+	size += sizeof(struct heap_chunk_tag) + sizeof(struct alloc_struct_begin);
 #if DEBUG_HEAP
 	size += PADDING_SIZE;
 #endif
@@ -323,75 +482,87 @@ void *heap_alloc(size_t size, unsigned int alignment)
 
 	mutex_acquire(&theheap.lock);
 
-	// walk through the list
+	// every chunk in a class above the one of size fits, so does every chunk
+	// of its own class when size is the smallest length of that class
 	ptr = NULL;
-	struct free_heap_chunk *chunk;
-	list_for_every_entry(&theheap.free_list, chunk, struct free_heap_chunk, node) {
-		DEBUG_ASSERT((chunk->len % sizeof(void *)) == 0); // len should always be a multiple of pointer size
+	struct free_heap_chunk *chunk = NULL;
+	uint bin = heap_bin_index(size);
+	uint found = heap_find_bin(heap_bin_min(bin) == size ? bin : bin + 1);
+	if (found < HEAP_BINS) {
+		chunk = list_peek_head_type(&theheap.bins[found], struct free_heap_chunk, node);
+	} else {
+		// last resort, first fit in the class of size
+		struct free_heap_chunk *entry;
+		list_for_every_entry(&theheap.bins[bin], entry, struct free_heap_chunk, node) {
+			if ((entry->tag.len & ~HEAP_CHUNK_FREE) >= size) {
+				chunk = entry;
+				break;
+			}
+		}
+	}
 
-		// is it big enough to service our allocation?
-		if (chunk->len >= size) {
-			ptr = chunk;
+	if (chunk) {
+		ptr = chunk;
 
-			// remove it from the list
-			struct list_node *next_node = list_next(&theheap.free_list, &chunk->node);
-			list_delete(&chunk->node);
+		// remove it from the bins
+		heap_bin_remove(chunk);
+		DEBUG_ASSERT((chunk->tag.len % sizeof(void *)) == 0); // len should always be a multiple of pointer size
 
-			if (chunk->len > size + sizeof(struct free_heap_chunk)) {
-				// there's enough space in this chunk to create a new one after the allocation
-				struct free_heap_chunk *newchunk = heap_create_free_chunk((uint8_t *)ptr + size, chunk->len - size, true);
+		if (chunk->tag.len >= size + sizeof(struct free_heap_chunk)) {
+			// there's enough space in this chunk to create a new one after the allocation
+			struct free_heap_chunk *newchunk = heap_create_free_chunk((uint8_t *)ptr + size, chunk->tag.len - size, true);
 
-				// truncate this chunk
-				chunk->len -= chunk->len - size;
+			newchunk->tag.prev_len = size;
+			heap_next_tag(&newchunk->tag)->prev_len = newchunk->tag.len;
+			heap_bin_add(newchunk);
 
-				// add the new one where chunk used to be
-				if (next_node)
-					list_add_before(next_node, &newchunk->node);
-				else
-					list_add_tail(&theheap.free_list, &newchunk->node);
-			}
+			// truncate this chunk
+			chunk->tag.len = size;
+		}
 
-			// the allocated size is actually the length of this chunk, not the size requested
-			DEBUG_ASSERT(chunk->len >= size);
-			size = chunk->len;
+		// the allocated size is actually the length of this chunk, not the size requested
+		DEBUG_ASSERT(chunk->tag.len >= size);
+		size = chunk->tag.len;
 
 #if DEBUG_HEAP
-			memset(ptr, ALLOC_FILL, size);
+		memset(chunk + 1, ALLOC_FILL, size - sizeof(*chunk));
 #endif
 
-			ptr = (void *)((addr_t)ptr + sizeof(struct alloc_struct_begin));
+		ptr = (void *)((addr_t)ptr + sizeof(struct heap_chunk_tag) + sizeof(struct alloc_struct_begin));
 
-			// align the output if requested
-			if (alignment > 0) {
-				ptr = (void *)ROUNDUP((addr_t)ptr, alignment);
-			}
+		// align the output if requested
+		if (alignment > 0) {
+			ptr = (void *)ROUNDUP((addr_t)ptr, (addr_t)alignment);
+		}
 
-			struct alloc_struct_begin *as = (struct alloc_struct_begin *)ptr;
-			as--;
+		struct alloc_struct_begin *as = (struct alloc_struct_begin *)ptr;
+		as--;
 #if LK_DEBUGLEVEL > 1
-			as->magic = HEAP_MAGIC;
+		as->magic = HEAP_MAGIC;
 #endif
-			as->ptr = (void *)chunk;
-			as->size = size;
-			theheap.remaining -= size;
+		as->ptr = (void *)chunk;
+		as->size = size;
+		theheap.remaining -= size;
 
-			if (theheap.remaining < theheap.low_watermark) {
-				theheap.low_watermark = theheap.remaining;
-			}
+		if (theheap.remaining < theheap.low_watermark) {
+			theheap.low_watermark = theheap.remaining;
+		}
 #if DEBUG_HEAP
-			as->padding_start = ((uint8_t *)ptr + original_size);
-			as->padding_size = (((addr_t)chunk + size) - ((addr_t)ptr + original_size));
-//			printf("padding start %p, size %u, chunk %p, size %u\n", as->padding_start, as->padding_size, chunk, size);
+		as->padding_start = ((uint8_t *)ptr + original_size);
+		as->padding_size = (((addr_t)chunk + size) - ((addr_t)ptr + original_size));
+//		printf("padding start %p, size %u, chunk %p, size %u\n", as->padding_start, as->padding_size, chunk, size);
 
-			memset(as->padding_start, PADDING_FILL, as->padding_size);
+		memset(as->padding_start, PADDING_FILL, as->padding_size);
 #endif
-
-			break;
-		}
 	}
 
 	mutex_release(&theheap.lock);
 
+#if HEAP_TRACE
+	if (ptr)
+		heap_trace(ptr, original_size, original_alignment, false);
+#endif
+
 	LTRACEF("returning ptr %p\n", ptr);
 
 	return ptr;
@@ -449,6 +620,10 @@ void heap_free(void *ptr)
 
 	LTRACEF("allocation was %zd bytes long at ptr %p\n", as->size, as->ptr);
 
+#if HEAP_TRACE
+	heap_trace(ptr, 0, 0, true);
+#endif
+
 	// looks good, create a free chunk and add it to the pool
 	heap_insert_free_chunk(heap_create_free_chunk(as->ptr, as->size, true));
 }
@@ -463,7 +638,11 @@ void heap_delayed_free(void *ptr)
 
 	DEBUG_ASSERT(as->magic == HEAP_MAGIC);
 
-	struct free_heap_chunk *chunk = heap_create_free_chunk(as->ptr, as->size, false);
+	struct free_heap_chunk *chunk = (struct free_heap_chunk *)as->ptr;
+
+#if HEAP_TRACE
+	heap_trace(ptr, 0, 0, true);
+#endif
 
 	enter_critical_section();
 	list_add_head(&theheap.delayed_free_list, &chunk->node);
@@ -489,11 +668,16 @@ void heap_get_stats(struct heap_stats *ptr)
 
 	mutex_acquire(&theheap.lock);
 
-	list_for_every_entry(&theheap.free_list, chunk, struct free_heap_chunk, node) {
-		ptr->heap_free += chunk->len;
+	uint bin;
+	for (bin = 0; bin < HEAP_BINS; bin++) {
+		list_for_every_entry(&theheap.bins[bin], chunk, struct free_heap_chunk, node) {
+			size_t len = chunk->tag.len & ~HEAP_CHUNK_FREE;
+
+			ptr->heap_free += len;
 
-		if (chunk->len > ptr->heap_max_chunk) {
-			ptr->heap_max_chunk = chunk->len;
+			if (len > ptr->heap_max_chunk) {
+				ptr->heap_max_chunk = len;
+			}
 		}
 	}
 
@@ -517,14 +701,17 @@ void heap_init(void)
 	// create a mutex
 	mutex_init(&theheap.lock);
 
-	// initialize the free list
-	list_initialize(&theheap.free_list);
+	// initialize the free bins
+	uint bin;
+	for (bin = 0; bin < HEAP_BINS; bin++)
+		list_initialize(&theheap.bins[bin]);
+	memset(theheap.bin_bitmap, 0, sizeof(theheap.bin_bitmap));
 
 	// initialize the delayed free list
 	list_initialize(&theheap.delayed_free_list);
 
 	// create an initial free chunk
-	heap_insert_free_chunk(heap_create_free_chunk(theheap.base, theheap.len, false));
+	heap_add_block(theheap.base, theheap.len);
 
 	// dump heap info
 //	heap_dump();
@@ -536,7 +723,23 @@ void heap_init(void)
 /* add a new block of memory to the heap */
 void heap_add_block(void *ptr, size_t len)
 {
-	heap_insert_free_chunk(heap_create_free_chunk(ptr, len, false));
+	struct free_heap_chunk *chunk;
+	struct heap_chunk_tag *end;
+	vaddr_t base = ROUNDUP((vaddr_t)ptr, sizeof(void *));
+
+	if (len < (base - (vaddr_t)ptr) + sizeof(struct free_heap_chunk) + sizeof(struct heap_chunk_tag))
+		return;
+	len = (len - (base - (vaddr_t)ptr)) & ~(sizeof(void *) - 1);
+
+	// the block ends with an allocated tag so merging never walks past it
+	len -= sizeof(struct heap_chunk_tag);
+	end = (struct heap_chunk_tag *)(base + len);
+	end->prev_len = len;
+	end->len = sizeof(struct heap_chunk_tag);
+
+	chunk = heap_create_free_chunk((void *)base, len, false);
+	chunk->tag.prev_len = 0;
+	heap_insert_free_chunk(chunk);
 }
 
 #if LK_DEBUGLEVEL > 1
@@ -1,2 +1,14 @@
 LOCAL_DIR := $(GET_LOCAL_DIR)
 
+ASM_STRING_OPS := bcopy bzero memchr memcmp memcpy memmove memset strlen
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/memchr.S \
+	$(LOCAL_DIR)/memcmp.S \
+	$(LOCAL_DIR)/memcpy.S \
+	$(LOCAL_DIR)/memset.S \
+	$(LOCAL_DIR)/strlen.S
+
+# filter out the C implementation
+C_STRING_OPS := $(filter-out $(ASM_STRING_OPS),$(C_STRING_OPS))
+
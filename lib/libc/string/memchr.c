@@ -27,19 +27,37 @@
 #include <string.h>
 #include <sys/types.h>
 
+#define ONES	((size_t)-1 / 0xff)
+#define HIGHS	(ONES << 7)
+#define HAS_ZERO(x)	(((x) - ONES) & ~(x) & HIGHS)
+
 void *
 memchr(void const *buf, int c, size_t len)
 {
-	size_t i;
 	unsigned char const *b= buf;
 	unsigned char        x= (c&0xff);
+	size_t               pattern= x * ONES;
+	size_t               w;
+
+	for (; len > 0 && ((uintptr_t)b & (sizeof(size_t)-1)); b++, len--) {
+		if (*b== x) {
+			return (void*)b;
+		}
+	}
 
-	for (i= 0; i< len; i++) {
-		if (b[i]== x) {
-			return (void*)(b+i);
+	// whole words, stopping at the first one holding a match
+	for (; len >= sizeof(size_t); b+= sizeof(size_t), len-= sizeof(size_t)) {
+		w= *(const size_t *)b ^ pattern;
+		if (HAS_ZERO(w)) {
+			break;
+		}
+	}
+
+	for (; len > 0; b++, len--) {
+		if (*b== x) {
+			return (void*)b;
 		}
 	}
 
 	return NULL;
 }
-
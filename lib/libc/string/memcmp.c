@@ -30,11 +30,21 @@
 int
 memcmp(const void *cs, const void *ct, size_t count)
 {
-	const unsigned char *su1, *su2;
-	signed char res = 0;
+	const unsigned char *su1 = cs, *su2 = ct;
 
-	for (su1 = cs, su2 = ct; 0 < count; ++su1, ++su2, count--)
-		if ((res = *su1 - *su2) != 0)
-			break;
-	return res;
+	// skip matching words when both sides can be brought to alignment
+	if (!(((uintptr_t)su1 ^ (uintptr_t)su2) & (sizeof(size_t)-1))) {
+		for (; count > 0 && ((uintptr_t)su1 & (sizeof(size_t)-1)); ++su1, ++su2, count--)
+			if (*su1 != *su2)
+				return *su1 - *su2;
+
+		for (; count >= sizeof(size_t); su1 += sizeof(size_t), su2 += sizeof(size_t), count -= sizeof(size_t))
+			if (*(const size_t *)su1 != *(const size_t *)su2)
+				break;
+	}
+
+	for (; 0 < count; ++su1, ++su2, count--)
+		if (*su1 != *su2)
+			return *su1 - *su2;
+	return 0;
 }
@@ -27,15 +27,33 @@
 #include <string.h>
 #include <sys/types.h>
 
+/* 0x0101..01 and 0x8080..80 for the native word */
+#define ONES	((size_t)-1 / 0xff)
+#define HIGHS	(ONES << 7)
+
+/* nonzero if any byte of x is zero */
+#define HAS_ZERO(x)	(((x) - ONES) & ~(x) & HIGHS)
+
 size_t
 strlen(char const *s)
 {
-	size_t i;
+	const char *p = s;
+	const size_t *w;
 
-	i= 0;
-	while (s[i]) {
-		i+= 1;
+	for (; (uintptr_t)p & (sizeof(size_t) - 1); p++) {
+		if (!*p)
+			return p - s;
 	}
 
-	return i;
+	/*
+	 * a word at a time from here. an aligned word never crosses a page,
+	 * so reading past the terminator can't fault
+	 */
+	for (w = (const size_t *)p; !HAS_ZERO(*w); w++)
+		;
+
+	for (p = (const char *)w; *p; p++)
+		;
+
+	return p - s;
 }
@@ -0,0 +1,190 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <arm_neon.h>
+#include <lib/pixel.h>
+#if ARCH_arm64
+#include <arch/arm64.h>
+#else
+#include <arch/arm.h>
+#endif
+
+#include "../pixel_priv.h"
+
+/*
+ * NEON kernels, 8 or 16 pixels per step with the tail left to the C
+ * versions. Stores are element sized so that uncached framebuffer
+ * mappings never see an unaligned access. 32 bit pixels are taken apart
+ * with vld4, which puts b, g, r and a in val[0..3] on little endian.
+ */
+
+static void pixel_neon_fill16(uint16_t *dst, uint16_t color, size_t count)
+{
+	uint16x8_t c = vdupq_n_u16(color);
+
+	for (; count >= 16; count -= 16, dst += 16) {
+		vst1q_u16(dst, c);
+		vst1q_u16(dst + 8, c);
+	}
+
+	pixel_c_fill16(dst, color, count);
+}
+
+static void pixel_neon_fill32(uint32_t *dst, uint32_t color, size_t count)
+{
+	uint32x4_t c = vdupq_n_u32(color);
+
+	for (; count >= 8; count -= 8, dst += 8) {
+		vst1q_u32(dst, c);
+		vst1q_u32(dst + 4, c);
+	}
+
+	pixel_c_fill32(dst, color, count);
+}
+
+static void pixel_neon_blend32(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	const uint16x8_t one = vdupq_n_u16(1);
+	const uint16x8_t k254 = vdupq_n_u16(254);
+	const uint8x8_t zero = vdup_n_u8(0);
+	const uint8x8_t full = vdup_n_u8(255);
+
+	for (; count >= 8; count -= 8, dst += 8, src += 8) {
+		uint8x8x4_t s = vld4_u8((const uint8_t *)src);
+		uint8x8x4_t d = vld4_u8((const uint8_t *)dst);
+		uint8x8x4_t r;
+		uint16x8_t a = vmovl_u8(s.val[3]);
+		uint16x8_t sa = vaddq_u16(a, one);
+		/* wraps for a == 255, which takes the source anyway */
+		uint16x8_t da = vsubq_u16(k254, a);
+		uint8x8_t clear = vceq_u8(s.val[3], zero);
+		uint8x8_t opaque = vceq_u8(s.val[3], full);
+		int i;
+
+		for (i = 0; i < 3; i++) {
+			uint8x8_t c;
+
+			c = vadd_u8(vshrn_n_u16(vmulq_u16(vmovl_u8(s.val[i]), sa), 8),
+				    vshrn_n_u16(vmulq_u16(vmovl_u8(d.val[i]), da), 8));
+			c = vbsl_u8(opaque, s.val[i], c);
+			r.val[i] = vbsl_u8(clear, d.val[i], c);
+		}
+		r.val[3] = vbsl_u8(clear, d.val[3],
+				   vbsl_u8(opaque, s.val[3], vmovn_u16(sa)));
+
+		vst4_u8((uint8_t *)dst, r);
+	}
+
+	pixel_c_blend32(dst, src, count);
+}
+
+static void pixel_neon_rgb565_to_argb8888(uint32_t *dst, const uint16_t *src, size_t count)
+{
+	const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+	const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+
+	for (; count >= 8; count -= 8, dst += 8, src += 8) {
+		uint16x8_t p = vld1q_u16(src);
+		uint8x8_t r = vmovn_u16(vshrq_n_u16(p, 11));
+		uint8x8_t g = vmovn_u16(vandq_u16(vshrq_n_u16(p, 5), mask6));
+		uint8x8_t b = vmovn_u16(vandq_u16(p, mask5));
+		uint8x8x4_t o;
+
+		o.val[0] = vorr_u8(vshl_n_u8(b, 3), vshr_n_u8(b, 2));
+		o.val[1] = vorr_u8(vshl_n_u8(g, 2), vshr_n_u8(g, 4));
+		o.val[2] = vorr_u8(vshl_n_u8(r, 3), vshr_n_u8(r, 2));
+		o.val[3] = vdup_n_u8(0xff);
+
+		vst4_u8((uint8_t *)dst, o);
+	}
+
+	pixel_c_rgb565_to_argb8888(dst, src, count);
+}
+
+static void pixel_neon_argb8888_to_rgb565(uint16_t *dst, const uint32_t *src, size_t count)
+{
+	for (; count >= 8; count -= 8, dst += 8, src += 8) {
+		uint8x8x4_t p = vld4_u8((const uint8_t *)src);
+		uint16x8_t o;
+
+		o = vshlq_n_u16(vmovl_u8(vshr_n_u8(p.val[2], 3)), 11);
+		o = vorrq_u16(o, vshlq_n_u16(vmovl_u8(vshr_n_u8(p.val[1], 2)), 5));
+		o = vorrq_u16(o, vmovl_u8(vshr_n_u8(p.val[0], 3)));
+
+		vst1q_u16(dst, o);
+	}
+
+	pixel_c_argb8888_to_rgb565(dst, src, count);
+}
+
+static void pixel_neon_swap_rgb888(uint8_t *buf, size_t count)
+{
+	for (; count >= 16; count -= 16, buf += 48) {
+		uint8x16x3_t v = vld3q_u8(buf);
+		uint8x16_t t = v.val[0];
+
+		v.val[0] = v.val[2];
+		v.val[2] = t;
+		vst3q_u8(buf, v);
+	}
+
+	pixel_c_swap_rgb888(buf, count);
+}
+
+static const struct pixel_ops pixel_ops_neon = {
+	.name = "neon",
+	.fill16 = pixel_neon_fill16,
+	.fill32 = pixel_neon_fill32,
+	.blend32 = pixel_neon_blend32,
+	.rgb565_to_argb8888 = pixel_neon_rgb565_to_argb8888,
+	.argb8888_to_rgb565 = pixel_neon_argb8888_to_rgb565,
+	.swap_rgb888 = pixel_neon_swap_rgb888,
+};
+
+const struct pixel_ops *pixel_neon_probe(void)
+{
+#if ARCH_arm64
+	/* AdvSIMD field of ID_AA64PFR0_EL1, 0xf if not implemented */
+	if (((ARM64_READ_SYSREG(id_aa64pfr0_el1) >> 20) & 0xf) == 0xf)
+		return NULL;
+#else
+	uint32_t mvfr1;
+
+	/* cp10/cp11 access reads back as zero without a vfp to enable */
+	if (!(arm_read_cpacr() & (0xf << 20)))
+		return NULL;
+
+	/* Advanced SIMD load/store and integer fields */
+	__asm__ volatile("vmrs %0, mvfr1" : "=r" (mvfr1));
+	if (!(mvfr1 & 0xf00) || !(mvfr1 & 0xf000))
+		return NULL;
+#endif
+
+	return &pixel_ops_neon;
+}
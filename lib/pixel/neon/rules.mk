@@ -0,0 +1,14 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/pixel_neon.c
+
+# the rest of the tree is built for plain vfp, see arch/arm/rules.mk;
+# pixel_neon_probe() keeps these off cores without the simd unit
+ifeq ($(ARCH),arm)
+MODULE_COMPILEFLAGS += -mfpu=neon
+endif
+
+include make/module.mk
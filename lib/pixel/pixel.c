@@ -0,0 +1,113 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <lib/pixel.h>
+
+#include "pixel_priv.h"
+
+void pixel_c_fill16(uint16_t *dst, uint16_t color, size_t count)
+{
+	while (count--)
+		*dst++ = color;
+}
+
+void pixel_c_fill32(uint32_t *dst, uint32_t color, size_t count)
+{
+	while (count--)
+		*dst++ = color;
+}
+
+void pixel_c_blend32(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	for (; count; count--, dst++, src++)
+		*dst = pixel_blend_one(*dst, *src);
+}
+
+void pixel_c_rgb565_to_argb8888(uint32_t *dst, const uint16_t *src, size_t count)
+{
+	while (count--)
+		*dst++ = pixel_rgb565_to_argb8888_one(*src++);
+}
+
+void pixel_c_argb8888_to_rgb565(uint16_t *dst, const uint32_t *src, size_t count)
+{
+	while (count--)
+		*dst++ = pixel_argb8888_to_rgb565_one(*src++);
+}
+
+void pixel_c_swap_rgb888(uint8_t *buf, size_t count)
+{
+	uint8_t t;
+
+	for (; count; count--, buf += 3) {
+		t = buf[0];
+		buf[0] = buf[2];
+		buf[2] = t;
+	}
+}
+
+const struct pixel_ops pixel_ops_c = {
+	.name = "c",
+	.fill16 = pixel_c_fill16,
+	.fill32 = pixel_c_fill32,
+	.blend32 = pixel_c_blend32,
+	.rgb565_to_argb8888 = pixel_c_rgb565_to_argb8888,
+	.argb8888_to_rgb565 = pixel_c_argb8888_to_rgb565,
+	.swap_rgb888 = pixel_c_swap_rgb888,
+};
+
+static const struct pixel_ops *pixel_ops;
+
+/* racing first callers all come up with the same answer */
+const struct pixel_ops *pixel_get_ops(void)
+{
+	const struct pixel_ops *ops = pixel_ops;
+
+	if (ops)
+		return ops;
+
+#if PIXEL_NEON
+	ops = pixel_neon_probe();
+#endif
+#if PIXEL_SSE2
+	ops = pixel_sse2_probe();
+#endif
+	if (!ops)
+		ops = &pixel_ops_c;
+
+	dprintf(SPEW, "pixel: using %s kernels\n", ops->name);
+	pixel_ops = ops;
+
+	return ops;
+}
+
+void pixel_set_ops(const struct pixel_ops *ops)
+{
+	pixel_ops = ops;
+}
@@ -0,0 +1,88 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __PIXEL_PRIV_H
+#define __PIXEL_PRIV_H
+
+#include <lib/pixel.h>
+
+/* the per pixel definitions every implementation has to agree with */
+
+static inline uint32_t pixel_blend_one(uint32_t dst, uint32_t src)
+{
+	uint32_t a = src >> 24;
+	uint32_t sa, da;
+
+	if (a == 0)
+		return dst;
+	if (a == 255)
+		return src;
+
+	/* same weights as gfx's alpha32_add_ignore_destalpha */
+	sa = a + 1;
+	da = 255 - sa;
+
+	return (sa << 24) |
+	       ((((src >> 16) & 0xff) * sa / 256 + ((dst >> 16) & 0xff) * da / 256) << 16) |
+	       ((((src >> 8) & 0xff) * sa / 256 + ((dst >> 8) & 0xff) * da / 256) << 8) |
+	       (((src & 0xff) * sa / 256 + (dst & 0xff) * da / 256));
+}
+
+static inline uint32_t pixel_rgb565_to_argb8888_one(uint16_t in)
+{
+	uint32_t r = (in >> 11) & 0x1f;
+	uint32_t g = (in >> 5) & 0x3f;
+	uint32_t b = in & 0x1f;
+
+	/* replicate the top bits so that white stays white */
+	r = (r << 3) | (r >> 2);
+	g = (g << 2) | (g >> 4);
+	b = (b << 3) | (b >> 2);
+
+	return 0xff000000 | (r << 16) | (g << 8) | b;
+}
+
+static inline uint16_t pixel_argb8888_to_rgb565_one(uint32_t in)
+{
+	return ((in >> 3) & 0x1f) |
+	       (((in >> 10) & 0x3f) << 5) |
+	       (((in >> 19) & 0x1f) << 11);
+}
+
+void pixel_c_fill16(uint16_t *dst, uint16_t color, size_t count);
+void pixel_c_fill32(uint32_t *dst, uint32_t color, size_t count);
+void pixel_c_blend32(uint32_t *dst, const uint32_t *src, size_t count);
+void pixel_c_rgb565_to_argb8888(uint32_t *dst, const uint16_t *src, size_t count);
+void pixel_c_argb8888_to_rgb565(uint16_t *dst, const uint32_t *src, size_t count);
+void pixel_c_swap_rgb888(uint8_t *buf, size_t count);
+
+/* return the accelerated ops if the cpu can run them, NULL otherwise */
+const struct pixel_ops *pixel_neon_probe(void);
+const struct pixel_ops *pixel_sse2_probe(void);
+
+#endif
@@ -0,0 +1,25 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/pixel.c
+
+# the simd kernels need their own compile flags, so they live in
+# submodules that are only pulled in where they can be built
+ifeq ($(ARCH),arm)
+ifneq ($(filter cortex-a%,$(ARM_CPU)),)
+MODULE_DEPS += $(LOCAL_DIR)/neon
+MODULE_DEFINES += PIXEL_NEON=1
+endif
+endif
+ifeq ($(ARCH),arm64)
+MODULE_DEPS += $(LOCAL_DIR)/neon
+MODULE_DEFINES += PIXEL_NEON=1
+endif
+ifneq ($(filter x86 x86-64,$(ARCH)),)
+MODULE_DEPS += $(LOCAL_DIR)/sse2
+MODULE_DEFINES += PIXEL_SSE2=1
+endif
+
+include make/module.mk
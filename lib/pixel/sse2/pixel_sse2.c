@@ -0,0 +1,189 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <emmintrin.h>
+#include <lib/pixel.h>
+
+#include "../pixel_priv.h"
+
+/*
+ * SSE2 kernels, 4 or 8 pixels per step with the tail left to the C
+ * versions. SSE2 has no byte shuffle, so the RGB888 swap stays in C.
+ */
+
+static void pixel_sse2_fill16(uint16_t *dst, uint16_t color, size_t count)
+{
+	__m128i c = _mm_set1_epi16(color);
+
+	for (; count >= 16; count -= 16, dst += 16) {
+		_mm_storeu_si128((__m128i *)dst, c);
+		_mm_storeu_si128((__m128i *)(dst + 8), c);
+	}
+
+	pixel_c_fill16(dst, color, count);
+}
+
+static void pixel_sse2_fill32(uint32_t *dst, uint32_t color, size_t count)
+{
+	__m128i c = _mm_set1_epi32(color);
+
+	for (; count >= 8; count -= 8, dst += 8) {
+		_mm_storeu_si128((__m128i *)dst, c);
+		_mm_storeu_si128((__m128i *)(dst + 4), c);
+	}
+
+	pixel_c_fill32(dst, color, count);
+}
+
+/* the three colour channels of two pixels, widened to 16 bits */
+static inline __m128i pixel_sse2_blend2(__m128i s, __m128i d)
+{
+	const __m128i one = _mm_set1_epi16(1);
+	const __m128i k254 = _mm_set1_epi16(254);
+	__m128i a, sa, da;
+
+	/* broadcast each pixel's alpha over its four lanes */
+	a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xff), 0xff);
+	sa = _mm_add_epi16(a, one);
+	da = _mm_sub_epi16(k254, a);
+
+	return _mm_add_epi16(_mm_srli_epi16(_mm_mullo_epi16(s, sa), 8),
+			     _mm_srli_epi16(_mm_mullo_epi16(d, da), 8));
+}
+
+static void pixel_sse2_blend32(uint32_t *dst, const uint32_t *src, size_t count)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i full = _mm_set1_epi32(255);
+
+	for (; count >= 4; count -= 4, dst += 4, src += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)src);
+		__m128i d = _mm_loadu_si128((const __m128i *)dst);
+		__m128i a = _mm_srli_epi32(s, 24);
+		__m128i clear = _mm_cmpeq_epi32(a, zero);
+		__m128i opaque = _mm_cmpeq_epi32(a, full);
+		__m128i r;
+
+		r = _mm_packus_epi16(pixel_sse2_blend2(_mm_unpacklo_epi8(s, zero),
+						       _mm_unpacklo_epi8(d, zero)),
+				     pixel_sse2_blend2(_mm_unpackhi_epi8(s, zero),
+						       _mm_unpackhi_epi8(d, zero)));
+		r = _mm_or_si128(_mm_and_si128(r, rgb),
+				 _mm_slli_epi32(_mm_add_epi32(a, one), 24));
+
+		r = _mm_or_si128(_mm_and_si128(opaque, s), _mm_andnot_si128(opaque, r));
+		r = _mm_or_si128(_mm_and_si128(clear, d), _mm_andnot_si128(clear, r));
+
+		_mm_storeu_si128((__m128i *)dst, r);
+	}
+
+	pixel_c_blend32(dst, src, count);
+}
+
+static void pixel_sse2_rgb565_to_argb8888(uint32_t *dst, const uint16_t *src, size_t count)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1f);
+	const __m128i mask6 = _mm_set1_epi16(0x3f);
+	const __m128i alpha = _mm_set1_epi16(0xff00);
+
+	for (; count >= 8; count -= 8, dst += 8, src += 8) {
+		__m128i p = _mm_loadu_si128((const __m128i *)src);
+		__m128i r = _mm_srli_epi16(p, 11);
+		__m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask6);
+		__m128i b = _mm_and_si128(p, mask5);
+		__m128i ar, gb;
+
+		r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+		g = _mm_or_si128(_mm_slli_epi16(g, 2), _mm_srli_epi16(g, 4));
+		b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+		ar = _mm_or_si128(alpha, r);
+		gb = _mm_or_si128(_mm_slli_epi16(g, 8), b);
+
+		_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(gb, ar));
+		_mm_storeu_si128((__m128i *)(dst + 4), _mm_unpackhi_epi16(gb, ar));
+	}
+
+	pixel_c_rgb565_to_argb8888(dst, src, count);
+}
+
+static inline __m128i pixel_sse2_to_rgb565(__m128i p)
+{
+	__m128i o;
+
+	o = _mm_and_si128(_mm_srli_epi32(p, 3), _mm_set1_epi32(0x001f));
+	o = _mm_or_si128(o, _mm_and_si128(_mm_srli_epi32(p, 5), _mm_set1_epi32(0x07e0)));
+	o = _mm_or_si128(o, _mm_and_si128(_mm_srli_epi32(p, 8), _mm_set1_epi32(0xf800)));
+
+	/* sign extend so the signed saturating pack keeps all 16 bits */
+	return _mm_srai_epi32(_mm_slli_epi32(o, 16), 16);
+}
+
+static void pixel_sse2_argb8888_to_rgb565(uint16_t *dst, const uint32_t *src, size_t count)
+{
+	for (; count >= 8; count -= 8, dst += 8, src += 8) {
+		__m128i lo = _mm_loadu_si128((const __m128i *)src);
+		__m128i hi = _mm_loadu_si128((const __m128i *)(src + 4));
+
+		_mm_storeu_si128((__m128i *)dst,
+				 _mm_packs_epi32(pixel_sse2_to_rgb565(lo),
+						 pixel_sse2_to_rgb565(hi)));
+	}
+
+	pixel_c_argb8888_to_rgb565(dst, src, count);
+}
+
+static const struct pixel_ops pixel_ops_sse2 = {
+	.name = "sse2",
+	.fill16 = pixel_sse2_fill16,
+	.fill32 = pixel_sse2_fill32,
+	.blend32 = pixel_sse2_blend32,
+	.rgb565_to_argb8888 = pixel_sse2_rgb565_to_argb8888,
+	.argb8888_to_rgb565 = pixel_sse2_argb8888_to_rgb565,
+	.swap_rgb888 = pixel_c_swap_rgb888,
+};
+
+const struct pixel_ops *pixel_sse2_probe(void)
+{
+	uint32_t eax = 1, ebx, ecx, edx;
+	unsigned long cr4;
+
+	__asm__ volatile("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+	if (!(edx & (1 << 26)))
+		return NULL;
+
+	/* sse instructions fault until the OS has set CR4.OSFXSR */
+	__asm__ volatile("mov %%cr4, %0" : "=r" (cr4));
+	if (!(cr4 & (1 << 9)))
+		return NULL;
+
+	return &pixel_ops_sse2;
+}
@@ -0,0 +1,11 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+MODULE := $(LOCAL_DIR)
+
+MODULE_SRCS += \
+	$(LOCAL_DIR)/pixel_sse2.c
+
+# 32 bit x86 builds don't assume sse2; pixel_sse2_probe() checks for it
+MODULE_COMPILEFLAGS += -msse2
+
+include make/module.mk
@@ -0,0 +1,284 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <trace.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <pow2.h>
+#include <arch/defines.h>
+#include <kernel/thread.h>
+#include <lib/pool.h>
+#include <lib/console.h>
+
+#define LOCAL_TRACE 0
+
+/* slabs are sized to hold at least POOL_SLAB_MIN_OBJS objects */
+#define POOL_SLAB_SIZE      4096
+#define POOL_SLAB_MIN_OBJS  4
+
+#define POOL_POISON_FREE    0xdb
+#define POOL_POISON_ALLOC   0xa5
+
+/* header at the start of every slab, the objects follow it */
+struct pool_slab {
+	struct pool_slab *next;
+	uint count;
+};
+
+static struct list_node pool_list = LIST_INITIAL_VALUE(pool_list);
+
+#if POOL_STATS
+#define POOL_STAT_INC(pool, field) ((pool)->stats.field++)
+#else
+#define POOL_STAT_INC(pool, field) do { } while (0)
+#endif
+
+/* settle the object size and alignment, a static initializer leaves it to the first grow */
+static void pool_setup(pool_t *pool)
+{
+	if (pool->align < sizeof(void *))
+		pool->align = sizeof(void *);
+
+	if (pool->flags & POOL_FLAG_DMA) {
+		if (pool->align < CACHE_LINE)
+			pool->align = CACHE_LINE;
+	}
+
+	/* the free list link lives in the object itself */
+	if (pool->obj_size < sizeof(void *))
+		pool->obj_size = sizeof(void *);
+
+	pool->obj_size = ROUNDUP(pool->obj_size, pool->align);
+
+	enter_critical_section();
+	if (!list_in_list(&pool->node))
+		list_add_tail(&pool_list, &pool->node);
+	exit_critical_section();
+}
+
+void pool_init(pool_t *pool, const char *name, size_t obj_size, size_t align, uint flags)
+{
+	DEBUG_ASSERT(pool);
+	DEBUG_ASSERT(!align || ispow2(align));
+
+	memset(pool, 0, sizeof(*pool));
+	pool->name = name;
+	pool->obj_size = obj_size;
+	pool->align = align;
+	pool->flags = flags;
+
+	pool_setup(pool);
+}
+
+static void pool_poison(pool_t *pool, void *obj)
+{
+	memset((uint8_t *)obj + sizeof(void *), POOL_POISON_FREE, pool->obj_size - sizeof(void *));
+}
+
+static void pool_check_poison(pool_t *pool, void *obj)
+{
+	uint8_t *p = (uint8_t *)obj + sizeof(void *);
+	size_t i;
+
+	for (i = 0; i < pool->obj_size - sizeof(void *); i++) {
+		if (p[i] != POOL_POISON_FREE)
+			panic("pool %s: object %p written after free at offset %zu\n",
+			      pool->name, obj, i + sizeof(void *));
+	}
+}
+
+/* add a slab worth of objects to the free list */
+static int pool_grow(pool_t *pool)
+{
+	struct pool_slab *slab;
+	size_t hdr;
+	size_t len;
+	uint count;
+	uint i;
+	uint8_t *obj;
+
+	if (!list_in_list(&pool->node))
+		pool_setup(pool);
+
+	hdr = ROUNDUP(sizeof(struct pool_slab), pool->align);
+	count = (POOL_SLAB_SIZE - hdr) / pool->obj_size;
+	if (count < POOL_SLAB_MIN_OBJS)
+		count = POOL_SLAB_MIN_OBJS;
+	len = hdr + count * pool->obj_size;
+
+	slab = memalign(pool->align, len);
+	if (!slab)
+		return -1;
+
+	LTRACEF("pool %s slab %p, %u objects of %zu\n", pool->name, slab, count, pool->obj_size);
+
+	slab->count = count;
+
+	/* chain the objects in address order */
+	obj = (uint8_t *)slab + hdr;
+	for (i = 0; i < count; i++, obj += pool->obj_size) {
+		if (pool->flags & POOL_FLAG_POISON)
+			pool_poison(pool, obj);
+		*(void **)obj = (i + 1 < count) ? obj + pool->obj_size : NULL;
+	}
+
+	enter_critical_section();
+	*(void **)(obj - pool->obj_size) = pool->free_list;
+	pool->free_list = (uint8_t *)slab + hdr;
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+	POOL_STAT_INC(pool, slabs);
+	exit_critical_section();
+
+	return 0;
+}
+
+void *pool_alloc(pool_t *pool)
+{
+	void *obj;
+
+	DEBUG_ASSERT(pool);
+
+	for (;;) {
+		enter_critical_section();
+		obj = pool->free_list;
+		if (obj) {
+			pool->free_list = *(void **)obj;
+#if POOL_STATS
+			pool->stats.allocs++;
+			if (++pool->stats.in_use > pool->stats.peak)
+				pool->stats.peak = pool->stats.in_use;
+#endif
+		}
+		exit_critical_section();
+
+		if (obj)
+			break;
+
+		if (pool_grow(pool))
+			return NULL;
+	}
+
+	if (pool->flags & POOL_FLAG_POISON) {
+		pool_check_poison(pool, obj);
+		memset(obj, POOL_POISON_ALLOC, pool->obj_size);
+	}
+
+	return obj;
+}
+
+void *pool_zalloc(pool_t *pool)
+{
+	void *obj = pool_alloc(pool);
+
+	if (obj)
+		memset(obj, 0, pool->obj_size);
+
+	return obj;
+}
+
+void pool_free(pool_t *pool, void *obj)
+{
+	DEBUG_ASSERT(pool);
+
+	if (!obj)
+		return;
+
+	if (pool->flags & POOL_FLAG_POISON)
+		pool_poison(pool, obj);
+
+	enter_critical_section();
+	*(void **)obj = pool->free_list;
+	pool->free_list = obj;
+#if POOL_STATS
+	pool->stats.frees++;
+	pool->stats.in_use--;
+#endif
+	exit_critical_section();
+}
+
+void pool_destroy(pool_t *pool)
+{
+	struct pool_slab *slab;
+
+	DEBUG_ASSERT(pool);
+
+#if POOL_STATS
+	if (pool->stats.in_use)
+		printf("warning: destroying pool %s with %u objects in use\n",
+		       pool->name, pool->stats.in_use);
+#endif
+
+	enter_critical_section();
+	if (list_in_list(&pool->node))
+		list_delete(&pool->node);
+	exit_critical_section();
+
+	while ((slab = pool->slabs)) {
+		pool->slabs = slab->next;
+		free(slab);
+	}
+	pool->free_list = NULL;
+}
+
+void pool_dump(pool_t *pool)
+{
+	printf("%s: obj_size=%zu align=%zu flags=0x%x",
+	       pool->name, pool->obj_size, pool->align, pool->flags);
+#if POOL_STATS
+	printf(" allocs=%u frees=%u in_use=%u peak=%u slabs=%u",
+	       pool->stats.allocs, pool->stats.frees, pool->stats.in_use,
+	       pool->stats.peak, pool->stats.slabs);
+#endif
+	printf("\n");
+}
+
+#if defined(WITH_LIB_CONSOLE)
+
+static int cmd_pool(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+STATIC_COMMAND("pool", "object pool statistics", &cmd_pool)
+STATIC_COMMAND_END(pool);
+
+static int cmd_pool(int argc, const cmd_args *argv)
+{
+	pool_t *pool;
+
+	list_for_every_entry(&pool_list, pool, pool_t, node) {
+		pool_dump(pool);
+	}
+
+	return 0;
+}
+
+#endif
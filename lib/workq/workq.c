@@ -0,0 +1,356 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <trace.h>
+#include <assert.h>
+#include <err.h>
+#include <stdio.h>
+#include <limits.h>
+#include <list.h>
+#include <arch/ops.h>
+#include <kernel/thread.h>
+#include <kernel/event.h>
+#include <kernel/mp.h>
+#include <lib/pool.h>
+#include <lib/workq.h>
+#include <lib/console.h>
+#include <lk/init.h>
+
+#define LOCAL_TRACE 0
+
+/* parallel_for splits the range into this many pieces per worker by default */
+#define PARALLEL_FOR_CHUNKS_PER_WORKER 4
+
+struct workq_task {
+	struct list_node node;
+	workq_callback cb;
+	void *arg;
+	workq_group_t *group;
+};
+
+struct workq_worker {
+	struct list_node queue;
+	event_t event;
+	thread_t *thread;
+	bool idle;
+	uint32_t executed;
+	uint32_t stolen;
+};
+
+/* indexed by cpu, a worker without a thread was never started */
+static struct workq_worker workers[SMP_MAX_CPUS];
+static uint workq_workers;
+
+static pool_t task_pool = POOL_INITIAL_VALUE(task_pool, "workq", sizeof(struct workq_task), 0, 0);
+
+static struct workq_worker *workq_local_worker(void)
+{
+	struct workq_worker *w = &workers[arch_curr_cpu_num()];
+
+	return w->thread ? w : &workers[0];
+}
+
+/* wake an idle worker, other cpus first since the caller keeps this one busy */
+static void workq_wake_one(struct workq_worker *local)
+{
+	uint start = local - workers;
+
+	for (uint i = 1; i <= SMP_MAX_CPUS; i++) {
+		struct workq_worker *w = &workers[(start + i) % SMP_MAX_CPUS];
+
+		if (w->thread && w->idle) {
+			w->idle = false;
+			event_signal(&w->event, false);
+			return;
+		}
+	}
+}
+
+/* take from the head of our own queue, else steal from the tail of another */
+static struct workq_task *workq_dequeue(struct workq_worker *self)
+{
+	struct workq_task *task;
+	uint start = self - workers;
+
+	task = list_remove_head_type(&self->queue, struct workq_task, node);
+	if (task)
+		return task;
+
+	for (uint i = 1; i < SMP_MAX_CPUS; i++) {
+		struct workq_worker *w = &workers[(start + i) % SMP_MAX_CPUS];
+
+		if (!w->thread)
+			continue;
+
+		task = list_remove_tail_type(&w->queue, struct workq_task, node);
+		if (task) {
+			self->stolen++;
+			return task;
+		}
+	}
+
+	return NULL;
+}
+
+static void workq_run(struct workq_task *task)
+{
+	workq_group_t *group = task->group;
+
+	LTRACEF("task %p cb %p arg %p\n", task, task->cb, task->arg);
+
+	task->cb(task->arg);
+
+	enter_critical_section();
+	pool_free(&task_pool, task);
+	if (group && --group->pending == 0)
+		event_signal(&group->done, false);
+	exit_critical_section();
+}
+
+static int workq_worker_routine(void *arg)
+{
+	struct workq_worker *self = arg;
+	struct workq_task *task;
+
+	for (;;) {
+		enter_critical_section();
+		task = workq_dequeue(self);
+		if (task)
+			self->executed++;
+		else
+			self->idle = true;
+		exit_critical_section();
+
+		if (task)
+			workq_run(task);
+		else
+			event_wait(&self->event);
+	}
+
+	return 0;
+}
+
+void workq_group_init(workq_group_t *group)
+{
+	group->pending = 0;
+	event_init(&group->done, true, 0);
+}
+
+void workq_group_wait(workq_group_t *group)
+{
+	struct workq_task *task;
+
+	for (;;) {
+		enter_critical_section();
+		if (group->pending == 0) {
+			exit_critical_section();
+			break;
+		}
+		task = workq_dequeue(workq_local_worker());
+		exit_critical_section();
+
+		if (task)
+			workq_run(task);
+		else
+			event_wait(&group->done);
+	}
+}
+
+status_t workq_submit(workq_group_t *group, workq_callback cb, void *arg)
+{
+	struct workq_task *task;
+	struct workq_worker *w;
+
+	/* before the workers are up there is nobody to hand it to */
+	if (workq_workers == 0) {
+		cb(arg);
+		return NO_ERROR;
+	}
+
+	task = pool_alloc(&task_pool);
+	if (!task)
+		return ERR_NO_MEMORY;
+
+	task->cb = cb;
+	task->arg = arg;
+	task->group = group;
+
+	enter_critical_section();
+	if (group && group->pending++ == 0)
+		event_unsignal(&group->done);
+	w = workq_local_worker();
+	list_add_tail(&w->queue, &task->node);
+	workq_wake_one(w);
+	exit_critical_section();
+
+	return NO_ERROR;
+}
+
+uint workq_num_workers(void)
+{
+	return workq_workers;
+}
+
+struct parallel_for_state {
+	volatile int next;
+	uint count;
+	size_t start;
+	size_t end;
+	size_t chunk;
+	parallel_for_callback cb;
+	void *arg;
+};
+
+/* every participant pulls chunk indices until the range is used up */
+static void parallel_for_work(void *arg)
+{
+	struct parallel_for_state *s = arg;
+	uint i;
+
+	while ((i = atomic_add(&s->next, 1)) < s->count) {
+		size_t lo = s->start + i * s->chunk;
+		size_t hi = (s->end - lo > s->chunk) ? lo + s->chunk : s->end;
+
+		s->cb(lo, hi, s->arg);
+	}
+}
+
+void parallel_for(size_t start, size_t end, size_t chunk,
+                  parallel_for_callback cb, void *arg)
+{
+	struct parallel_for_state s;
+	workq_group_t group;
+	uint workers = workq_workers ? workq_workers : 1;
+	uint helpers;
+	size_t len;
+
+	if (end <= start)
+		return;
+
+	len = end - start;
+	if (chunk == 0) {
+		chunk = len / (workers * PARALLEL_FOR_CHUNKS_PER_WORKER);
+		if (chunk == 0)
+			chunk = 1;
+	}
+
+	s.next = 0;
+	s.count = len / chunk + ((len % chunk) ? 1 : 0);
+	s.start = start;
+	s.end = end;
+	s.chunk = chunk;
+	s.cb = cb;
+	s.arg = arg;
+	DEBUG_ASSERT(s.count <= INT_MAX);
+
+	/* the calling thread takes a share too */
+	helpers = workers - 1;
+	if (helpers > s.count - 1)
+		helpers = s.count - 1;
+
+	workq_group_init(&group);
+	for (uint i = 0; i < helpers; i++) {
+		if (workq_submit(&group, parallel_for_work, &s) < 0)
+			break;
+	}
+
+	parallel_for_work(&s);
+
+	workq_group_wait(&group);
+	event_destroy(&group.done);
+}
+
+static void workq_init(uint level)
+{
+	char name[32];
+
+	/* one worker per cpu that made it up, pinned so the stealing stays local */
+	for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+		struct workq_worker *w = &workers[cpu];
+		thread_t *t;
+
+		if (!mp_is_cpu_active(cpu))
+			continue;
+
+		list_initialize(&w->queue);
+		event_init(&w->event, false, EVENT_FLAG_AUTOUNSIGNAL);
+
+		snprintf(name, sizeof(name), "workq %u", cpu);
+		t = thread_create(name, &workq_worker_routine, w, DEFAULT_PRIORITY, DEFAULT_STACK_SIZE);
+		if (!t) {
+			dprintf(CRITICAL, "workq: failed to create worker for cpu %u\n", cpu);
+			continue;
+		}
+		thread_set_pinned_cpu(t, cpu);
+
+		enter_critical_section();
+		w->thread = t;
+		workq_workers++;
+		exit_critical_section();
+
+		thread_detach_and_resume(t);
+	}
+
+	dprintf(INFO, "workq: %u workers\n", workq_workers);
+}
+
+/* after mp_start_secondary_cpus, so every cpu gets a worker */
+LK_INIT_HOOK(libworkq, &workq_init, LK_INIT_LEVEL_PLATFORM);
+
+#if defined(WITH_LIB_CONSOLE)
+
+static int cmd_workq(int argc, const cmd_args *argv);
+
+STATIC_COMMAND_START
+STATIC_COMMAND("workq", "work queue statistics", &cmd_workq)
+STATIC_COMMAND_END(workq);
+
+static int cmd_workq(int argc, const cmd_args *argv)
+{
+	for (uint cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+		struct workq_worker *w = &workers[cpu];
+		struct list_node *node;
+		uint queued = 0;
+
+		if (!w->thread)
+			continue;
+
+		enter_critical_section();
+		list_for_every(&w->queue, node)
+			queued++;
+		exit_critical_section();
+
+		printf("cpu %u: queued %u executed %u stolen %u%s\n",
+		       cpu, queued, w->executed, w->stolen, w->idle ? " idle" : "");
+	}
+
+	return 0;
+}
+
+#endif
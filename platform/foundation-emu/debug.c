@@ -42,7 +42,9 @@ uint32_t semihost_call(uint64_t op, void *ptr);
 
 void platform_dputc(char c)
 {
+#if !PLATFORM_QEMU_VIRT
     semihost_call(SEMIHOST_WRITEC, (void *)&c);
+#endif
 
     if (c == '\n')
         UARTREG(DR) = '\r';
@@ -78,7 +80,9 @@ void platform_init_debug(void)
 void platform_halt(void)
 {
     arch_disable_ints();
+#if !PLATFORM_QEMU_VIRT
     *REG32(SYSREG_CONTROL) = 0xc0800000;
+#endif
     for (;;);
 }
 
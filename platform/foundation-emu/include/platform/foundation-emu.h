@@ -4,6 +4,14 @@
 #include <reg.h>
 
 /* memory map */
+#if PLATFORM_QEMU_VIRT
+/* QEMU's virt machine has the same pl011, gic-400 and generic timer at
+ * different addresses, and none of the versatile express system registers.
+ */
+#define UART0_BASE        (0x09000000)
+#define GIC_DISTRIB_BASE  (0x08000000)
+#define GIC_PROC_BASE     (0x08010000)
+#else
 #define NOR0_BASE       (0x08000000)
 #define NOR1_BASE       (0x0c000000)
 #define ETH_BASE        (0x1a000000)
@@ -30,6 +38,7 @@
 #define GIC_PROC_HYP_BASE (0x2c004000)
 #define GIC_HYP_BASE      (0x2c005000)
 #define GIC_VCPU_BASE     (0x2c006000)
+#endif
 
 /* interrupts */
 #define INT_PPI_VMAINT       (16+9)
@@ -42,6 +51,7 @@
 
 #define MAX_INT 96
 
+#if !PLATFORM_QEMU_VIRT
 /* system control registers */
 #define SYSREG_ID       (SYSREG_BASE + 0x00)
 #define SYSREG_SWITCH   (SYSREG_BASE + 0x04)
@@ -65,4 +75,5 @@ static inline void shutdown(void)
     *REG32(SYSREG_CONTROL) = 0xc0800000;
     for (;;);
 }
+#endif
 
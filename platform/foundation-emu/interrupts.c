@@ -27,6 +27,7 @@
 #include <reg.h>
 #include <kernel/thread.h>
 #include <kernel/debug.h>
+#include <kernel/mp.h>
 #include <platform/interrupts.h>
 #include <arch/ops.h>
 #include <arch/arm64.h>
@@ -126,6 +127,11 @@ void platform_init_interrupts(void)
     GICDISTREG(DISTCONTROL) = 1; // enable GIC0, IRQ only
     GICCPUREG(CONTROL) = (0<<3)|(0<<2)||1; // enable GIC0, IRQ only, group 0 set to IRQ
 
+#if WITH_SMP
+    register_int_handler(MP_IPI_SGI_BASE + MP_IPI_RESCHEDULE, &mp_mbx_reschedule_irq, NULL);
+    register_int_handler(MP_IPI_SGI_BASE + MP_IPI_TICK, &mp_mbx_tick_irq, NULL);
+#endif
+
 #if 0
     hexdump((void *)GIC_PROC_BASE, 0x20);
     hexdump((void *)GIC_DISTRIB_BASE, 0x10);
@@ -151,6 +157,30 @@ void platform_init_interrupts(void)
 #endif
 }
 
+#if WITH_SMP
+/* the sgi/ppi enables and priorities are banked, so each cpu sets up its own */
+void platform_mp_init_percpu(void)
+{
+    GICDISTREG(CLRENABLE) = 0xffff0000;
+    GICDISTREG(SETENABLE) = 0x0000ffff;
+
+    for (int i = 0; i < 32 / 4; i++) {
+        GICDISTREG(PRIORITY + i * 4) = 0x80808080;
+    }
+
+    GICCPUREG(PMR) = 0xf0;
+    GICCPUREG(CONTROL) = 1;
+}
+
+status_t platform_mp_send_ipi(mp_cpu_mask_t target, mp_ipi_t ipi)
+{
+    /* target list filter 0: deliver to the cpus in the target list */
+    GICDISTREG(SGIR) = ((target & 0xff) << 16) | (MP_IPI_SGI_BASE + ipi);
+
+    return NO_ERROR;
+}
+#endif
+
 status_t mask_interrupt(unsigned int vector)
 {
     if (vector >= MAX_INT)
@@ -43,7 +43,9 @@ void platform_early_init(void)
 
 void platform_init(void)
 {
+#if !PLATFORM_QEMU_VIRT
     /* add the rest of the 6GB of ram */
     heap_add_block((void *)0x880000000ULL, 0x180000000ULL);
+#endif
 }
 
@@ -18,9 +18,18 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/timer.c \
 	$(LOCAL_DIR)/semihost.S
 
+ifeq ($(FOUNDATION_EMU_QEMU_VIRT),1)
+# qemu virt machine, ram starts at 1GB
+MEMBASE := 0x40000000
+MEMSIZE := 0x08000000
+
+GLOBAL_DEFINES += \
+	PLATFORM_QEMU_VIRT=1
+else
 # first 2GB of ram
 MEMBASE := 0x80000000
 MEMSIZE := 0x80000000
+endif
 
 GLOBAL_DEFINES += \
 	MEMBASE=$(MEMBASE) \
@@ -165,16 +165,23 @@ void platform_init_timer(void)
 {
     TRACE_ENTRY;
 
+#if PLATFORM_QEMU_VIRT
+    /* the counter is already running, firmware (qemu) set CNTFRQ */
+    timer_freq = ARM64_READ_SYSREG(CNTFRQ_EL0);
+#else
     /* read the base frequency from the control block */
     timer_freq = *REG32(REFCLK_CNTControl + CNTFID0);
+#endif
     printf("timer running at %d Hz\n", timer_freq);
 
     /* calculate the ratio of microseconds and milliseconds */
     usec_ratio = timer_freq / 1000000U;
     msec_ratio = timer_freq / 1000U;
 
+#if !PLATFORM_QEMU_VIRT
     /* start the physical timer */
     *REG32(REFCLK_CNTControl + CNTCR) = 1;
+#endif
 
     mask_interrupt(INT_PPI_NSPHYS_TIMER);
     register_int_handler(INT_PPI_NSPHYS_TIMER, &platform_tick, NULL);
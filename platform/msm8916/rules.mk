@@ -9,6 +9,9 @@ DEFINES += ARM_CPU_CORE_A7
 
 MMC_SLOT         := 1
 
+# cpus to bring up when built with WITH_SMP=1
+SMP_MAX_CPUS ?= 4
+
 DEFINES += PERIPH_BLK_BLSP=1
 DEFINES += WITH_CPU_EARLY_INIT=0 WITH_CPU_WARM_BOOT=0 \
           MMC_SLOT=$(MMC_SLOT) SSD_ENABLE
@@ -9,6 +9,9 @@ DEFINES += ARM_CORE_V8
 
 MMC_SLOT         := 1
 
+# cpus to bring up when built with WITH_SMP=1
+SMP_MAX_CPUS ?= 8
+
 DEFINES += PERIPH_BLK_BLSP=1
 DEFINES += WITH_CPU_EARLY_INIT=0 WITH_CPU_WARM_BOOT=0 \
 	   MMC_SLOT=$(MMC_SLOT)
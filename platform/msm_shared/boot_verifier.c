@@ -40,6 +40,8 @@
 static KEYSTORE *oem_keystore;
 static KEYSTORE *user_keystore;
 static uint32_t dev_boot_state = RED;
+/* Image bytes already hashed by the caller of boot_verify_image */
+static uint32_t img_hashed_len;
 BUF_DMA_ALIGN(keystore_buf, 4096);
 char KEYSTORE_PTN_NAME[] = "keystore";
 
@@ -167,7 +169,8 @@ static int add_attribute_to_img(unsigned char *ptr, AUTH_ATTR *input)
 }
 
 static bool boot_verify_compare_sha256(unsigned char *image_ptr,
-		unsigned int image_size, unsigned char *signature_ptr, RSA *rsa)
+		unsigned int image_size, unsigned int hashed_len,
+		unsigned char *signature_ptr, RSA *rsa)
 {
 	int ret = -1;
 	bool auth = false;
@@ -180,9 +183,15 @@ static bool boot_verify_compare_sha256(unsigned char *image_ptr,
 		goto cleanup;
 	}
 
-	/* Calculate SHA256sum */
-	image_find_digest(image_ptr, image_size, CRYPTO_AUTH_ALG_SHA256,
-			(unsigned char *)&digest);
+	/* Calculate SHA256sum, hash only what the caller did not hash yet */
+	if (hashed_len)
+	{
+		hash_update(image_ptr + hashed_len, image_size - hashed_len);
+		image_finish_digest(CRYPTO_AUTH_ALG_SHA256, (unsigned char *)&digest);
+	}
+	else
+		image_find_digest(image_ptr, image_size, CRYPTO_AUTH_ALG_SHA256,
+				(unsigned char *)&digest);
 
 	/* Find digest from the image */
 	ret = image_decrypt_signature_rsa(signature_ptr, plain_text, rsa);
@@ -207,7 +216,7 @@ cleanup:
 }
 
 static bool verify_image_with_sig(unsigned char* img_addr, uint32_t img_size,
-		char *pname, VERIFIED_BOOT_SIG *sig, KEYSTORE *ks)
+		uint32_t hashed_len, char *pname, VERIFIED_BOOT_SIG *sig, KEYSTORE *ks)
 {
 	bool ret = false;
 	uint32_t len;
@@ -260,7 +269,7 @@ static bool verify_image_with_sig(unsigned char* img_addr, uint32_t img_size,
 	if(ks != NULL)
 		rsa = ks->mykeybag->mykey->key_material;
 
-	ret = boot_verify_compare_sha256(img_addr, img_size,
+	ret = boot_verify_compare_sha256(img_addr, img_size, hashed_len,
 			(unsigned char*)sig->sig->data, rsa);
 
 	if(!ret)
@@ -299,7 +308,7 @@ static bool verify_keystore(unsigned char * ks_addr, KEYSTORE *ks)
 	bool ret = false;
 	unsigned char * ptr = ks_addr;
 	uint32_t inner_len = encode_inner_keystore(ptr, ks);
-	ret = verify_image_with_sig(ks_addr, inner_len, "keystore", ks->sig,
+	ret = verify_image_with_sig(ks_addr, inner_len, 0, "keystore", ks->sig,
 			oem_keystore);
 	return ret;
 }
@@ -387,12 +396,25 @@ uint32_t boot_verify_keystore_init()
 	return dev_boot_state;
 }
 
+/*
+ * The first len bytes of the image given to the next boot_verify_image
+ * call were fed to hash_update after hash_start(CRYPTO_AUTH_ALG_SHA256)
+ * while the image was being read, only the rest needs to be hashed.
+ */
+void boot_verify_image_hashed(uint32_t len)
+{
+	img_hashed_len = len;
+}
+
 bool boot_verify_image(unsigned char* img_addr, uint32_t img_size, char *pname)
 {
 	bool ret = false;
 	VERIFIED_BOOT_SIG *sig = NULL;
 	unsigned char* sig_addr = (unsigned char*)(img_addr + img_size);
 	uint32_t sig_len = read_der_message_length(sig_addr);
+	uint32_t hashed_len = img_hashed_len;
+
+	img_hashed_len = 0;
 
 	if(dev_boot_state == ORANGE)
 	{
@@ -414,7 +436,7 @@ bool boot_verify_image(unsigned char* img_addr, uint32_t img_size, char *pname)
 		goto verify_image_error;
 	}
 
-	ret = verify_image_with_sig(img_addr, img_size, pname, sig, user_keystore);
+	ret = verify_image_with_sig(img_addr, img_size, hashed_len, pname, sig, user_keystore);
 
 verify_image_error:
 	if(sig != NULL)
@@ -37,6 +37,18 @@ static crypto_SHA256_ctx g_sha256_ctx;
 static crypto_SHA1_ctx g_sha1_ctx;
 static bool crypto_init_done;
 
+/* State of the multi part hash started by hash_start */
+static struct {
+	unsigned char auth_alg;
+	crypto_engine_type ce_type;
+	SHA_CTX sw_sha1_ctx;
+	SHA256_CTX sw_sha256_ctx;
+	unsigned char *pend_ptr;
+	unsigned int pend_size;
+	bool first;
+	crypto_result_type ret_val;
+} g_hash_state;
+
 extern void ce_clock_init(void);
 
 /*
@@ -164,6 +176,139 @@ static crypto_result_type crypto_sha1_init(crypto_SHA1_ctx * ctx_ptr)
 	return CRYPTO_SHA_ERR_NONE;
 }
 
+/*
+ * Multi part hashing of data that is not contiguous. hash_start starts a
+ * new digest, hash_update adds the next piece of data & hash_finish gives
+ * the digest of all the pieces, in order. With the crypto engine the last
+ * piece is held back until hash_finish, as the engine needs to know which
+ * piece is the last one. So the data passed to hash_update must stay
+ * untouched until the next hash_update or hash_finish call, & every piece
+ * but the last must be a multiple of CRYPTO_SHA_BLOCK_SIZE.
+ */
+
+void hash_start(unsigned char auth_alg)
+{
+	g_hash_state.auth_alg = auth_alg;
+	g_hash_state.ce_type = board_ce_type();
+	g_hash_state.pend_ptr = NULL;
+	g_hash_state.pend_size = 0;
+	g_hash_state.first = TRUE;
+	g_hash_state.ret_val = CRYPTO_SHA_ERR_NONE;
+
+	if ((auth_alg != CRYPTO_AUTH_ALG_SHA1) && (auth_alg != CRYPTO_AUTH_ALG_SHA256)) {
+		g_hash_state.ret_val = CRYPTO_SHA_ERR_FAIL;
+		return;
+	}
+
+	if (g_hash_state.ce_type == CRYPTO_ENGINE_TYPE_SW) {
+		/* Hardware CE is not present , use software hashing */
+		if (auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			SHA1_Init(&g_hash_state.sw_sha1_ctx);
+		else
+			SHA256_Init(&g_hash_state.sw_sha256_ctx);
+	} else if (g_hash_state.ce_type == CRYPTO_ENGINE_TYPE_HW) {
+		/* Initialize crypto engine hardware for a new SHA operation */
+		crypto_init();
+
+		if (auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			crypto_sha1_init(&g_sha1_ctx);
+		else
+			crypto_sha256_init(&g_sha256_ctx);
+	} else
+		g_hash_state.ret_val = CRYPTO_SHA_ERR_FAIL;
+}
+
+/*
+ * Send the piece held back by hash_update to the crypto engine.
+ */
+
+static void hash_send_pending(bool last)
+{
+	void *ctx_ptr;
+
+	if (g_hash_state.auth_alg == CRYPTO_AUTH_ALG_SHA1)
+		ctx_ptr = (void *)&g_sha1_ctx;
+	else
+		ctx_ptr = (void *)&g_sha256_ctx;
+
+	g_hash_state.ret_val = do_sha_update(ctx_ptr, g_hash_state.pend_ptr,
+					     g_hash_state.pend_size,
+					     g_hash_state.auth_alg,
+					     g_hash_state.first, last);
+
+	g_hash_state.first = FALSE;
+	g_hash_state.pend_ptr = NULL;
+	g_hash_state.pend_size = 0;
+}
+
+void hash_update(unsigned char *addr, unsigned int size)
+{
+	if (!size || (g_hash_state.ret_val != CRYPTO_SHA_ERR_NONE))
+		return;
+
+	if (g_hash_state.ce_type == CRYPTO_ENGINE_TYPE_SW) {
+		if (g_hash_state.auth_alg == CRYPTO_AUTH_ALG_SHA1)
+			SHA1_Update(&g_hash_state.sw_sha1_ctx, addr, size);
+		else
+			SHA256_Update(&g_hash_state.sw_sha256_ctx, addr, size);
+		return;
+	}
+
+	if (g_hash_state.pend_size)
+		hash_send_pending(FALSE);
+
+	g_hash_state.pend_ptr = addr;
+	g_hash_state.pend_size = size;
+}
+
+void hash_finish(unsigned char *digest)
+{
+	if (g_hash_state.ret_val == CRYPTO_SHA_ERR_NONE) {
+		if (g_hash_state.ce_type == CRYPTO_ENGINE_TYPE_SW) {
+			if (g_hash_state.auth_alg == CRYPTO_AUTH_ALG_SHA1)
+				SHA1_Final(digest, &g_hash_state.sw_sha1_ctx);
+			else
+				SHA256_Final(digest, &g_hash_state.sw_sha256_ctx);
+			return;
+		}
+
+		if (g_hash_state.pend_size)
+			hash_send_pending(TRUE);
+		else
+			g_hash_state.ret_val = CRYPTO_SHA_ERR_INVALID_PARAM;
+	}
+
+	if (g_hash_state.ret_val != CRYPTO_SHA_ERR_NONE) {
+		dprintf(CRITICAL, "hash_finish returns error %d\n", g_hash_state.ret_val);
+		return;
+	}
+
+	/* Copy the digest value from context pointer to digest pointer */
+	if (g_hash_state.auth_alg == CRYPTO_AUTH_ALG_SHA1)
+		memcpy(digest, (unsigned char *)g_sha1_ctx.auth_iv, 20);
+	else
+		memcpy(digest, (unsigned char *)g_sha256_ctx.auth_iv, 32);
+}
+
+/*
+ * Calculates SHAx digest of the buffers of an iovec, as if they were
+ * one contiguous buffer.
+ */
+
+void
+hash_find_iov(iovec_t *iov, uint32_t iov_cnt, unsigned char *digest,
+	      unsigned char auth_alg)
+{
+	uint32_t i;
+
+	hash_start(auth_alg);
+
+	for (i = 0; i < iov_cnt; i++)
+		hash_update((unsigned char *)iov[i].iov_base, iov[i].iov_len);
+
+	hash_finish(digest);
+}
+
 /*
  * Function to calculate SHA256 digest of given data buffer.
  * It works on contiguous data and gives digest in single pass.
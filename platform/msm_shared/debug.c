@@ -42,6 +42,8 @@
 #include <platform.h>
 #include <platform/msm_shared.h>
 #include <platform/msm_shared/timer.h>
+#include <arch/ops.h>
+#include <lk/init.h>
 
 #if PON_VIB_SUPPORT
 #include <vibrator.h>
@@ -69,11 +71,10 @@ static void write_dcc(char c)
 
 #if WITH_DEBUG_LOG_BUF
 
-#ifndef LK_LOG_BUF_SIZE
-#define LK_LOG_BUF_SIZE    (4096) /* align on 4k */
-#endif
+STATIC_ASSERT((LK_LOG_BUF_SIZE & (LK_LOG_BUF_SIZE - 1)) == 0);
 
 #define LK_LOG_COOKIE    0x474f4c52 /* "RLOG" in ASCII */
+#define LK_LOG_MASK      (LK_LOG_BUF_SIZE - 1)
 
 struct lk_log {
 	struct lk_log_header {
@@ -95,19 +96,186 @@ static struct lk_log log = {
 	.data = {0}
 };
 
+/*
+ * The log ring takes bytes from any cpu without a lock: a writer reserves a
+ * slot by moving log_head, stores its byte and publishes it by moving
+ * log_commit, in reservation order. The header keeps following log_commit
+ * for whoever reads the log out of a RAM dump.
+ *
+ * With WITH_DEBUG_UART the ring is also the uart TX queue: log_drained
+ * trails log_commit and is moved along a FIFO batch at a time by a low
+ * priority thread, so dprintf no longer waits for the line. A writer that
+ * would overwrite bytes the uart has not taken drains them itself, nothing
+ * is dropped.
+ */
+static volatile int log_head;
+static volatile int log_commit;
+
+#if WITH_DEBUG_UART
+#define LOG_DRAIN_IDLE_MS    10
+
+static volatile int log_drained;
+static spin_lock_t log_drain_lock;
+static bool log_drain_thread_running;
+
+/*
+ * Hand the uart the next committed bytes, at most one batch, and return
+ * how many it took: 0 if another cpu is draining or the FIFO is busy.
+ * The thread lock is taken first, the uart driver's critical section
+ * nests inside ours. The interrupt state of the caller is kept as it
+ * was, log_putc drains with interrupts masked. force skips the drain
+ * lock for the panic path, the cpu holding it may never let go.
+ */
+static int log_drain(bool force)
+{
+	unsigned drained, pending, off;
+	bool ints = arch_ints_disabled();
+	bool locked;
+	int n = 0;
+
+	if (!ints)
+		arch_disable_ints();
+	inc_critical_section();
+
+	locked = !spin_trylock(&log_drain_lock);
+	if (!locked && !force)
+		goto out;
+
+	drained = log_drained;
+	pending = (unsigned)log_commit - drained;
+	/* the bytes are only read once their commit has been seen */
+	dmb();
+	if (pending) {
+		/* a batch does not wrap around the end of the ring */
+		off = drained & LK_LOG_MASK;
+		n = uart_write(0, &log.data[off], MIN(pending, LK_LOG_BUF_SIZE - off));
+
+		/* no uart yet, the bytes only go to the log as before */
+		if (n < 0)
+			n = pending;
+
+		dmb();
+		log_drained = drained + n;
+	}
+
+	if (locked)
+		spin_unlock(&log_drain_lock);
+out:
+	dec_critical_section();
+	if (!ints)
+		arch_enable_ints();
+
+	return n;
+}
+
+static void log_flush(bool force)
+{
+	while ((unsigned)log_commit != (unsigned)log_drained)
+		log_drain(force);
+}
+
+static int log_drain_thread(void *arg)
+{
+	for (;;) {
+		if ((unsigned)log_commit == (unsigned)log_drained)
+			thread_sleep(LOG_DRAIN_IDLE_MS);
+		else if (!log_drain(false))
+			thread_sleep(1);
+	}
+
+	return 0;
+}
+
+static void log_drain_init(uint level)
+{
+	thread_t *t;
+
+	t = thread_create("log_drain", log_drain_thread, NULL, LOW_PRIORITY,
+			  DEFAULT_STACK_SIZE);
+	if (!t)
+		return;
+
+	log_drain_thread_running = true;
+	thread_detach_and_resume(t);
+}
+
+LK_INIT_HOOK(log_drain, &log_drain_init, LK_INIT_LEVEL_THREADING);
+#endif /* WITH_DEBUG_UART */
+
 static void log_putc(char c)
 {
-	log.data[log.header.idx++] = c;
-	log.header.size_written++;
-	if (unlikely(log.header.idx >= log.header.max_size))
-		log.header.idx = 0;
+	bool ints = arch_ints_disabled();
+	unsigned pos;
+
+	if (!ints)
+		arch_disable_ints();
+
+	for (;;) {
+		pos = log_head;
+#if WITH_DEBUG_UART
+		/* Room has to be there before the slot is taken: once reserved
+		 * the slot holds up every later writer until it is committed. */
+		if (pos - (unsigned)log_drained >= LK_LOG_BUF_SIZE) {
+			log_drain(false);
+			continue;
+		}
+#endif
+		if ((unsigned)atomic_cmpxchg(&log_head, pos, pos + 1) == pos)
+			break;
+	}
+
+	log.data[pos & LK_LOG_MASK] = c;
+
+	/* earlier slots belong to writers that are a store away from done */
+	while ((unsigned)log_commit != pos)
+		;
+
+	log.header.idx = (pos + 1) & LK_LOG_MASK;
+	log.header.size_written = pos + 1;
+	dmb();
+	log_commit = pos + 1;
+
+	if (!ints)
+		arch_enable_ints();
+
+#if WITH_DEBUG_UART
+	/* until the drain thread runs the uart is fed right away */
+	if (!log_drain_thread_running)
+		log_drain(false);
+#endif
 }
+
 char* lk_log_getbuf(void) {
     return log.data;
 }
 unsigned lk_log_getsize(void) {
     return log.header.size_written;
 }
+
+/*
+ * Copy what the ring still holds, oldest byte first, to buf and NUL
+ * terminate it. Returns the number of bytes copied.
+ */
+unsigned lk_log_copy(char *buf, unsigned len)
+{
+	unsigned end = log_commit;
+	unsigned start, off, n, i;
+
+	if (!len)
+		return 0;
+
+	start = end > LK_LOG_BUF_SIZE ? end - LK_LOG_BUF_SIZE : 0;
+	n = MIN(end - start, len - 1);
+	start = end - n;
+
+	for (i = 0; i < n; i += off) {
+		off = MIN(n - i, LK_LOG_BUF_SIZE - ((start + i) & LK_LOG_MASK));
+		memcpy(buf + i, &log.data[(start + i) & LK_LOG_MASK], off);
+	}
+	buf[n] = '\0';
+
+	return n;
+}
 #endif /* WITH_DEBUG_LOG_BUF */
 
 void platform_dputc(char c)
@@ -121,7 +289,7 @@ void platform_dputc(char c)
 	}
 	write_dcc(c) ;
 #endif
-#if WITH_DEBUG_UART
+#if WITH_DEBUG_UART && !WITH_DEBUG_LOG_BUF
 	uart_putc(0, c);
 #endif
 #if WITH_DEBUG_FBCON && WITH_DEV_FBCON
@@ -135,6 +303,15 @@ void platform_dputc(char c)
 #endif
 }
 
+/* push out whatever is still queued for the uart, e.g. before the kernel
+ * takes it over */
+void platform_dflush(void)
+{
+#if WITH_DEBUG_LOG_BUF && WITH_DEBUG_UART
+	log_flush(false);
+#endif
+}
+
 int platform_dgetc(char *c, bool wait)
 {
 	int n;
@@ -155,6 +332,13 @@ int platform_dgetc(char *c, bool wait)
 
 void platform_halt(void)
 {
+#if WITH_DEBUG_LOG_BUF && WITH_DEBUG_UART
+	/* get the panic message out, whoever holds the drain lock */
+	log_flush(true);
+#endif
+#if WITH_DEBUG_FBCON && WITH_DEV_FBCON
+	fbcon_flush();
+#endif
 #if PON_VIB_SUPPORT
 	vib_turn_off();
 #endif
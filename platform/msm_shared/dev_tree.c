@@ -39,6 +39,7 @@
 #include <board.h>
 #include <list.h>
 #include <kernel/thread.h>
+#include <lib/pool.h>
 
 struct dt_entry_v1
 {
@@ -97,6 +98,12 @@ extern int check_aboot_addr_range_overlap(uint32_t start, uint32_t size);
    otherwise return 0xFFFFFFFF */
 #define INVALID_SOC_REV_ID 0XFFFFFFFF
 
+/* dt entry lists are built and torn down for every dtb scanned */
+static pool_t dt_node_pool = POOL_INITIAL_VALUE(dt_node_pool, "dt_entry_node",
+		sizeof(struct dt_entry_node), 0, 0);
+static pool_t dt_entry_pool = POOL_INITIAL_VALUE(dt_entry_pool, "dt_entry",
+		sizeof(struct dt_entry), 0, 0);
+
 /* Add function to allocate dt entry list, used for recording
 *  the entry which conform to platform_dt_absolute_match()
 */
@@ -104,17 +111,14 @@ static struct dt_entry_node *dt_entry_list_init(void)
 {
 	struct dt_entry_node *dt_node_member = NULL;
 
-	dt_node_member = (struct dt_entry_node *)
-		malloc(sizeof(struct dt_entry_node));
+	dt_node_member = (struct dt_entry_node *) pool_alloc(&dt_node_pool);
 
 	ASSERT(dt_node_member);
 
 	list_clear_node(&dt_node_member->node);
-	dt_node_member->dt_entry_m = (struct dt_entry *)
-			malloc(sizeof(struct dt_entry));
+	dt_node_member->dt_entry_m = (struct dt_entry *) pool_zalloc(&dt_entry_pool);
 	ASSERT(dt_node_member->dt_entry_m);
 
-	memset(dt_node_member->dt_entry_m ,0 ,sizeof(struct dt_entry));
 	return dt_node_member;
 }
 
@@ -127,8 +131,8 @@ static void dt_entry_list_delete(struct dt_entry_node *dt_node_member)
 {
 	if (list_in_list(&dt_node_member->node)) {
 			list_delete(&dt_node_member->node);
-			free(dt_node_member->dt_entry_m);
-			free(dt_node_member);
+			pool_free(&dt_entry_pool, dt_node_member->dt_entry_m);
+			pool_free(&dt_node_pool, dt_node_member);
 	}
 }
 
@@ -449,8 +453,23 @@ static int dev_tree_compatible(void *dtb, uint32_t dtb_size, struct dt_entry_nod
  */
 void *dev_tree_appended(void *kernel, uint32_t kernel_size, void *tags)
 {
-	void *kernel_end = kernel + kernel_size;
 	uint32_t app_dtb_offset = 0;
+
+	memcpy((void*) &app_dtb_offset, (void*) (kernel + DTB_OFFSET), sizeof(uint32_t));
+
+	return dev_tree_appended_at(kernel, kernel_size, app_dtb_offset, tags);
+}
+
+/*
+ * Same as dev_tree_appended, for images where the device trees don't start
+ * at the offset recorded in the kernel header, e.g. after a compressed kernel.
+ *
+ * Arguments:    dtb_offset - Offset of the first device tree from kernel
+ */
+void *dev_tree_appended_at(void *kernel, uint32_t kernel_size, uint32_t app_dtb_offset,
+                           void *tags)
+{
+	void *kernel_end = kernel + kernel_size;
 	void *dtb = NULL;
 	void *bestmatch_tag = NULL;
 	struct dt_entry *best_match_dt_entry = NULL;
@@ -470,9 +489,6 @@ void *dev_tree_appended(void *kernel, uint32_t kernel_size, void *tags)
 	}
 	list_initialize(&dt_entry_queue->node);
 
-
-	memcpy((void*) &app_dtb_offset, (void*) (kernel + DTB_OFFSET), sizeof(uint32_t));
-
 	if (((uintptr_t)kernel + (uintptr_t)app_dtb_offset) < (uintptr_t)kernel) {
 		return NULL;
 	}
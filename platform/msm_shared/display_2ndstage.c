@@ -40,6 +40,16 @@ void sync_sw_buffer(void) {
 	memcpy(real_fb, config->base, (config->width*config->height*config->bpp/8));
 }
 
+void sync_sw_rect(unsigned x, unsigned y, unsigned w, unsigned h) {
+	struct fbcon_config *config = fbcon_display();
+	unsigned pitch = config->stride * config->bpp / 8;
+	unsigned offset = y * pitch + x * config->bpp / 8;
+
+	for (; h; h--, offset += pitch)
+		memcpy((uint8_t *)real_fb + offset, (uint8_t *)config->base + offset,
+		       w * config->bpp / 8);
+}
+
 void target_display_init(const char *panel_name)
 {
 #ifdef DISPLAY_2NDSTAGE_FBADDR
@@ -59,6 +69,7 @@ void target_display_init(const char *panel_name)
 	config->format = DSI_VIDEO_DST_FORMAT_RGB888;
 	config->update_start = NULL;
 	config->update_done = NULL;
+	config->update_rect = NULL;
 
 #if TARGET_MSM8960_ARIES
 	config->base = real_fb;
@@ -69,6 +80,7 @@ void target_display_init(const char *panel_name)
 	config->base = fb + fb_size;
 	memset(config->base, 0, fb_size);
 	config->update_start = sync_sw_buffer;
+	config->update_rect = sync_sw_rect;
 #endif
 
 	fbcon_setup(config);
@@ -334,6 +334,8 @@ int dme_read_unit_desc(struct ufs_dev *dev, uint8_t index)
 
 	dev->lun_cfg[index].erase_blk_size = BE32(desc->erase_blk_size);
 
+	dev->lun_cfg[index].provisioning_type = desc->provisioning_type;
+
 	return UFS_SUCCESS;
 }
 
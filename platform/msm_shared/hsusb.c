@@ -42,6 +42,7 @@
 #include <kernel/thread.h>
 #include <reg.h>
 #include <dev/udc.h>
+#include <lib/pool.h>
 #include "hsusb.h"
 
 #if WITH_APP_DISPLAY_SERVER
@@ -252,21 +253,32 @@ static void endpoint_enable(struct udc_endpoint *ept, unsigned yes)
 	writel(n, USB_ENDPTCTRL(ept->num));
 }
 
+static pool_t usb_req_pool = POOL_INITIAL_VALUE(usb_req_pool, "usb_request",
+		sizeof(struct usb_request), 0, POOL_FLAG_DMA);
+static pool_t ept_item_pool = POOL_INITIAL_VALUE(ept_item_pool, "ept_queue_item",
+		sizeof(struct ept_queue_item), 0, POOL_FLAG_DMA);
+
 struct udc_request *udc_request_alloc(void)
 {
 	struct usb_request *req;
-	req = memalign(CACHE_LINE, ROUNDUP(sizeof(*req), CACHE_LINE));
+	req = pool_alloc(&usb_req_pool);
 	ASSERT(req);
 	req->req.buf = 0;
 	req->req.length = 0;
-	req->item = memalign(CACHE_LINE, ROUNDUP(sizeof(struct ept_queue_item),
-								CACHE_LINE));
+	/* the pool keeps its free list in the first word, which is next here;
+	 * udc_request_queue() takes anything but TERMINATE for a TD chain */
+	req->item = pool_zalloc(&ept_item_pool);
+	ASSERT(req->item);
+	req->item->next = TERMINATE;
 	return &req->req;
 }
 
 void udc_request_free(struct udc_request *req)
 {
-	free(req);
+	struct usb_request *ureq = (struct usb_request *)req;
+
+	pool_free(&ept_item_pool, ureq->item);
+	pool_free(&usb_req_pool, ureq);
 }
 
 /*
@@ -107,11 +107,34 @@ image_decrypt_signature(unsigned char *signature_ptr, unsigned char *plain_text)
 /* Calculates digest of an image and save it in digest buffer */
 void image_find_digest(unsigned char *image_ptr, unsigned int image_size,
 		unsigned hash_type, unsigned char *digest)
+{
+	iovec_t iov = { image_ptr, image_size };
+
+	image_find_digest_iov(&iov, 1, hash_type, digest);
+}
+
+/* Calculates digest of an image scattered over an iovec and save it in digest buffer */
+void image_find_digest_iov(iovec_t *iov, uint32_t iov_cnt,
+		unsigned hash_type, unsigned char *digest)
 {
 	/*
 	 * Calculate hash of image and save calculated hash on TZ.
 	 */
-	hash_find(image_ptr, image_size, (unsigned char *)digest, hash_type);
+	hash_start(hash_type);
+	while (iov_cnt--) {
+		hash_update((unsigned char *)iov->iov_base, iov->iov_len);
+		iov++;
+	}
+	image_finish_digest(hash_type, digest);
+}
+
+/*
+ * Completes the digest of an image the caller fed to hash_update after
+ * hash_start, while the image was being read, & save it in digest buffer
+ */
+void image_finish_digest(unsigned hash_type, unsigned char *digest)
+{
+	hash_finish(digest);
 #ifdef TZ_SAVE_KERNEL_HASH
 	if (hash_type == CRYPTO_AUTH_ALG_SHA256) {
 		save_kernel_hash_cmd(digest);
@@ -131,11 +154,42 @@ image_verify(unsigned char *image_ptr,
 	     unsigned char *signature_ptr,
 	     unsigned int image_size, unsigned hash_type)
 {
+	iovec_t iov = { image_ptr, image_size };
+
+	return image_verify_iov(&iov, 1, signature_ptr, hash_type);
+}
+
+/*
+ * Same as image_verify, for an image whose pieces are scattered over the
+ * buffers of an iovec. The signature covers the pieces in iovec order.
+ */
+int
+image_verify_iov(iovec_t *iov, uint32_t iov_cnt,
+		 unsigned char *signature_ptr, unsigned hash_type)
+{
+	unsigned int digest[8];
+
+	/*
+	 * Calculate hash of image and save calculated hash on TZ.
+	 */
+	image_find_digest_iov(iov, iov_cnt, hash_type,
+			(unsigned char *)&digest);
+
+	return image_verify_digest((unsigned char *)&digest, signature_ptr, hash_type);
+}
+
+/*
+ * Same as image_verify, for an image whose digest was already calculated
+ * by image_find_digest_iov or image_finish_digest.
+ */
+int
+image_verify_digest(unsigned char *digest,
+		    unsigned char *signature_ptr, unsigned hash_type)
+{
 
 	unsigned ret = -1;
 	int auth = 0;
 	unsigned char *plain_text = NULL;
-	unsigned int digest[8];
 	unsigned int hash_size;
 
 	plain_text = (unsigned char *)calloc(sizeof(char), SIGNATURE_SIZE);
@@ -144,13 +198,8 @@ image_verify(unsigned char *image_ptr,
 		goto cleanup;
 	}
 
-	/*
-	 * Calculate hash of image and save calculated hash on TZ.
-	 */
 	hash_size =
 	    (hash_type == CRYPTO_AUTH_ALG_SHA256) ? SHA256_SIZE : SHA1_SIZE;
-	image_find_digest(image_ptr, image_size, hash_type,
-			(unsigned char *)&digest);
 
 	/*
 	 * Decrypt the pre-calculated expected image hash.
@@ -147,6 +147,8 @@ extern char KEYSTORE_PTN_NAME[];
 uint32_t boot_verify_keystore_init(void);
 /* Function to verify boot/recovery image */
 bool boot_verify_image(unsigned char* img_addr, uint32_t img_size, char *pname);
+/* Function to skip hashing the image data already hashed while reading it */
+void boot_verify_image_hashed(uint32_t len);
 /* Function to send event to boot state machine */
 void boot_verify_send_event(uint32_t event);
 /* Read current boot state */
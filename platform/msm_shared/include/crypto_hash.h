@@ -29,6 +29,8 @@
 #ifndef __CRYPTO_HASH_H__
 #define __CRYPTO_HASH_H__
 
+#include <iovec.h>
+
 #ifndef NULL
 #define NULL		0
 #endif
@@ -135,5 +137,15 @@ void
 hash_find(unsigned char *addr, unsigned int size, unsigned char *digest,
 	  unsigned char auth_alg);
 
+void
+hash_find_iov(iovec_t *iov, uint32_t iov_cnt, unsigned char *digest,
+	      unsigned char auth_alg);
+
+void hash_start(unsigned char auth_alg);
+
+void hash_update(unsigned char *addr, unsigned int size);
+
+void hash_finish(unsigned char *digest);
+
 bool crypto_initialized(void);
 #endif
@@ -151,4 +151,6 @@ int dev_tree_get_entry_info(struct dt_table *table, struct dt_entry *dt_entry_in
 int update_device_tree(void *fdt, const char *, void *, unsigned);
 int dev_tree_add_mem_info(void *fdt, uint32_t offset, uint64_t size, uint64_t addr);
 void *dev_tree_appended(void *kernel, uint32_t kernel_size, void *tags);
+void *dev_tree_appended_at(void *kernel, uint32_t kernel_size, uint32_t dtb_offset,
+                           void *tags);
 #endif
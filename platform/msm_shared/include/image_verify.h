@@ -28,6 +28,7 @@
 #define __IMAGE_VERIFY_H
 
 #include <x509.h>
+#include <iovec.h>
 
 #define SHA1_SIZE      16
 #define SHA256_SIZE    32
@@ -39,6 +40,10 @@ static int image_decrypt_signature(unsigned char *signature_ptr,
 int image_verify(unsigned char *image_ptr,
 		 unsigned char *signature_ptr,
 		 unsigned int image_size, unsigned hash_type);
+int image_verify_iov(iovec_t *iov, uint32_t iov_cnt,
+		 unsigned char *signature_ptr, unsigned hash_type);
+int image_verify_digest(unsigned char *digest,
+		 unsigned char *signature_ptr, unsigned hash_type);
 
 /* Decrypt signature with RSA public key */
 int image_decrypt_signature_rsa(unsigned char *signature_ptr,
@@ -47,4 +52,11 @@ int image_decrypt_signature_rsa(unsigned char *signature_ptr,
 /* Find hash of image */
 void image_find_digest(unsigned char *image_ptr, unsigned int image_size,
 		unsigned hash_type, unsigned char *digest);
+
+/* Find hash of image scattered over an iovec */
+void image_find_digest_iov(iovec_t *iov, uint32_t iov_cnt,
+		unsigned hash_type, unsigned char *digest);
+
+/* Complete the hash of an image fed to hash_update after hash_start */
+void image_finish_digest(unsigned hash_type, unsigned char *digest);
 #endif
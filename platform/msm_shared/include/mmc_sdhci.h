@@ -96,6 +96,7 @@
 #define MMC_SEC_COUNT2                            213
 #define MMC_SEC_COUNT1                            212
 #define MMC_PART_CONFIG                           179
+#define MMC_ERASED_MEM_CONT                       181
 #define MMC_ERASE_GRP_DEF                         175
 #define MMC_USR_WP                                171
 #define MMC_ERASE_TIMEOUT_MULT                    223
@@ -323,6 +324,14 @@ struct mmc_device *mmc_init(struct mmc_config_data *);
 uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest, uint64_t blk_addr, uint32_t num_blocks);
 /* API: Write requried number of blocks from source to card */
 uint32_t mmc_sdhci_write(struct mmc_device *dev, void *src, uint64_t blk_addr, uint32_t num_blocks);
+/* API: Read required number of blocks from card into a scatter list */
+uint32_t mmc_sdhci_read_iov(struct mmc_device *dev, iovec_t *iov, uint32_t iov_cnt, uint64_t blk_addr, uint32_t num_blocks);
+/* API: Issue a read/write command without waiting for the data transfer */
+uint32_t mmc_sdhci_start_rw(struct mmc_device *dev, struct mmc_command *cmd, void *buf, uint64_t blk_addr, uint32_t num_blocks, uint32_t trans_mode);
+/* API: Check if the transfer issued by mmc_sdhci_start_rw is over */
+bool mmc_sdhci_rw_done(struct mmc_device *dev, struct mmc_command *cmd);
+/* API: Wait for the transfer issued by mmc_sdhci_start_rw & check the status */
+uint32_t mmc_sdhci_finish_rw(struct mmc_device *dev, struct mmc_command *cmd);
 /* API: Erase len bytes (after converting to number of erase groups), from specified address */
 uint32_t mmc_sdhci_erase(struct mmc_device *dev, uint32_t blk_addr, uint64_t len);
 /* API: Write protect or release len bytes (after converting to number of write protect groups) from specified start address*/
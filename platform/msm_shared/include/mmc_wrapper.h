@@ -30,8 +30,21 @@
 #define __MMC_WRAPPER_H__
 
 #include <mmc_sdhci.h>
+#include <list.h>
 
 #define BOARD_KERNEL_PAGESIZE                2048
+
+/* Asynchronous read/write request, owned by the queue until it is done */
+struct mmc_io_req {
+	struct list_node node;
+	uint64_t data_addr;     /* Card address of the data left to transfer */
+	uint8_t *buf;           /* Buffer of the data left to transfer */
+	uint32_t data_len;      /* Bytes left to transfer */
+	uint32_t trans_mode;    /* SDHCI_MMC_READ or SDHCI_MMC_WRITE */
+	uint32_t status;        /* 0 on Success, non zero on failure */
+	bool done;
+};
+
 /* Wrapper APIs */
 
 struct mmc_device *get_mmc_device(void);
@@ -39,10 +52,16 @@ uint32_t mmc_get_psn(void);
 
 uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len);
 uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in);
+uint32_t mmc_read_iovec(uint64_t data_addr, iovec_t *iov, uint32_t iov_cnt);
+uint32_t mmc_read_async(struct mmc_io_req *req, uint64_t data_addr, uint32_t *out, uint32_t data_len);
+uint32_t mmc_write_async(struct mmc_io_req *req, uint64_t data_addr, uint32_t data_len, void *in);
+bool mmc_io_poll(void);
+uint32_t mmc_io_wait(struct mmc_io_req *req);
 uint32_t mmc_erase_card(uint64_t, uint64_t);
 uint64_t mmc_get_device_capacity(void);
 uint32_t mmc_erase_card(uint64_t addr, uint64_t len);
 uint32_t mmc_get_device_blocksize(void);
+uint32_t mmc_fill(uint64_t data_addr, uint64_t data_len, uint32_t pattern);
 uint32_t mmc_page_size(void);
 void mmc_device_sleep(void);
 void mmc_set_lun(uint8_t lun);
@@ -165,6 +165,8 @@ struct partition_info {
 };
 
 int partition_get_index(const char *name);
+int partition_get_index_lun(const char *name, uint8_t lun);
+int partition_get_index_spec(const char *spec);
 unsigned long long partition_get_size(int index);
 unsigned long long partition_get_offset(int index);
 uint8_t partition_get_lun(int index);
@@ -68,5 +68,7 @@ status_t gic_unmask_interrupt(unsigned int vector);
 void gic_register_int_handler(unsigned int vector, int_handler func, void *arg);
 status_t gic_mask_interrupt(unsigned int vector);
 void gic_platform_fiq(struct arm_iframe *frame);
+void qgic_secondary_cpu_init(void);
+void qgic_send_sgi(uint8_t cpumask, uint8_t irq);
 
 #endif
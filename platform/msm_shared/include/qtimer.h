@@ -34,9 +34,13 @@
 #define QTMR_TIMER_CTRL_INT_MASK        (1 << 1)
 
 #define QTMR_PHY_CNT_MAX_VALUE          0xFFFFFFFFFFFFFF
+/* Longest interval the 32 bit down counter can be programmed with */
+#define QTMR_TVAL_MAX_VALUE             0x7FFFFFFF
 
 void qtimer_set_physical_timer(lk_time_t msecs_interval,
 	platform_timer_callback tmr_callback, void *tmr_arg);
+void qtimer_set_oneshot_timer(lk_time_t msecs_interval,
+	platform_timer_callback tmr_callback, void *tmr_arg);
 void qtimer_disable(void);
 uint64_t qtimer_get_phy_timer_cnt(void);
 uint32_t qtimer_current_time(void);
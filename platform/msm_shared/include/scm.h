@@ -320,6 +320,12 @@ int scm_xpu_err_fatal_init(void);
  * in x0-x3*/
 uint32_t scm_call2(scmcall_arg *arg, scmcall_ret *ret);
 
+/* PSCI, answered by TZ on the ARMv8 parts */
+#define PSCI_0_2_FN_CPU_ON          0x84000003
+#define PSCI_RET_ALREADY_ON         -4
+
+int scm_psci_cpu_on(uint32_t mpidr, paddr_t entry, uint32_t context_id);
+
 /**
  * struct scm_command - one SCM command buffer
  * @len: total available memory for command and response
@@ -32,6 +32,7 @@
 #include <reg.h>
 #include <bits.h>
 #include <kernel/event.h>
+#include <iovec.h>
 
 //#define DEBUG_SDHCI
 
@@ -72,6 +73,7 @@ struct sdhci_host {
 	uint16_t minor;          /* host controller major ver */
 	bool use_cdclp533;       /* Use cdclp533 calibration circuit */
 	event_t* sdhc_event;     /* Event for power control irqs */
+	struct desc_entry *adma_desc; /* Preallocated adma descriptor table */
 	struct host_caps caps;   /* Host capabilities */
 	struct sdhci_msm_data *msm_host; /* MSM specific host info */
 };
@@ -81,6 +83,8 @@ struct sdhci_host {
  */
 struct mmc_data {
 	void *data_ptr;      /* Points to stream of data */
+	iovec_t *iov;        /* Scatter list used instead of data_ptr if iov_cnt */
+	uint32_t iov_cnt;    /* Number of entries in iov */
 	uint32_t blk_sz;     /* Block size for the data */
 	uint32_t num_blocks; /* num of blocks, each always of size SDHCI_MMC_BLK_SZ */
 };
@@ -252,6 +256,10 @@ enum {
 #define SDHCI_ERR_INT_STAT_MASK                   0x8000
 #define SDHCI_ADMA_DESC_LINE_SZ                   65536
 #define SDHCI_ADMA_MAX_TRANS_SZ                   (65535 * 512)
+/* Max number of buffers in a scatter list */
+#define SDHCI_ADMA_MAX_SEGS                       16
+/* Descriptors for a max size transfer split over SDHCI_ADMA_MAX_SEGS buffers */
+#define SDHCI_ADMA_DESC_NUM                       ((SDHCI_ADMA_MAX_TRANS_SZ / SDHCI_ADMA_DESC_LINE_SZ) + SDHCI_ADMA_MAX_SEGS)
 #define SDHCI_ADMA_TRANS_VALID                    BIT(0)
 #define SDHCI_ADMA_TRANS_END                      BIT(1)
 #define SDHCI_ADMA_TRANS_DATA                     BIT(5)
@@ -369,6 +377,12 @@ enum {
 void     sdhci_init(struct sdhci_host *);
 /* API: Send the command & transfer data using adma */
 uint32_t sdhci_send_command(struct sdhci_host *, struct mmc_command *);
+/* API: Issue the command without waiting for it to complete */
+uint32_t sdhci_start_command(struct sdhci_host *, struct mmc_command *);
+/* API: Check if the command issued by sdhci_start_command has completed */
+bool     sdhci_command_done(struct sdhci_host *, struct mmc_command *);
+/* API: Wait for & complete the command issued by sdhci_start_command */
+uint32_t sdhci_finish_command(struct sdhci_host *, struct mmc_command *);
 /* API: Set the bus width for the contoller */
 uint8_t  sdhci_set_bus_width(struct sdhci_host *, uint16_t);
 /* API: Clock supply for the controller */
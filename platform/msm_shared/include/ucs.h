@@ -30,6 +30,11 @@
 #define _UCS_H
 
 #define SCSI_MAX_DATA_TRANS_BLK_LEN    0xFFFF
+#define SCSI_MAX_LBA_10                0xFFFFFFFFULL
+
+/* Read/write requests kept in flight and blocks (1MB) per request */
+#define UCS_QUEUE_DEPTH                8
+#define UCS_QUEUED_XFER_BLK_LEN        256
 #define UFS_DEFAULT_SECTORE_SIZE       4096
 
 #define SCSI_STATUS_GOOD               0x00
@@ -64,6 +69,8 @@ enum utp_scsi_cmd_type
 	SCSI_CMD_SYNC_CACHE10       = 0x35,
 	SCSI_CMD_UNMAP              = 0x42,
 	SCSI_CMD_WRITE10            = 0x2A,
+	SCSI_CMD_READ16             = 0x88,
+	SCSI_CMD_WRITE16            = 0x8A,
 	SCSI_CMD_SECPROT_IN         = 0xA2,     // Security Protocal in
 	SCSI_CMD_SECPROT_OUT        = 0xB5,     // Security Protocal out
 	SCSI_CMD_REPORT_LUNS        = 0xA0,
@@ -82,7 +89,7 @@ struct scsi_req_build_type
 struct scsi_rdwr_req
 {
 	uint8_t  lun;
-	uint32_t start_lba;
+	uint64_t start_lba;
 	uint32_t num_blocks;
 	uint32_t data_buffer_base;
 };
@@ -98,6 +105,16 @@ struct scsi_rdwr_cdb
 	uint8_t  resv[6];
 }__PACKED;
 
+struct scsi_rdwr16_cdb
+{
+	uint8_t  opcode;
+	uint8_t  cdb1;
+	uint64_t lba;
+	uint32_t trans_len;
+	uint8_t  grp_num;
+	uint8_t  control;
+}__PACKED;
+
 struct scsi_unmap_req
 {
 	uint8_t  lun;
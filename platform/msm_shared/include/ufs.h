@@ -106,6 +106,9 @@ struct ufs_dev
 	struct ufs_uic_meta_data     uic_data;
 };
 
+/* bProvisioningType: thin provisioning, unmapped blocks read as zero */
+#define UFS_PROV_TYPE_TPRZ       0x03
+
 /* Define all the basic WLUN type  */
 #define UFS_WLUN_REPORT          0x81
 #define UFS_UFS_DEVICE           0xD0
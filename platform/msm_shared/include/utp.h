@@ -143,7 +143,20 @@ struct utp_bitmap_access_type
 	mutex_t *mutx;
 };
 
+/* A transfer request in flight in one UTRD slot. */
+struct utp_queued_req
+{
+	struct upiu_gen_hdr       *req_upiu;
+	uint32_t                  cmd_desc_len;
+	struct utp_trans_req_desc *desc;
+	uint32_t                  door_bell_bit;
+	struct upiu_basic_hdr     resp_upiu;
+};
+
 int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data);
+int utp_submit_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data, struct utp_queued_req *qreq);
+uint32_t utp_poll_queued(struct ufs_dev *dev, uint32_t door_bell_bits);
+int utp_complete_upiu(struct ufs_dev *dev, struct utp_queued_req *qreq);
 void utp_process_req_completion(struct ufs_req_irq_type *irq);
 int utp_poll_utrd_complete(struct ufs_dev *dev);
 #endif
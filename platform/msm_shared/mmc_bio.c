@@ -0,0 +1,213 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <err.h>
+#include <arch/defines.h>
+#include <mmc_wrapper.h>
+#include <mmc_bio.h>
+#include <boot_device.h>
+
+#if WITH_LIB_BIO
+#include <lib/bio.h>
+
+/* Bounce buffer for callers handing in buffers that are not cache line aligned */
+#define MMC_BIO_BOUNCE_SIZE                 (64 * 1024)
+
+typedef struct {
+	bdev_t dev;
+	uint8_t lun;
+} mmc_bdev_t;
+
+static mmc_bdev_t *mmc_bdevs[MMC_BIO_MAX_LUNS];
+static uint8_t *mmc_bio_bounce;
+
+/*
+ * Run one transfer on the lun of the device, the raw api is lun relative
+ * on UFS and ignores the lun on eMMC.
+ */
+static uint32_t mmc_bio_xfer(mmc_bdev_t *mdev, void *buf, bnum_t block, uint count, bool write)
+{
+	uint64_t addr = (uint64_t)block * mdev->dev.block_size;
+	uint32_t len = count * mdev->dev.block_size;
+	uint8_t lun = mmc_get_lun();
+	uint32_t ret;
+
+	mmc_set_lun(mdev->lun);
+
+	if (write)
+		ret = mmc_write(addr, len, buf);
+	else
+		ret = mmc_read(addr, (uint32_t *)buf, len);
+
+	mmc_set_lun(lun);
+
+	return ret;
+}
+
+static ssize_t mmc_bio_rw_block(struct bdev *dev, void *buf, bnum_t block, uint count, bool write)
+{
+	mmc_bdev_t *mdev = (mmc_bdev_t *)dev;
+	uint8_t *ptr = (uint8_t *)buf;
+	uint chunk;
+	uint left = count;
+
+	/* dma straight into the caller's buffer when cache maintenance can't clobber its neighbours */
+	if (IS_CACHE_LINE_ALIGNED(buf) && IS_CACHE_LINE_ALIGNED(count * dev->block_size))
+	{
+		if (mmc_bio_xfer(mdev, buf, block, count, write))
+			return ERR_IO;
+
+		return count * dev->block_size;
+	}
+
+	if (!mmc_bio_bounce)
+	{
+		mmc_bio_bounce = memalign(CACHE_LINE, MMC_BIO_BOUNCE_SIZE);
+		if (!mmc_bio_bounce)
+			return ERR_NO_MEMORY;
+	}
+
+	while (left)
+	{
+		chunk = MIN(left, MMC_BIO_BOUNCE_SIZE / dev->block_size);
+
+		if (write)
+			memcpy(mmc_bio_bounce, ptr, chunk * dev->block_size);
+
+		if (mmc_bio_xfer(mdev, mmc_bio_bounce, block, chunk, write))
+			return ERR_IO;
+
+		if (!write)
+			memcpy(ptr, mmc_bio_bounce, chunk * dev->block_size);
+
+		ptr   += chunk * dev->block_size;
+		block += chunk;
+		left  -= chunk;
+	}
+
+	return count * dev->block_size;
+}
+
+static ssize_t mmc_bio_read_block(struct bdev *dev, void *buf, bnum_t block, uint count)
+{
+	return mmc_bio_rw_block(dev, buf, block, count, false);
+}
+
+static ssize_t mmc_bio_write_block(struct bdev *dev, const void *buf, bnum_t block, uint count)
+{
+	return mmc_bio_rw_block(dev, (void *)buf, block, count, true);
+}
+
+static int mmc_bio_ioctl(struct bdev *dev, int request, void *argp)
+{
+	mmc_bdev_t *mdev = (mmc_bdev_t *)dev;
+	struct bio_discard_range *range = argp;
+	uint8_t lun;
+	uint32_t ret;
+
+	switch (request)
+	{
+		case BIO_IOCTL_DISCARD:
+			if (!range || (range->offset % dev->block_size) || (range->len % dev->block_size))
+				return ERR_INVALID_ARGS;
+
+			if (bio_trim_range(dev, range->offset, range->len) != range->len)
+				return ERR_INVALID_ARGS;
+
+			/* a zero fill is an erase/unmap where the card reads those back
+			 * as zero, and unlike mmc_erase_card it leaves the scratch
+			 * region (the download buffer) alone */
+			lun = mmc_get_lun();
+			mmc_set_lun(mdev->lun);
+			ret = mmc_fill(range->offset, range->len, 0);
+			mmc_set_lun(lun);
+
+			return ret ? ERR_IO : NO_ERROR;
+		default:
+			return ERR_NOT_SUPPORTED;
+	}
+}
+
+/*
+ * Function: mmc bio get bdev
+ * Arg     : LUN, always 0 for eMMC
+ * Return  : Name of the raw block device, NULL on failure
+ * Flow    : Register the whole device (eMMC) or the LUN (UFS) with lib/bio
+ *           on first use.
+ */
+const char *mmc_bio_get_bdev(uint8_t lun)
+{
+	mmc_bdev_t *mdev;
+	char name[16];
+	uint8_t cur_lun;
+	uint32_t block_size;
+	uint64_t capacity;
+
+	if (lun >= MMC_BIO_MAX_LUNS)
+		return NULL;
+
+	if (mmc_bdevs[lun])
+		return mmc_bdevs[lun]->dev.name;
+
+	cur_lun = mmc_get_lun();
+	mmc_set_lun(lun);
+	block_size = mmc_get_device_blocksize();
+	capacity = mmc_get_device_capacity();
+	mmc_set_lun(cur_lun);
+
+	if (!block_size || !capacity)
+		return NULL;
+
+	if (platform_boot_dev_isemmc())
+		snprintf(name, sizeof(name), "mmc0");
+	else
+		snprintf(name, sizeof(name), "ufs_lun%u", lun);
+
+	mdev = malloc(sizeof(mmc_bdev_t));
+	if (!mdev)
+		return NULL;
+
+	bio_initialize_bdev(&mdev->dev, name, block_size, capacity / block_size);
+
+	mdev->lun             = lun;
+	mdev->dev.read_block  = &mmc_bio_read_block;
+	mdev->dev.write_block = &mmc_bio_write_block;
+	mdev->dev.ioctl       = &mmc_bio_ioctl;
+
+	bio_register_device(&mdev->dev);
+	mmc_bdevs[lun] = mdev;
+
+	return mdev->dev.name;
+}
+
+#endif /* WITH_LIB_BIO */
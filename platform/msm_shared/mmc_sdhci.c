@@ -1807,27 +1807,37 @@ static uint32_t mmc_stop_command(struct mmc_device *dev)
 }
 
 /*
- * Function: mmc sdhci read
- * Arg     : mmc device structure, block address, number of blocks & destination
- * Return  : 0 on Success, non zero on success
- * Flow    : Fill in the command structure & send the command
+ * Function: mmc sdhci prep rw
+ * Arg     : mmc device structure, command structure, block address,
+ *           number of blocks & transfer direction
+ * Return  : None
+ * Flow    : Fill in the read/write command structure, except the data
+ *           buffer
  */
-uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
-						uint64_t blk_addr, uint32_t num_blocks)
+static void mmc_sdhci_prep_rw(struct mmc_device *dev, struct mmc_command *cmd,
+							  uint64_t blk_addr, uint32_t num_blocks, uint32_t trans_mode)
 {
-	uint32_t mmc_ret = 0;
-	struct mmc_command cmd;
 	struct mmc_card *card = &dev->card;
 
-	memset((struct mmc_command *)&cmd, 0, sizeof(struct mmc_command));
+	memset(cmd, 0, sizeof(struct mmc_command));
 
-	/* CMD17/18 Format:
+	/* CMD17/18 & CMD24/25 Format:
 	 * [31:0] Data Address
 	 */
-	if (num_blocks == 1)
-		cmd.cmd_index = CMD17_READ_SINGLE_BLOCK;
+	if (trans_mode == SDHCI_MMC_READ)
+	{
+		if (num_blocks == 1)
+			cmd->cmd_index = CMD17_READ_SINGLE_BLOCK;
+		else
+			cmd->cmd_index = CMD18_READ_MULTIPLE_BLOCK;
+	}
 	else
-		cmd.cmd_index = CMD18_READ_MULTIPLE_BLOCK;
+	{
+		if (num_blocks == 1)
+			cmd->cmd_index = CMD24_WRITE_SINGLE_BLOCK;
+		else
+			cmd->cmd_index = CMD25_WRITE_MULTIPLE_BLOCK;
+	}
 
 	/*
 	 * Standard emmc cards use byte mode addressing
@@ -1835,14 +1845,13 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 	 * sending the command
 	 */
 	if (card->type == MMC_TYPE_STD_MMC)
-		cmd.argument = blk_addr * card->block_size;
+		cmd->argument = blk_addr * card->block_size;
 	else
-		cmd.argument = blk_addr;
+		cmd->argument = blk_addr;
 
-	cmd.cmd_type = SDHCI_CMD_TYPE_NORMAL;
-	cmd.resp_type = SDHCI_CMD_RESP_R1;
-	cmd.trans_mode = SDHCI_MMC_READ;
-	cmd.data_present = 0x1;
+	cmd->cmd_type = SDHCI_CMD_TYPE_NORMAL;
+	cmd->resp_type = SDHCI_CMD_RESP_R1;
+	cmd->trans_mode = trans_mode;
 
 	/* Use CMD23 If card supports CMD23:
 	 * For SD card use the value read from SCR register
@@ -1852,18 +1861,59 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 	 * enabled
 	 */
 	if (MMC_CARD_SD(card))
-		cmd.cmd23_support = dev->card.scr.cmd23_support;
+		cmd->cmd23_support = dev->card.scr.cmd23_support;
 	else
-		cmd.cmd23_support = 0x1;
+		cmd->cmd23_support = 0x1;
 
-	cmd.data.data_ptr = dest;
-	cmd.data.num_blocks = num_blocks;
+	cmd->data_present = 0x1;
+	cmd->data.num_blocks = num_blocks;
+}
 
-	/* send command */
-	mmc_ret = sdhci_send_command(&dev->host, &cmd);
+/*
+ * Function: mmc sdhci start rw
+ * Arg     : mmc device structure, command structure, data buffer,
+ *           block address, number of blocks & transfer direction
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Fill in the read/write command structure & issue the command
+ *           without waiting for the transfer to complete. The command
+ *           structure must stay valid until mmc_sdhci_finish_rw is called.
+ */
+uint32_t mmc_sdhci_start_rw(struct mmc_device *dev, struct mmc_command *cmd,
+							void *buf, uint64_t blk_addr, uint32_t num_blocks,
+							uint32_t trans_mode)
+{
+	mmc_sdhci_prep_rw(dev, cmd, blk_addr, num_blocks, trans_mode);
+
+	cmd->data.data_ptr = buf;
+
+	/* issue command */
+	return sdhci_start_command(&dev->host, cmd);
+}
+
+/*
+ * Function: mmc sdhci rw done
+ * Arg     : mmc device structure & command issued by mmc_sdhci_start_rw
+ * Return  : true if the transfer is over, false if still in progress
+ */
+bool mmc_sdhci_rw_done(struct mmc_device *dev, struct mmc_command *cmd)
+{
+	return sdhci_command_done(&dev->host, cmd);
+}
+
+/*
+ * Function: mmc sdhci finish rw
+ * Arg     : mmc device structure & command issued by mmc_sdhci_start_rw
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Wait for the transfer to complete & check the card status
+ */
+uint32_t mmc_sdhci_finish_rw(struct mmc_device *dev, struct mmc_command *cmd)
+{
+	uint32_t mmc_ret = 0;
 
-	/* For multi block read failures send stop command */
-	if (mmc_ret && num_blocks > 1)
+	mmc_ret = sdhci_finish_command(&dev->host, cmd);
+
+	/* For multi block read/write failures send stop command */
+	if (mmc_ret && cmd->data.num_blocks > 1)
 	{
 		return mmc_stop_command(dev);
 	}
@@ -1872,7 +1922,24 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 	 * Response contains 32 bit Card status.
 	 * Parse the errors & provide relevant information
 	 */
-	return mmc_parse_response(cmd.resp[0]);
+	return mmc_parse_response(cmd->resp[0]);
+}
+
+/*
+ * Function: mmc sdhci read
+ * Arg     : mmc device structure, block address, number of blocks & destination
+ * Return  : 0 on Success, non zero on success
+ * Flow    : Fill in the command structure & send the command
+ */
+uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
+						uint64_t blk_addr, uint32_t num_blocks)
+{
+	struct mmc_command cmd;
+
+	if (mmc_sdhci_start_rw(dev, &cmd, dest, blk_addr, num_blocks, SDHCI_MMC_READ))
+		return 1;
+
+	return mmc_sdhci_finish_rw(dev, &cmd);
 }
 
 /*
@@ -1884,64 +1951,37 @@ uint32_t mmc_sdhci_read(struct mmc_device *dev, void *dest,
 uint32_t mmc_sdhci_write(struct mmc_device *dev, void *src,
 						 uint64_t blk_addr, uint32_t num_blocks)
 {
-	uint32_t mmc_ret = 0;
 	struct mmc_command cmd;
-	struct mmc_card *card = &dev->card;
-
-	memset((struct mmc_command *)&cmd, 0, sizeof(struct mmc_command));
-
-	/* CMD24/25 Format:
-	 * [31:0] Data Address
-	 */
 
-	if (num_blocks == 1)
-		cmd.cmd_index = CMD24_WRITE_SINGLE_BLOCK;
-	else
-		cmd.cmd_index = CMD25_WRITE_MULTIPLE_BLOCK;
+	if (mmc_sdhci_start_rw(dev, &cmd, src, blk_addr, num_blocks, SDHCI_MMC_WRITE))
+		return 1;
 
-	/*
-	 * Standard emmc cards use byte mode addressing
-	 * convert the block address to byte address before
-	 * sending the command
-	 */
-	if (card->type == MMC_TYPE_STD_MMC)
-		cmd.argument = blk_addr * card->block_size;
-	else
-		cmd.argument = blk_addr;
-	cmd.cmd_type = SDHCI_CMD_TYPE_NORMAL;
-	cmd.resp_type = SDHCI_CMD_RESP_R1;
-	cmd.trans_mode = SDHCI_MMC_WRITE;
+	return mmc_sdhci_finish_rw(dev, &cmd);
+}
 
-	/* Use CMD23 If card supports CMD23:
-	 * For SD card use the value read from SCR register
-	 * For emmc by default use CMD23.
-	 * Also as per SDCC spec always use CMD23 to stop
-	 * multiblock read/write if UHS (Ultra High Speed) is
-	 * enabled
-	 */
-	if (MMC_CARD_SD(card))
-		cmd.cmd23_support = dev->card.scr.cmd23_support;
-	else
-		cmd.cmd23_support = 0x1;
+/*
+ * Function: mmc sdhci read iov
+ * Arg     : mmc device structure, scatter list, number of entries,
+ *           block address & number of blocks
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Read consecutive blocks into the buffers of the scatter list
+ *           with one command. Every buffer but the last must be a multiple
+ *           of the block size & all of them cache line aligned.
+ */
+uint32_t mmc_sdhci_read_iov(struct mmc_device *dev, iovec_t *iov, uint32_t iov_cnt,
+							uint64_t blk_addr, uint32_t num_blocks)
+{
+	struct mmc_command cmd;
 
-	cmd.data_present = 0x1;
-	cmd.data.data_ptr = src;
-	cmd.data.num_blocks = num_blocks;
+	mmc_sdhci_prep_rw(dev, &cmd, blk_addr, num_blocks, SDHCI_MMC_READ);
 
-	/* send command */
-	mmc_ret = sdhci_send_command(&dev->host, &cmd);
+	cmd.data.iov = iov;
+	cmd.data.iov_cnt = iov_cnt;
 
-	/* For multi block write failures send stop command */
-	if (mmc_ret && num_blocks > 1)
-	{
-		return mmc_stop_command(dev);
-	}
+	if (sdhci_start_command(&dev->host, &cmd))
+		return 1;
 
-	/*
-	 * Response contains 32 bit Card status.
-	 * Parse the errors & provide relevant information
-	 */
-	return mmc_parse_response(cmd.resp[0]);
+	return mmc_sdhci_finish_rw(dev, &cmd);
 }
 
 /*
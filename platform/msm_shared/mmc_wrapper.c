@@ -38,6 +38,20 @@
 #include <string.h>
 #include <partition_parser.h>
 #include <boot_device.h>
+#include <list.h>
+#include <arch/ops.h>
+
+/* Largest pattern buffer used by mmc_fill, one ADMA transfer at most */
+#define MMC_FILL_BUF_SZ                   MIN((1024 * 1024), SDHCI_ADMA_MAX_TRANS_SZ)
+
+/* Queue of pending asynchronous requests, the head one is on the bus */
+static struct list_node mmc_io_queue = LIST_INITIAL_VALUE(mmc_io_queue);
+/* Command of the transfer in flight & its length in bytes */
+static struct mmc_command mmc_io_cmd;
+static uint32_t mmc_io_xfer;
+static struct mmc_io_req *mmc_io_active;
+
+static void mmc_io_drain(void);
 
 /*
  * Weak function for UFS.
@@ -128,6 +142,8 @@ uint32_t mmc_write(uint64_t data_addr, uint32_t data_len, void *in)
 
 	if (platform_boot_dev_isemmc())
 	{
+		mmc_io_drain();
+
 		/* TODO: This function is aware of max data that can be
 		 * tranferred using sdhci adma mode, need to have a cleaner
 		 * implementation to keep this function independent of sdhci
@@ -190,6 +206,8 @@ uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
 
 	if (platform_boot_dev_isemmc())
 	{
+		mmc_io_drain();
+
 		/* TODO: This function is aware of max data that can be
 		 * tranferred using sdhci adma mode, need to have a cleaner
 		 * implementation to keep this function independent of sdhci
@@ -227,6 +245,304 @@ uint32_t mmc_read(uint64_t data_addr, uint32_t *out, uint32_t data_len)
 	return ret;
 }
 
+/*
+ * Function: mmc_read_iovec
+ * Arg     : Data address on card, scatter list & number of entries
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Read consecutive data from the card into the buffers of the
+ *           scatter list. Every buffer length must be a multiple of the
+ *           block size. On eMMC the list is read with as few adma
+ *           transfers as possible.
+ */
+uint32_t mmc_read_iovec(uint64_t data_addr, iovec_t *iov, uint32_t iov_cnt)
+{
+	uint32_t ret = 0;
+	uint32_t block_size;
+	uint32_t i;
+	uint32_t seg_cnt;
+	uint32_t xfer_len;
+	size_t pos = 0;
+	size_t len;
+	iovec_t seg[SDHCI_ADMA_MAX_SEGS];
+	void *dev;
+
+	dev = target_mmc_device();
+	block_size = mmc_get_device_blocksize();
+
+	ASSERT(!(data_addr % block_size));
+
+	for (i = 0; i < iov_cnt; i++)
+		ASSERT(!(iov[i].iov_len % block_size));
+
+	if (!platform_boot_dev_isemmc())
+	{
+		for (i = 0; i < iov_cnt; i++)
+		{
+			if (!iov[i].iov_len)
+				continue;
+
+			ret = mmc_read(data_addr, (uint32_t *)iov[i].iov_base, iov[i].iov_len);
+			if (ret)
+				return ret;
+
+			data_addr += iov[i].iov_len;
+		}
+
+		return 0;
+	}
+
+	mmc_io_drain();
+
+	i = 0;
+	while (i < iov_cnt)
+	{
+		/*
+		 * Gather as many buffers as fit in one adma transfer, a
+		 * buffer crossing the transfer limit is split
+		 */
+		seg_cnt = 0;
+		xfer_len = 0;
+		while (i < iov_cnt && seg_cnt < SDHCI_ADMA_MAX_SEGS && xfer_len < SDHCI_ADMA_MAX_TRANS_SZ)
+		{
+			len = MIN(iov[i].iov_len - pos, SDHCI_ADMA_MAX_TRANS_SZ - xfer_len);
+
+			if (len)
+			{
+				seg[seg_cnt].iov_base = (uint8_t *)iov[i].iov_base + pos;
+				seg[seg_cnt].iov_len = len;
+				seg_cnt++;
+			}
+
+			xfer_len += len;
+			pos += len;
+
+			if (pos == iov[i].iov_len)
+			{
+				pos = 0;
+				i++;
+			}
+		}
+
+		if (!xfer_len)
+			break;
+
+		ret = mmc_sdhci_read_iov((struct mmc_device *)dev, seg, seg_cnt, (data_addr / block_size), (xfer_len / block_size));
+		if (ret)
+		{
+			dprintf(CRITICAL, "Failed Reading block @ %llx\n", (data_addr / block_size));
+			return ret;
+		}
+
+		data_addr += xfer_len;
+	}
+
+	return 0;
+}
+
+/*
+ * Function: mmc io start
+ * Arg     : None
+ * Return  : None
+ * Flow    : Put the next segment of the request at the head of the
+ *           queue on the bus, if the bus is idle. A segment is at most
+ *           one adma transfer long.
+ */
+static void mmc_io_start(void)
+{
+	struct mmc_device *dev;
+	struct mmc_io_req *req;
+	uint32_t block_size;
+
+	if (mmc_io_active)
+		return;
+
+	dev = target_mmc_device();
+	block_size = mmc_get_device_blocksize();
+
+	while ((req = list_peek_head_type(&mmc_io_queue, struct mmc_io_req, node)))
+	{
+		mmc_io_xfer = MIN(req->data_len, SDHCI_ADMA_MAX_TRANS_SZ);
+
+		if (!mmc_sdhci_start_rw(dev, &mmc_io_cmd, req->buf, (req->data_addr / block_size),
+								(mmc_io_xfer / block_size), req->trans_mode))
+		{
+			mmc_io_active = req;
+			return;
+		}
+
+		dprintf(CRITICAL, "Failed to start transfer @ %llx\n", (req->data_addr / block_size));
+		req->status = 1;
+		req->done = true;
+		list_delete(&req->node);
+	}
+}
+
+/*
+ * Function: mmc io complete
+ * Arg     : None
+ * Return  : None
+ * Flow    : Wait for the segment in flight, account it to its request
+ *           & start the next segment
+ */
+static void mmc_io_complete(void)
+{
+	struct mmc_device *dev;
+	struct mmc_io_req *req = mmc_io_active;
+	uint32_t ret;
+
+	if (!req)
+		return;
+
+	dev = target_mmc_device();
+
+	ret = mmc_sdhci_finish_rw(dev, &mmc_io_cmd);
+	mmc_io_active = NULL;
+
+	if (ret)
+	{
+		dprintf(CRITICAL, "Failed %s block @ %llx\n",
+				(req->trans_mode == SDHCI_MMC_READ) ? "Reading" : "Writing",
+				(req->data_addr / mmc_get_device_blocksize()));
+		req->status = ret;
+		req->done = true;
+	}
+	else
+	{
+		req->buf += mmc_io_xfer;
+		req->data_addr += mmc_io_xfer;
+		req->data_len -= mmc_io_xfer;
+		req->done = !req->data_len;
+	}
+
+	if (req->done)
+		list_delete(&req->node);
+
+	mmc_io_start();
+}
+
+/*
+ * Function: mmc io drain
+ * Arg     : None
+ * Return  : None
+ * Flow    : Complete all the queued requests, needed before the bus is
+ *           used for anything else
+ */
+static void mmc_io_drain(void)
+{
+	while (mmc_io_active)
+		mmc_io_complete();
+}
+
+/*
+ * Function: mmc io submit
+ * Arg     : Request, data address on card, buffer, data length & direction
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Queue the request & start it if the bus is idle. UFS requests
+ *           are completed before returning.
+ */
+static uint32_t mmc_io_submit(struct mmc_io_req *req, uint64_t data_addr, void *buf,
+							  uint32_t data_len, uint32_t trans_mode)
+{
+	uint32_t block_size;
+
+	block_size = mmc_get_device_blocksize();
+
+	ASSERT(!(data_addr % block_size));
+
+	if (data_len % block_size)
+		data_len = ROUNDUP(data_len, block_size);
+
+	req->data_addr = data_addr;
+	req->buf = (uint8_t *)buf;
+	req->data_len = data_len;
+	req->trans_mode = trans_mode;
+	req->status = 0;
+	req->done = false;
+
+	if (!platform_boot_dev_isemmc())
+	{
+		if (trans_mode == SDHCI_MMC_READ)
+			req->status = mmc_read(data_addr, (uint32_t *)buf, data_len);
+		else
+			req->status = mmc_write(data_addr, data_len, buf);
+		req->done = true;
+		return req->status;
+	}
+
+	if (!data_len)
+	{
+		req->done = true;
+		return 0;
+	}
+
+	/*
+	 * The buffer belongs to the controller until the request is done,
+	 * make sure no dirty line is evicted over the data being transferred
+	 */
+	if (trans_mode == SDHCI_MMC_READ)
+		arch_invalidate_cache_range((addr_t)buf, data_len);
+	else
+		arch_clean_invalidate_cache_range((addr_t)buf, data_len);
+
+	list_add_tail(&mmc_io_queue, &req->node);
+	mmc_io_start();
+
+	return 0;
+}
+
+/*
+ * Function: mmc read async
+ * Arg     : Request, data address on card, o/p buffer & data length
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Queue a read of data_len bytes to out. The request & buffer
+ *           must not be touched until mmc_io_wait returns for it.
+ */
+uint32_t mmc_read_async(struct mmc_io_req *req, uint64_t data_addr, uint32_t *out, uint32_t data_len)
+{
+	return mmc_io_submit(req, data_addr, out, data_len, SDHCI_MMC_READ);
+}
+
+/*
+ * Function: mmc write async
+ * Arg     : Request, data address on card, data length & i/p buffer
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Queue a write of data_len bytes from in. The request & buffer
+ *           must not be touched until mmc_io_wait returns for it.
+ */
+uint32_t mmc_write_async(struct mmc_io_req *req, uint64_t data_addr, uint32_t data_len, void *in)
+{
+	return mmc_io_submit(req, data_addr, in, data_len, SDHCI_MMC_WRITE);
+}
+
+/*
+ * Function: mmc io poll
+ * Arg     : None
+ * Return  : true if no request is pending
+ * Flow    : Move the queue along without blocking, to be called from
+ *           loops doing other work while requests are in flight
+ */
+bool mmc_io_poll(void)
+{
+	if (mmc_io_active && mmc_sdhci_rw_done(target_mmc_device(), &mmc_io_cmd))
+		mmc_io_complete();
+
+	return list_is_empty(&mmc_io_queue);
+}
+
+/*
+ * Function: mmc io wait
+ * Arg     : Request queued by mmc_read_async/mmc_write_async
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Complete the queued requests up to & including req
+ */
+uint32_t mmc_io_wait(struct mmc_io_req *req)
+{
+	while (!req->done && mmc_io_active)
+		mmc_io_complete();
+
+	return req->status;
+}
+
 
 /*
  * Function: mmc get erase unit size
@@ -334,6 +650,8 @@ uint32_t mmc_erase_card(uint64_t addr, uint64_t len)
 
 	if (platform_boot_dev_isemmc())
 	{
+		mmc_io_drain();
+
 		erase_unit_sz = mmc_get_eraseunit_size();
 		dprintf(SPEW, "erase_unit_sz:0x%x\n", erase_unit_sz);
 
@@ -404,6 +722,142 @@ uint32_t mmc_erase_card(uint64_t addr, uint64_t len)
 	return 0;
 }
 
+/*
+ * Function: mmc erase reads zero
+ * Arg     : None
+ * Return  : true if erased (eMMC) or unmapped (UFS) blocks read back as zero
+ * Flow    : Check ERASED_MEM_CONT for eMMC, the LU provisioning type for UFS
+ */
+static bool mmc_erase_reads_zero(void)
+{
+	void *dev;
+
+	dev = target_mmc_device();
+
+	if (platform_boot_dev_isemmc())
+	{
+		struct mmc_card *card = &((struct mmc_device *)dev)->card;
+
+		return MMC_CARD_MMC(card) && !card->ext_csd[MMC_ERASED_MEM_CONT];
+	}
+	else
+	{
+		struct ufs_dev *ufs = (struct ufs_dev *)dev;
+
+		return ufs->lun_cfg[ufs->current_lun].provisioning_type == UFS_PROV_TYPE_TPRZ;
+	}
+}
+
+/*
+ * Function: mmc fill write
+ * Arg     : Data address on card, data length & 32 bit pattern
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Write the pattern replicated in a large buffer, so that each
+ *           write command covers up to MMC_FILL_BUF_SZ bytes
+ */
+static uint32_t mmc_fill_write(uint64_t data_addr, uint64_t data_len, uint32_t pattern)
+{
+	uint32_t buf_len = MIN(data_len, MMC_FILL_BUF_SZ);
+	uint32_t *buf;
+	uint32_t xfer;
+	uint32_t ret = 0;
+	uint32_t i;
+
+	if (!data_len)
+		return 0;
+
+	buf = (uint32_t *) memalign(CACHE_LINE, ROUNDUP(buf_len, CACHE_LINE));
+	if (!buf)
+	{
+		dprintf(CRITICAL, "Failed to allocate fill buffer\n");
+		return 1;
+	}
+
+	for (i = 0; i < buf_len / sizeof(uint32_t); i++)
+		buf[i] = pattern;
+
+	while (data_len)
+	{
+		xfer = MIN(data_len, buf_len);
+		ret = mmc_write(data_addr, xfer, buf);
+		if (ret)
+			break;
+
+		data_addr += xfer;
+		data_len -= xfer;
+	}
+
+	free(buf);
+
+	return ret;
+}
+
+/*
+ * Function: mmc fill
+ * Arg     : Data address on card, data length & 32 bit pattern
+ * Return  : 0 on Success, non zero on failure
+ * Flow    : Fill the range with the pattern. A zero pattern is turned into
+ *           an erase (eMMC) or unmap (UFS) of the whole erase units it
+ *           covers when the card reads erased blocks back as zero, only
+ *           the unaligned head & tail are written.
+ */
+uint32_t mmc_fill(uint64_t data_addr, uint64_t data_len, uint32_t pattern)
+{
+	void *dev;
+	uint32_t block_size;
+	uint64_t unit_sz;
+	uint64_t head;
+	uint64_t erase_len;
+	uint32_t ret;
+
+	dev = target_mmc_device();
+	block_size = mmc_get_device_blocksize();
+
+	ASSERT(!(data_addr % block_size));
+	ASSERT(!(data_len % block_size));
+
+	if (pattern || !mmc_erase_reads_zero())
+		return mmc_fill_write(data_addr, data_len, pattern);
+
+	/* UFS unmaps any block range, eMMC only erases whole groups */
+	if (platform_boot_dev_isemmc())
+		unit_sz = (uint64_t) mmc_get_eraseunit_size() * block_size;
+	else
+		unit_sz = block_size;
+
+	if (!unit_sz)
+		return mmc_fill_write(data_addr, data_len, pattern);
+
+	head = (unit_sz - (data_addr % unit_sz)) % unit_sz;
+	if (data_len < head + unit_sz)
+		return mmc_fill_write(data_addr, data_len, pattern);
+
+	erase_len = data_len - head;
+	erase_len -= erase_len % unit_sz;
+
+	ret = mmc_fill_write(data_addr, head, pattern);
+	if (ret)
+		return ret;
+
+	dprintf(SPEW, "Zero fill by erase: 0x%llx:0x%llx\n", data_addr + head, erase_len);
+
+	if (platform_boot_dev_isemmc())
+	{
+		mmc_io_drain();
+		ret = mmc_sdhci_erase((struct mmc_device *)dev, (data_addr + head) / block_size, erase_len);
+	}
+	else
+		ret = ufs_erase((struct ufs_dev *)dev, data_addr + head, erase_len / block_size);
+
+	if (ret)
+	{
+		dprintf(CRITICAL, "Erase failed for zero fill @ %llx\n", data_addr + head);
+		return ret;
+	}
+
+	return mmc_fill_write(data_addr + head + erase_len, data_len - head - erase_len, pattern);
+}
+
 /*
  * Function: mmc get psn
  * Arg     : None
@@ -517,6 +971,7 @@ void mmc_device_sleep(void)
 
 	if (platform_boot_dev_isemmc())
 	{
+		mmc_io_drain();
 		mmc_put_card_to_sleep((struct mmc_device *)dev);
 	}
 }
@@ -0,0 +1,64 @@
+/* Copyright (c) 2015, The Linux Foundation. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ *       copyright notice, this list of conditions and the following
+ *       disclaimer in the documentation and/or other materials provided
+ *       with the distribution.
+ *     * Neither the name of The Linux Foundation nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+ * IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <debug.h>
+#include <err.h>
+#include <kernel/mp.h>
+#include <qgic.h>
+#include <scm.h>
+
+/*
+ * Secondary cpu bring up for the ARMv8 parts (msm8916, msm8994), where TZ
+ * implements PSCI. The older Krait parts power their cores up through the
+ * APCS registers instead and are not handled here.
+ */
+status_t platform_mp_start_cpu(uint cpu, paddr_t entry)
+{
+	uint32_t mpidr = ((cpu / SMP_CPUS_PER_CLUSTER) << 8) | (cpu % SMP_CPUS_PER_CLUSTER);
+	int ret;
+
+	ret = scm_psci_cpu_on(mpidr, entry, cpu);
+	if (ret && ret != PSCI_RET_ALREADY_ON) {
+		dprintf(CRITICAL, "PSCI cpu_on for cpu %u (mpidr 0x%x) failed: %d\n", cpu, mpidr, ret);
+		return ERR_GENERIC;
+	}
+
+	return NO_ERROR;
+}
+
+void platform_mp_init_percpu(void)
+{
+	qgic_secondary_cpu_init();
+}
+
+status_t platform_mp_send_ipi(mp_cpu_mask_t target, mp_ipi_t ipi)
+{
+	qgic_send_sgi(target, MP_IPI_SGI_BASE + ipi);
+
+	return NO_ERROR;
+}
@@ -32,6 +32,11 @@
 #include <assert.h>
 #include <mmc.h>
 #include <partition_parser.h>
+#include <lib/cksum.h>
+#if WITH_LIB_BIO
+#include <lib/bio.h>
+#include <mmc_bio.h>
+#endif
 
 __WEAK void mmc_set_lun(uint8_t lun)
 {
@@ -42,6 +47,13 @@ __WEAK uint8_t mmc_get_lun(void)
 	return 0;
 }
 
+#if WITH_LIB_BIO
+__WEAK const char *mmc_bio_get_bdev(uint8_t lun)
+{
+	return NULL;
+}
+#endif
+
 __WEAK void mmc_read_partition_table(uint8_t arg)
 {
 	if(partition_read_table())
@@ -82,6 +94,118 @@ struct partition_entry *partition_entries;
 static unsigned gpt_partitions_exist = 0;
 static unsigned partition_count;
 
+/*
+ * Name lookup index over partition_entries, built as the table is read.
+ * Open addressing with linear probing, slots hold entry index + 1 (0 = free).
+ * Entries are inserted in table order so the first match found for a name
+ * is always the lowest index, same as the linear scan it replaces.
+ */
+#define PARTITION_HASH_SIZE        (NUM_PARTITIONS * 2)
+static uint16_t partition_hash[PARTITION_HASH_SIZE];
+static uint8_t partition_name_len[NUM_PARTITIONS];
+static unsigned partition_indexed;
+
+static uint32_t partition_name_hash(const char *name, unsigned *len)
+{
+	uint32_t hash = 2166136261U;	/* FNV-1a */
+	unsigned n = 0;
+
+	while (name[n]) {
+		hash = (hash ^ (uint8_t)name[n]) * 16777619U;
+		n++;
+	}
+	*len = n;
+
+	return hash;
+}
+
+static void partition_index_reset(void)
+{
+	memset(partition_hash, 0, sizeof(partition_hash));
+	partition_indexed = 0;
+}
+
+/* Index the entries added since the last call */
+static void partition_index_update(void)
+{
+	uint32_t slot;
+	unsigned len;
+
+	for (; partition_indexed < partition_count; partition_indexed++) {
+		slot = partition_name_hash((const char *)partition_entries[partition_indexed].name, &len);
+		partition_name_len[partition_indexed] = len;
+		while (partition_hash[slot % PARTITION_HASH_SIZE])
+			slot++;
+		partition_hash[slot % PARTITION_HASH_SIZE] = partition_indexed + 1;
+	}
+}
+
+#if WITH_LIB_BIO
+static unsigned partition_published;
+
+/* Publish the entries added since the last call as bio subdevices of their lun */
+static void partition_bio_publish(void)
+{
+	struct partition_entry *ptn;
+	const char *parent;
+	bdev_t *dev;
+
+	for (; partition_published < partition_count; partition_published++) {
+		ptn = &partition_entries[partition_published];
+
+		parent = mmc_bio_get_bdev(ptn->lun);
+		if (!parent || !ptn->name[0])
+			continue;
+
+		/* names can repeat across luns, the first one wins as in partition_get_index */
+		dev = bio_open((const char *)ptn->name);
+		if (dev) {
+			bio_close(dev);
+			continue;
+		}
+
+		if (bio_publish_subdevice(parent, (const char *)ptn->name,
+					  ptn->first_lba, ptn->size))
+			dprintf(CRITICAL, "Failed to publish partition %s\n", ptn->name);
+	}
+}
+
+static void partition_bio_unpublish(void)
+{
+	bdev_t *dev;
+	unsigned i;
+
+	for (i = 0; i < partition_published; i++) {
+		dev = bio_open((const char *)partition_entries[i].name);
+		if (!dev)
+			continue;
+
+		bio_unregister_device(dev);
+		bio_close(dev);
+	}
+	partition_published = 0;
+}
+#endif
+
+/* Look up name, restricted to one lun unless lun is negative */
+static int partition_index_find(const char *name, int lun)
+{
+	uint32_t slot;
+	unsigned len;
+	unsigned n;
+
+	slot = partition_name_hash(name, &len);
+	while ((n = partition_hash[slot % PARTITION_HASH_SIZE])) {
+		n--;
+		if (partition_name_len[n] == len &&
+		    !memcmp(name, partition_entries[n].name, len) &&
+		    (lun < 0 || partition_entries[n].lun == lun))
+			return n;
+		slot++;
+	}
+	return INVALID_PTN;
+}
+
 unsigned int partition_read_table()
 {
 	unsigned int ret;
@@ -100,7 +224,7 @@ unsigned int partition_read_table()
 	ret = mmc_boot_read_mbr(block_size);
 	if (ret) {
 		dprintf(CRITICAL, "MMC Boot: MBR read failed!\n");
-		return 1;
+		goto end;
 	}
 
 	/* Read GPT of the card if exist */
@@ -108,10 +232,16 @@ unsigned int partition_read_table()
 		ret = mmc_boot_read_gpt(block_size);
 		if (ret) {
 			dprintf(CRITICAL, "MMC Boot: GPT read failed!\n");
-			return 1;
+			goto end;
 		}
 	}
-	return 0;
+end:
+	/* Index whatever was read, including the entries of a partial table */
+	partition_index_update();
+#if WITH_LIB_BIO
+	partition_bio_publish();
+#endif
+	return ret ? 1 : 0;
 }
 
 /*
@@ -475,55 +605,12 @@ static unsigned int write_mbr(uint32_t size, uint8_t *mbrImage, uint32_t block_s
 	return ret;
 }
 
-/*
- * A8h reflected is 15h, i.e. 10101000 <--> 00010101
-*/
-int reflect(int data, int len)
-{
-	int ref = 0;
-
-	for (int i = 0; i < len; i++) {
-		if (data & 0x1) {
-			ref |= (1 << ((len - 1) - i));
-		}
-		data = (data >> 1);
-	}
-
-	return ref;
-}
-
 /*
 * Function to calculate the CRC32
 */
 unsigned int calculate_crc32(unsigned char *buffer, int len)
 {
-	int byte_length = 8;	/*length of unit (i.e. byte) */
-	int msb = 0;
-	int polynomial = 0x04C11DB7;	/* IEEE 32bit polynomial */
-	unsigned int regs = 0xFFFFFFFF;	/* init to all ones */
-	int regs_mask = 0xFFFFFFFF;	/* ensure only 32 bit answer */
-	int regs_msb = 0;
-	unsigned int reflected_regs;
-
-	for (int i = 0; i < len; i++) {
-		int data_byte = buffer[i];
-		data_byte = reflect(data_byte, 8);
-		for (int j = 0; j < byte_length; j++) {
-			msb = data_byte >> (byte_length - 1);	/* get MSB */
-			msb &= 1;	/* ensure just 1 bit */
-			regs_msb = (regs >> 31) & 1;	/* MSB of regs */
-			regs = regs << 1;	/* shift regs for CRC-CCITT */
-			if (regs_msb ^ msb) {	/* MSB is a 1 */
-				regs = regs ^ polynomial;	/* XOR with generator poly */
-			}
-			regs = regs & regs_mask;	/* Mask off excess upper bits */
-			data_byte <<= 1;	/* get to next bit */
-		}
-	}
-	regs = regs & regs_mask;
-	reflected_regs = reflect(regs, 32) ^ 0xFFFFFFFF;
-
-	return reflected_regs;
+	return crc32(0, buffer, len);
 }
 
 /*
@@ -741,7 +828,11 @@ static unsigned int write_gpt(uint32_t size, uint8_t *gptImage, uint32_t block_s
 
 	/* Re-read the GPT partition table */
 	dprintf(INFO, "Re-reading the GPT Partition Table\n");
+#if WITH_LIB_BIO
+	partition_bio_unpublish();
+#endif
 	partition_count = 0;
+	partition_index_reset();
 	mmc_read_partition_table(0);
 	partition_dump();
 	dprintf(CRITICAL, "GPT: Partition Table written\n");
@@ -866,22 +957,55 @@ mbr_fill_name(struct partition_entry *partition_ent, unsigned int type)
  */
 int partition_get_index(const char *name)
 {
-	unsigned int input_string_length = strlen(name);
-	unsigned n;
+	if( partition_count >= NUM_PARTITIONS)
+	{
+		return INVALID_PTN;
+	}
+	return partition_index_find(name, -1);
+}
 
+/*
+ * Find index of partition on a given lun, for names repeated across luns
+ */
+int partition_get_index_lun(const char *name, uint8_t lun)
+{
 	if( partition_count >= NUM_PARTITIONS)
 	{
 		return INVALID_PTN;
 	}
-	for (n = 0; n < partition_count; n++) {
-		if (!memcmp
-		    (name, &partition_entries[n].name, input_string_length)
-		    && input_string_length ==
-		    strlen((const char *)&partition_entries[n].name)) {
-			return n;
-		}
+	return partition_index_find(name, lun);
+}
+
+/*
+ * Find index of partition given as "name" or "name:lun", as fastboot's
+ * flash takes it, the latter reaching a name repeated on a later lun
+ */
+int partition_get_index_spec(const char *spec)
+{
+	char name[MAX_GPT_NAME_SIZE];
+	const char *sep;
+	const char *p;
+	unsigned lun = 0;
+
+	sep = strrchr(spec, ':');
+	if (!sep)
+		return partition_get_index(spec);
+
+	if (!sep[1] || (size_t)(sep - spec) >= sizeof(name))
+		return INVALID_PTN;
+
+	for (p = sep + 1; *p; p++) {
+		if (*p < '0' || *p > '9')
+			return INVALID_PTN;
+		lun = lun * 10 + (*p - '0');
+		if (lun > UINT8_MAX)
+			return INVALID_PTN;
 	}
-	return INVALID_PTN;
+
+	memcpy(name, spec, sep - spec);
+	name[sep - spec] = '\0';
+
+	return partition_get_index_lun(name, lun);
 }
 
 /* Get size of the partition */
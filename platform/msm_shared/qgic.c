@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <arch/arm.h>
 #include <kernel/thread.h>
+#include <kernel/mp.h>
 #include <platform/irqs.h>
 #include <qgic.h>
 
@@ -124,20 +125,51 @@ void qgic_init(void)
 {
 	qgic_dist_init();
 	qgic_cpu_init();
+
+#if WITH_SMP
+	gic_register_int_handler(MP_IPI_SGI_BASE + MP_IPI_RESCHEDULE, mp_mbx_reschedule_irq, NULL);
+	gic_register_int_handler(MP_IPI_SGI_BASE + MP_IPI_TICK, mp_mbx_tick_irq, NULL);
+#endif
+}
+
+#if WITH_SMP
+/* Initialize the banked SGI/PPI state and cpu interface of a secondary cpu */
+void qgic_secondary_cpu_init(void)
+{
+	uint32_t i;
+
+	writel(0xffff0000, GIC_DIST_ENABLE_CLEAR);
+	writel(0x0000ffff, GIC_DIST_ENABLE_SET);
+
+	for (i = 0; i < 32; i += 4)
+		writel(0xa0a0a0a0, GIC_DIST_PRI + i);
+
+	qgic_cpu_init();
+}
+
+/* Raise software interrupt irq on the cpus in cpumask */
+void qgic_send_sgi(uint8_t cpumask, uint8_t irq)
+{
+	/* make the caller's writes visible before the target takes the irq */
+	dsb();
+	writel((cpumask << 16) | irq, GIC_DIST_SOFTINT);
 }
+#endif
 
 /* IRQ handler */
 enum handler_return gic_platform_irq(struct arm_iframe *frame)
 {
-	uint32_t num;
+	uint32_t iar, num;
 	enum handler_return ret;
 
-	num = readl(GIC_CPU_INTACK);
+	/* for SGIs the upper bits hold the sending cpu, and the EOI has to match */
+	iar = readl(GIC_CPU_INTACK);
+	num = iar & 0x3ff;
 	if (num >= NR_IRQS)
 		return 0;
 
 	ret = handler[num].func(handler[num].arg);
-	writel(num, GIC_CPU_EOI);
+	writel(iar, GIC_CPU_EOI);
 
 	return ret;
 }
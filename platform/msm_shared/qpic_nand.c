@@ -51,8 +51,22 @@ static uint32_t ecc_bch_cfg;
 
 struct cmd_element ce_array[100];
 
-#define QPIC_BAM_DATA_FIFO_SIZE          64
-#define QPIC_BAM_CMD_FIFO_SIZE           64
+#define QPIC_BAM_DATA_FIFO_SIZE          128
+#define QPIC_BAM_CMD_FIFO_SIZE           128
+
+/* Max pages queued in one BAM batch by flash_read_ext. The batch is
+ * trimmed further at init so that it fits in the descriptor FIFOs.
+ */
+#define QPIC_NAND_READ_BATCH_PAGES       8
+
+/* Cmd elements per page read: erased CW detection reset/activate, addr/cfg,
+ * ECC cfg, read location 1 and erased CW status once per page, plus cmd,
+ * read location 0, exec and two status reads per codeword.
+ */
+#define QPIC_NAND_READ_CE_PER_PAGE       (9 + 5 * QPIC_NAND_MAX_CWS_IN_PAGE)
+
+/* Blocks whose bad block marker is read in one BAM batch at init. */
+#define QPIC_NAND_BBT_SCAN_BATCH         16
 
 static struct bam_desc cmd_desc_fifo[QPIC_BAM_CMD_FIFO_SIZE] __attribute__ ((aligned(BAM_DESC_SIZE)));
 static struct bam_desc data_desc_fifo[QPIC_BAM_DATA_FIFO_SIZE] __attribute__ ((aligned(BAM_DESC_SIZE)));
@@ -62,6 +76,12 @@ static uint8_t *bbtbl;
 
 static uint8_t* rdwr_buf;
 
+static uint32_t read_batch_pages;
+static struct cmd_element read_ce_array[QPIC_NAND_READ_BATCH_PAGES * QPIC_NAND_READ_CE_PER_PAGE];
+static uint32_t read_flash_sts[QPIC_NAND_READ_BATCH_PAGES][QPIC_NAND_MAX_CWS_IN_PAGE];
+static uint32_t read_buffer_sts[QPIC_NAND_READ_BATCH_PAGES][QPIC_NAND_MAX_CWS_IN_PAGE];
+static uint32_t read_erased_sts[QPIC_NAND_READ_BATCH_PAGES];
+
 static struct flash_id supported_flash[] = {
 	/* Flash ID    ID Mask      Density(MB)    Wid Pgsz    Blksz              oobsz   8-bit ECCf */
 	{0x1590AC2C,   0xFFFFFFFF,  0x20000000,    0,  2048,   0x00020000,        0x40,   0},
@@ -155,24 +175,21 @@ qpic_nand_erased_status_reset(struct cmd_element *cmd_list_ptr, uint8_t flags)
 	qpic_nand_wait_for_cmd_exec(1);
 }
 
+/* Checks a flash status given the erased CW detection status
+ * of the same page read.
+ */
 static nand_result_t
-qpic_nand_check_status(uint32_t status)
+qpic_nand_check_read_status(uint32_t status, uint32_t erase_sts)
 {
-	uint32_t erase_sts;
-
 	/* Check for errors */
 	if (status & NAND_FLASH_ERR)
 	{
 		/* Check if this is an ECC error on an erased page. */
-		if (status & NAND_FLASH_OP_ERR)
+		if ((status & NAND_FLASH_OP_ERR) &&
+			(erase_sts & (1 << NAND_ERASED_CW_DETECT_STATUS_PAGE_ALL_ERASED)))
 		{
-			erase_sts = qpic_nand_read_reg(NAND_ERASED_CW_DETECT_STATUS, 0, ce_array);
-			if ((erase_sts & (1 << NAND_ERASED_CW_DETECT_STATUS_PAGE_ALL_ERASED)))
-			{
-				/* Mask the OP ERROR. */
-				status &= ~NAND_FLASH_OP_ERR;
-				qpic_nand_erased_status_reset(ce_array, 0);
-			}
+			/* Mask the OP ERROR. */
+			status &= ~NAND_FLASH_OP_ERR;
 		}
 
 		/* ECC error flagged on an erased page read.
@@ -192,6 +209,21 @@ qpic_nand_check_status(uint32_t status)
 	return NANDC_RESULT_SUCCESS;
 }
 
+static nand_result_t
+qpic_nand_check_status(uint32_t status)
+{
+	uint32_t erase_sts = 0;
+
+	if ((status & NAND_FLASH_ERR) && (status & NAND_FLASH_OP_ERR))
+	{
+		erase_sts = qpic_nand_read_reg(NAND_ERASED_CW_DETECT_STATUS, 0, ce_array);
+		if ((erase_sts & (1 << NAND_ERASED_CW_DETECT_STATUS_PAGE_ALL_ERASED)))
+			qpic_nand_erased_status_reset(ce_array, 0);
+	}
+
+	return qpic_nand_check_read_status(status, erase_sts);
+}
+
 static uint32_t
 qpic_nand_fetch_id(struct flash_info *flash)
 {
@@ -818,13 +850,58 @@ qpic_nand_block_isbad_exec(struct cfg_params *params,
 	return nand_ret;
 }
 
+/* Fills in the params to read the bad block marker of the block
+ * starting at page: 4 raw bytes at the start of the spare area.
+ */
+static void
+qpic_nand_isbad_params(uint32_t page, struct cfg_params *params)
+{
+	/* Read page cmd */
+	params->cmd =  NAND_CMD_PAGE_READ_ECC;
+	/* Clear the CW per page bits */
+	params->cfg0 = cfg0_raw & ~(7U << NAND_DEV0_CFG0_CW_PER_PAGE_SHIFT);
+	params->cfg1 = cfg1_raw;
+	/* addr0 - Write column addr + few bits in row addr upto 32 bits. */
+	params->addr0 = (page << 16) | (USER_DATA_BYTES_PER_CW * flash.cws_per_page);
+
+	/* addr1 - Write rest of row addr.
+	 * This will be all 0s.
+	 */
+	params->addr1 = (page >> 16) & 0xff;
+	params->addr_loc_0 = NAND_RD_LOC_OFFSET(0);
+	params->addr_loc_0 |= NAND_RD_LOC_LAST_BIT(1);
+	params->addr_loc_0 |= NAND_RD_LOC_SIZE(4); /* Read 4 bytes */
+	params->ecc_cfg = ecc_bch_cfg | 0x1; /* Disable ECC */
+	params->exec = 1;
+}
+
+/* Records the bad block marker read for blk in the bad block table. */
+static int
+qpic_nand_bbt_update(uint32_t blk, uint8_t *bad_block)
+{
+	if (flash.widebus)
+	{
+		if (bad_block[0] != 0xFF && bad_block[1] != 0xFF)
+		{
+			bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_BAD;
+			return NANDC_RESULT_BAD_BLOCK;
+		}
+	}
+	else if (bad_block[0] != 0xFF)
+	{
+		bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_BAD;
+		return NANDC_RESULT_BAD_BLOCK;
+	}
+
+	bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_GOOD;
+	return NANDC_RESULT_SUCCESS;
+}
+
 static int
 qpic_nand_block_isbad(unsigned page)
 {
-	unsigned cwperpage;
 	struct cfg_params params;
 	uint8_t bad_block[4];
-	unsigned nand_ret = NANDC_RESULT_SUCCESS;
 	uint32_t blk = page / flash.num_pages_per_blk;
 
 	if (bbtbl[blk] == NAND_BAD_BLK_VALUE_IS_GOOD)
@@ -836,26 +913,7 @@ qpic_nand_block_isbad(unsigned page)
 		/* Read the bad block value from the flash.
 		 * Bad block value is stored in the first page of the block.
 		 */
-		/* Read the first page in the block. */
-		cwperpage = flash.cws_per_page;
-
-		/* Read page cmd */
-		params.cmd =  NAND_CMD_PAGE_READ_ECC;
-		/* Clear the CW per page bits */
-		params.cfg0 = cfg0_raw & ~(7U << NAND_DEV0_CFG0_CW_PER_PAGE_SHIFT);
-		params.cfg1 = cfg1_raw;
-		/* addr0 - Write column addr + few bits in row addr upto 32 bits. */
-		params.addr0 = (page << 16) | (USER_DATA_BYTES_PER_CW * cwperpage);
-
-		/* addr1 - Write rest of row addr.
-		 * This will be all 0s.
-		 */
-		params.addr1 = (page >> 16) & 0xff;
-		params.addr_loc_0 = NAND_RD_LOC_OFFSET(0);
-		params.addr_loc_0 |= NAND_RD_LOC_LAST_BIT(1);
-		params.addr_loc_0 |= NAND_RD_LOC_SIZE(4); /* Read 4 bytes */
-		params.ecc_cfg = ecc_bch_cfg | 0x1; /* Disable ECC */
-		params.exec = 1;
+		qpic_nand_isbad_params(page - (page & flash.num_pages_per_blk_mask), &params);
 
 		if (qpic_nand_block_isbad_exec(&params, bad_block))
 		{
@@ -864,24 +922,102 @@ qpic_nand_block_isbad(unsigned page)
 			return NANDC_RESULT_FAILURE;
 		}
 
-		if (flash.widebus)
-		{
-			if (bad_block[0] != 0xFF && bad_block[1] != 0xFF)
-			{
-				bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_BAD;
-				nand_ret = NANDC_RESULT_BAD_BLOCK;
-			}
-		}
-		else if (bad_block[0] != 0xFF)
-		{
-			bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_BAD;
-			nand_ret = NANDC_RESULT_BAD_BLOCK;
-		}
-		else
-			bbtbl[blk] = NAND_BAD_BLK_VALUE_IS_GOOD;
+		return qpic_nand_bbt_update(blk, bad_block);
+	}
+}
+
+/* Reads the bad block markers of nblks blocks from blk in a single
+ * BAM batch and records them in the bad block table. Blocks whose
+ * marker read fails are left unread, qpic_nand_block_isbad retries them.
+ */
+static void
+qpic_nand_scan_bbt_batch(uint32_t blk, uint32_t nblks)
+{
+	static uint8_t markers[QPIC_NAND_BBT_SCAN_BATCH][4];
+	static uint32_t status[QPIC_NAND_BBT_SCAN_BATCH];
+	struct cfg_params params;
+	struct cmd_element *cmd_list_ptr = read_ce_array;
+	struct cmd_element *cmd_list_ptr_start;
+	uint8_t flags;
+	uint32_t i;
+
+	for (i = 0; i < nblks; i++)
+	{
+		qpic_nand_isbad_params((blk + i) * flash.num_pages_per_blk, &params);
+
+		cmd_list_ptr_start = cmd_list_ptr;
+		cmd_list_ptr = qpic_nand_add_isbad_cmd_ce(&params, cmd_list_ptr);
+
+		flags = BAM_DESC_NWD_FLAG | BAM_DESC_CMD_FLAG;
+		if (i == 0)
+			flags |= BAM_DESC_LOCK_FLAG;
+
+		bam_add_one_desc(&bam,
+						 CMD_PIPE_INDEX,
+						 (unsigned char*)PA((addr_t)cmd_list_ptr_start),
+						 PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_ptr_start),
+						 flags);
 
-		return nand_ret;
+		/* Interrupt once the marker of the last block is in. */
+		bam_add_one_desc(&bam,
+						 DATA_PRODUCER_PIPE_INDEX,
+						 (unsigned char *)PA((addr_t)markers[i]),
+						 4,
+						 (i == nblks - 1) ? BAM_DESC_INT_FLAG : 0);
+		bam_sys_gen_event(&bam, DATA_PRODUCER_PIPE_INDEX, 1);
+
+		cmd_list_ptr_start = cmd_list_ptr;
+		bam_add_cmd_element(cmd_list_ptr, NAND_FLASH_STATUS, (uint32_t)PA((addr_t)&status[i]), CE_READ_TYPE);
+		cmd_list_ptr++;
+
+		flags = BAM_DESC_CMD_FLAG;
+		if (i == nblks - 1)
+			flags |= BAM_DESC_UNLOCK_FLAG;
+
+		bam_add_one_desc(&bam,
+						 CMD_PIPE_INDEX,
+						 (unsigned char*)PA((addr_t)cmd_list_ptr_start),
+						 PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_ptr_start),
+						 flags);
+
+		/* Notify BAM HW about the newly added descriptors */
+		bam_sys_gen_event(&bam, CMD_PIPE_INDEX, 2);
 	}
+
+	qpic_nand_wait_for_data(DATA_PRODUCER_PIPE_INDEX);
+
+	for (i = 0; i < nblks; i++)
+	{
+		if (qpic_nand_check_read_status(status[i], 0))
+			continue;
+
+		qpic_nand_bbt_update(blk + i, markers[i]);
+	}
+}
+
+/* Builds the bad block table for the whole device, so that reads only
+ * ever look blocks up in memory.
+ */
+static void
+qpic_nand_scan_bbt(void)
+{
+	uint32_t blk;
+	uint32_t nblks;
+	uint32_t bad = 0;
+
+	for (blk = 0; blk < flash.num_blocks; blk += nblks)
+	{
+		nblks = MIN(flash.num_blocks - blk, QPIC_NAND_BBT_SCAN_BATCH);
+		qpic_nand_scan_bbt_batch(blk, nblks);
+	}
+
+	for (blk = 0; blk < flash.num_blocks; blk++)
+	{
+		if (bbtbl[blk] == NAND_BAD_BLK_VALUE_IS_BAD)
+			bad++;
+	}
+
+	dprintf(INFO, "NAND: %u bad blocks out of %u\n", bad, flash.num_blocks);
 }
 
 /* Function to erase a block on the nand.
@@ -1174,6 +1310,8 @@ qpic_nand_mark_badblock(uint32_t page)
 	if (page & flash.num_pages_per_blk_mask)
 		page = page - (page & flash.num_pages_per_blk_mask);
 
+	bbtbl[page / flash.num_pages_per_blk] = NAND_BAD_BLK_VALUE_IS_BAD;
+
 	return qpic_nand_write_page(page, NAND_CFG_RAW, empty_buf, 0);
 }
 
@@ -1283,13 +1421,22 @@ qpic_nand_init(struct qpic_nand_init_config *config)
 	for (i = 0; i < flash.num_blocks; i++)
 		bbtbl[i] = NAND_BAD_BLK_VALUE_NOT_READ;
 
+	/* Batch as many pages per read as the descriptor FIFOs hold:
+	 * one erased CW reset desc plus two cmd descs per codeword,
+	 * and a data desc per codeword plus one for the spare bytes.
+	 */
+	read_batch_pages = QPIC_NAND_READ_BATCH_PAGES;
+	read_batch_pages = MIN(read_batch_pages, (QPIC_BAM_CMD_FIFO_SIZE - 1) / (2 * flash.cws_per_page + 1));
+	read_batch_pages = MIN(read_batch_pages, (QPIC_BAM_DATA_FIFO_SIZE - 1) / (flash.cws_per_page + 1));
+
 	/* Set aside contiguous memory for reads/writes.
 	 * This is needed as the BAM transfers only work with
 	 * physically contiguous buffers.
 	 * We will copy any data to be written/ to be read from
 	 * nand to this buffer and this buffer will be submitted to BAM.
+	 * Reads use it for a whole batch: the pages, then their spare bytes.
 	 */
-	rdwr_buf = (uint8_t*) malloc(flash.page_size + flash.spare_size);
+	rdwr_buf = (uint8_t*) malloc(read_batch_pages * (flash.page_size + flash.spare_size));
 
 	if (rdwr_buf == NULL)
 	{
@@ -1297,6 +1444,7 @@ qpic_nand_init(struct qpic_nand_init_config *config)
 		return;
 	}
 
+	qpic_nand_scan_bbt();
 }
 
 unsigned
@@ -1338,25 +1486,32 @@ flash_set_ptable(struct ptable *new_ptable)
 	flash_ptable = new_ptable;
 }
 
-/* Note: No support for raw reads. */
+/* Reads npages consecutive pages, all in one block, in a single BAM batch.
+ * Page n is read to buffer + n * stride and its spare bytes to
+ * spareaddr + n * spare_stride. nread returns the number of pages read
+ * before the first one that failed.
+ * Note: No support for raw reads.
+ */
 static int
-qpic_nand_read_page(uint32_t page, unsigned char* buffer, unsigned char* spareaddr)
+qpic_nand_read_pages(uint32_t page, uint32_t npages,
+					 unsigned char *buffer, uint32_t stride,
+					 unsigned char *spareaddr, uint32_t spare_stride,
+					 uint32_t *nread)
 {
 	struct cfg_params params;
 	uint32_t ecc;
-	uint32_t flash_sts[QPIC_NAND_MAX_CWS_IN_PAGE];
-	uint32_t buffer_sts[QPIC_NAND_MAX_CWS_IN_PAGE];
 	uint32_t addr_loc_0;
 	uint32_t addr_loc_1;
-	struct cmd_element *cmd_list_ptr = ce_array;
-	struct cmd_element *cmd_list_ptr_start = ce_array;
+	struct cmd_element *cmd_list_ptr = read_ce_array;
+	struct cmd_element *cmd_list_ptr_start = read_ce_array;
 	uint32_t num_cmd_desc = 0;
 	uint32_t num_data_desc = 0;
-	uint32_t status;
 	uint32_t i;
+	uint32_t pg;
 	int nand_ret = NANDC_RESULT_SUCCESS;
 	uint8_t flags = 0;
 	uint32_t *cmd_list_temp = NULL;
+	unsigned char *data;
 
 	/* UD bytes in last CW is 512 - cws_per_page *4.
 	 * Since each of the CW read earlier reads 4 spare bytes.
@@ -1364,157 +1519,186 @@ qpic_nand_read_page(uint32_t page, unsigned char* buffer, unsigned char* sparead
 	uint16_t ud_bytes_in_last_cw = USER_DATA_BYTES_PER_CW - ((flash.cws_per_page - 1) << 2);
 	uint16_t oob_bytes = DATA_BYTES_IN_IMG_PER_CW - ud_bytes_in_last_cw;
 
-	params.addr0 = page << 16;
-	params.addr1 = (page >> 16) & 0xff;
+	ASSERT(npages && npages <= read_batch_pages);
+
 	params.cfg0 = cfg0;
 	params.cfg1 = cfg1;
 	params.cmd = NAND_CMD_PAGE_READ_ALL;
 	params.exec = 1;
 	ecc = ecc_bch_cfg;
 
-	/* Read all the Data bytes in the first 3 CWs. */
-	addr_loc_0 = NAND_RD_LOC_OFFSET(0);
-	addr_loc_0 |= NAND_RD_LOC_SIZE(DATA_BYTES_IN_IMG_PER_CW);
-	addr_loc_0 |= NAND_RD_LOC_LAST_BIT(1);
-
-
 	addr_loc_1 = NAND_RD_LOC_OFFSET(ud_bytes_in_last_cw);
 	addr_loc_1 |= NAND_RD_LOC_SIZE(oob_bytes);
 	addr_loc_1 |= NAND_RD_LOC_LAST_BIT(1);
 
-	status = qpic_nand_block_isbad(page);
+	for (pg = 0; pg < npages; pg++)
+	{
+		params.addr0 = (page + pg) << 16;
+		params.addr1 = ((page + pg) >> 16) & 0xff;
+		data = buffer + pg * stride;
 
-	if (status)
-		return status;
+		/* Read all the Data bytes in the first 3 CWs. */
+		addr_loc_0 = NAND_RD_LOC_OFFSET(0);
+		addr_loc_0 |= NAND_RD_LOC_SIZE(DATA_BYTES_IN_IMG_PER_CW);
+		addr_loc_0 |= NAND_RD_LOC_LAST_BIT(1);
 
-	/* Reset and Configure erased CW/page detection controller */
-	qpic_nand_erased_status_reset(ce_array, BAM_DESC_LOCK_FLAG);
+		/* Reset and Configure erased CW/page detection controller
+		 * for this page. The BAM stays locked for the whole batch.
+		 */
+		cmd_list_ptr_start = cmd_list_ptr;
 
-	/* Queue up the command and data descriptors for all the codewords in a page
-	 * and do a single bam transfer at the end.*/
-	for (i = 0; i < flash.cws_per_page; i++)
-	{
-		num_cmd_desc = 0;
-		num_data_desc = 0;
+		bam_add_cmd_element(cmd_list_ptr, NAND_ERASED_CW_DETECT_CFG,
+							NAND_ERASED_CW_DETECT_CFG_RESET_CTRL, CE_WRITE_TYPE);
+		cmd_list_ptr++;
+		bam_add_cmd_element(cmd_list_ptr, NAND_ERASED_CW_DETECT_CFG,
+							NAND_ERASED_CW_DETECT_CFG_ACTIVATE_CTRL | NAND_ERASED_CW_DETECT_ERASED_CW_ECC_MASK,
+							CE_WRITE_TYPE);
+		cmd_list_ptr++;
 
-		if (i == 0)
-		{
-			cmd_list_ptr = qpic_nand_add_addr_n_cfg_ce(&params, cmd_list_ptr);
+		bam_add_one_desc(&bam,
+						 CMD_PIPE_INDEX,
+						 (unsigned char*)PA((addr_t)cmd_list_ptr_start),
+						 PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_ptr_start),
+						 BAM_DESC_CMD_FLAG | (pg == 0 ? BAM_DESC_LOCK_FLAG : 0));
+		bam_sys_gen_event(&bam, CMD_PIPE_INDEX, 1);
 
-			bam_add_cmd_element(cmd_list_ptr, NAND_DEV0_ECC_CFG,(uint32_t)ecc, CE_WRITE_TYPE);
-			cmd_list_ptr++;
-		}
-		else
+		/* Queue up the command and data descriptors for all the codewords
+		 * in a page, each page of the batch follows without waiting.
+		 */
+		for (i = 0; i < flash.cws_per_page; i++)
+		{
+			num_cmd_desc = 0;
+			num_data_desc = 0;
 			cmd_list_ptr_start = cmd_list_ptr;
 
-		bam_add_cmd_element(cmd_list_ptr, NAND_FLASH_CMD, (uint32_t)params.cmd, CE_WRITE_TYPE);
-		cmd_list_ptr++;
+			if (i == 0)
+			{
+				cmd_list_ptr = qpic_nand_add_addr_n_cfg_ce(&params, cmd_list_ptr);
 
-		if (i == flash.cws_per_page - 1)
-		{
-			addr_loc_0 = NAND_RD_LOC_OFFSET(0);
-			addr_loc_0 |= NAND_RD_LOC_SIZE(ud_bytes_in_last_cw);
-			addr_loc_0 |= NAND_RD_LOC_LAST_BIT(0);
+				bam_add_cmd_element(cmd_list_ptr, NAND_DEV0_ECC_CFG,(uint32_t)ecc, CE_WRITE_TYPE);
+				cmd_list_ptr++;
+			}
 
-			/* Write addr loc 1 only for the last CW. */
-			bam_add_cmd_element(cmd_list_ptr, NAND_READ_LOCATION_n(1), (uint32_t)addr_loc_1, CE_WRITE_TYPE);
+			bam_add_cmd_element(cmd_list_ptr, NAND_FLASH_CMD, (uint32_t)params.cmd, CE_WRITE_TYPE);
 			cmd_list_ptr++;
 
-			/* Add Data desc */
-			bam_add_one_desc(&bam,
-							 DATA_PRODUCER_PIPE_INDEX,
-							 (unsigned char *)PA((addr_t)buffer),
-							 (uint32_t)ud_bytes_in_last_cw,
-							 0);
-			num_data_desc++;
-
-			bam_add_one_desc(&bam,
-							 DATA_PRODUCER_PIPE_INDEX,
-							 (unsigned char *)PA((addr_t)spareaddr),
-							 (uint32_t)oob_bytes,
-							 BAM_DESC_INT_FLAG);
-			num_data_desc++;
+			if (i == flash.cws_per_page - 1)
+			{
+				addr_loc_0 = NAND_RD_LOC_OFFSET(0);
+				addr_loc_0 |= NAND_RD_LOC_SIZE(ud_bytes_in_last_cw);
+				addr_loc_0 |= NAND_RD_LOC_LAST_BIT(0);
+
+				/* Write addr loc 1 only for the last CW. */
+				bam_add_cmd_element(cmd_list_ptr, NAND_READ_LOCATION_n(1), (uint32_t)addr_loc_1, CE_WRITE_TYPE);
+				cmd_list_ptr++;
+
+				/* Add Data desc */
+				bam_add_one_desc(&bam,
+								 DATA_PRODUCER_PIPE_INDEX,
+								 (unsigned char *)PA((addr_t)data),
+								 (uint32_t)ud_bytes_in_last_cw,
+								 0);
+				num_data_desc++;
+
+				/* Interrupt only at the end of the batch. */
+				bam_add_one_desc(&bam,
+								 DATA_PRODUCER_PIPE_INDEX,
+								 (unsigned char *)PA((addr_t)(spareaddr + pg * spare_stride)),
+								 (uint32_t)oob_bytes,
+								 (pg == npages - 1) ? BAM_DESC_INT_FLAG : 0);
+				num_data_desc++;
+
+				bam_sys_gen_event(&bam, DATA_PRODUCER_PIPE_INDEX, num_data_desc);
+			}
+			else
+			{
+				/* Add Data desc */
+				bam_add_one_desc(&bam,
+								 DATA_PRODUCER_PIPE_INDEX,
+								 (unsigned char *)PA((addr_t)data),
+								 DATA_BYTES_IN_IMG_PER_CW,
+								 0);
+				num_data_desc++;
+				bam_sys_gen_event(&bam, DATA_PRODUCER_PIPE_INDEX, num_data_desc);
+			}
 
-			bam_sys_gen_event(&bam, DATA_PRODUCER_PIPE_INDEX, num_data_desc);
-		}
-		else
-		{
-			/* Add Data desc */
-			bam_add_one_desc(&bam,
-							 DATA_PRODUCER_PIPE_INDEX,
-							 (unsigned char *)PA((addr_t)buffer),
-							 DATA_BYTES_IN_IMG_PER_CW,
-							 0);
-			num_data_desc++;
-			bam_sys_gen_event(&bam, DATA_PRODUCER_PIPE_INDEX, num_data_desc);
-		}
+			/* Write addr loc 0. */
+			bam_add_cmd_element(cmd_list_ptr,
+								NAND_READ_LOCATION_n(0),
+								(uint32_t)addr_loc_0,
+								CE_WRITE_TYPE);
 
-		/* Write addr loc 0. */
-		bam_add_cmd_element(cmd_list_ptr,
-							NAND_READ_LOCATION_n(0),
-							(uint32_t)addr_loc_0,
-							CE_WRITE_TYPE);
+			cmd_list_ptr++;
+			bam_add_cmd_element(cmd_list_ptr,
+								NAND_EXEC_CMD,
+								(uint32_t)params.exec,
+								CE_WRITE_TYPE);
+			cmd_list_ptr++;
 
-		cmd_list_ptr++;
-		bam_add_cmd_element(cmd_list_ptr,
-							NAND_EXEC_CMD,
-							(uint32_t)params.exec,
-							CE_WRITE_TYPE);
-		cmd_list_ptr++;
+			/* Enqueue the desc for the above commands */
+			bam_add_one_desc(&bam,
+						 CMD_PIPE_INDEX,
+						 (unsigned char*)PA((addr_t)cmd_list_ptr_start),
+						 PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_ptr_start),
+						 BAM_DESC_NWD_FLAG | BAM_DESC_CMD_FLAG);
+			num_cmd_desc++;
 
-		/* Enqueue the desc for the above commands */
-		bam_add_one_desc(&bam,
-					 CMD_PIPE_INDEX,
-					 (unsigned char*)cmd_list_ptr_start,
-					 PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_ptr_start),
-					 BAM_DESC_NWD_FLAG | BAM_DESC_CMD_FLAG);
-		num_cmd_desc++;
+			bam_add_cmd_element(cmd_list_ptr, NAND_FLASH_STATUS, (uint32_t)PA((addr_t)&(read_flash_sts[pg][i])), CE_READ_TYPE);
 
-		bam_add_cmd_element(cmd_list_ptr, NAND_FLASH_STATUS, (uint32_t)PA((addr_t)&(flash_sts[i])), CE_READ_TYPE);
+			cmd_list_temp = (uint32_t*)cmd_list_ptr;
 
-		cmd_list_temp = (uint32_t*)cmd_list_ptr;
+			cmd_list_ptr++;
 
-		cmd_list_ptr++;
+			bam_add_cmd_element(cmd_list_ptr, NAND_BUFFER_STATUS, (uint32_t)PA((addr_t)&(read_buffer_sts[pg][i])), CE_READ_TYPE);
+			cmd_list_ptr++;
 
-		bam_add_cmd_element(cmd_list_ptr, NAND_BUFFER_STATUS, (uint32_t)PA((addr_t)&(buffer_sts[i])), CE_READ_TYPE);
-		cmd_list_ptr++;
+			if (i == flash.cws_per_page - 1)
+			{
+				/* Keep the erased CW status of this page for the status check. */
+				bam_add_cmd_element(cmd_list_ptr, NAND_ERASED_CW_DETECT_STATUS, (uint32_t)PA((addr_t)&(read_erased_sts[pg])), CE_READ_TYPE);
+				cmd_list_ptr++;
+			}
 
-		if (i == flash.cws_per_page - 1)
-		{
-			flags = BAM_DESC_CMD_FLAG | BAM_DESC_UNLOCK_FLAG;
-		}
-		else
-			flags = BAM_DESC_CMD_FLAG;
+			if ((i == flash.cws_per_page - 1) && (pg == npages - 1))
+			{
+				flags = BAM_DESC_CMD_FLAG | BAM_DESC_UNLOCK_FLAG;
+			}
+			else
+				flags = BAM_DESC_CMD_FLAG;
 
-		/* Enqueue the desc for the above command */
-		bam_add_one_desc(&bam,
-					CMD_PIPE_INDEX,
-					(unsigned char*)PA((addr_t)cmd_list_temp),
-					PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_temp),
-					flags);
-		num_cmd_desc++;
+			/* Enqueue the desc for the above command */
+			bam_add_one_desc(&bam,
+						CMD_PIPE_INDEX,
+						(unsigned char*)PA((addr_t)cmd_list_temp),
+						PA((uint32_t)cmd_list_ptr - (uint32_t)cmd_list_temp),
+						flags);
+			num_cmd_desc++;
 
-		buffer += DATA_BYTES_IN_IMG_PER_CW;
+			data += DATA_BYTES_IN_IMG_PER_CW;
 
-		/* Notify BAM HW about the newly added descriptors */
-		bam_sys_gen_event(&bam, CMD_PIPE_INDEX, num_cmd_desc);
+			/* Notify BAM HW about the newly added descriptors */
+			bam_sys_gen_event(&bam, CMD_PIPE_INDEX, num_cmd_desc);
+		}
 	}
 
 	qpic_nand_wait_for_data(DATA_PRODUCER_PIPE_INDEX);
 
 	/* Check status */
-	for (i = 0; i < flash.cws_per_page ; i ++)
+	for (pg = 0; pg < npages; pg++)
 	{
-		flash_sts[i] = qpic_nand_check_status(flash_sts[i]);
-		if (flash_sts[i])
+		for (i = 0; i < flash.cws_per_page ; i ++)
 		{
-			nand_ret = NANDC_RESULT_BAD_PAGE;
-			dprintf(CRITICAL, "NAND page read failed. page: %x status %x\n", page, flash_sts[i]);
-			goto qpic_nand_read_page_error;
+			if (qpic_nand_check_read_status(read_flash_sts[pg][i], read_erased_sts[pg]))
+			{
+				nand_ret = NANDC_RESULT_BAD_PAGE;
+				dprintf(CRITICAL, "NAND page read failed. page: %x status %x\n", page + pg, read_flash_sts[pg][i]);
+				goto qpic_nand_read_pages_error;
+			}
 		}
 	}
-qpic_nand_read_page_error:
-return nand_ret;
+qpic_nand_read_pages_error:
+	*nread = pg;
+	return nand_ret;
 }
 
 /* Function to read a flash partition.
@@ -1538,9 +1722,9 @@ flash_read_ext(struct ptentry *ptn,
 	uint32_t count =
 		(bytes + flash.page_size - 1 + extra_per_page) / (flash.page_size +
 									 extra_per_page);
-	uint32_t *spare = (unsigned *)flash_spare_bytes;
 	uint32_t errors = 0;
 	unsigned char *image = data;
+	unsigned char *spare;
 	int result = 0;
 	uint32_t current_block =
 	    (page - (page & flash.num_pages_per_blk_mask)) / flash.num_pages_per_blk;
@@ -1548,6 +1732,10 @@ flash_read_ext(struct ptentry *ptn,
 	uint32_t start_block_count = 0;
 	uint32_t isbad = 0;
 	uint32_t current_page;
+	uint32_t npages;
+	uint32_t nread;
+	uint32_t stride = flash.page_size + extra_per_page;
+	uint32_t i;
 
 	/* Verify first byte is at page boundary. */
 	if (offset & (flash.page_size - 1))
@@ -1584,40 +1772,59 @@ flash_read_ext(struct ptentry *ptn,
 			return NANDC_RESULT_SUCCESS;
 		}
 
-#if CONTIGUOUS_MEMORY
-		result = qpic_nand_read_page(page, image, (unsigned char *) spare);
-#else
-		result = qpic_nand_read_page(page, rdwr_buf, (unsigned char *) spare);
-#endif
-		if (result == NANDC_RESULT_BAD_PAGE)
-		{
-			/* bad page, go to next page. */
-			page++;
-			errors++;
-			continue;
-		}
-		else if (result == NANDC_RESULT_BAD_BLOCK)
+		result = qpic_nand_block_isbad(page);
+		if (result == NANDC_RESULT_BAD_BLOCK)
 		{
 			/* bad block, go to next block same offset. */
 			page += flash.num_pages_per_blk;
 			errors++;
 			continue;
 		}
+		else if (result)
+		{
+			dprintf(CRITICAL, "flash_read_image: bad block check failed @ page %d\n", page);
+			return NANDC_RESULT_FAILURE;
+		}
 
-#ifndef CONTIGUOUS_MEMORY
-		/* Copy the read page into correct location. */
-		memcpy(image, rdwr_buf, flash.page_size);
+		/* Read up to the end of the block in batches. */
+		npages = flash.num_pages_per_blk - (page & flash.num_pages_per_blk_mask);
+		npages = MIN(npages, count);
+		npages = MIN(npages, read_batch_pages);
+
+		/* The spare bytes go after the batch's pages in rdwr_buf. */
+		spare = rdwr_buf + read_batch_pages * flash.page_size;
+
+#if CONTIGUOUS_MEMORY
+		/* DMA straight into the image, leaving room for the spare bytes. */
+		result = qpic_nand_read_pages(page, npages, image, stride,
+									  spare, flash.spare_size, &nread);
+#else
+		result = qpic_nand_read_pages(page, npages, rdwr_buf, flash.page_size,
+									  spare, flash.spare_size, &nread);
 #endif
-		page++;
-		image += flash.page_size;
-		/* Copy spare bytes to image */
-		if(extra_per_page)
+
+		for (i = 0; i < nread; i++)
 		{
-			memcpy(image, spare, extra_per_page);
-			image += extra_per_page;
+#ifndef CONTIGUOUS_MEMORY
+			/* Copy the read page into correct location. */
+			memcpy(image, rdwr_buf + i * flash.page_size, flash.page_size);
+#endif
+			/* Copy spare bytes to image */
+			if (extra_per_page)
+				memcpy(image + flash.page_size, spare + i * flash.spare_size, extra_per_page);
+
+			image += stride;
 		}
 
-		count -= 1;
+		page += nread;
+		count -= nread;
+
+		if (result == NANDC_RESULT_BAD_PAGE)
+		{
+			/* bad page, go to next page. */
+			page++;
+			errors++;
+		}
 	}
 
 	/* could not find enough valid pages before we hit the end */
@@ -46,6 +46,24 @@ status_t platform_set_periodic_timer(platform_timer_callback callback,
 	return 0;
 }
 
+#if PLATFORM_HAS_DYNAMIC_TIMER
+status_t platform_set_oneshot_timer(platform_timer_callback callback,
+	void *arg, lk_time_t interval)
+{
+	enter_critical_section();
+
+	qtimer_set_oneshot_timer(interval, callback, arg);
+
+	exit_critical_section();
+	return 0;
+}
+
+void platform_stop_timer(void)
+{
+	qtimer_disable();
+}
+#endif
+
 lk_time_t current_time(void)
 {
 	return qtimer_current_time();
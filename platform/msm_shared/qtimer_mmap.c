@@ -42,11 +42,18 @@ static lk_time_t timer_interval;
 /* time in ms from start of LK. */
 static volatile uint32_t current_time;
 static uint32_t tick_count;
+static bool timer_oneshot;
 
 static void qtimer_enable(void);
 
 static enum handler_return qtimer_irq(void *arg)
 {
+	if (timer_oneshot)
+	{
+		qtimer_disable();
+		return timer_callback(timer_arg, qtimer_current_time());
+	}
+
 	current_time += timer_interval;
 
 	/* Program the down counter again to get
@@ -69,6 +76,7 @@ void qtimer_set_physical_timer(lk_time_t msecs_interval,
 	qtimer_disable();
 
 	/* Save the timer interval and call back data*/
+	timer_oneshot = false;
 	tick_count = msecs_interval * qtimer_tick_rate() / 1000;;
 	timer_interval = msecs_interval;
 	timer_arg = tmr_arg;
@@ -85,6 +93,38 @@ void qtimer_set_physical_timer(lk_time_t msecs_interval,
 	qtimer_enable();
 }
 
+#if PLATFORM_HAS_DYNAMIC_TIMER
+/* Programs the down counter once for the next timer deadline, the
+ * interrupt is not rearmed and time is read from the physical counter.
+ */
+void qtimer_set_oneshot_timer(lk_time_t msecs_interval,
+							  platform_timer_callback tmr_callback,
+							  void *tmr_arg)
+{
+	uint64_t ticks;
+
+	qtimer_disable();
+
+	ticks = (uint64_t) msecs_interval * qtimer_tick_rate() / 1000;
+	if (!ticks)
+		ticks = 1;
+	if (ticks > QTMR_TVAL_MAX_VALUE)
+		ticks = QTMR_TVAL_MAX_VALUE;
+
+	timer_oneshot = true;
+	timer_arg = tmr_arg;
+	timer_callback = tmr_callback;
+
+	writel((uint32_t) ticks, QTMR_V1_CNTP_TVAL);
+	dsb();
+
+	register_int_handler(INT_QTMR_FRM_0_PHYSICAL_TIMER_EXP, qtimer_irq, 0);
+
+	unmask_interrupt(INT_QTMR_FRM_0_PHYSICAL_TIMER_EXP);
+
+	qtimer_enable();
+}
+#endif
 
 /* Function to return the frequency of the timer */
 uint32_t qtimer_get_frequency(void)
@@ -144,5 +184,15 @@ inline __ALWAYS_INLINE uint64_t qtimer_get_phy_timer_cnt()
 
 uint32_t qtimer_current_time(void)
 {
+#if PLATFORM_HAS_DYNAMIC_TIMER
+	uint32_t ticks_per_msec = qtimer_tick_rate() / 1000;
+
+	/* There is no periodic tick to count, the counter is the clock,
+	 * whether or not a oneshot has been armed yet.
+	 */
+	if (ticks_per_msec)
+		return qtimer_get_phy_timer_cnt() / ticks_per_msec;
+#endif
+
 	return current_time;
 }
@@ -3,7 +3,10 @@ LOCAL_DIR := $(GET_LOCAL_DIR)
 MODULE := $(LOCAL_DIR)
 
 MODULE_DEPS += \
-	lib/openssl
+	lib/openssl \
+	lib/iovec \
+	lib/cksum \
+	lib/pool
 
 GLOBAL_INCLUDES += \
 	$(LOCAL_DIR) \
@@ -22,6 +25,12 @@ MODULE_SRCS += \
 	$(LOCAL_DIR)/hsusb.c \
 	$(LOCAL_DIR)/boot_stats.c
 
+ifeq ($(WITH_SMP),1)
+# secondary cpus through PSCI, ARMv8 parts only
+MODULE_SRCS += \
+	$(LOCAL_DIR)/mp.c
+endif
+
 ifeq ($(ENABLE_SMD_SUPPORT),1)
 MODULE_SRCS += \
 	$(LOCAL_DIR)/rpm-smd.c \
@@ -30,11 +39,16 @@ MODULE_SRCS += \
 endif
 
 ifeq ($(ENABLE_SDHCI_SUPPORT),1)
+# partitions are published as bio devices, see mmc_bio.c
+MODULE_DEPS += \
+	lib/bio
+
 MODULE_SRCS += \
 	$(LOCAL_DIR)/sdhci.c \
 	$(LOCAL_DIR)/sdhci_msm.c \
 	$(LOCAL_DIR)/mmc_sdhci.c \
-	$(LOCAL_DIR)/mmc_wrapper.c
+	$(LOCAL_DIR)/mmc_wrapper.c \
+	$(LOCAL_DIR)/mmc_bio.c
 else
 MODULE_SRCS += \
 	$(LOCAL_DIR)/mmc.c
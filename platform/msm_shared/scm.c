@@ -971,3 +971,11 @@ uint32_t scm_call2(scmcall_arg *arg, scmcall_ret *ret)
 
 	return 0;
 }
+
+/* PSCI 0.2 CPU_ON over the smc32 calling convention: start the cpu with
+ * the given MPIDR at entry, passing context_id in r0.
+ */
+int scm_psci_cpu_on(uint32_t mpidr, paddr_t entry, uint32_t context_id)
+{
+	return (int)scm_call_a32(PSCI_0_2_FN_CPU_ON, mpidr, entry, context_id, 0, 0, NULL);
+}
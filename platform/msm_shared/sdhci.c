@@ -578,86 +578,79 @@ err:
 }
 
 /*
- * Function: sdhci prep desc table
- * Arg     : Pointer data & length
- * Return  : Pointer to desc table
- * Flow:   : Prepare the adma table as per the sd spec v 3.0
+ * Function: sdhci add desc
+ * Arg     : Pointer to the next free descriptor, data & length
+ * Return  : Number of descriptors used for the data
+ * Flow:   : Split the data in descriptor lines of at most
+ *           SDHCI_ADMA_DESC_LINE_SZ bytes
  */
-static struct desc_entry *sdhci_prep_desc_table(void *data, uint32_t len)
+static uint32_t sdhci_add_desc(struct desc_entry *sg_list, uint8_t *data, uint32_t len)
 {
-	struct desc_entry *sg_list;
-	uint32_t sg_len = 0;
-	uint32_t remain = 0;
-	uint32_t i;
-	uint32_t table_len = 0;
-
-	if (len <= SDHCI_ADMA_DESC_LINE_SZ) {
-		/* Allocate only one descriptor */
-		sg_list = (struct desc_entry *) memalign(lcm(4, CACHE_LINE), ROUNDUP(sizeof(struct desc_entry), CACHE_LINE));
+	uint32_t i = 0;
+	uint32_t line;
 
-		if (!sg_list) {
-			dprintf(CRITICAL, "Error allocating memory\n");
-			ASSERT(0);
-		}
+	/*
+	 * Prepare sglist in the format:
+	 *  ___________________________________________________
+	 * |Transfer Len | Transfer ATTR | Data Address        |
+	 * | (16 bit)    | (16 bit)      | (32 bit)            |
+	 * |_____________|_______________|_____________________|
+	 */
+	while (len) {
+		line = MIN(len, SDHCI_ADMA_DESC_LINE_SZ);
 
-		sg_list[0].addr = (uint32_t)data;
-		sg_list[0].len = (len < SDHCI_ADMA_DESC_LINE_SZ) ? len : (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-		sg_list[0].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA
-							  | SDHCI_ADMA_TRANS_END;
+		sg_list[i].addr = (uint32_t)data;
+		/*
+		 * Length attribute is 16 bit value & max transfer size for one
+		 * descriptor line is 65536 bytes, As per SD Spec3.0 'len = 0'
+		 * implies 65536 bytes. Truncate the length to limit to 16 bit
+		 * range.
+		 */
+		sg_list[i].len = (line & 0xffff);
+		sg_list[i].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA;
 
-		sg_len = 1;
-		table_len = sizeof(struct desc_entry);
-	} else {
-		/* Calculate the number of entries in desc table */
-		sg_len = len / SDHCI_ADMA_DESC_LINE_SZ;
-		remain = len - (sg_len * SDHCI_ADMA_DESC_LINE_SZ);
+		data += line;
+		len -= line;
+		i++;
+	}
 
-		/* Allocate sg_len + 1 entries if there are remaining bytes at the end */
-		if (remain)
-			sg_len++;
+	return i;
+}
 
-		table_len = (sg_len * sizeof(struct desc_entry));
+/*
+ * Function: sdhci prep desc table
+ * Arg     : Host structure, data & length
+ * Return  : Pointer to desc table
+ * Flow:   : Prepare the adma table as per the sd spec v 3.0 in the
+ *           descriptor table preallocated for the host. Data is either
+ *           one buffer or the iovec of the command.
+ */
+static struct desc_entry *sdhci_prep_desc_table(struct sdhci_host *host,
+												struct mmc_data *data, uint32_t len)
+{
+	struct desc_entry *sg_list = host->adma_desc;
+	uint32_t sg_len = 0;
+	uint32_t seg_len;
+	uint32_t i;
 
-		sg_list = (struct desc_entry *) memalign(lcm(4, CACHE_LINE), ROUNDUP(table_len, CACHE_LINE));
+	if (data->iov_cnt) {
+		ASSERT(data->iov_cnt <= SDHCI_ADMA_MAX_SEGS);
 
-		if (!sg_list) {
-			dprintf(CRITICAL, "Error allocating memory\n");
-			ASSERT(0);
+		for (i = 0; i < data->iov_cnt && len; i++) {
+			seg_len = MIN(len, data->iov[i].iov_len);
+			sg_len += sdhci_add_desc(&sg_list[sg_len], data->iov[i].iov_base, seg_len);
+			len -= seg_len;
 		}
+	} else {
+		sg_len = sdhci_add_desc(sg_list, data->data_ptr, len);
+	}
 
-		memset((void *) sg_list, 0, table_len);
+	ASSERT(sg_len && sg_len <= SDHCI_ADMA_DESC_NUM);
 
-		/*
-		 * Prepare sglist in the format:
-		 *  ___________________________________________________
-		 * |Transfer Len | Transfer ATTR | Data Address        |
-		 * | (16 bit)    | (16 bit)      | (32 bit)            |
-		 * |_____________|_______________|_____________________|
-		 */
-		for (i = 0; i < (sg_len - 1); i++) {
-				sg_list[i].addr = (uint32_t)data;
-				/*
-				 * Length attribute is 16 bit value & max transfer size for one
-				 * descriptor line is 65536 bytes, As per SD Spec3.0 'len = 0'
-				 * implies 65536 bytes. Truncate the length to limit to 16 bit
-				 * range.
-				 */
-				sg_list[i].len = (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-				sg_list[i].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA;
-				data += SDHCI_ADMA_DESC_LINE_SZ;
-				len -= SDHCI_ADMA_DESC_LINE_SZ;
-			}
+	/* Mark the last entry of the table with End attribute */
+	sg_list[sg_len - 1].tran_att |= SDHCI_ADMA_TRANS_END;
 
-			/* Fill the last entry of the table with Valid & End
-			 * attributes
-			 */
-			sg_list[sg_len - 1].addr = (uint32_t)data;
-			sg_list[sg_len - 1].len = (len < SDHCI_ADMA_DESC_LINE_SZ) ? len : (SDHCI_ADMA_DESC_LINE_SZ & 0xffff);
-			sg_list[sg_len - 1].tran_att = SDHCI_ADMA_TRANS_VALID | SDHCI_ADMA_TRANS_DATA |
-										   SDHCI_ADMA_TRANS_END;
-		}
-
-	arch_clean_invalidate_cache_range((addr_t)sg_list, table_len);
+	arch_clean_invalidate_cache_range((addr_t)sg_list, sg_len * sizeof(struct desc_entry));
 
 	for (i = 0; i < sg_len; i++)
 	{
@@ -681,12 +674,10 @@ static struct desc_entry *sdhci_adma_transfer(struct sdhci_host *host,
 {
 	uint32_t num_blks = 0;
 	uint32_t sz;
-	void *data;
 	struct desc_entry *adma_addr;
 
 
 	num_blks = cmd->data.num_blocks;
-	data = cmd->data.data_ptr;
 
 	/*
 	 * Some commands send data on DAT lines which is less
@@ -702,7 +693,7 @@ static struct desc_entry *sdhci_adma_transfer(struct sdhci_host *host,
 		sz = num_blks * SDHCI_MMC_BLK_SZ;
 
 	/* Prepare adma descriptor table */
-	adma_addr = sdhci_prep_desc_table(data, sz);
+	adma_addr = sdhci_prep_desc_table(host, &cmd->data, sz);
 
 	/* Write adma address to adma register */
 	REG_WRITE32(host, (uint32_t) adma_addr, SDHCI_ADM_ADDR_REG);
@@ -722,29 +713,27 @@ static struct desc_entry *sdhci_adma_transfer(struct sdhci_host *host,
 }
 
 /*
- * Function: sdhci send command
+ * Function: sdhci start command
  * Arg     : Host structure & command stucture
  * Return  : 0 on Success, 1 on Failure
  * Flow:   : 1. Prepare the command register
  *           2. If data is present, prepare adma table
- *           3. Run the command
- *           4. Check for command results & take action
+ *           3. Run the command, without waiting for it to complete
  */
-uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
+uint32_t sdhci_start_command(struct sdhci_host *host, struct mmc_command *cmd)
 {
-	uint32_t ret = 0;
+	uint32_t i;
 	uint8_t retry = 0;
 	uint32_t resp_type = 0;
 	uint16_t trans_mode = 0;
 	uint16_t present_state;
 	uint32_t flags;
-	struct desc_entry *sg_list = NULL;
 
 	DBG("\n %s: START: cmd:%04d, arg:0x%08x, resp_type:0x%04x, data_present:%d\n",
 				__func__, cmd->cmd_index, cmd->argument, cmd->resp_type, cmd->data_present);
 
 	if (cmd->data_present)
-		ASSERT(cmd->data.data_ptr);
+		ASSERT(cmd->data.data_ptr || cmd->data.iov_cnt);
 
 	/*
 	 * Assert if the data buffer is not aligned to cache
@@ -756,7 +745,15 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	 * certain image formats like sparse image.
 	 */
 	if (cmd->trans_mode == SDHCI_READ_MODE)
-		ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.data_ptr));
+	{
+		if (cmd->data.iov_cnt)
+		{
+			for (i = 0; i < cmd->data.iov_cnt; i++)
+				ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.iov[i].iov_base));
+		}
+		else
+			ASSERT(IS_CACHE_LINE_ALIGNED(cmd->data.data_ptr));
+	}
 
 	do {
 		present_state = REG_READ32(host, SDHCI_PRESENT_STATE_REG);
@@ -834,7 +831,7 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 
 	/* Check if data needs to be processed */
 	if (cmd->data_present)
-		sg_list = sdhci_adma_transfer(host, cmd);
+		sdhci_adma_transfer(host, cmd);
 
 	/* Write the argument 1 */
 	REG_WRITE32(host, cmd->argument, SDHCI_ARGUMENT_REG);
@@ -874,27 +871,79 @@ uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
 	/* Write the command register */
 	REG_WRITE16(host, SDHCI_PREP_CMD(cmd->cmd_index, flags), SDHCI_CMD_REG);
 
+	return 0;
+}
+
+/*
+ * Function: sdhci command done
+ * Arg     : Host structure & command stucture
+ * Return  : true if the command started by sdhci_start_command has
+ *           completed or failed, false while it is still in progress
+ * Flow:   : Peek at the interrupt status without clearing it
+ */
+bool sdhci_command_done(struct sdhci_host *host, struct mmc_command *cmd)
+{
+	uint16_t int_status;
+
+	int_status = REG_READ16(host, SDHCI_NRML_INT_STS_REG);
+
+	if (int_status & SDHCI_ERR_INT_STAT_MASK)
+		return true;
+
+	if (cmd->data_present || cmd->resp_type == SDHCI_CMD_RESP_R1B)
+		return !!(int_status & SDHCI_INT_STS_TRANS_COMPLETE);
+
+	return !!(int_status & SDHCI_INT_STS_CMD_COMPLETE);
+}
+
+/*
+ * Function: sdhci finish command
+ * Arg     : Host structure & command stucture
+ * Return  : 0 on Success, 1 on Failure
+ * Flow:   : 1. Wait for the command started by sdhci_start_command
+ *           2. Check for command results & take action
+ */
+uint32_t sdhci_finish_command(struct sdhci_host *host, struct mmc_command *cmd)
+{
+	uint32_t ret = 0;
+	uint32_t i;
+
 	/* Command complete sequence */
 	if (sdhci_cmd_complete(host, cmd))
-	{
-		ret = 1;
-		goto err;
-	}
+		return 1;
 
 	/* Invalidate the cache only for read operations */
 	if (cmd->trans_mode == SDHCI_MMC_READ)
-		arch_invalidate_cache_range((addr_t)cmd->data.data_ptr, (cmd->data.num_blocks * SDHCI_MMC_BLK_SZ));
+	{
+		if (cmd->data.iov_cnt)
+		{
+			for (i = 0; i < cmd->data.iov_cnt; i++)
+				arch_invalidate_cache_range((addr_t)cmd->data.iov[i].iov_base, cmd->data.iov[i].iov_len);
+		}
+		else
+			arch_invalidate_cache_range((addr_t)cmd->data.data_ptr, (cmd->data.num_blocks * SDHCI_MMC_BLK_SZ));
+	}
 
 	DBG("\n %s: END: cmd:%04d, arg:0x%08x, resp:0x%08x 0x%08x 0x%08x 0x%08x\n",
 				__func__, cmd->cmd_index, cmd->argument, cmd->resp[0], cmd->resp[1], cmd->resp[2], cmd->resp[3]);
-err:
-	/* Free the scatter/gather list */
-	if (sg_list)
-		free(sg_list);
 
 	return ret;
 }
 
+/*
+ * Function: sdhci send command
+ * Arg     : Host structure & command stucture
+ * Return  : 0 on Success, 1 on Failure
+ * Flow:   : Start the command & wait for its completion
+ */
+uint32_t sdhci_send_command(struct sdhci_host *host, struct mmc_command *cmd)
+{
+	if (sdhci_start_command(host, cmd))
+		return 1;
+
+	return sdhci_finish_command(host, cmd);
+}
+
 /*
  * Function: sdhci init
  * Arg     : Host structure
@@ -912,6 +961,14 @@ void sdhci_init(struct sdhci_host *host)
 	uint32_t caps[2];
 	uint32_t version;
 
+	/*
+	 * Allocate the adma descriptor table once, large enough for the
+	 * biggest transfer, every command reuses it
+	 */
+	host->adma_desc = (struct desc_entry *) memalign(lcm(4, CACHE_LINE),
+							ROUNDUP(SDHCI_ADMA_DESC_NUM * sizeof(struct desc_entry), CACHE_LINE));
+	ASSERT(host->adma_desc);
+
 	/* Read the capabilities register & store the info */
 	caps[0] = REG_READ32(host, SDHCI_CAPS_REG1);
 	caps[1] = REG_READ32(host, SDHCI_CAPS_REG2);
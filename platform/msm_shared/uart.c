@@ -194,6 +194,19 @@ int uart_putc(int port, char c)
 	_uart_putc(0, c);
 }
 
+int uart_write(int port, const char *buf, size_t len)
+{
+	size_t i;
+
+	if (!uart_ready)
+		return -1;
+
+	for (i = 0; i < len; i++)
+		uart_putc(port, buf[i]);
+
+	return len;
+}
+
 int uart_getc(int port, bool wait)
 {
 	if (!uart_ready)
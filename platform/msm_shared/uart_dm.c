@@ -65,6 +65,10 @@ static int uart_init_flag = 0;
 
 #define NON_PRINTABLE_ASCII_CHAR      128
 
+/* Characters per uart_write batch: even if every one is a '\n' the 32
+ * words fit the TX FIFO */
+#define UART_DM_TX_BATCH              64
+
 static uint8_t pack_chars_into_words(uint8_t *buffer, uint8_t cnt, uint32_t *word)
 {
 	uint8_t num_chars_writtten = 0;
@@ -438,6 +442,31 @@ int uart_putc(int port, char c)
 	return 0;
 }
 
+/* Hand up to len characters to the TX FIFO if it is idle, returns how many
+ * were taken, 0 while the FIFO is still busy. A batch is kept small enough
+ * for the FIFO to hold it after '\n' expansion, so nothing spins on TXRDY
+ * and the caller can do something better than wait for the line.
+ */
+int uart_write(int port, const char *buf, size_t len)
+{
+	char batch[UART_DM_TX_BATCH];
+	uint32_t uart_base = port_lookup[port];
+
+	/* Don't do anything if UART is not initialized */
+	if (!uart_init_flag)
+		return -1;
+
+	if (!(readl(MSM_BOOT_UART_DM_SR(uart_base)) & MSM_BOOT_UART_DM_SR_TXEMT))
+		return 0;
+
+	/* the write path rewrites the buffer while expanding '\n' */
+	len = MIN(len, sizeof(batch));
+	memcpy(batch, buf, len);
+	msm_boot_uart_dm_write(uart_base, batch, len);
+
+	return len;
+}
+
 static int has_cbuf = 0;
 static int cbuf = 0;
 
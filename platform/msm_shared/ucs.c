@@ -34,29 +34,35 @@
 
 static int ucs_do_request_sense(struct ufs_dev *dev);
 
+static void ucs_fill_scsi_upiu(struct scsi_req_build_type *req, struct upiu_req_build_type *req_upiu,
+							   struct upiu_basic_hdr *resp_upiu)
+{
+	memset(req_upiu, 0 , sizeof(struct upiu_req_build_type));
+
+	req_upiu->cmd_set_type	    = UPIU_SCSI_CMD_SET;
+	req_upiu->trans_type	    = UPIU_TYPE_COMMAND;
+	req_upiu->data_buffer_addr  = req->data_buffer_addr;
+	req_upiu->expected_data_len = req->data_len;
+	req_upiu->data_seg_len	    = 0;
+	req_upiu->ehs_len		    = 0;
+	req_upiu->flags			    = req->flags;
+	req_upiu->lun			    = req->lun;
+	req_upiu->query_mgmt_func   = 0;
+	req_upiu->cdb			    = req->cdb;
+	req_upiu->cmd_type		    = UTRD_SCSCI_CMD;
+	req_upiu->dd			    = req->dd;
+	req_upiu->resp_ptr		    = resp_upiu;
+	req_upiu->resp_len		    = sizeof(*resp_upiu);
+	req_upiu->timeout_msecs	    = UTP_GENERIC_CMD_TIMEOUT;
+}
+
 int ucs_do_scsi_cmd(struct ufs_dev *dev, struct scsi_req_build_type *req)
 {
 	struct upiu_req_build_type req_upiu;
 	struct upiu_basic_hdr      resp_upiu;
 	int                        ret;
 
-	memset(&req_upiu, 0 , sizeof(struct upiu_req_build_type));
-
-	req_upiu.cmd_set_type	   = UPIU_SCSI_CMD_SET;
-	req_upiu.trans_type	       = UPIU_TYPE_COMMAND;
-	req_upiu.data_buffer_addr  = req->data_buffer_addr;
-	req_upiu.expected_data_len = req->data_len;
-	req_upiu.data_seg_len	   = 0;
-	req_upiu.ehs_len		   = 0;
-	req_upiu.flags			   = req->flags;
-	req_upiu.lun			   = req->lun;
-	req_upiu.query_mgmt_func   = 0;
-	req_upiu.cdb			   = req->cdb;
-	req_upiu.cmd_type		   = UTRD_SCSCI_CMD;
-	req_upiu.dd			       = req->dd;
-	req_upiu.resp_ptr		   = &resp_upiu;
-	req_upiu.resp_len		   = sizeof(resp_upiu);
-	req_upiu.timeout_msecs	   = UTP_GENERIC_CMD_TIMEOUT;
+	ucs_fill_scsi_upiu(req, &req_upiu, &resp_upiu);
 
 	if (utp_enqueue_upiu(dev, &req_upiu))
 	{
@@ -80,64 +86,128 @@ int ucs_do_scsi_cmd(struct ufs_dev *dev, struct scsi_req_build_type *req)
 	return UFS_SUCCESS;
 }
 
-int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+/* READ10/WRITE10 for LBAs that fit in 32 bits, READ16/WRITE16 beyond. */
+static void ucs_build_rdwr_cdb(uint8_t *cdb, bool write, uint64_t lba, uint32_t blks)
 {
-	STACKBUF_DMA_ALIGN(cdb, sizeof(struct scsi_rdwr_cdb));
-	struct scsi_req_build_type     req_upiu;
-	struct scsi_rdwr_cdb           *cdb_param;
+	struct scsi_rdwr_cdb   *cdb10 = (struct scsi_rdwr_cdb *) cdb;
+	struct scsi_rdwr16_cdb *cdb16 = (struct scsi_rdwr16_cdb *) cdb;
+
+	memset(cdb, 0, SCSI_CDB_PARAM_LEN);
+
+	if (lba + blks - 1 > SCSI_MAX_LBA_10)
+	{
+		cdb16->opcode    = write ? SCSI_CMD_WRITE16 : SCSI_CMD_READ16;
+		cdb16->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
+		cdb16->lba       = BE64(lba);
+		cdb16->trans_len = BE32(blks);
+	}
+	else
+	{
+		cdb10->opcode    = write ? SCSI_CMD_WRITE10 : SCSI_CMD_READ10;
+		cdb10->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
+		cdb10->lba       = BE32((uint32_t) lba);
+		cdb10->trans_len = BE16((uint16_t) blks);
+	}
+}
+
+/*
+ * Split the transfer in UCS_QUEUED_XFER_BLK_LEN block commands and keep up
+ * to UCS_QUEUE_DEPTH of them in flight in separate UTRD slots, refilling
+ * each slot as soon as its command completes, whatever the order.
+ */
+static int ucs_do_scsi_rdwr(struct ufs_dev *dev, struct scsi_rdwr_req *req, bool write)
+{
+	STACKBUF_DMA_ALIGN(cdb, SCSI_CDB_PARAM_LEN);
+	struct scsi_req_build_type     scsi_req;
+	struct upiu_req_build_type     req_upiu;
+	struct utp_queued_req          qreq[UCS_QUEUE_DEPTH];
+	uint32_t                       busy = 0;
 	uint32_t                       blks_remaining;
-	uint16_t                       blks_to_transfer;
-	uint64_t                       bytes_to_transfer;
-	uint32_t                       start_blk;
-	uint32_t                       buf;
+	uint32_t                       blks_to_transfer;
+	uint64_t                       start_blk;
+	addr_t                         buf;
+	bool                           chk_cond = false;
+	int                            ret = UFS_SUCCESS;
+	uint32_t                       i;
 
 	blks_remaining = req->num_blocks;
 	buf            = req->data_buffer_base;
 	start_blk      = req->start_lba;
 
-	cdb_param = (struct scsi_rdwr_cdb*) cdb;
-	while (blks_remaining)
+	memset(&scsi_req, 0, sizeof(struct scsi_req_build_type));
+	scsi_req.cdb   = (addr_t) cdb;
+	scsi_req.lun   = req->lun;
+	scsi_req.flags = write ? UPIU_FLAGS_WRITE : UPIU_FLAGS_READ;
+	scsi_req.dd    = write ? UTRD_SYSTEM_TO_TARGET : UTRD_TARGET_TO_SYSTEM;
+
+	while (blks_remaining || busy)
 	{
-		if (blks_remaining <= SCSI_MAX_DATA_TRANS_BLK_LEN)
+		/* Fill the free slots, stop submitting after an error. */
+		for (i = 0; i < UCS_QUEUE_DEPTH && blks_remaining && !ret; i++)
 		{
-			blks_to_transfer = blks_remaining;
-			blks_remaining   = 0;
-		}
-		else
-		{
-			blks_to_transfer = SCSI_MAX_DATA_TRANS_BLK_LEN;
-			blks_remaining  -= SCSI_MAX_DATA_TRANS_BLK_LEN;
-		}
+			if (busy & (1 << i))
+				continue;
 
-		bytes_to_transfer = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
+			blks_to_transfer = MIN(blks_remaining, UCS_QUEUED_XFER_BLK_LEN);
 
-		memset(cdb_param, 0, sizeof(struct scsi_rdwr_cdb));
-		cdb_param->opcode    = SCSI_CMD_READ10;
-		cdb_param->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
-		cdb_param->lba       = BE32(start_blk);
-		cdb_param->trans_len = BE16(blks_to_transfer);
+			/* The cdb is copied into the request upiu on submit. */
+			ucs_build_rdwr_cdb(cdb, write, start_blk, blks_to_transfer);
 
+			scsi_req.data_buffer_addr = buf;
+			scsi_req.data_len         = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
+			ucs_fill_scsi_upiu(&scsi_req, &req_upiu, NULL);
 
-		dsb();
-		arch_clean_invalidate_cache_range((addr_t) cdb_param, sizeof(struct scsi_rdwr_cdb));
+			if (utp_submit_upiu(dev, &req_upiu, &qreq[i]))
+			{
+				dprintf(CRITICAL, "ucs_do_scsi_rdwr: submit failed\n");
+				ret = -UFS_FAILURE;
+				break;
+			}
 
-		memset(&req_upiu, 0 , sizeof(struct scsi_req_build_type));
+			busy           |= 1 << i;
+			buf            += scsi_req.data_len;
+			start_blk      += blks_to_transfer;
+			blks_remaining -= blks_to_transfer;
+		}
 
-		req_upiu.cdb               = (addr_t) cdb_param;
-		req_upiu.data_buffer_addr  = buf;
-		req_upiu.data_len = bytes_to_transfer;
-		req_upiu.flags             = UPIU_FLAGS_READ;
-		req_upiu.lun               = req->lun;
-		req_upiu.dd                = UTRD_TARGET_TO_SYSTEM;
+		if (!busy)
+			break;
 
-		if (ucs_do_scsi_cmd(dev, &req_upiu))
+		/* Reap every completed slot. */
+		for (i = 0; i < UCS_QUEUE_DEPTH; i++)
 		{
-			dprintf(CRITICAL, "ucs_do_scsi_read: failed\n");
-			return -UFS_FAILURE;
+			if (!(busy & (1 << i)) || !utp_poll_queued(dev, qreq[i].door_bell_bit))
+				continue;
+
+			busy &= ~(1 << i);
+
+			if (utp_complete_upiu(dev, &qreq[i]))
+			{
+				ret = -UFS_FAILURE;
+			}
+			else if (qreq[i].resp_upiu.status != SCSI_STATUS_GOOD)
+			{
+				dprintf(CRITICAL, "ucs_do_scsi_rdwr failed status = %x\n", qreq[i].resp_upiu.status);
+				if (qreq[i].resp_upiu.status == SCSI_STATUS_CHK_COND)
+					chk_cond = true;
+				ret = -UFS_FAILURE;
+			}
 		}
+	}
+
+	/* Only once the queue is idle, sense uses the synchronous path. */
+	if (chk_cond && ucs_do_request_sense(dev))
+		dprintf(CRITICAL, "SCSI request sense failed.\n");
+
+	return ret;
+}
 
-		buf       += bytes_to_transfer;
-		start_blk += SCSI_MAX_DATA_TRANS_BLK_LEN;
+int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req)
+{
+	if (ucs_do_scsi_rdwr(dev, req, false))
+	{
+		dprintf(CRITICAL, "ucs_do_scsi_read: failed\n");
+		return -UFS_FAILURE;
 	}
 
 	return UFS_SUCCESS;
@@ -145,62 +215,10 @@ int ucs_do_scsi_read(struct ufs_dev *dev, struct scsi_rdwr_req *req)
 
 int ucs_do_scsi_write(struct ufs_dev *dev, struct scsi_rdwr_req *req)
 {
-	struct scsi_req_build_type     req_upiu;
-	STACKBUF_DMA_ALIGN(cdb, sizeof(struct scsi_rdwr_cdb));
-	struct scsi_rdwr_cdb           *cdb_param;
-	uint32_t                       blks_remaining;
-	uint16_t                       blks_to_transfer;
-	uint64_t                       bytes_to_transfer;
-	uint32_t                       start_blk;
-	uint32_t                       buf;
-
-	blks_remaining = req->num_blocks;
-	buf = req->data_buffer_base;
-	start_blk = req->start_lba;
-
-	cdb_param = (struct scsi_rdwr_cdb*) cdb;
-	while (blks_remaining)
+	if (ucs_do_scsi_rdwr(dev, req, true))
 	{
-		if (blks_remaining <= SCSI_MAX_DATA_TRANS_BLK_LEN)
-		{
-			blks_to_transfer = blks_remaining;
-			blks_remaining   = 0;
-		}
-		else
-		{
-			blks_to_transfer = SCSI_MAX_DATA_TRANS_BLK_LEN;
-			blks_remaining  -= SCSI_MAX_DATA_TRANS_BLK_LEN;
-		}
-
-		bytes_to_transfer = blks_to_transfer * UFS_DEFAULT_SECTORE_SIZE;
-
-		memset(cdb_param, 0, sizeof(struct scsi_rdwr_cdb));
-		cdb_param->opcode    = SCSI_CMD_WRITE10;
-		cdb_param->cdb1      = SCSI_READ_WRITE_10_CDB1(0, 0, 1, 0);
-		cdb_param->lba       = BE32(start_blk);
-		cdb_param->trans_len = BE16(blks_to_transfer);
-
-		/* Flush cdb to memory. */
-		dsb();
-		arch_clean_invalidate_cache_range((addr_t) cdb_param, sizeof(struct scsi_rdwr_cdb));
-
-		memset(&req_upiu, 0 , sizeof(struct scsi_req_build_type));
-
-		req_upiu.cdb               = (addr_t) cdb_param;
-		req_upiu.data_buffer_addr  = buf;
-		req_upiu.data_len          = bytes_to_transfer;
-		req_upiu.flags             = UPIU_FLAGS_WRITE;
-		req_upiu.lun               = req->lun;
-		req_upiu.dd                = UTRD_SYSTEM_TO_TARGET;
-
-		if (ucs_do_scsi_cmd(dev, &req_upiu))
-		{
-			dprintf(CRITICAL, "ucs_do_scsi_write: failed\n");
-			return -UFS_FAILURE;
-		}
-
-		buf       += bytes_to_transfer;
-		start_blk += SCSI_MAX_DATA_TRANS_BLK_LEN;
+		dprintf(CRITICAL, "ucs_do_scsi_write: failed\n");
+		return -UFS_FAILURE;
 	}
 
 	return UFS_SUCCESS;
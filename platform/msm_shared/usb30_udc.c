@@ -39,6 +39,7 @@
 #include <stdlib.h>
 #include <arch/defines.h>
 #include <dev/udc.h>
+#include <lib/pool.h>
 #include <platform/iomap.h>
 #include <usb30_dwc.h>
 #include <usb30_wrapper.h>
@@ -1144,11 +1145,14 @@ static void udc_descriptor_register(udc_t *udc, struct udc_descriptor *desc)
 }
 
 
+static pool_t udc_req_pool = POOL_INITIAL_VALUE(udc_req_pool, "udc_request",
+		sizeof(struct udc_request), 0, 0);
+
 struct udc_request *usb30_udc_request_alloc(void)
 {
 	struct udc_request *req;
 
-	req = malloc(sizeof(*req));
+	req = pool_alloc(&udc_req_pool);
 	ASSERT(req);
 
 	req->buf      = 0;
@@ -1161,7 +1165,7 @@ struct udc_request *usb30_udc_request_alloc(void)
 
 void usb30_udc_request_free(struct udc_request *req)
 {
-	free(req);
+	pool_free(&udc_req_pool, req);
 }
 
 void usb30_udc_endpoint_free(struct udc_endpoint *ept)
@@ -202,6 +202,7 @@ static struct utp_trans_req_desc* utp_get_desc_slot_addr(struct ufs_dev *dev, st
 	*door_bell_val = utp_get_door_bell_bit(UFS_UTRLDBR(dev->base), &dev->utrd_data.bitmap, &door_bell_slot);
 	if (!(*door_bell_val))
 	{
+		mutex_release(&(dev->utrd_data.bitmap_mutex));
 		goto utp_get_desc_slot_addr_err;
 	}
 
@@ -442,15 +443,18 @@ static void utp_fill_prdt_entries(struct upiu_req_build_type *upiu_data, struct
 
 }
 
-int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
+/* Allocate and fill the UTP command descriptor (request upiu, response
+ * space and PRDT) for a upiu, and the UTRD properties pointing at it.
+ */
+static struct upiu_gen_hdr *utp_build_cmd_desc(struct ufs_dev *dev,
+											   struct upiu_req_build_type *upiu_data,
+											   struct utp_utrd_req_build_type *utrd,
+											   uint32_t *cmd_desc_len)
 {
 	struct upiu_gen_hdr            *req_upiu;
-	struct utp_utrd_req_build_type utrd;
 	uint32_t                       num_prdt;
 	struct utp_prdt_entry          *prdt_entry;
-	int                            ret = UFS_SUCCESS;
 	uint32_t                       resp_len;
-	uint32_t                       cmd_desc_len;
 	struct utrd_cmd_desc           cmd_desc;
 
 	/* Round up resp_upiu_len to a DWORD boundary.
@@ -459,31 +463,31 @@ int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
 	resp_len = ROUNDUP(upiu_data->resp_data_len, 4) + UPIU_HDR_LEN;
 
 	if (utp_get_prdt_len(upiu_data->expected_data_len, &num_prdt))
-		return -UFS_FAILURE;
+		return NULL;
 
 	/* Calculate the length. */
-	cmd_desc_len = UPIU_HDR_LEN + resp_len + num_prdt * sizeof(struct utp_prdt_entry);
+	*cmd_desc_len = UPIU_HDR_LEN + resp_len + num_prdt * sizeof(struct utp_prdt_entry);
 
 	/* Allocate memory for UTP Command Descriptor. */
-	req_upiu = (struct upiu_gen_hdr*) memalign((size_t ) lcm(CACHE_LINE, UTP_CMD_DESC_BASE_ALIGNMENT_SIZE), ROUNDUP(cmd_desc_len, CACHE_LINE));
+	req_upiu = (struct upiu_gen_hdr*) memalign((size_t ) lcm(CACHE_LINE, UTP_CMD_DESC_BASE_ALIGNMENT_SIZE), ROUNDUP(*cmd_desc_len, CACHE_LINE));
 	if (!req_upiu)
 	{
 		dprintf(CRITICAL, "Unable to allocate request upiu\n");
-		return -UFS_FAILURE;
+		return NULL;
 	}
 
 	/* Fill req upiu. */
-	ret = utp_fill_req_upiu(dev, upiu_data, req_upiu);
-	if (ret)
+	if (utp_fill_req_upiu(dev, upiu_data, req_upiu))
 	{
-		goto utp_enqueue_upiu_err;
+		free(req_upiu);
+		return NULL;
 	}
 
 	/* Fill UTRD properties. */
 	cmd_desc.num_prdt      = num_prdt;
 	cmd_desc.req_upiu      = req_upiu;
 	cmd_desc.resp_upiu_len = resp_len;
-	utp_fill_utrd_properties(upiu_data, &utrd, &cmd_desc);
+	utp_fill_utrd_properties(upiu_data, utrd, &cmd_desc);
 
 	prdt_entry         = (struct utp_prdt_entry *) ((uint32_t) req_upiu + UPIU_HDR_LEN + resp_len);
 
@@ -493,7 +497,21 @@ int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
 
 	/* Flush req_upiu */
 	dsb();
-	arch_clean_invalidate_cache_range((addr_t) req_upiu, cmd_desc_len);
+	arch_clean_invalidate_cache_range((addr_t) req_upiu, *cmd_desc_len);
+
+	return req_upiu;
+}
+
+int utp_enqueue_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data)
+{
+	struct upiu_gen_hdr            *req_upiu;
+	struct utp_utrd_req_build_type utrd;
+	int                            ret = UFS_SUCCESS;
+	uint32_t                       cmd_desc_len;
+
+	req_upiu = utp_build_cmd_desc(dev, upiu_data, &utrd, &cmd_desc_len);
+	if (!req_upiu)
+		return -UFS_FAILURE;
 
 	/* Check the response. */
 	ret = utp_enqueue_utrd(dev, &utrd);
@@ -514,3 +532,91 @@ utp_enqueue_upiu_err:
 	free(req_upiu);
 	return ret;
 }
+
+/*
+ * Queued transfer requests: the command is put in a free UTRD slot and the
+ * door bell is rung without waiting, so several slots can be in flight.
+ * Completion is detected from the slot's door bell bit clearing, in any
+ * order. No synchronous command (utp_enqueue_upiu) may be issued while
+ * queued requests are outstanding since both look at UTRCS.
+ */
+int utp_submit_upiu(struct ufs_dev *dev, struct upiu_req_build_type *upiu_data, struct utp_queued_req *qreq)
+{
+	struct utp_utrd_req_build_type utrd;
+	struct utp_bitmap_access_type  bitmap_req;
+
+	qreq->req_upiu = utp_build_cmd_desc(dev, upiu_data, &utrd, &qreq->cmd_desc_len);
+	if (!qreq->req_upiu)
+		return -UFS_FAILURE;
+
+	qreq->desc = utp_get_desc_slot_addr(dev, &utrd, &qreq->door_bell_bit);
+	if (!qreq->desc)
+		goto utp_submit_upiu_err;
+
+	/* Check register UTRLRSR and make sure it is read 1 before continuing. */
+	if (!readl(UFS_UTRLRSR(dev->base)))
+	{
+		bitmap_req.bitmap        = &dev->utrd_data.bitmap;
+		bitmap_req.door_bell_bit = qreq->door_bell_bit;
+		bitmap_req.mutx          = &(dev->utrd_data.bitmap_mutex);
+		utp_remove_from_bitmap(&bitmap_req);
+		goto utp_submit_upiu_err;
+	}
+
+	utp_enqueue_utrd_fill_desc(qreq->desc, &utrd);
+
+	dsb();
+
+	utp_ring_door_bell(UFS_UTRLDBR(dev->base), qreq->door_bell_bit);
+
+	dsb();
+
+	return UFS_SUCCESS;
+
+utp_submit_upiu_err:
+	free(qreq->req_upiu);
+	qreq->req_upiu = NULL;
+	return -UFS_FAILURE;
+}
+
+/* Return the door bell bits of the given set that the host has processed. */
+uint32_t utp_poll_queued(struct ufs_dev *dev, uint32_t door_bell_bits)
+{
+	return door_bell_bits & ~readl(UFS_UTRLDBR(dev->base));
+}
+
+/* Collect the result of a processed queued request and free its slot. */
+int utp_complete_upiu(struct ufs_dev *dev, struct utp_queued_req *qreq)
+{
+	struct utp_bitmap_access_type bitmap_req;
+	int                           ret = UFS_SUCCESS;
+
+	/* Acknowledge, the next completion sets it again. */
+	writel(UFS_IS_UTRCS, UFS_IS(dev->base));
+
+	/* Force read UTRD from memory. */
+	dsb();
+	cache_clean_invalidate_unaligned_start_addr((addr_t) qreq->desc, sizeof(struct utp_trans_req_desc));
+
+	if (qreq->desc->overall_cmd_status != UTRD_OCS_SUCCESS)
+	{
+		dprintf(CRITICAL, "Queued command failed. ocs = %x\n", qreq->desc->overall_cmd_status);
+		ret = -UFS_FAILURE;
+	}
+
+	/* UPIU processed. Invalidate cache to update resp. */
+	arch_invalidate_cache_range((addr_t) qreq->req_upiu, qreq->cmd_desc_len);
+	memcpy(&qreq->resp_upiu, (void *) ((uint32_t)qreq->req_upiu + UPIU_HDR_LEN), sizeof(struct upiu_basic_hdr));
+
+	/* Signal slot as free. */
+	bitmap_req.bitmap        = &dev->utrd_data.bitmap;
+	bitmap_req.door_bell_bit = qreq->door_bell_bit;
+	bitmap_req.mutx          = &(dev->utrd_data.bitmap_mutex);
+	if (utp_remove_from_bitmap(&bitmap_req))
+		ret = -UFS_FAILURE;
+
+	free(qreq->req_upiu);
+	qreq->req_upiu = NULL;
+
+	return ret;
+}
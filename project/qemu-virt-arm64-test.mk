@@ -0,0 +1,17 @@
+# qemu-system-aarch64 -M virt -cpu cortex-a53 -smp 4 -nographic \
+#     -kernel build-qemu-virt-arm64-test/lk.elf
+
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+TARGET := qemu-virt-arm64
+
+MODULES += \
+	app/tests \
+	app/stringtests \
+	app/shell \
+	lib/debugcommands
+
+# qemu's psci runs in the hypervisor slot when there is no EL3 firmware
+WITH_SMP := 1
+SMP_MAX_CPUS := 4
+ARM64_PSCI_USE_HVC := 1
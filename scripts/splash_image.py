@@ -0,0 +1,312 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015, The Linux Foundation. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are
+# met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above
+#       copyright notice, this list of conditions and the following
+#       disclaimer in the documentation and/or other materials provided
+#       with the distribution.
+#     * Neither the name of The Linux Foundation nor the names of its
+#       contributors may be used to endorse or promote products derived
+#       from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT
+# ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS
+# BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+# CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+# SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+# BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+# OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN
+# IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+
+"""Build a splash partition image for aboot.
+
+The image is a 512 byte header (struct logo_img_header in
+include/dev/fbcon.h) followed by the pixels as RGB888, either raw or
+compressed:
+
+  rle   a count byte c, then (c & 0x7f) + 1 copies of one pixel when
+        bit 7 is set, or that many literal pixels when it is clear
+  lz4   one lz4 frame per band of rows, so the loader only needs a band
+        sized buffer while it decodes into the framebuffer
+
+A compressed payload that comes out no smaller than the raw pixels is
+written raw. Input is a binary PPM (P6), raw RGB888 with --size, or
+anything PIL can read if it is installed.
+
+  splash_image.py [-t raw|rle|lz4] [--bgr] [-s WxH] input splash.img
+"""
+
+import getopt
+import struct
+import sys
+
+LOGO_IMG_MAGIC = b"SPLASH!!"
+LOGO_IMG_VERSION = 1
+LOGO_IMG_TYPES = {"raw": 0, "rle": 1, "lz4": 2}
+LOGO_IMG_FLAG_BGR = 1 << 0
+HEADER_SIZE = 512
+
+LZ4_FRAME_MAGIC = 0x184D2204
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5
+LZ4_MATCH_LIMIT = 12
+LZ4_MAX_OFFSET = 65535
+
+#
+# Input
+#
+
+def read_ppm(data):
+    # P6, then width, height and maxval separated by whitespace/comments
+    fields = []
+    pos = 2
+    while len(fields) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b"#":
+            while data[pos:pos + 1] not in (b"\n", b""):
+                pos += 1
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        fields.append(int(data[start:pos]))
+    width, height, maxval = fields
+    if maxval != 255:
+        raise ValueError("only 8 bit PPM files are supported")
+    pos += 1
+    return width, height, data[pos:pos + width * height * 3]
+
+def read_image(path, size):
+    with open(path, "rb") as f:
+        data = f.read()
+    if size:
+        width, height = size
+        if len(data) < width * height * 3:
+            raise ValueError("%s is smaller than %dx%d RGB888" % (path, width, height))
+        return width, height, data[:width * height * 3]
+    if data[:2] == b"P6":
+        return read_ppm(data)
+    try:
+        from PIL import Image
+    except ImportError:
+        raise ValueError("%s: not a PPM, and PIL is not installed" % path)
+    img = Image.open(path).convert("RGB")
+    return img.size[0], img.size[1], img.tobytes()
+
+def swap_rgb(pixels):
+    out = bytearray(pixels)
+    out[0::3] = pixels[2::3]
+    out[2::3] = pixels[0::3]
+    return bytes(out)
+
+#
+# RLE24
+#
+
+def rle24(pixels):
+    out = bytearray()
+    n = len(pixels) // 3
+    i = 0
+    lit = 0     # start of the pending literal pixels
+    while i < n:
+        px = pixels[i * 3:i * 3 + 3]
+        run = 1
+        while i + run < n and run < 128 and pixels[(i + run) * 3:(i + run) * 3 + 3] == px:
+            run += 1
+        if run >= 2:
+            flush_literals(out, pixels, lit, i)
+            out.append(0x80 | (run - 1))
+            out += px
+            i += run
+            lit = i
+        else:
+            i += 1
+    flush_literals(out, pixels, lit, n)
+    return bytes(out)
+
+def flush_literals(out, pixels, start, end):
+    while start < end:
+        count = min(end - start, 128)
+        out.append(count - 1)
+        out += pixels[start * 3:(start + count) * 3]
+        start += count
+
+#
+# LZ4
+#
+
+def xxh32(data, seed=0):
+    p1, p2, p3, p4, p5 = 2654435761, 2246822519, 3266489917, 668265263, 374761393
+    mask = 0xffffffff
+    rotl = lambda x, r: ((x << r) | (x >> (32 - r))) & mask
+    n = len(data)
+    i = 0
+    if n >= 16:
+        v = [(seed + p1 + p2) & mask, (seed + p2) & mask, seed, (seed - p1) & mask]
+        while i + 16 <= n:
+            for k in range(4):
+                lane = struct.unpack_from("<I", data, i + k * 4)[0]
+                v[k] = (rotl((v[k] + lane * p2) & mask, 13) * p1) & mask
+            i += 16
+        h = (rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18)) & mask
+    else:
+        h = (seed + p5) & mask
+    h = (h + n) & mask
+    while i + 4 <= n:
+        h = (rotl((h + struct.unpack_from("<I", data, i)[0] * p3) & mask, 17) * p4) & mask
+        i += 4
+    while i < n:
+        h = (rotl((h + data[i] * p5) & mask, 11) * p1) & mask
+        i += 1
+    h ^= h >> 15
+    h = (h * p2) & mask
+    h ^= h >> 13
+    h = (h * p3) & mask
+    h ^= h >> 16
+    return h
+
+def lz4_length(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+def lz4_sequence(out, literals, match_len):
+    lit = len(literals)
+    token = min(lit, 15) << 4
+    if match_len is not None:
+        token |= min(match_len - LZ4_MIN_MATCH, 15)
+    out.append(token)
+    if lit >= 15:
+        lz4_length(out, lit - 15)
+    out += literals
+
+def lz4_block(data):
+    # greedy, one hash table slot per 4 byte prefix
+    out = bytearray()
+    n = len(data)
+    table = {}
+    anchor = 0
+    i = 0
+    limit = n - LZ4_MATCH_LIMIT
+    while i < limit:
+        key = data[i:i + 4]
+        ref = table.get(key)
+        table[key] = i
+        if ref is None or i - ref > LZ4_MAX_OFFSET:
+            i += 1
+            continue
+        length = 4
+        end = n - LZ4_LAST_LITERALS
+        while i + length < end and data[ref + length] == data[i + length]:
+            length += 1
+        lz4_sequence(out, data[anchor:i], length)
+        out += struct.pack("<H", i - ref)
+        if length - LZ4_MIN_MATCH >= 15:
+            lz4_length(out, length - LZ4_MIN_MATCH - 15)
+        i += length
+        anchor = i
+    lz4_sequence(out, data[anchor:], None)
+    return bytes(out)
+
+def lz4_frame(data):
+    # version 1, independent blocks, no checksums, 4MB max block size
+    desc = bytes([0x60, 0x70])
+    out = bytearray(struct.pack("<I", LZ4_FRAME_MAGIC))
+    out += desc
+    out.append((xxh32(desc) >> 8) & 0xff)
+    block = lz4_block(data)
+    if len(block) < len(data):
+        out += struct.pack("<I", len(block)) + block
+    else:
+        out += struct.pack("<I", len(data) | 0x80000000) + data
+    out += struct.pack("<I", 0)
+    return bytes(out)
+
+def lz4_bands(pixels, width, band_rows):
+    band = width * 3 * band_rows
+    return b"".join(lz4_frame(pixels[i:i + band]) for i in range(0, len(pixels), band))
+
+#
+# Output
+#
+
+def splash_image(pixels, width, height, kind, bgr, band_rows):
+    flags = LOGO_IMG_FLAG_BGR if bgr else 0
+    if bgr:
+        pixels = swap_rgb(pixels)
+
+    payload = pixels
+    if kind == "rle":
+        payload = rle24(pixels)
+    elif kind == "lz4":
+        payload = lz4_bands(pixels, width, band_rows)
+    if len(payload) >= len(pixels):
+        kind = "raw"
+        payload = pixels
+
+    header = struct.pack("<8s8I", LOGO_IMG_MAGIC, width, height, 0, LOGO_IMG_VERSION,
+                         LOGO_IMG_TYPES[kind], flags, len(payload),
+                         band_rows if kind == "lz4" else 0)
+    header += b"\0" * (HEADER_SIZE - len(header))
+
+    # the loaders read whole 512 byte blocks
+    pad = -len(payload) % 512
+    return kind, header + payload + b"\0" * pad
+
+def usage():
+    sys.stderr.write(__doc__)
+    sys.exit(1)
+
+def main(argv):
+    kind = "lz4"
+    bgr = False
+    size = None
+    band_rows = 16
+
+    try:
+        opts, args = getopt.getopt(argv, "t:s:b:h", ["type=", "size=", "band-rows=", "bgr", "help"])
+    except getopt.GetoptError as e:
+        sys.stderr.write("%s\n" % e)
+        usage()
+
+    for opt, val in opts:
+        if opt in ("-t", "--type"):
+            if val not in LOGO_IMG_TYPES:
+                usage()
+            kind = val
+        elif opt in ("-s", "--size"):
+            size = tuple(int(v) for v in val.lower().split("x"))
+        elif opt in ("-b", "--band-rows"):
+            band_rows = int(val)
+        elif opt == "--bgr":
+            bgr = True
+        else:
+            usage()
+
+    if len(args) != 2 or band_rows < 1:
+        usage()
+
+    width, height, pixels = read_image(args[0], size)
+    kind, image = splash_image(pixels, width, height, kind, bgr, band_rows)
+
+    with open(args[1], "wb") as f:
+        f.write(image)
+
+    raw = width * height * 3
+    print("%s: %dx%d %s, %d bytes (%.1f%% of raw)" %
+          (args[1], width, height, kind, len(image) - HEADER_SIZE,
+           100.0 * (len(image) - HEADER_SIZE) / raw))
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
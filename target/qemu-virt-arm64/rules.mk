@@ -0,0 +1,5 @@
+LOCAL_DIR := $(GET_LOCAL_DIR)
+
+# the foundation-emu platform, built for QEMU's virt machine
+PLATFORM := foundation-emu
+FOUNDATION_EMU_QEMU_VIRT := 1
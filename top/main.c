@@ -36,6 +36,7 @@
 #include <target.h>
 #include <lib/heap.h>
 #include <kernel/thread.h>
+#include <kernel/mp.h>
 #include <lk/init.h>
 #if WITH_PLATFORM_MSM_SHARED
 #include <boot_stats.h>
@@ -129,6 +130,29 @@ void lk_main(void)
 #endif
 }
 
+#if WITH_SMP
+/* called from arch code on each secondary cpu */
+void lk_secondary_cpu_entry(void)
+{
+	uint cpu = arch_curr_cpu_num();
+
+	// take the kernel lock before touching any thread state
+	inc_critical_section();
+
+	// get us into some sort of thread context
+	thread_secondary_cpu_init_early();
+
+	// per cpu interrupt controller state
+	platform_mp_init_percpu();
+
+	dprintf(SPEW, "cpu %u up\n", cpu);
+	atomic_or((volatile int *)&mp.active_cpus, 1U << cpu);
+
+	// become this cpu's idle thread and start scheduling
+	thread_become_idle();
+}
+#endif
+
 static int bootstrap2(void *arg)
 {
 	dprintf(SPEW, "top of bootstrap2()\n");
@@ -141,6 +165,9 @@ static int bootstrap2(void *arg)
 	lk_init_level(LK_INIT_LEVEL_PLATFORM - 1);
 	platform_init();
 
+	// bring up the other cpus, now that interrupts and ipis are set up
+	mp_start_secondary_cpus();
+
 	// initialize the target
 	dprintf(SPEW, "initializing target\n");
 	lk_init_level(LK_INIT_LEVEL_TARGET - 1);